@@ -46,12 +46,25 @@
 /**
  * SECTION:element-plugin
  *
- * FIXME:Describe plugin here.
+ * Applies a gain to S16, S32, F32 or F64 audio, interleaved or not.
+ *
+ * The gain kernel for the negotiated format and the function walking the
+ * buffer layout are picked once in setup(), buffers are processed without
+ * looking at the format again.
+ *
+ * With chunk-frames set, interleaved audio is collected in a #GstAdapter
+ * and leaves in buffers of exactly that many frames, whatever sizes come
+ * in. Their memory is 64 byte aligned and the gain is applied while the
+ * samples are copied out of the adapter, so block based processing never
+ * needs a remainder loop. The timestamps follow the input, a partial
+ * chunk is pushed on EOS, on caps changes and before a discontinuity,
+ * and dropped on flush. The chunk adds its length to the latency.
  *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
- * gst-launch -v -m audiotestsrc ! plugin ! autoaudiosink
+ * gst-launch -v -m audiotestsrc ! audiofiltertemplate gain=0.5 ! autoaudiosink
+ * gst-launch -v -m audiotestsrc ! audiofiltertemplate chunk-frames=256 ! autoaudiosink
  * ]|
  * </refsect2>
  */
@@ -63,7 +76,17 @@
 #include <gst/gst.h>
 #include <gst/audio/audio.h>
 #include <gst/audio/gstaudiofilter.h>
-#include <string.h>
+#include <gst/base/gstadapter.h>
+
+#include "gstaudiofilterkernels.h"
+#include "gstaudiolatency.h"
+#include "gstfirconvolver.h"
+#include "gstloudnessmeter.h"
+#include "gstpolyresample.h"
+#include "gstchannelmatrix.h"
+#include "gstlimiter.h"
+#include "gstsilencegap.h"
+#include "gstsimdmixer.h"
 
 GST_DEBUG_CATEGORY_STATIC (audiofiltertemplate_debug);
 #define GST_CAT_DEFAULT audiofiltertemplate_debug
@@ -72,12 +95,28 @@ GST_DEBUG_CATEGORY_STATIC (audiofiltertemplate_debug);
 G_DECLARE_FINAL_TYPE (GstAudioFilterTemplate, gst_audio_filter_template,
     GST, AUDIO_FILTER_TEMPLATE, GstAudioFilter);
 
+/* processes a whole buffer from inbuf into outbuf, which may be the same
+ * buffer. Picked in setup from the layout */
+typedef gboolean (*GstAudioFilterTemplateProcessFunc) (GstAudioFilterTemplate *
+    filter, GstBuffer * inbuf, GstBuffer * outbuf, gdouble gain);
+
 struct _GstAudioFilterTemplate
 {
   GstAudioFilter audiofilter;
 
-  /* here you can add additional per-instance
-   * data such as properties */
+  /* properties, protected by the object lock */
+  gdouble gain;
+  guint chunk_frames;
+
+  /* set up in setup() for the negotiated format */
+  GstAudioFilterTemplateGainFunc gain_func;
+  GstAudioFilterTemplateProcessFunc process;
+
+  /* rechunking, streaming thread */
+  GstAdapter *adapter;
+  gsize chunk_bytes;            /* 0 when buffers pass as they come */
+  gboolean discont;
+  gint latency;                 /* frames, atomic */
 };
 
 
@@ -89,16 +128,24 @@ enum
 
 enum
 {
-  ARG_0
-      /* FILL ME */
+  ARG_0,
+  ARG_GAIN,
+  ARG_CHUNK_FRAMES
 };
 
+#define DEFAULT_GAIN 1.0
+#define DEFAULT_CHUNK_FRAMES 0
+
+/* alignment of the chunks, a full cache line and enough for AVX-512 */
+#define CHUNK_ALIGN 64
+
 G_DEFINE_TYPE (GstAudioFilterTemplate, gst_audio_filter_template,
     GST_TYPE_AUDIO_FILTER);
 
 GST_ELEMENT_REGISTER_DEFINE (audiofiltertemplate, "audiofiltertemplate",
     GST_RANK_NONE, GST_TYPE_AUDIO_FILTER_TEMPLATE);
 
+static void gst_audio_filter_template_finalize (GObject * object);
 static void gst_audio_filter_template_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
 static void gst_audio_filter_template_get_property (GObject * object,
@@ -111,17 +158,31 @@ static GstFlowReturn gst_audio_filter_template_filter (GstBaseTransform *
 static GstFlowReturn
 gst_audio_filter_template_filter_inplace (GstBaseTransform *
     base_transform, GstBuffer * buf);
+static GstFlowReturn
+gst_audio_filter_template_prepare_output_buffer (GstBaseTransform *
+    base_transform, GstBuffer * inbuf, GstBuffer ** outbuf);
+static gboolean gst_audio_filter_template_stop (GstBaseTransform *
+    base_transform);
+static gboolean gst_audio_filter_template_sink_event (GstBaseTransform *
+    base_transform, GstEvent * event);
+static gboolean gst_audio_filter_template_query (GstBaseTransform *
+    base_transform, GstPadDirection direction, GstQuery * query);
+static GstFlowReturn
+gst_audio_filter_template_submit_input_buffer (GstBaseTransform *
+    base_transform, gboolean is_discont, GstBuffer * input);
+static GstFlowReturn
+gst_audio_filter_template_generate_output (GstBaseTransform *
+    base_transform, GstBuffer ** outbuf);
 
-#if 0
-/* This means we support signed 16-bit pcm and signed 32-bit pcm in native
- * endianness */
-#define SUPPORTED_CAPS_STRING \
-    GST_AUDIO_CAPS_MAKE("{ " GST_AUDIO_NE(S16) ", " GST_AUDIO_NE(S32) " }")
-#endif
-
-/* For simplicity only support 16-bit pcm in native endianness for starters */
+/* 16 and 32-bit pcm and 32 and 64-bit float in native endianness, with
+ * interleaved or planar layout */
 #define SUPPORTED_CAPS_STRING \
-    GST_AUDIO_CAPS_MAKE(GST_AUDIO_NE(S16))
+    "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (S16) ", " GST_AUDIO_NE (S32) ", " \
+        GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (F64) " }, " \
+    "rate = " GST_AUDIO_RATE_RANGE ", " \
+    "channels = " GST_AUDIO_CHANNELS_RANGE ", " \
+    "layout = (string) { interleaved, non-interleaved }"
 
 /* GObject vmethod implementations */
 static void
@@ -138,16 +199,24 @@ gst_audio_filter_template_class_init (GstAudioFilterTemplateClass * klass)
   btrans_class = (GstBaseTransformClass *) klass;
   audio_filter_class = (GstAudioFilterClass *) klass;
 
-#if 0
-  g_object_class_install_property (gobject_class, ARG_METHOD,
-      g_param_spec_enum ("method", "method", "method",
-          GST_TYPE_AUDIOTEMPLATE_METHOD, GST_AUDIOTEMPLATE_METHOD_1,
-          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
-#endif
-
+  gobject_class->finalize = gst_audio_filter_template_finalize;
   gobject_class->set_property = gst_audio_filter_template_set_property;
   gobject_class->get_property = gst_audio_filter_template_get_property;
 
+  g_object_class_install_property (gobject_class, ARG_GAIN,
+      g_param_spec_double ("gain", "Gain", "Linear gain applied to samples",
+          0.0, 10.0, DEFAULT_GAIN,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, ARG_CHUNK_FRAMES,
+      g_param_spec_uint ("chunk-frames", "Chunk frames",
+          "Output interleaved audio in buffers of exactly this many frames, "
+          "0 keeps the input buffer sizes", 0, G_MAXINT / 64,
+          DEFAULT_CHUNK_FRAMES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   /* this function will be called when the format is set before the
    * first buffer comes in, and whenever the format changes */
   audio_filter_class->setup = gst_audio_filter_template_setup;
@@ -156,6 +225,16 @@ gst_audio_filter_template_class_init (GstAudioFilterTemplateClass * klass)
    * one input buffer to another output buffer); only one is required */
   btrans_class->transform = gst_audio_filter_template_filter;
   btrans_class->transform_ip = gst_audio_filter_template_filter_inplace;
+  /* reuse writable input buffers even when the copying transform is used */
+  btrans_class->prepare_output_buffer =
+      gst_audio_filter_template_prepare_output_buffer;
+  /* rechunking collects the input and hands out whole chunks */
+  btrans_class->submit_input_buffer =
+      gst_audio_filter_template_submit_input_buffer;
+  btrans_class->generate_output = gst_audio_filter_template_generate_output;
+  btrans_class->stop = gst_audio_filter_template_stop;
+  btrans_class->sink_event = gst_audio_filter_template_sink_event;
+  btrans_class->query = gst_audio_filter_template_query;
   /* Set some basic metadata about your new element */
   gst_element_class_set_details_simple (element_class, "Audio Filter Template", /* FIXME: short name */
       "Filter/Effect/Audio", "Filters audio",   /* FIXME: short description */
@@ -172,6 +251,25 @@ gst_audio_filter_template_init (GstAudioFilterTemplate * filter)
   /* This function is called when a new filter object is created. You
    * would typically do things like initialise properties to their
    * default values here if needed. */
+  filter->gain = DEFAULT_GAIN;
+  filter->chunk_frames = DEFAULT_CHUNK_FRAMES;
+  filter->gain_func = NULL;
+  filter->process = NULL;
+
+  filter->adapter = gst_adapter_new ();
+  filter->chunk_bytes = 0;
+  filter->discont = FALSE;
+  filter->latency = 0;
+}
+
+static void
+gst_audio_filter_template_finalize (GObject * object)
+{
+  GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (object);
+
+  g_object_unref (filter->adapter);
+
+  G_OBJECT_CLASS (gst_audio_filter_template_parent_class)->finalize (object);
 }
 
 static void
@@ -182,6 +280,12 @@ gst_audio_filter_template_set_property (GObject * object, guint prop_id,
 
   GST_OBJECT_LOCK (filter);
   switch (prop_id) {
+    case ARG_GAIN:
+      filter->gain = g_value_get_double (value);
+      break;
+    case ARG_CHUNK_FRAMES:
+      filter->chunk_frames = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -197,6 +301,12 @@ gst_audio_filter_template_get_property (GObject * object, guint prop_id,
 
   GST_OBJECT_LOCK (filter);
   switch (prop_id) {
+    case ARG_GAIN:
+      g_value_set_double (value, filter->gain);
+      break;
+    case ARG_CHUNK_FRAMES:
+      g_value_set_uint (value, filter->chunk_frames);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -204,6 +314,80 @@ gst_audio_filter_template_get_property (GObject * object, guint prop_id,
   GST_OBJECT_UNLOCK (filter);
 }
 
+/* interleaved: one run over all samples of the buffer */
+static gboolean
+gst_audio_filter_template_process_interleaved (GstAudioFilterTemplate *
+    filter, GstBuffer * inbuf, GstBuffer * outbuf, gdouble gain)
+{
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (filter);
+  GstMapInfo map_in;
+  GstMapInfo map_out;
+
+  if (inbuf == outbuf) {
+    if (!gst_buffer_map (outbuf, &map_out, GST_MAP_READWRITE))
+      return FALSE;
+    filter->gain_func (map_out.data, map_out.data,
+        map_out.size / GST_AUDIO_INFO_BPS (info), gain);
+    gst_buffer_unmap (outbuf, &map_out);
+    return TRUE;
+  }
+
+  if (!gst_buffer_map (inbuf, &map_in, GST_MAP_READ))
+    return FALSE;
+  if (!gst_buffer_map (outbuf, &map_out, GST_MAP_WRITE)) {
+    gst_buffer_unmap (inbuf, &map_in);
+    return FALSE;
+  }
+
+  g_assert (map_out.size == map_in.size);
+  filter->gain_func (map_out.data, map_in.data,
+      map_in.size / GST_AUDIO_INFO_BPS (info), gain);
+
+  gst_buffer_unmap (outbuf, &map_out);
+  gst_buffer_unmap (inbuf, &map_in);
+  return TRUE;
+}
+
+/* non-interleaved: one run per channel plane, the planes are found through
+ * the GstAudioMeta of the buffers */
+static gboolean
+gst_audio_filter_template_process_planar (GstAudioFilterTemplate * filter,
+    GstBuffer * inbuf, GstBuffer * outbuf, gdouble gain)
+{
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (filter);
+  GstAudioBuffer abuf_in;
+  GstAudioBuffer abuf_out;
+  guint p;
+
+  if (inbuf == outbuf) {
+    if (!gst_audio_buffer_map (&abuf_out, info, outbuf, GST_MAP_READWRITE))
+      return FALSE;
+    for (p = 0; p < GST_AUDIO_BUFFER_N_PLANES (&abuf_out); p++)
+      filter->gain_func (GST_AUDIO_BUFFER_PLANE_DATA (&abuf_out, p),
+          GST_AUDIO_BUFFER_PLANE_DATA (&abuf_out, p),
+          GST_AUDIO_BUFFER_N_SAMPLES (&abuf_out), gain);
+    gst_audio_buffer_unmap (&abuf_out);
+    return TRUE;
+  }
+
+  if (!gst_audio_buffer_map (&abuf_in, info, inbuf, GST_MAP_READ))
+    return FALSE;
+  if (!gst_audio_buffer_map (&abuf_out, info, outbuf, GST_MAP_WRITE)) {
+    gst_audio_buffer_unmap (&abuf_in);
+    return FALSE;
+  }
+
+  for (p = 0; p < GST_AUDIO_BUFFER_N_PLANES (&abuf_out); p++)
+    filter->gain_func (GST_AUDIO_BUFFER_PLANE_DATA (&abuf_out, p),
+        GST_AUDIO_BUFFER_PLANE_DATA (&abuf_in, p),
+        MIN (GST_AUDIO_BUFFER_N_SAMPLES (&abuf_in),
+            GST_AUDIO_BUFFER_N_SAMPLES (&abuf_out)), gain);
+
+  gst_audio_buffer_unmap (&abuf_out);
+  gst_audio_buffer_unmap (&abuf_in);
+  return TRUE;
+}
+
 static gboolean
 gst_audio_filter_template_setup (GstAudioFilter * filter,
     const GstAudioInfo * info)
@@ -211,6 +395,7 @@ gst_audio_filter_template_setup (GstAudioFilter * filter,
   GstAudioFilterTemplate *filter_template;
   GstAudioFormat fmt;
   gint chans, rate;
+  guint chunk_frames;
 
   filter_template = GST_AUDIO_FILTER_TEMPLATE (filter);
 
@@ -221,7 +406,33 @@ gst_audio_filter_template_setup (GstAudioFilter * filter,
   GST_INFO_OBJECT (filter_template, "format %d (%s), rate %d, %d channels",
       fmt, GST_AUDIO_INFO_NAME (info), rate, chans);
 
-  /* if any setup needs to be done (like memory allocated), do it here */
+  /* pick the kernel and the layout walker here so that buffers are
+   * processed without switching on the format */
+  filter_template->gain_func = gst_audio_filter_template_gain_func (fmt);
+  if (filter_template->gain_func == NULL) {
+    GST_ERROR_OBJECT (filter_template, "unsupported format %s",
+        GST_AUDIO_INFO_NAME (info));
+    return FALSE;
+  }
+
+  if (GST_AUDIO_INFO_LAYOUT (info) == GST_AUDIO_LAYOUT_INTERLEAVED)
+    filter_template->process = gst_audio_filter_template_process_interleaved;
+  else
+    filter_template->process = gst_audio_filter_template_process_planar;
+
+  /* planar chunks would need every plane rechunked on its own */
+  GST_OBJECT_LOCK (filter_template);
+  chunk_frames = filter_template->chunk_frames;
+  GST_OBJECT_UNLOCK (filter_template);
+  if (chunk_frames > 0
+      && GST_AUDIO_INFO_LAYOUT (info) != GST_AUDIO_LAYOUT_INTERLEAVED) {
+    GST_WARNING_OBJECT (filter_template, "no rechunking of planar audio");
+    chunk_frames = 0;
+  }
+  filter_template->chunk_bytes = (gsize) chunk_frames *
+      GST_AUDIO_INFO_BPF (info);
+
+  gst_audio_latency_update (filter, &filter_template->latency, chunk_frames);
 
   /* The audio filter base class also saves the audio info in
    * GST_AUDIO_FILTER_INFO(filter) so it's automatically available
@@ -236,26 +447,41 @@ gst_audio_filter_template_setup (GstAudioFilter * filter,
  * audiofilter to use the optimal function in every situation,
  * with a minimum of memory copies. */
 
+/* take over the input buffer when nobody else holds a reference to it, so
+ * the data is processed in place instead of into a newly allocated buffer.
+ * Shared buffers go through the default allocation and the copying
+ * transform, which reads the input once and writes the output once */
+static GstFlowReturn
+gst_audio_filter_template_prepare_output_buffer (GstBaseTransform *
+    base_transform, GstBuffer * inbuf, GstBuffer ** outbuf)
+{
+  if (!gst_base_transform_is_passthrough (base_transform)
+      && gst_buffer_is_writable (inbuf)) {
+    GST_LOG_OBJECT (base_transform, "processing writable input in place");
+    *outbuf = inbuf;
+    return GST_FLOW_OK;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (gst_audio_filter_template_parent_class)->
+      prepare_output_buffer (base_transform, inbuf, outbuf);
+}
+
 static GstFlowReturn
 gst_audio_filter_template_filter (GstBaseTransform * base_transform,
     GstBuffer * inbuf, GstBuffer * outbuf)
 {
   GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (base_transform);
-  GstMapInfo map_in;
-  GstMapInfo map_out;
+  gdouble gain;
 
   GST_LOG_OBJECT (filter, "transform buffer");
 
-  /* FIXME: do something interesting here.  We simply copy the input data
-   * to the output buffer for now. */
-  if (gst_buffer_map (inbuf, &map_in, GST_MAP_READ)) {
-    if (gst_buffer_map (outbuf, &map_out, GST_MAP_WRITE)) {
-      g_assert (map_out.size == map_in.size);
-      memcpy (map_out.data, map_in.data, map_out.size);
-      gst_buffer_unmap (outbuf, &map_out);
-    }
-    gst_buffer_unmap (inbuf, &map_in);
-  }
+  GST_OBJECT_LOCK (filter);
+  gain = filter->gain;
+  GST_OBJECT_UNLOCK (filter);
+
+  /* inbuf is outbuf when prepare_output_buffer reused the input */
+  if (!filter->process (filter, inbuf, outbuf, gain))
+    return GST_FLOW_ERROR;
 
   return GST_FLOW_OK;
 }
@@ -266,39 +492,205 @@ gst_audio_filter_template_filter_inplace (GstBaseTransform * base_transform,
 {
   GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (base_transform);
   GstFlowReturn flow = GST_FLOW_OK;
-  GstMapInfo map;
+  gdouble gain;
 
   GST_LOG_OBJECT (filter, "transform buffer in place");
 
-  /* FIXME: do something interesting here.  Doing nothing means the input
-   * buffer is simply pushed out as is without any modification */
-  if (gst_buffer_map (buf, &map, GST_MAP_READWRITE)) {
-#if 0
-    switch (GST_AUDIO_FILTER_FORMAT (filter)) {
-      case GST_AUDIO_FORMAT_S16LE:
-      case GST_AUDIO_FORMAT_S16BE:{
-        gint16 *samples = map.data;
-        guint n_samples = map.size / sizeof (gint16);
-        guint i;
-
-        for (i = 0; i < n; ++n) {
-          samples[i] = samples[i];
-        }
-        break;
-      }
-      default:
-        g_warning ("Unexpected audio format %s!",
-            GST_AUDIO_INFO_NAME (GST_AUDIO_FILTER_INFO (filter)));
-        flow = GST_FLOW_ERROR;
-        break;
-    }
-#endif
-    gst_buffer_unmap (buf, &map);
-  }
+  GST_OBJECT_LOCK (filter);
+  gain = filter->gain;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (!filter->process (filter, buf, buf, gain))
+    flow = GST_FLOW_ERROR;
 
   return flow;
 }
 
+/* Copies size bytes out of the adapter into a new aligned buffer, applying
+ * the gain on the way. Every contiguous piece of the adapter is read in
+ * place, only a sample split between two input buffers gets merged */
+static GstFlowReturn
+gst_audio_filter_template_take_chunk (GstAudioFilterTemplate * filter,
+    gsize size, GstBuffer ** outbuf)
+{
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (filter);
+  gint rate = GST_AUDIO_INFO_RATE (info);
+  guint bpf = GST_AUDIO_INFO_BPF (info);
+  guint bps = GST_AUDIO_INFO_BPS (info);
+  GstAllocationParams params;
+  GstClockTime pts;
+  guint64 distance;
+  GstBuffer *buf;
+  GstMapInfo map;
+  gdouble gain;
+  gsize done = 0;
+
+  GST_OBJECT_LOCK (filter);
+  gain = filter->gain;
+  GST_OBJECT_UNLOCK (filter);
+
+  /* timestamp of the last input buffer that started before the chunk,
+   * advanced by the frames already taken from it */
+  pts = gst_adapter_prev_pts (filter->adapter, &distance);
+  if (GST_CLOCK_TIME_IS_VALID (pts))
+    pts += gst_util_uint64_scale_int (distance / bpf, GST_SECOND, rate);
+
+  gst_allocation_params_init (&params);
+  params.align = CHUNK_ALIGN - 1;
+  buf = gst_buffer_new_allocate (NULL, size, &params);
+  if (buf == NULL || !gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    GST_ELEMENT_ERROR (filter, RESOURCE, FAILED, (NULL),
+        ("could not allocate a chunk of %" G_GSIZE_FORMAT " bytes", size));
+    if (buf)
+      gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+
+  while (done < size) {
+    gsize n = MIN (gst_adapter_available_fast (filter->adapter), size - done);
+    const guint8 *src;
+
+    n -= n % bps;
+    if (n == 0)
+      n = bps;
+    src = gst_adapter_map (filter->adapter, n);
+    filter->gain_func (map.data + done, src, n / bps, gain);
+    gst_adapter_unmap (filter->adapter);
+    gst_adapter_flush (filter->adapter, n);
+    done += n;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  GST_BUFFER_PTS (buf) = pts;
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (size / bpf,
+      GST_SECOND, rate);
+  if (filter->discont) {
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+    filter->discont = FALSE;
+  }
+
+  *outbuf = buf;
+  return GST_FLOW_OK;
+}
+
+/* push the whole frames left in the adapter as a short chunk */
+static GstFlowReturn
+gst_audio_filter_template_drain (GstAudioFilterTemplate * filter)
+{
+  guint bpf = GST_AUDIO_INFO_BPF (GST_AUDIO_FILTER_INFO (filter));
+  gsize avail = gst_adapter_available (filter->adapter);
+  GstBuffer *buf;
+  GstFlowReturn ret;
+
+  if (filter->chunk_bytes == 0 || avail < bpf) {
+    gst_adapter_clear (filter->adapter);
+    return GST_FLOW_OK;
+  }
+
+  GST_DEBUG_OBJECT (filter, "draining %" G_GSIZE_FORMAT " frames",
+      avail / bpf);
+  ret = gst_audio_filter_template_take_chunk (filter, avail - avail % bpf,
+      &buf);
+  gst_adapter_clear (filter->adapter);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  return gst_audio_latency_push_tail (GST_AUDIO_FILTER (filter), buf);
+}
+
+static GstFlowReturn
+gst_audio_filter_template_submit_input_buffer (GstBaseTransform *
+    base_transform, gboolean is_discont, GstBuffer * input)
+{
+  GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (base_transform);
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (filter->chunk_bytes == 0)
+    return GST_BASE_TRANSFORM_CLASS (gst_audio_filter_template_parent_class)->
+        submit_input_buffer (base_transform, is_discont, input);
+
+  /* a chunk never spans a discontinuity */
+  if (is_discont) {
+    ret = gst_audio_filter_template_drain (filter);
+    filter->discont = TRUE;
+  }
+
+  gst_adapter_push (filter->adapter, input);
+  return ret;
+}
+
+/* called until it returns no buffer, one chunk per call */
+static GstFlowReturn
+gst_audio_filter_template_generate_output (GstBaseTransform *
+    base_transform, GstBuffer ** outbuf)
+{
+  GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (base_transform);
+
+  if (filter->chunk_bytes == 0)
+    return GST_BASE_TRANSFORM_CLASS (gst_audio_filter_template_parent_class)->
+        generate_output (base_transform, outbuf);
+
+  *outbuf = NULL;
+  if (gst_adapter_available (filter->adapter) < filter->chunk_bytes)
+    return GST_FLOW_OK;
+
+  return gst_audio_filter_template_take_chunk (filter, filter->chunk_bytes,
+      outbuf);
+}
+
+static gboolean
+gst_audio_filter_template_stop (GstBaseTransform * base_transform)
+{
+  GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (base_transform);
+
+  gst_adapter_clear (filter->adapter);
+  filter->chunk_bytes = 0;
+  filter->discont = FALSE;
+  g_atomic_int_set (&filter->latency, 0);
+  return TRUE;
+}
+
+static gboolean
+gst_audio_filter_template_sink_event (GstBaseTransform * base_transform,
+    GstEvent * event)
+{
+  GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (base_transform);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+    case GST_EVENT_CAPS:
+      /* the tail still has the old format when the caps change */
+      gst_audio_filter_template_drain (filter);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_adapter_clear (filter->adapter);
+      filter->discont = TRUE;
+      break;
+    default:
+      break;
+  }
+
+  return
+      GST_BASE_TRANSFORM_CLASS (gst_audio_filter_template_parent_class)->
+      sink_event (base_transform, event);
+}
+
+/* a frame waits up to a whole chunk before it leaves */
+static gboolean
+gst_audio_filter_template_query (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstAudioFilterTemplate *filter = GST_AUDIO_FILTER_TEMPLATE (base_transform);
+
+  if (!GST_BASE_TRANSFORM_CLASS (gst_audio_filter_template_parent_class)->
+      query (base_transform, direction, query))
+    return FALSE;
+
+  gst_audio_latency_query (GST_AUDIO_FILTER (filter), &filter->latency,
+      direction, query);
+  return TRUE;
+}
+
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
@@ -308,7 +700,23 @@ plugin_init (GstPlugin * plugin)
       "Audio filter template example");
 
   /* This is the name used in gst-launch-1.0 and gst_element_factory_make() */
-  return GST_ELEMENT_REGISTER (audiofiltertemplate, plugin);
+  if (!GST_ELEMENT_REGISTER (audiofiltertemplate, plugin))
+    return FALSE;
+
+  /* elements built on the same audio filter plumbing */
+  if (!GST_ELEMENT_REGISTER (fir_convolver, plugin))
+    return FALSE;
+  if (!GST_ELEMENT_REGISTER (loudness_meter, plugin))
+    return FALSE;
+  if (!GST_ELEMENT_REGISTER (poly_resample, plugin))
+    return FALSE;
+  if (!GST_ELEMENT_REGISTER (channel_matrix, plugin))
+    return FALSE;
+  if (!GST_ELEMENT_REGISTER (limiter, plugin))
+    return FALSE;
+  if (!GST_ELEMENT_REGISTER (silence_gap, plugin))
+    return FALSE;
+  return GST_ELEMENT_REGISTER (simd_mixer, plugin);
 }
 
 /* gstreamer looks for this structure to register plugins
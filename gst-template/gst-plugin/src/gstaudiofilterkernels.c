@@ -0,0 +1,239 @@
+/* GStreamer audio filter example kernels
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Gain kernels of the audio filter example, one per sample format. The
+ * element picks one in setup() and calls it for every plane, so the
+ * processing loop never switches on the format. Every kernel reads its
+ * input and writes its output in the same pass, so the copying transform
+ * touches each byte once instead of copying first and processing after.
+ * The SSE2 variants are used when the compiler targets SSE2 (always on
+ * x86-64), otherwise the scalar loops are used. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstaudiofilterkernels.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* round half away from zero, the SSE2 conversions round half to even so
+ * the two may differ by one at exact halves */
+#define ROUND_TO_INT(x) ((x) >= 0 ? (gint64) ((x) + 0.5) : (gint64) ((x) - 0.5))
+
+static void
+gain_s16_scalar (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gint16 *d = dest;
+  const gint16 *s = src;
+  gfloat g = (gfloat) gain;
+  guint i;
+
+  for (i = 0; i < n_samples; i++) {
+    gint64 v = ROUND_TO_INT (s[i] * g);
+
+    d[i] = CLAMP (v, G_MININT16, G_MAXINT16);
+  }
+}
+
+static void
+gain_s32_scalar (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gint32 *d = dest;
+  const gint32 *s = src;
+  guint i;
+
+  for (i = 0; i < n_samples; i++) {
+    gdouble v = CLAMP (s[i] * gain, (gdouble) G_MININT32, (gdouble) G_MAXINT32);
+
+    d[i] = ROUND_TO_INT (v);
+  }
+}
+
+static void
+gain_f32_scalar (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gfloat *d = dest;
+  const gfloat *s = src;
+  gfloat g = (gfloat) gain;
+  guint i;
+
+  for (i = 0; i < n_samples; i++)
+    d[i] = s[i] * g;
+}
+
+static void
+gain_f64_scalar (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gdouble *d = dest;
+  const gdouble *s = src;
+  guint i;
+
+  for (i = 0; i < n_samples; i++)
+    d[i] = s[i] * gain;
+}
+
+#ifdef __SSE2__
+
+/* 8 samples: widen to 32 bit, multiply as float, pack with saturation */
+static void
+gain_s16_sse2 (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gint16 *d = dest;
+  const gint16 *s = src;
+  __m128 g = _mm_set1_ps ((gfloat) gain);
+  guint i = 0;
+
+  for (; i + 8 <= n_samples; i += 8) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (s + i));
+    __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+    __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+
+    lo = _mm_cvtps_epi32 (_mm_mul_ps (_mm_cvtepi32_ps (lo), g));
+    hi = _mm_cvtps_epi32 (_mm_mul_ps (_mm_cvtepi32_ps (hi), g));
+    _mm_storeu_si128 ((__m128i *) (d + i), _mm_packs_epi32 (lo, hi));
+  }
+  gain_s16_scalar (d + i, s + i, n_samples - i, gain);
+}
+
+/* 4 samples: multiply as double for full precision, clamp, narrow */
+static void
+gain_s32_sse2 (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gint32 *d = dest;
+  const gint32 *s = src;
+  __m128d g = _mm_set1_pd (gain);
+  __m128d lo_limit = _mm_set1_pd ((gdouble) G_MININT32);
+  __m128d hi_limit = _mm_set1_pd ((gdouble) G_MAXINT32);
+  guint i = 0;
+
+  for (; i + 4 <= n_samples; i += 4) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (s + i));
+    __m128d a = _mm_cvtepi32_pd (v);
+    __m128d b = _mm_cvtepi32_pd (_mm_shuffle_epi32 (v, _MM_SHUFFLE (1, 0, 3,
+                2)));
+
+    a = _mm_min_pd (_mm_max_pd (_mm_mul_pd (a, g), lo_limit), hi_limit);
+    b = _mm_min_pd (_mm_max_pd (_mm_mul_pd (b, g), lo_limit), hi_limit);
+    _mm_storeu_si128 ((__m128i *) (d + i),
+        _mm_unpacklo_epi64 (_mm_cvtpd_epi32 (a), _mm_cvtpd_epi32 (b)));
+  }
+  gain_s32_scalar (d + i, s + i, n_samples - i, gain);
+}
+
+static void
+gain_f32_sse2 (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gfloat *d = dest;
+  const gfloat *s = src;
+  __m128 g = _mm_set1_ps ((gfloat) gain);
+  guint i = 0;
+
+  for (; i + 4 <= n_samples; i += 4)
+    _mm_storeu_ps (d + i, _mm_mul_ps (_mm_loadu_ps (s + i), g));
+  gain_f32_scalar (d + i, s + i, n_samples - i, gain);
+}
+
+static void
+gain_f64_sse2 (gpointer dest, gconstpointer src, guint n_samples,
+    gdouble gain)
+{
+  gdouble *d = dest;
+  const gdouble *s = src;
+  __m128d g = _mm_set1_pd (gain);
+  guint i = 0;
+
+  for (; i + 2 <= n_samples; i += 2)
+    _mm_storeu_pd (d + i, _mm_mul_pd (_mm_loadu_pd (s + i), g));
+  gain_f64_scalar (d + i, s + i, n_samples - i, gain);
+}
+
+#endif /* __SSE2__ */
+
+GstAudioFilterTemplateGainFunc
+gst_audio_filter_template_gain_func_scalar (GstAudioFormat format)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return gain_s16_scalar;
+    case GST_AUDIO_FORMAT_S32:
+      return gain_s32_scalar;
+    case GST_AUDIO_FORMAT_F32:
+      return gain_f32_scalar;
+    case GST_AUDIO_FORMAT_F64:
+      return gain_f64_scalar;
+    default:
+      return NULL;
+  }
+}
+
+/* the fastest kernel for a native endian format, NULL if unsupported */
+GstAudioFilterTemplateGainFunc
+gst_audio_filter_template_gain_func (GstAudioFormat format)
+{
+#ifdef __SSE2__
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return gain_s16_sse2;
+    case GST_AUDIO_FORMAT_S32:
+      return gain_s32_sse2;
+    case GST_AUDIO_FORMAT_F32:
+      return gain_f32_sse2;
+    case GST_AUDIO_FORMAT_F64:
+      return gain_f64_sse2;
+    default:
+      return NULL;
+  }
+#else
+  return gst_audio_filter_template_gain_func_scalar (format);
+#endif
+}
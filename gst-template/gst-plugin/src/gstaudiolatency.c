@@ -0,0 +1,154 @@
+/* GStreamer audio filter example latency helpers
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/* The elements of the audio filter example that hold samples back (a
+ * block, a lookahead, a filter delay or a chunk) all report that delay in
+ * the same way: the frame count is kept as an atomic int, changes post a
+ * latency message, and the LATENCY query adds it at the input rate. On
+ * EOS the held back samples are pushed as one last buffer.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gst/base/gstbasetransform.h>
+
+#include "gstaudiolatency.h"
+
+void
+gst_audio_latency_update (GstAudioFilter * filter, gint * latency,
+    guint frames)
+{
+  if (g_atomic_int_get (latency) == (gint) frames)
+    return;
+
+  g_atomic_int_set (latency, (gint) frames);
+  gst_element_post_message (GST_ELEMENT (filter),
+      gst_message_new_latency (GST_OBJECT (filter)));
+}
+
+void
+gst_audio_latency_query (GstAudioFilter * filter, const gint * latency,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstClockTime min, max, delay;
+  gboolean live;
+  gint rate, frames;
+
+  if (direction != GST_PAD_SRC || GST_QUERY_TYPE (query) != GST_QUERY_LATENCY)
+    return;
+
+  rate = GST_AUDIO_INFO_RATE (GST_AUDIO_FILTER_INFO (filter));
+  frames = g_atomic_int_get ((gint *) latency);
+  if (rate <= 0 || frames == 0)
+    return;
+
+  gst_query_parse_latency (query, &live, &min, &max);
+  delay = gst_util_uint64_scale_int (frames, GST_SECOND, rate);
+  min += delay;
+  if (GST_CLOCK_TIME_IS_VALID (max))
+    max += delay;
+  gst_query_set_latency (query, live, min, max);
+
+  GST_DEBUG_OBJECT (filter, "reporting latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (min));
+}
+
+void
+gst_audio_latency_track (GstClockTime * next_ts, GstBuffer * buf)
+{
+  if (!GST_BUFFER_PTS_IS_VALID (buf))
+    return;
+
+  *next_ts = GST_BUFFER_PTS (buf);
+  if (GST_BUFFER_DURATION_IS_VALID (buf))
+    *next_ts += GST_BUFFER_DURATION (buf);
+}
+
+GstFlowReturn
+gst_audio_latency_push_tail (GstAudioFilter * filter, GstBuffer * buf)
+{
+  GstFlowReturn ret;
+
+  GST_DEBUG_OBJECT (filter, "draining %" G_GSIZE_FORMAT " bytes at %"
+      GST_TIME_FORMAT, gst_buffer_get_size (buf),
+      GST_TIME_ARGS (GST_BUFFER_PTS (buf)));
+
+  ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (filter), buf);
+  if (ret != GST_FLOW_OK)
+    GST_DEBUG_OBJECT (filter, "pushing the tail returned %s",
+        gst_flow_get_name (ret));
+  return ret;
+}
+
+GstFlowReturn
+gst_audio_latency_drain (GstAudioFilter * filter, guint frames,
+    GstClockTime pts, GstAudioLatencyProcessFunc process)
+{
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (filter);
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  if (frames == 0)
+    return GST_FLOW_OK;
+
+  buf = gst_buffer_new_allocate (NULL, frames * GST_AUDIO_INFO_BPF (info),
+      NULL);
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+  memset (map.data, 0, map.size);
+  process (filter, (gfloat *) map.data, frames);
+  gst_buffer_unmap (buf, &map);
+
+  GST_BUFFER_PTS (buf) = pts;
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (frames, GST_SECOND,
+      GST_AUDIO_INFO_RATE (info));
+
+  return gst_audio_latency_push_tail (filter, buf);
+}
@@ -0,0 +1,81 @@
+/* GStreamer audio filter example latency helpers
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_AUDIO_LATENCY_H__
+#define __GST_AUDIO_LATENCY_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/audio/gstaudiofilter.h>
+
+G_BEGIN_DECLS
+
+/* fills frames of interleaved F32 in place, for draining the tail */
+typedef void (*GstAudioLatencyProcessFunc) (GstAudioFilter * filter,
+    gfloat * data, guint frames);
+
+/* store the frames the element holds back, posting a latency message when
+ * they change. latency is read by the LATENCY query from any thread */
+void gst_audio_latency_update (GstAudioFilter * filter, gint * latency,
+    guint frames);
+
+/* add latency frames at the input rate to a LATENCY query answered by the
+ * parent class on the src pad, leaves every other query alone */
+void gst_audio_latency_query (GstAudioFilter * filter, const gint * latency,
+    GstPadDirection direction, GstQuery * query);
+
+/* remember where the last buffer ended, the drained tail starts there */
+void gst_audio_latency_track (GstClockTime * next_ts, GstBuffer * buf);
+
+/* push a tail drained on EOS. Timestamps already on buf are kept */
+GstFlowReturn gst_audio_latency_push_tail (GstAudioFilter * filter,
+    GstBuffer * buf);
+
+/* feed frames of silence through process and push the result stamped at
+ * pts, for filters that drain by flushing their delay line */
+GstFlowReturn gst_audio_latency_drain (GstAudioFilter * filter, guint frames,
+    GstClockTime pts, GstAudioLatencyProcessFunc process);
+
+G_END_DECLS
+
+#endif /* __GST_AUDIO_LATENCY_H__ */
@@ -0,0 +1,435 @@
+/* GStreamer channel matrix mixer
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/**
+ * SECTION:element-channelmatrix
+ *
+ * Mixes F32 audio from one channel layout into another, e.g. 7.1 or 5.1
+ * down to stereo. Each output channel is a weighted sum of the input
+ * channels with the gains of the matrix property, one row per output
+ * channel. Without a matrix the channel counts are negotiated freely and
+ * a standard ITU-R BS.775 style matrix is derived from the channel
+ * positions.
+ *
+ * A matrix that only reorders channels is applied as a copy without any
+ * arithmetic, and an identity matrix switches the element to passthrough.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -v audiotestsrc ! audio/x-raw,channels=6 ! audioconvert ! channelmatrix ! audio/x-raw,channels=2 ! autoaudiosink
+ * gst-launch -v audiotestsrc ! audio/x-raw,channels=2 ! audioconvert ! channelmatrix matrix="<<(float)0.5,(float)0.5>>" ! autoaudiosink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstchannelmatrix.h"
+
+GST_DEBUG_CATEGORY_STATIC (channel_matrix_debug);
+#define GST_CAT_DEFAULT channel_matrix_debug
+
+enum
+{
+  PROP_0,
+  PROP_MATRIX
+};
+
+#define MAX_CHANNELS 64
+
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE (GST_AUDIO_NE (F32)) ", layout = (string) interleaved"
+
+G_DEFINE_TYPE (GstChannelMatrix, gst_channel_matrix, GST_TYPE_AUDIO_FILTER);
+
+GST_ELEMENT_REGISTER_DEFINE (channel_matrix, "channelmatrix", GST_RANK_NONE,
+    GST_TYPE_CHANNEL_MATRIX);
+
+static void gst_channel_matrix_finalize (GObject * object);
+static void gst_channel_matrix_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_channel_matrix_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static GstCaps *gst_channel_matrix_transform_caps (GstBaseTransform *
+    base_transform, GstPadDirection direction, GstCaps * caps,
+    GstCaps * filter);
+static GstCaps *gst_channel_matrix_fixate_caps (GstBaseTransform *
+    base_transform, GstPadDirection direction, GstCaps * caps,
+    GstCaps * othercaps);
+static gboolean gst_channel_matrix_transform_size (GstBaseTransform *
+    base_transform, GstPadDirection direction, GstCaps * caps, gsize size,
+    GstCaps * othercaps, gsize * othersize);
+static gboolean gst_channel_matrix_set_caps (GstBaseTransform *
+    base_transform, GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_channel_matrix_stop (GstBaseTransform * base_transform);
+static GstFlowReturn gst_channel_matrix_transform (GstBaseTransform *
+    base_transform, GstBuffer * inbuf, GstBuffer * outbuf);
+
+static void
+gst_channel_matrix_class_init (GstChannelMatrixClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstBaseTransformClass *btrans_class = (GstBaseTransformClass *) klass;
+  GstAudioFilterClass *audio_filter_class = (GstAudioFilterClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (channel_matrix_debug, "channelmatrix", 0,
+      "Channel matrix mixer");
+
+  gobject_class->finalize = gst_channel_matrix_finalize;
+  gobject_class->set_property = gst_channel_matrix_set_property;
+  gobject_class->get_property = gst_channel_matrix_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_MATRIX,
+      gst_param_spec_array ("matrix", "Matrix",
+          "Gain of every input channel (columns) in every output channel "
+          "(rows), empty for the standard matrix of the negotiated layouts",
+          gst_param_spec_array ("row", "Row", "Gains of one output channel",
+              g_param_spec_float ("gain", "Gain", "Gain of one input channel",
+                  -G_MAXFLOAT, G_MAXFLOAT, 0.0,
+                  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+              G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  btrans_class->transform_caps =
+      GST_DEBUG_FUNCPTR (gst_channel_matrix_transform_caps);
+  btrans_class->fixate_caps =
+      GST_DEBUG_FUNCPTR (gst_channel_matrix_fixate_caps);
+  btrans_class->transform_size =
+      GST_DEBUG_FUNCPTR (gst_channel_matrix_transform_size);
+  btrans_class->set_caps = GST_DEBUG_FUNCPTR (gst_channel_matrix_set_caps);
+  btrans_class->stop = GST_DEBUG_FUNCPTR (gst_channel_matrix_stop);
+  btrans_class->transform = GST_DEBUG_FUNCPTR (gst_channel_matrix_transform);
+
+  gst_element_class_set_details_simple (element_class, "Channel matrix",
+      "Filter/Converter/Audio",
+      "Mixes audio channels into another layout with a gain matrix",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  caps = gst_caps_from_string (SUPPORTED_CAPS_STRING);
+  gst_audio_filter_class_add_pad_templates (audio_filter_class, caps);
+  gst_caps_unref (caps);
+}
+
+static void
+gst_channel_matrix_init (GstChannelMatrix * cm)
+{
+  cm->matrix = NULL;
+  cm->rows = 0;
+  cm->columns = 0;
+
+  cm->mix = NULL;
+  gst_audio_info_init (&cm->out_info);
+}
+
+static void
+gst_channel_matrix_finalize (GObject * object)
+{
+  GstChannelMatrix *cm = GST_CHANNEL_MATRIX (object);
+
+  gst_channel_mix_free (cm->mix);
+  g_free (cm->matrix);
+
+  G_OBJECT_CLASS (gst_channel_matrix_parent_class)->finalize (object);
+}
+
+static void
+gst_channel_matrix_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstChannelMatrix *cm = GST_CHANNEL_MATRIX (object);
+
+  switch (prop_id) {
+    case PROP_MATRIX:{
+      guint rows = gst_value_array_get_size (value), columns = 0, o, i;
+      gfloat *matrix = NULL;
+
+      if (rows > 0) {
+        columns = gst_value_array_get_size (gst_value_array_get_value (value,
+                0));
+        if (columns == 0 || rows > MAX_CHANNELS || columns > MAX_CHANNELS) {
+          g_warning ("channelmatrix: matrix must be 1x1 to %ux%u",
+              MAX_CHANNELS, MAX_CHANNELS);
+          return;
+        }
+
+        matrix = g_new (gfloat, rows * columns);
+        for (o = 0; o < rows; o++) {
+          const GValue *row = gst_value_array_get_value (value, o);
+
+          if (gst_value_array_get_size (row) != columns) {
+            g_warning ("channelmatrix: all rows need %u gains", columns);
+            g_free (matrix);
+            return;
+          }
+          for (i = 0; i < columns; i++)
+            matrix[o * columns + i] =
+                g_value_get_float (gst_value_array_get_value (row, i));
+        }
+      }
+
+      GST_OBJECT_LOCK (cm);
+      g_free (cm->matrix);
+      cm->matrix = matrix;
+      cm->rows = rows;
+      cm->columns = columns;
+      GST_OBJECT_UNLOCK (cm);
+
+      gst_base_transform_reconfigure_src (GST_BASE_TRANSFORM (cm));
+      break;
+    }
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_channel_matrix_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstChannelMatrix *cm = GST_CHANNEL_MATRIX (object);
+
+  GST_OBJECT_LOCK (cm);
+  switch (prop_id) {
+    case PROP_MATRIX:{
+      GValue row = G_VALUE_INIT, v = G_VALUE_INIT;
+      guint o, i;
+
+      g_value_init (&v, G_TYPE_FLOAT);
+      for (o = 0; o < cm->rows; o++) {
+        g_value_init (&row, GST_TYPE_ARRAY);
+        for (i = 0; i < cm->columns; i++) {
+          g_value_set_float (&v, cm->matrix[o * cm->columns + i]);
+          gst_value_array_append_value (&row, &v);
+        }
+        gst_value_array_append_and_take_value (value, &row);
+      }
+      g_value_unset (&v);
+      break;
+    }
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (cm);
+}
+
+/* the matrix fixes the channel count on each side, without one any count
+ * is possible but keeping the input layout comes first */
+static GstCaps *
+gst_channel_matrix_transform_caps (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter)
+{
+  GstChannelMatrix *cm = GST_CHANNEL_MATRIX (base_transform);
+  GstCaps *res;
+  guint channels, i;
+
+  GST_OBJECT_LOCK (cm);
+  channels = direction == GST_PAD_SINK ? cm->rows : cm->columns;
+  GST_OBJECT_UNLOCK (cm);
+
+  res = channels ? gst_caps_new_empty () : gst_caps_copy (caps);
+  for (i = 0; i < gst_caps_get_size (caps); i++) {
+    GstStructure *s = gst_structure_copy (gst_caps_get_structure (caps, i));
+
+    if (channels)
+      gst_structure_set (s, "channels", G_TYPE_INT, channels, NULL);
+    else
+      gst_structure_set (s, "channels", GST_TYPE_INT_RANGE, 1, MAX_CHANNELS,
+          NULL);
+    gst_structure_remove_field (s, "channel-mask");
+    res = gst_caps_merge_structure (res, s);
+  }
+
+  if (filter) {
+    GstCaps *tmp = gst_caps_intersect_full (filter, res,
+        GST_CAPS_INTERSECT_FIRST);
+
+    gst_caps_unref (res);
+    res = tmp;
+  }
+
+  return res;
+}
+
+/* same channels and mask as the other side if possible, otherwise the
+ * default layout for the channel count */
+static GstCaps *
+gst_channel_matrix_fixate_caps (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstCaps * caps, GstCaps * othercaps)
+{
+  GstStructure *s = gst_caps_get_structure (caps, 0), *os;
+  gint channels, out_channels;
+  guint64 mask;
+
+  othercaps = gst_caps_make_writable (gst_caps_truncate (othercaps));
+  os = gst_caps_get_structure (othercaps, 0);
+
+  if (!gst_structure_get_int (s, "channels", &channels))
+    return gst_caps_fixate (othercaps);
+
+  gst_structure_fixate_field_nearest_int (os, "channels", channels);
+  gst_structure_get_int (os, "channels", &out_channels);
+
+  if (out_channels > 1 && !gst_structure_has_field (os, "channel-mask")) {
+    if (out_channels != channels ||
+        !gst_structure_get (s, "channel-mask", GST_TYPE_BITMASK, &mask, NULL))
+      mask = gst_audio_channel_get_fallback_mask (out_channels);
+    gst_structure_set (os, "channel-mask", GST_TYPE_BITMASK, mask, NULL);
+  }
+
+  return gst_caps_fixate (othercaps);
+}
+
+static gboolean
+gst_channel_matrix_transform_size (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstCaps * caps, gsize size,
+    GstCaps * othercaps, gsize * othersize)
+{
+  GstAudioInfo info, other;
+
+  if (!gst_audio_info_from_caps (&info, caps) ||
+      !gst_audio_info_from_caps (&other, othercaps))
+    return FALSE;
+
+  *othersize = size / GST_AUDIO_INFO_BPF (&info) * GST_AUDIO_INFO_BPF (&other);
+  return TRUE;
+}
+
+static gboolean
+gst_channel_matrix_set_caps (GstBaseTransform * base_transform,
+    GstCaps * incaps, GstCaps * outcaps)
+{
+  GstChannelMatrix *cm = GST_CHANNEL_MATRIX (base_transform);
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (cm);
+  gint in_channels, out_channels;
+  gfloat *matrix = NULL;
+
+  if (!GST_BASE_TRANSFORM_CLASS (gst_channel_matrix_parent_class)->set_caps
+      (base_transform, incaps, outcaps))
+    return FALSE;
+  if (!gst_audio_info_from_caps (&cm->out_info, outcaps))
+    return FALSE;
+
+  in_channels = GST_AUDIO_INFO_CHANNELS (info);
+  out_channels = GST_AUDIO_INFO_CHANNELS (&cm->out_info);
+
+  GST_OBJECT_LOCK (cm);
+  if (cm->rows > 0) {
+    if (cm->rows == (guint) out_channels &&
+        cm->columns == (guint) in_channels) {
+      matrix = g_new (gfloat, in_channels * out_channels);
+      memcpy (matrix, cm->matrix, in_channels * out_channels *
+          sizeof (gfloat));
+    }
+  } else {
+    matrix = g_new (gfloat, in_channels * out_channels);
+    gst_channel_mix_standard_matrix (info->position, in_channels,
+        cm->out_info.position, out_channels, matrix);
+  }
+  GST_OBJECT_UNLOCK (cm);
+
+  if (matrix == NULL) {
+    GST_WARNING_OBJECT (cm, "matrix does not match %d to %d channels",
+        in_channels, out_channels);
+    return FALSE;
+  }
+
+  gst_channel_mix_free (cm->mix);
+  cm->mix = gst_channel_mix_new (in_channels, out_channels, matrix);
+  g_free (matrix);
+
+  GST_INFO_OBJECT (cm, "%d to %d channels, %s kernel", in_channels,
+      out_channels, gst_channel_mix_get_kernel_name (cm->mix));
+
+  /* an identity matrix leaves the samples as they are */
+  gst_base_transform_set_passthrough (base_transform,
+      gst_channel_mix_is_identity (cm->mix));
+  return TRUE;
+}
+
+static gboolean
+gst_channel_matrix_stop (GstBaseTransform * base_transform)
+{
+  GstChannelMatrix *cm = GST_CHANNEL_MATRIX (base_transform);
+
+  gst_channel_mix_free (cm->mix);
+  cm->mix = NULL;
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_channel_matrix_transform (GstBaseTransform * base_transform,
+    GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstChannelMatrix *cm = GST_CHANNEL_MATRIX (base_transform);
+  GstMapInfo in_map, out_map;
+
+  if (cm->mix == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  if (!gst_buffer_map (inbuf, &in_map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+  if (!gst_buffer_map (outbuf, &out_map, GST_MAP_WRITE)) {
+    gst_buffer_unmap (inbuf, &in_map);
+    return GST_FLOW_ERROR;
+  }
+
+  gst_channel_mix_process (cm->mix, (const gfloat *) in_map.data,
+      (gfloat *) out_map.data,
+      in_map.size / GST_AUDIO_INFO_BPF (GST_AUDIO_FILTER_INFO (cm)));
+
+  gst_buffer_unmap (outbuf, &out_map);
+  gst_buffer_unmap (inbuf, &in_map);
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,550 @@
+/* GStreamer channel matrix mixing
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Matrix mixing of interleaved F32 frames. The common downmixes have
+ * kernels with the channel counts fixed at compile time. They work on 4
+ * frames at once: the input is transposed into one vector per channel,
+ * each output channel is a sum of broadcast gains times those vectors,
+ * and the result is transposed back. Other channel counts use a scalar
+ * loop. Matrices that only copy or reorder channels skip the arithmetic.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstchannelmix.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MINUS_3DB 0.70710678f
+
+typedef void (*GstChannelMixFunc) (const GstChannelMix * mix,
+    const gfloat * in, gfloat * out, guint frames);
+
+struct _GstChannelMix
+{
+  guint in_channels;
+  guint out_channels;
+  gfloat *matrix;
+  /* output channel n copies input reorder[n], NULL for a real mix */
+  guint *reorder;
+  gboolean identity;
+
+  GstChannelMixFunc func;
+  const gchar *kernel_name;
+};
+
+/* frames [start, frames) for any channel counts */
+static void
+mix_tail (const gfloat * m, guint in_ch, guint out_ch, const gfloat * in,
+    gfloat * out, guint start, guint frames)
+{
+  guint f, i, o;
+
+  for (f = start; f < frames; f++) {
+    const gfloat *x = in + f * in_ch;
+    gfloat *y = out + f * out_ch;
+
+    for (o = 0; o < out_ch; o++) {
+      gfloat sum = 0.0f;
+
+      for (i = 0; i < in_ch; i++)
+        sum += m[o * in_ch + i] * x[i];
+      y[o] = sum;
+    }
+  }
+}
+
+static void
+mix_generic (const GstChannelMix * mix, const gfloat * in, gfloat * out,
+    guint frames)
+{
+  mix_tail (mix->matrix, mix->in_channels, mix->out_channels, in, out, 0,
+      frames);
+}
+
+static void
+mix_reorder (const GstChannelMix * mix, const gfloat * in, gfloat * out,
+    guint frames)
+{
+  guint in_ch = mix->in_channels, out_ch = mix->out_channels, f, o;
+  const guint *reorder = mix->reorder;
+
+  for (f = 0; f < frames; f++) {
+    for (o = 0; o < out_ch; o++)
+      out[o] = in[reorder[o]];
+    in += in_ch;
+    out += out_ch;
+  }
+}
+
+static void
+mix_copy (const GstChannelMix * mix, const gfloat * in, gfloat * out,
+    guint frames)
+{
+  memcpy (out, in, (gsize) frames * mix->in_channels * sizeof (gfloat));
+}
+
+#ifdef __SSE2__
+
+/* 4 interleaved frames to one vector per channel */
+static inline void
+load_1 (const gfloat * in, __m128 * x)
+{
+  x[0] = _mm_loadu_ps (in);
+}
+
+static inline void
+load_2 (const gfloat * in, __m128 * x)
+{
+  __m128 a = _mm_loadu_ps (in), b = _mm_loadu_ps (in + 4);
+
+  x[0] = _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+  x[1] = _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+}
+
+/* channels 0-3 and 2-5 as two overlapping 4x4 transposes */
+static inline void
+load_6 (const gfloat * in, __m128 * x)
+{
+  __m128 a0 = _mm_loadu_ps (in), a1 = _mm_loadu_ps (in + 6);
+  __m128 a2 = _mm_loadu_ps (in + 12), a3 = _mm_loadu_ps (in + 18);
+  __m128 b0 = _mm_loadu_ps (in + 2), b1 = _mm_loadu_ps (in + 8);
+  __m128 b2 = _mm_loadu_ps (in + 14), b3 = _mm_loadu_ps (in + 20);
+
+  _MM_TRANSPOSE4_PS (a0, a1, a2, a3);
+  _MM_TRANSPOSE4_PS (b0, b1, b2, b3);
+  x[0] = a0;
+  x[1] = a1;
+  x[2] = a2;
+  x[3] = a3;
+  x[4] = b2;
+  x[5] = b3;
+}
+
+static inline void
+load_8 (const gfloat * in, __m128 * x)
+{
+  __m128 a0 = _mm_loadu_ps (in), a1 = _mm_loadu_ps (in + 8);
+  __m128 a2 = _mm_loadu_ps (in + 16), a3 = _mm_loadu_ps (in + 24);
+  __m128 b0 = _mm_loadu_ps (in + 4), b1 = _mm_loadu_ps (in + 12);
+  __m128 b2 = _mm_loadu_ps (in + 20), b3 = _mm_loadu_ps (in + 28);
+
+  _MM_TRANSPOSE4_PS (a0, a1, a2, a3);
+  _MM_TRANSPOSE4_PS (b0, b1, b2, b3);
+  x[0] = a0;
+  x[1] = a1;
+  x[2] = a2;
+  x[3] = a3;
+  x[4] = b0;
+  x[5] = b1;
+  x[6] = b2;
+  x[7] = b3;
+}
+
+/* one vector per channel back to 4 interleaved frames */
+static inline void
+store_1 (gfloat * out, const __m128 * y)
+{
+  _mm_storeu_ps (out, y[0]);
+}
+
+static inline void
+store_2 (gfloat * out, const __m128 * y)
+{
+  _mm_storeu_ps (out, _mm_unpacklo_ps (y[0], y[1]));
+  _mm_storeu_ps (out + 4, _mm_unpackhi_ps (y[0], y[1]));
+}
+
+static inline void
+store_6 (gfloat * out, const __m128 * y)
+{
+  __m128 t0 = y[0], t1 = y[1], t2 = y[2], t3 = y[3];
+  __m128 lo = _mm_unpacklo_ps (y[4], y[5]), hi = _mm_unpackhi_ps (y[4], y[5]);
+
+  _MM_TRANSPOSE4_PS (t0, t1, t2, t3);
+  _mm_storeu_ps (out, t0);
+  _mm_storel_pi ((__m64 *) (out + 4), lo);
+  _mm_storeu_ps (out + 6, t1);
+  _mm_storeh_pi ((__m64 *) (out + 10), lo);
+  _mm_storeu_ps (out + 12, t2);
+  _mm_storel_pi ((__m64 *) (out + 16), hi);
+  _mm_storeu_ps (out + 18, t3);
+  _mm_storeh_pi ((__m64 *) (out + 22), hi);
+}
+
+/* the loops over IN and OUT have constant bounds and unroll completely */
+#define DEFINE_MIX_KERNEL(IN, OUT)                                      \
+static void                                                             \
+mix_##IN##_##OUT (const GstChannelMix * mix, const gfloat * in,         \
+    gfloat * out, guint frames)                                         \
+{                                                                       \
+  __m128 c[OUT * IN];                                                   \
+  guint f = 0, i, o;                                                    \
+                                                                        \
+  for (i = 0; i < OUT * IN; i++)                                        \
+    c[i] = _mm_set1_ps (mix->matrix[i]);                                \
+                                                                        \
+  for (; f + 4 <= frames; f += 4) {                                     \
+    __m128 x[IN], y[OUT];                                               \
+                                                                        \
+    load_##IN (in + f * IN, x);                                         \
+    for (o = 0; o < OUT; o++) {                                         \
+      y[o] = _mm_mul_ps (c[o * IN], x[0]);                              \
+      for (i = 1; i < IN; i++)                                          \
+        y[o] = _mm_add_ps (y[o], _mm_mul_ps (c[o * IN + i], x[i]));     \
+    }                                                                   \
+    store_##OUT (out + f * OUT, y);                                     \
+  }                                                                     \
+  mix_tail (mix->matrix, IN, OUT, in, out, f, frames);                  \
+}
+
+DEFINE_MIX_KERNEL (1, 2);
+DEFINE_MIX_KERNEL (2, 1);
+DEFINE_MIX_KERNEL (6, 2);
+DEFINE_MIX_KERNEL (8, 2);
+DEFINE_MIX_KERNEL (8, 6);
+
+static const struct
+{
+  guint in_channels;
+  guint out_channels;
+  GstChannelMixFunc func;
+  const gchar *name;
+} mix_kernels[] = {
+  {1, 2, mix_1_2, "sse2 1>2"},
+  {2, 1, mix_2_1, "sse2 2>1"},
+  {6, 2, mix_6_2, "sse2 6>2"},
+  {8, 2, mix_8_2, "sse2 8>2"},
+  {8, 6, mix_8_6, "sse2 8>6"},
+};
+
+#endif /* __SSE2__ */
+
+static void
+gst_channel_mix_pick_kernel (GstChannelMix * mix)
+{
+  guint in_ch = mix->in_channels, out_ch = mix->out_channels, i, o;
+  guint *reorder = g_new (guint, out_ch);
+
+  /* a reorder has exactly one 1.0 and no other gain in every row */
+  for (o = 0; o < out_ch; o++) {
+    guint ones = 0;
+
+    for (i = 0; i < in_ch; i++) {
+      gfloat g = mix->matrix[o * in_ch + i];
+
+      if (g == 1.0f) {
+        reorder[o] = i;
+        ones++;
+      } else if (g != 0.0f) {
+        ones = 0;
+        break;
+      }
+    }
+    if (ones != 1)
+      break;
+  }
+
+  if (o == out_ch) {
+    mix->reorder = reorder;
+    mix->identity = in_ch == out_ch;
+    for (o = 0; o < out_ch && mix->identity; o++)
+      mix->identity = reorder[o] == o;
+
+    if (mix->identity) {
+      mix->func = mix_copy;
+      mix->kernel_name = "identity";
+    } else {
+      mix->func = mix_reorder;
+      mix->kernel_name = "reorder";
+    }
+    return;
+  }
+  g_free (reorder);
+
+  mix->func = mix_generic;
+  mix->kernel_name = "generic";
+#ifdef __SSE2__
+  for (i = 0; i < G_N_ELEMENTS (mix_kernels); i++) {
+    if (mix_kernels[i].in_channels == in_ch &&
+        mix_kernels[i].out_channels == out_ch) {
+      mix->func = mix_kernels[i].func;
+      mix->kernel_name = mix_kernels[i].name;
+    }
+  }
+#endif
+}
+
+GstChannelMix *
+gst_channel_mix_new (guint in_channels, guint out_channels,
+    const gfloat * matrix)
+{
+  GstChannelMix *mix;
+
+  g_return_val_if_fail (in_channels > 0 && out_channels > 0, NULL);
+  g_return_val_if_fail (matrix != NULL, NULL);
+
+  mix = g_new0 (GstChannelMix, 1);
+  mix->in_channels = in_channels;
+  mix->out_channels = out_channels;
+  mix->matrix = g_new (gfloat, in_channels * out_channels);
+  memcpy (mix->matrix, matrix, in_channels * out_channels * sizeof (gfloat));
+  gst_channel_mix_pick_kernel (mix);
+
+  return mix;
+}
+
+void
+gst_channel_mix_free (GstChannelMix * mix)
+{
+  if (mix == NULL)
+    return;
+
+  g_free (mix->matrix);
+  g_free (mix->reorder);
+  g_free (mix);
+}
+
+gboolean
+gst_channel_mix_is_identity (const GstChannelMix * mix)
+{
+  return mix->identity;
+}
+
+gboolean
+gst_channel_mix_is_reorder (const GstChannelMix * mix)
+{
+  return mix->reorder != NULL;
+}
+
+const gchar *
+gst_channel_mix_get_kernel_name (const GstChannelMix * mix)
+{
+  return mix->kernel_name;
+}
+
+void
+gst_channel_mix_process (const GstChannelMix * mix, const gfloat * in,
+    gfloat * out, guint frames)
+{
+  mix->func (mix, in, out, frames);
+}
+
+typedef enum
+{
+  SIDE_LEFT,
+  SIDE_RIGHT,
+  SIDE_CENTER,
+  SIDE_LFE
+} Side;
+
+static void
+classify (GstAudioChannelPosition position, Side * side, gboolean * front)
+{
+  *front = TRUE;
+
+  switch (position) {
+    case GST_AUDIO_CHANNEL_POSITION_REAR_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_SIDE_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_SURROUND_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_FRONT_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_REAR_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_SIDE_LEFT:
+      *front = FALSE;
+      /* fall through */
+    case GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT_OF_CENTER:
+    case GST_AUDIO_CHANNEL_POSITION_WIDE_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_BOTTOM_FRONT_LEFT:
+      *side = SIDE_LEFT;
+      break;
+    case GST_AUDIO_CHANNEL_POSITION_REAR_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_SIDE_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_SURROUND_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_FRONT_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_REAR_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_SIDE_RIGHT:
+      *front = FALSE;
+      /* fall through */
+    case GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT_OF_CENTER:
+    case GST_AUDIO_CHANNEL_POSITION_WIDE_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_BOTTOM_FRONT_RIGHT:
+      *side = SIDE_RIGHT;
+      break;
+    case GST_AUDIO_CHANNEL_POSITION_REAR_CENTER:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_CENTER:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_FRONT_CENTER:
+    case GST_AUDIO_CHANNEL_POSITION_TOP_REAR_CENTER:
+      *front = FALSE;
+      *side = SIDE_CENTER;
+      break;
+    case GST_AUDIO_CHANNEL_POSITION_LFE1:
+    case GST_AUDIO_CHANNEL_POSITION_LFE2:
+      *side = SIDE_LFE;
+      break;
+    default:
+      *side = SIDE_CENTER;
+      break;
+  }
+}
+
+static gboolean
+same_position (GstAudioChannelPosition a, GstAudioChannelPosition b)
+{
+  /* mono is the front center */
+  if (a == GST_AUDIO_CHANNEL_POSITION_MONO)
+    a = GST_AUDIO_CHANNEL_POSITION_FRONT_CENTER;
+  if (b == GST_AUDIO_CHANNEL_POSITION_MONO)
+    b = GST_AUDIO_CHANNEL_POSITION_FRONT_CENTER;
+  return a == b;
+}
+
+/* first output channel on side, -1 if there is none */
+static gint
+find_output (const GstAudioChannelPosition * position, guint channels,
+    Side side, gboolean front)
+{
+  guint o;
+
+  for (o = 0; o < channels; o++) {
+    Side s;
+    gboolean f;
+
+    classify (position[o], &s, &f);
+    if (s == side && f == front)
+      return o;
+  }
+  return -1;
+}
+
+void
+gst_channel_mix_standard_matrix (const GstAudioChannelPosition *
+    in_position, guint in_channels,
+    const GstAudioChannelPosition * out_position, guint out_channels,
+    gfloat * matrix)
+{
+  guint i, o;
+
+#define GAIN(o, i) matrix[(o) * in_channels + (i)]
+
+  memset (matrix, 0, in_channels * out_channels * sizeof (gfloat));
+
+  for (i = 0; i < in_channels; i++)
+    if (in_position[i] == GST_AUDIO_CHANNEL_POSITION_NONE)
+      goto unpositioned;
+  for (o = 0; o < out_channels; o++)
+    if (out_position[o] == GST_AUDIO_CHANNEL_POSITION_NONE)
+      goto unpositioned;
+
+  for (i = 0; i < in_channels; i++) {
+    Side side;
+    gboolean front;
+    gfloat g;
+    gint l, r, c;
+
+    for (o = 0; o < out_channels; o++)
+      if (same_position (in_position[i], out_position[o]))
+        break;
+    if (o < out_channels) {
+      GAIN (o, i) = 1.0f;
+      continue;
+    }
+
+    classify (in_position[i], &side, &front);
+    if (side == SIDE_LFE)
+      continue;
+
+    /* surround to the output's surround channels first */
+    if (!front) {
+      if (side != SIDE_CENTER) {
+        c = find_output (out_position, out_channels, side, FALSE);
+        if (c >= 0) {
+          GAIN (c, i) = 1.0f;
+          continue;
+        }
+      } else {
+        l = find_output (out_position, out_channels, SIDE_LEFT, FALSE);
+        r = find_output (out_position, out_channels, SIDE_RIGHT, FALSE);
+        if (l >= 0 && r >= 0) {
+          GAIN (l, i) = GAIN (r, i) = MINUS_3DB;
+          continue;
+        }
+      }
+    }
+
+    /* then to the front, surround 3 dB down */
+    g = front ? 1.0f : MINUS_3DB;
+    if (side == SIDE_CENTER) {
+      c = find_output (out_position, out_channels, SIDE_CENTER, TRUE);
+      l = find_output (out_position, out_channels, SIDE_LEFT, TRUE);
+      r = find_output (out_position, out_channels, SIDE_RIGHT, TRUE);
+      if (c >= 0) {
+        GAIN (c, i) = g;
+      } else if (l >= 0 && r >= 0) {
+        GAIN (l, i) = GAIN (r, i) = g * MINUS_3DB;
+      }
+    } else {
+      l = find_output (out_position, out_channels, side, TRUE);
+      c = find_output (out_position, out_channels, SIDE_CENTER, TRUE);
+      if (l >= 0)
+        GAIN (l, i) = g;
+      else if (c >= 0)
+        /* left and right average into mono */
+        GAIN (c, i) = g * 0.5f;
+    }
+  }
+  return;
+
+unpositioned:
+  for (i = 0; i < MIN (in_channels, out_channels); i++)
+    GAIN (i, i) = 1.0f;
+
+#undef GAIN
+}
@@ -0,0 +1,81 @@
+/* GStreamer channel matrix mixing
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_CHANNEL_MIX_H__
+#define __GST_CHANNEL_MIX_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstChannelMix GstChannelMix;
+
+/* matrix has out_channels rows of in_channels gains, it is copied */
+GstChannelMix *gst_channel_mix_new (guint in_channels, guint out_channels,
+    const gfloat * matrix);
+void gst_channel_mix_free (GstChannelMix * mix);
+
+/* output equals input, nothing to compute */
+gboolean gst_channel_mix_is_identity (const GstChannelMix * mix);
+/* every output is a copy of one input */
+gboolean gst_channel_mix_is_reorder (const GstChannelMix * mix);
+const gchar *gst_channel_mix_get_kernel_name (const GstChannelMix * mix);
+
+/* interleaved F32, in and out must not overlap */
+void gst_channel_mix_process (const GstChannelMix * mix, const gfloat * in,
+    gfloat * out, guint frames);
+
+/* ITU-R BS.775 style matrix between two layouts: shared positions pass
+ * unchanged, surround channels fold into the front at -3 dB, the center
+ * into left and right at -3 dB, LFE is dropped. Unpositioned layouts map
+ * channel n to channel n */
+void gst_channel_mix_standard_matrix (const GstAudioChannelPosition *
+    in_position, guint in_channels,
+    const GstAudioChannelPosition * out_position, guint out_channels,
+    gfloat * matrix);
+
+G_END_DECLS
+
+#endif /* __GST_CHANNEL_MIX_H__ */
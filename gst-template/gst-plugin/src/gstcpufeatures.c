@@ -0,0 +1,92 @@
+/* GStreamer CPU feature detection
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/* One CPUID probe for every kernel set in the plugins, so they all agree
+ * on what the machine can run and the probe is not repeated per element.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstcpufeatures.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_CPUID 1
+#endif
+
+/* g_once_init_leave() wants a non-zero value */
+#define FEATURES_PROBED ((gsize) 1 << 31)
+
+GstCpuFeatures
+gst_cpu_features_get (void)
+{
+  static gsize features = 0;
+
+  if (g_once_init_enter (&features)) {
+    gsize probed = FEATURES_PROBED;
+
+#ifdef HAVE_X86_CPUID
+    /* the checks include the OS saving the wider registers */
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("sse2"))
+      probed |= GST_CPU_FEATURE_SSE2;
+    if (__builtin_cpu_supports ("avx2"))
+      probed |= GST_CPU_FEATURE_AVX2;
+    if (__builtin_cpu_supports ("fma"))
+      probed |= GST_CPU_FEATURE_FMA;
+    if (__builtin_cpu_supports ("avx512f"))
+      probed |= GST_CPU_FEATURE_AVX512F;
+#endif
+
+    g_once_init_leave (&features, probed);
+  }
+  return (GstCpuFeatures) (features & ~FEATURES_PROBED);
+}
+
+gboolean
+gst_cpu_features_have (GstCpuFeatures features)
+{
+  return (gst_cpu_features_get () & features) == features;
+}
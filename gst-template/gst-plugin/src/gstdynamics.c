@@ -0,0 +1,451 @@
+/* GStreamer lookahead dynamics processing
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Lookahead compressor / limiter working on blocks of BLOCK frames.
+ *
+ * The signal runs through a delay line of lookahead + 2 blocks. When an
+ * input block is complete its peak (sample or true peak) goes through the
+ * static curve, giving the gain r that block needs. The gain of the block
+ * lookahead blocks older is the lowest of the linear attack ramps towards
+ * every r in the attack window, so it reaches r exactly when that block
+ * comes out; rising gain follows a one-pole release per block. Inside a
+ * block the gain is interpolated linearly between the block boundaries,
+ * and each boundary takes the lower of its two neighbours, so no sample
+ * gets more gain than its block allows.
+ *
+ * The true peak interpolator lags the input by a few frames, so the peaks
+ * it reports for the first frames of a block belong to the end of the
+ * previous one and lower that block's gain, which is still waiting in the
+ * delay line. The sample peaks of a block count as well, the interpolated
+ * phases fall between the samples.
+ *
+ * Only the detection and the curve run per block, with one log and one
+ * exp per detector. The per-sample work is a max of abs values and a
+ * multiply with a ramp, both SSE2.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "gstdynamics.h"
+#include "gsttruepeak.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define BLOCK 32
+
+struct _GstDynamics
+{
+  guint rate;
+  guint channels;
+  guint lookahead;              /* blocks */
+
+  /* derived from the parameters */
+  gdouble threshold;
+  gdouble slope;                /* 1 - 1 / ratio */
+  gdouble knee;
+  gfloat makeup;
+  guint attack;                 /* blocks, <= lookahead */
+  gfloat release;               /* per block coefficient */
+  gboolean linked;
+  gboolean true_peak;
+
+  /* delay line of (lookahead + 2) blocks, interleaved */
+  gfloat *delay;
+  guint delay_frames;
+  guint pos;
+  guint fill;                   /* frames of the current input block */
+
+  /* needed gain of the last lookahead + 1 blocks, per detector */
+  gfloat *needed;
+  guint needed_pos;
+  gfloat *gain;                 /* gain of the previous block */
+  gfloat *boundary;             /* gain at the start of the next block */
+  gfloat *end;                  /* gain at its end */
+
+  GstTruePeak *tp;
+  guint tp_delay;               /* frames, < BLOCK */
+  gfloat *peak;
+  gfloat *tail;                 /* true peak of the previous block's end */
+  gfloat ramp[BLOCK];           /* (f + 1) / BLOCK */
+  gfloat gains[BLOCK];
+};
+
+GstDynamics *
+gst_dynamics_new (guint rate, guint channels, guint lookahead_frames)
+{
+  GstDynamics *dyn;
+  GstDynamicsParams params = { -1.0, 0.0, 0.0, 0.0, 5.0, 100.0, TRUE, FALSE };
+  guint f;
+
+  g_return_val_if_fail (rate > 0 && channels > 0, NULL);
+
+  dyn = g_new0 (GstDynamics, 1);
+  dyn->rate = rate;
+  dyn->channels = channels;
+  dyn->lookahead = (lookahead_frames + BLOCK - 1) / BLOCK;
+
+  dyn->delay_frames = (dyn->lookahead + 2) * BLOCK;
+  dyn->delay = g_new (gfloat, dyn->delay_frames * channels);
+  dyn->needed = g_new (gfloat, (dyn->lookahead + 1) * channels);
+  dyn->gain = g_new0 (gfloat, channels);
+  dyn->boundary = g_new0 (gfloat, channels);
+  dyn->end = g_new (gfloat, channels);
+  dyn->tp = gst_true_peak_new (channels);
+  dyn->tp_delay = gst_true_peak_get_delay (dyn->tp);
+  dyn->peak = g_new (gfloat, channels);
+  dyn->tail = g_new (gfloat, channels);
+  for (f = 0; f < BLOCK; f++)
+    dyn->ramp[f] = (gfloat) (f + 1) / BLOCK;
+
+  gst_dynamics_set_params (dyn, &params);
+  gst_dynamics_reset (dyn);
+
+  return dyn;
+}
+
+void
+gst_dynamics_free (GstDynamics * dyn)
+{
+  if (dyn == NULL)
+    return;
+
+  g_free (dyn->delay);
+  g_free (dyn->needed);
+  g_free (dyn->gain);
+  g_free (dyn->boundary);
+  g_free (dyn->end);
+  gst_true_peak_free (dyn->tp);
+  g_free (dyn->peak);
+  g_free (dyn->tail);
+  g_free (dyn);
+}
+
+void
+gst_dynamics_reset (GstDynamics * dyn)
+{
+  guint i;
+
+  memset (dyn->delay, 0, dyn->delay_frames * dyn->channels * sizeof (gfloat));
+  dyn->pos = 0;
+  dyn->fill = 0;
+
+  for (i = 0; i < (dyn->lookahead + 1) * dyn->channels; i++)
+    dyn->needed[i] = 1.0f;
+  dyn->needed_pos = 0;
+  for (i = 0; i < dyn->channels; i++)
+    dyn->gain[i] = dyn->boundary[i] = 1.0f;
+
+  gst_true_peak_reset (dyn->tp);
+}
+
+void
+gst_dynamics_set_params (GstDynamics * dyn, const GstDynamicsParams * params)
+{
+  gdouble block_time = (gdouble) BLOCK / dyn->rate;
+  guint attack;
+
+  dyn->threshold = params->threshold;
+  dyn->slope = params->ratio >= 1.0 ? 1.0 - 1.0 / params->ratio : 1.0;
+  dyn->knee = MAX (params->knee, 0.0);
+  dyn->makeup = (gfloat) pow (10.0, params->makeup / 20.0);
+
+  attack = (guint) (params->attack / 1000.0 / block_time + 0.5);
+  dyn->attack = MIN (attack, dyn->lookahead);
+  dyn->release = params->release > 0.0 ?
+      (gfloat) (1.0 - exp (-block_time / (params->release / 1000.0))) : 1.0f;
+
+  /* switching the detection mode starts from the strongest reduction */
+  if (dyn->linked != params->linked) {
+    guint c;
+
+    for (c = 1; c < dyn->channels; c++) {
+      dyn->gain[0] = MIN (dyn->gain[0], dyn->gain[c]);
+      dyn->boundary[0] = MIN (dyn->boundary[0], dyn->boundary[c]);
+    }
+    for (c = 1; c < dyn->channels; c++) {
+      dyn->gain[c] = dyn->gain[0];
+      dyn->boundary[c] = dyn->boundary[0];
+    }
+  }
+  dyn->linked = params->linked;
+
+  /* the interpolator history is stale after running without it */
+  if (params->true_peak && !dyn->true_peak)
+    gst_true_peak_reset (dyn->tp);
+  dyn->true_peak = params->true_peak;
+}
+
+guint
+gst_dynamics_get_latency (const GstDynamics * dyn)
+{
+  return dyn->delay_frames;
+}
+
+/* gain the static curve gives a peak, linear */
+static gfloat
+gst_dynamics_curve (const GstDynamics * dyn, gfloat peak)
+{
+  gdouble level, over, reduction;
+
+  if (peak <= 0.0f)
+    return 1.0f;
+
+  level = 20.0 * log10 (peak);
+  over = level - dyn->threshold;
+
+  if (2.0 * over <= -dyn->knee)
+    return 1.0f;
+  if (2.0 * over < dyn->knee) {
+    gdouble x = over + dyn->knee / 2.0;
+
+    reduction = dyn->slope * x * x / (2.0 * dyn->knee);
+  } else {
+    reduction = dyn->slope * over;
+  }
+  return (gfloat) pow (10.0, -reduction / 20.0);
+}
+
+/* largest absolute sample of the block */
+static gfloat
+max_abs (const gfloat * data, guint n)
+{
+  gfloat m = 0.0f;
+  guint i = 0;
+
+#ifdef __SSE2__
+  __m128 abs_mask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+  __m128 vm = _mm_setzero_ps ();
+  gfloat lanes[4];
+
+  for (; i + 4 <= n; i += 4)
+    vm = _mm_max_ps (vm, _mm_and_ps (_mm_loadu_ps (data + i), abs_mask));
+  _mm_storeu_ps (lanes, vm);
+  m = MAX (MAX (lanes[0], lanes[1]), MAX (lanes[2], lanes[3]));
+#endif
+  for (; i < n; i++)
+    m = MAX (m, fabsf (data[i]));
+  return m;
+}
+
+/* peak of every detector in the block, and with true peak detection the
+ * interpolated peaks of the previous block's last tp_delay frames in tail */
+static void
+gst_dynamics_detect (GstDynamics * dyn, const gfloat * block)
+{
+  guint ch = dyn->channels, delay = dyn->tp_delay, c, f;
+
+  if (dyn->linked) {
+    dyn->peak[0] = max_abs (block, BLOCK * ch);
+  } else {
+    memset (dyn->peak, 0, ch * sizeof (gfloat));
+    for (f = 0; f < BLOCK; f++)
+      for (c = 0; c < ch; c++)
+        dyn->peak[c] = MAX (dyn->peak[c], fabsf (block[f * ch + c]));
+  }
+
+  if (!dyn->true_peak)
+    return;
+
+  memset (dyn->tail, 0, ch * sizeof (gfloat));
+  gst_true_peak_process (dyn->tp, block, delay, dyn->tail, NULL);
+  if (dyn->linked) {
+    for (c = 1; c < ch; c++)
+      dyn->peak[c] = dyn->peak[0];
+  }
+  gst_true_peak_process (dyn->tp, block + delay * ch, BLOCK - delay,
+      dyn->peak, NULL);
+  if (dyn->linked) {
+    for (c = 1; c < ch; c++) {
+      dyn->peak[0] = MAX (dyn->peak[0], dyn->peak[c]);
+      dyn->tail[0] = MAX (dyn->tail[0], dyn->tail[c]);
+    }
+  }
+}
+
+/* multiply the block by a ramp from g0 to g1, the same on all channels */
+static void
+apply_linked (GstDynamics * dyn, gfloat * block, gfloat g0, gfloat g1)
+{
+  guint ch = dyn->channels, f = 0, c;
+  gfloat *gains = dyn->gains;
+
+#ifdef __SSE2__
+  __m128 v0 = _mm_set1_ps (g0), vd = _mm_set1_ps (g1 - g0);
+
+  for (f = 0; f < BLOCK; f += 4)
+    _mm_storeu_ps (gains + f, _mm_add_ps (v0, _mm_mul_ps (vd,
+                _mm_loadu_ps (dyn->ramp + f))));
+
+  if (ch == 1) {
+    for (f = 0; f < BLOCK; f += 4)
+      _mm_storeu_ps (block + f, _mm_mul_ps (_mm_loadu_ps (block + f),
+              _mm_loadu_ps (gains + f)));
+    return;
+  }
+  if (ch == 2) {
+    for (f = 0; f < BLOCK; f += 4) {
+      __m128 g = _mm_loadu_ps (gains + f);
+
+      _mm_storeu_ps (block + 2 * f, _mm_mul_ps (_mm_loadu_ps (block + 2 * f),
+              _mm_unpacklo_ps (g, g)));
+      _mm_storeu_ps (block + 2 * f + 4,
+          _mm_mul_ps (_mm_loadu_ps (block + 2 * f + 4), _mm_unpackhi_ps (g,
+                  g)));
+    }
+    return;
+  }
+#else
+  for (f = 0; f < BLOCK; f++)
+    gains[f] = g0 + (g1 - g0) * dyn->ramp[f];
+#endif
+
+  for (f = 0; f < BLOCK; f++)
+    for (c = 0; c < ch; c++)
+      block[f * ch + c] *= gains[f];
+}
+
+/* one ramp per channel */
+static void
+apply_independent (GstDynamics * dyn, gfloat * block, const gfloat * g0,
+    const gfloat * g1)
+{
+  guint ch = dyn->channels, f, c;
+
+  for (f = 0; f < BLOCK; f++)
+    for (c = 0; c < ch; c++)
+      block[f * ch + c] *= g0[c] + (g1[c] - g0[c]) * dyn->ramp[f];
+}
+
+/* the input block just completed at in, the block about to leave the
+ * delay line at out */
+static void
+gst_dynamics_end_block (GstDynamics * dyn, const gfloat * in, gfloat * out)
+{
+  guint ch = dyn->channels, slots = dyn->lookahead + 1;
+  guint n_det = dyn->linked ? 1 : ch, d, k;
+  gfloat *end_gain = dyn->end;
+
+  gst_dynamics_detect (dyn, in);
+  for (d = 0; d < n_det; d++)
+    dyn->needed[dyn->needed_pos * ch + d] =
+        gst_dynamics_curve (dyn, dyn->peak[d]);
+
+  /* without lookahead the previous block is already out, its tail can
+   * only lower this one */
+  if (dyn->true_peak) {
+    guint prev = (dyn->needed_pos + slots - 1) % slots;
+
+    for (d = 0; d < n_det; d++) {
+      gfloat *r = &dyn->needed[prev * ch + d];
+
+      *r = MIN (*r, gst_dynamics_curve (dyn, dyn->tail[d]));
+    }
+  }
+  dyn->needed_pos = (dyn->needed_pos + 1) % slots;
+
+  for (d = 0; d < n_det; d++) {
+    gfloat a = 1.0f, g;
+
+    /* needed_pos now points at the oldest block, the one being decided */
+    for (k = 0; k <= dyn->attack; k++) {
+      gfloat r = dyn->needed[((dyn->needed_pos + k) % slots) * ch + d];
+      gfloat frac = (gfloat) (dyn->attack + 1 - k) / (dyn->attack + 1);
+
+      a = MIN (a, 1.0f - (1.0f - r) * frac);
+    }
+
+    g = dyn->gain[d];
+    g = a < g ? a : g + (a - g) * dyn->release;
+
+    end_gain[d] = MIN (dyn->gain[d], g) * dyn->makeup;
+    dyn->gain[d] = g;
+  }
+
+  if (dyn->linked) {
+    apply_linked (dyn, out, dyn->boundary[0], end_gain[0]);
+    dyn->boundary[0] = end_gain[0];
+  } else {
+    apply_independent (dyn, out, dyn->boundary, end_gain);
+    memcpy (dyn->boundary, end_gain, ch * sizeof (gfloat));
+  }
+}
+
+void
+gst_dynamics_process (GstDynamics * dyn, gfloat * data, guint frames)
+{
+  guint ch = dyn->channels;
+
+  while (frames > 0) {
+    guint n = MIN (frames, BLOCK - dyn->fill), i;
+    gfloat *d = dyn->delay + dyn->pos * ch;
+
+    /* output the delayed samples and keep the new ones */
+    for (i = 0; i < n * ch; i++) {
+      gfloat x = data[i];
+
+      data[i] = d[i];
+      d[i] = x;
+    }
+
+    data += n * ch;
+    frames -= n;
+    dyn->pos += n;
+    dyn->fill += n;
+
+    if (dyn->fill == BLOCK) {
+      const gfloat *in = dyn->delay + (dyn->pos - BLOCK) * ch;
+
+      if (dyn->pos == dyn->delay_frames)
+        dyn->pos = 0;
+      gst_dynamics_end_block (dyn, in, dyn->delay + dyn->pos * ch);
+      dyn->fill = 0;
+    }
+  }
+}
@@ -0,0 +1,83 @@
+/* GStreamer lookahead dynamics processing
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_DYNAMICS_H__
+#define __GST_DYNAMICS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstDynamics GstDynamics;
+
+typedef struct
+{
+  gdouble threshold;            /* dBFS */
+  gdouble ratio;                /* >= 1, 0 for a limiter */
+  gdouble knee;                 /* dB, soft knee width */
+  gdouble makeup;               /* dB */
+  gdouble attack;               /* ms, at most the lookahead */
+  gdouble release;              /* ms */
+  gboolean linked;              /* one gain for all channels */
+  gboolean true_peak;           /* detect 4x oversampled peaks */
+} GstDynamicsParams;
+
+/* Everything is allocated here, processing never allocates. The lookahead
+ * is rounded up to whole blocks */
+GstDynamics *gst_dynamics_new (guint rate, guint channels,
+    guint lookahead_frames);
+void gst_dynamics_free (GstDynamics * dyn);
+void gst_dynamics_reset (GstDynamics * dyn);
+void gst_dynamics_set_params (GstDynamics * dyn,
+    const GstDynamicsParams * params);
+
+/* frames the output lags behind the input */
+guint gst_dynamics_get_latency (const GstDynamics * dyn);
+
+/* interleaved F32, in place */
+void gst_dynamics_process (GstDynamics * dyn, gfloat * data, guint frames);
+
+G_END_DECLS
+
+#endif /* __GST_DYNAMICS_H__ */
@@ -0,0 +1,726 @@
+/* GStreamer FIR convolution element
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/**
+ * SECTION:element-firconvolver
+ *
+ * Convolves F32 audio with a long FIR filter, e.g. a room correction
+ * impulse response with thousands of taps, using the partitioned
+ * overlap-save engine in gstfirengine.c.
+ *
+ * The taps come from the taps property or from a text file with one
+ * coefficient per line (location). block-size sets the latency. In
+ * non-uniform partitioning the block size doubles along the impulse
+ * response up to max-block-size, which costs far less CPU for long
+ * filters than uniform partitioning at the same latency. Channels are
+ * processed by up to threads workers in parallel, each worker on its own
+ * deinterleaved copy of its channels.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -v audiotestsrc ! audioconvert ! firconvolver location=room.txt block-size=128 ! autoaudiosink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstfirconvolver.h"
+#include "gstaudiolatency.h"
+
+GST_DEBUG_CATEGORY_STATIC (fir_convolver_debug);
+#define GST_CAT_DEFAULT fir_convolver_debug
+
+enum
+{
+  PROP_0,
+  PROP_TAPS,
+  PROP_LOCATION,
+  PROP_BLOCK_SIZE,
+  PROP_MAX_BLOCK_SIZE,
+  PROP_PARTITIONING,
+  PROP_THREADS
+};
+
+#define DEFAULT_BLOCK_SIZE 256
+#define DEFAULT_MAX_BLOCK_SIZE 8192
+#define DEFAULT_PARTITIONING GST_FIR_CONVOLVER_PARTITIONING_NON_UNIFORM
+#define DEFAULT_THREADS 1
+
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE (GST_AUDIO_NE (F32)) ", layout = (string) interleaved"
+
+struct _GstFirConvolverJob
+{
+  GstFirConvolver *conv;
+  guint index;
+  gfloat *data;
+  guint frames;
+};
+
+G_DEFINE_TYPE (GstFirConvolver, gst_fir_convolver, GST_TYPE_AUDIO_FILTER);
+
+GST_ELEMENT_REGISTER_DEFINE (fir_convolver, "firconvolver", GST_RANK_NONE,
+    GST_TYPE_FIR_CONVOLVER);
+
+#define GST_TYPE_FIR_CONVOLVER_PARTITIONING \
+    (gst_fir_convolver_partitioning_get_type ())
+static GType
+gst_fir_convolver_partitioning_get_type (void)
+{
+  static GType partitioning_type = 0;
+  static const GEnumValue partitioning[] = {
+    {GST_FIR_CONVOLVER_PARTITIONING_UNIFORM,
+        "All partitions have block-size taps", "uniform"},
+    {GST_FIR_CONVOLVER_PARTITIONING_NON_UNIFORM,
+        "Partitions grow up to max-block-size taps", "non-uniform"},
+    {0, NULL, NULL},
+  };
+
+  if (!partitioning_type)
+    partitioning_type =
+        g_enum_register_static ("GstFirConvolverPartitioning", partitioning);
+  return partitioning_type;
+}
+
+static void gst_fir_convolver_finalize (GObject * object);
+static void gst_fir_convolver_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_fir_convolver_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static gboolean gst_fir_convolver_setup (GstAudioFilter * filter,
+    const GstAudioInfo * info);
+static gboolean gst_fir_convolver_stop (GstBaseTransform * base_transform);
+static gboolean gst_fir_convolver_sink_event (GstBaseTransform *
+    base_transform, GstEvent * event);
+static gboolean gst_fir_convolver_query (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstQuery * query);
+static void gst_fir_convolver_before_transform (GstBaseTransform *
+    base_transform, GstBuffer * buf);
+static GstFlowReturn gst_fir_convolver_transform_ip (GstBaseTransform *
+    base_transform, GstBuffer * buf);
+static void gst_fir_convolver_worker (gpointer data, gpointer user_data);
+
+static void
+gst_fir_convolver_class_init (GstFirConvolverClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstBaseTransformClass *btrans_class = (GstBaseTransformClass *) klass;
+  GstAudioFilterClass *audio_filter_class = (GstAudioFilterClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (fir_convolver_debug, "firconvolver", 0,
+      "FIR convolution");
+
+  gobject_class->finalize = gst_fir_convolver_finalize;
+  gobject_class->set_property = gst_fir_convolver_set_property;
+  gobject_class->get_property = gst_fir_convolver_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_TAPS,
+      gst_param_spec_array ("taps", "Taps", "FIR filter coefficients",
+          g_param_spec_float ("tap", "Tap", "FIR filter coefficient",
+              -G_MAXFLOAT, G_MAXFLOAT, 0.0,
+              G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "Text file with one filter coefficient per line, replaces taps",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_BLOCK_SIZE,
+      g_param_spec_uint ("block-size", "Block size",
+          "Smallest partition in samples, rounded up to a power of two. "
+          "This is the latency of the element",
+          16, 65536, DEFAULT_BLOCK_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_BLOCK_SIZE,
+      g_param_spec_uint ("max-block-size", "Max. block size",
+          "Largest partition in samples in non-uniform mode",
+          16, 65536, DEFAULT_MAX_BLOCK_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_PARTITIONING,
+      g_param_spec_enum ("partitioning", "Partitioning",
+          "How the impulse response is split into partitions",
+          GST_TYPE_FIR_CONVOLVER_PARTITIONING, DEFAULT_PARTITIONING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Number of threads processing channels in parallel, 0 for one per "
+          "CPU core", 0, 64, DEFAULT_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  audio_filter_class->setup = GST_DEBUG_FUNCPTR (gst_fir_convolver_setup);
+
+  btrans_class->stop = GST_DEBUG_FUNCPTR (gst_fir_convolver_stop);
+  btrans_class->sink_event = GST_DEBUG_FUNCPTR (gst_fir_convolver_sink_event);
+  btrans_class->query = GST_DEBUG_FUNCPTR (gst_fir_convolver_query);
+  btrans_class->before_transform =
+      GST_DEBUG_FUNCPTR (gst_fir_convolver_before_transform);
+  btrans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_fir_convolver_transform_ip);
+
+  gst_element_class_set_details_simple (element_class, "FIR convolver",
+      "Filter/Effect/Audio",
+      "Partitioned FFT convolution with long FIR filters",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  caps = gst_caps_from_string (SUPPORTED_CAPS_STRING);
+  gst_audio_filter_class_add_pad_templates (audio_filter_class, caps);
+  gst_caps_unref (caps);
+}
+
+static void
+gst_fir_convolver_init (GstFirConvolver * conv)
+{
+  conv->taps = g_array_new (FALSE, FALSE, sizeof (gfloat));
+  conv->location = NULL;
+  conv->block_size = DEFAULT_BLOCK_SIZE;
+  conv->max_block_size = DEFAULT_MAX_BLOCK_SIZE;
+  conv->partitioning = DEFAULT_PARTITIONING;
+  conv->threads = DEFAULT_THREADS;
+  conv->engine_dirty = 0;
+
+  conv->engine = NULL;
+  conv->channels = NULL;
+  conv->n_channels = 0;
+  conv->latency = 0;
+  conv->next_ts = GST_CLOCK_TIME_NONE;
+
+  conv->pool = NULL;
+  conv->jobs = NULL;
+  conv->n_jobs = 0;
+  g_mutex_init (&conv->jobs_lock);
+  g_cond_init (&conv->jobs_cond);
+  conv->jobs_pending = 0;
+  conv->scratch_mem = NULL;
+  conv->scratch = NULL;
+  conv->scratch_stride = 0;
+
+  /* nothing to do until there are taps */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (conv), TRUE);
+}
+
+static void
+gst_fir_convolver_free_engine (GstFirConvolver * conv)
+{
+  guint c;
+
+  for (c = 0; c < conv->n_channels; c++)
+    gst_fir_engine_channel_free (conv->channels[c]);
+  g_free (conv->channels);
+  conv->channels = NULL;
+  conv->n_channels = 0;
+
+  gst_fir_engine_free (conv->engine);
+  conv->engine = NULL;
+  g_atomic_int_set (&conv->latency, 0);
+
+  g_free (conv->scratch_mem);
+  conv->scratch_mem = NULL;
+  conv->scratch = NULL;
+  conv->scratch_stride = 0;
+}
+
+static void
+gst_fir_convolver_free_pool (GstFirConvolver * conv)
+{
+  if (conv->pool) {
+    g_thread_pool_free (conv->pool, FALSE, TRUE);
+    conv->pool = NULL;
+  }
+  g_free (conv->jobs);
+  conv->jobs = NULL;
+  conv->n_jobs = 0;
+}
+
+static void
+gst_fir_convolver_finalize (GObject * object)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (object);
+
+  gst_fir_convolver_free_engine (conv);
+  gst_fir_convolver_free_pool (conv);
+  g_array_free (conv->taps, TRUE);
+  g_free (conv->location);
+  g_mutex_clear (&conv->jobs_lock);
+  g_cond_clear (&conv->jobs_cond);
+
+  G_OBJECT_CLASS (gst_fir_convolver_parent_class)->finalize (object);
+}
+
+/* whitespace or comma separated numbers, '#' starts a comment */
+static GArray *
+gst_fir_convolver_load_taps (const gchar * location, GError ** error)
+{
+  GArray *taps;
+  gchar *contents, *p;
+
+  if (!g_file_get_contents (location, &contents, NULL, error))
+    return NULL;
+
+  taps = g_array_new (FALSE, FALSE, sizeof (gfloat));
+  p = contents;
+  while (*p) {
+    gchar *end;
+    gfloat tap;
+
+    if (g_ascii_isspace (*p) || *p == ',') {
+      p++;
+      continue;
+    }
+    if (*p == '#') {
+      while (*p && *p != '\n')
+        p++;
+      continue;
+    }
+
+    tap = (gfloat) g_ascii_strtod (p, &end);
+    if (end == p) {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+          "%s: invalid coefficient at offset %u", location,
+          (guint) (p - contents));
+      g_array_free (taps, TRUE);
+      g_free (contents);
+      return NULL;
+    }
+    g_array_append_val (taps, tap);
+    p = end;
+  }
+
+  g_free (contents);
+  return taps;
+}
+
+static void
+gst_fir_convolver_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (object);
+
+  switch (prop_id) {
+    case PROP_TAPS:{
+      guint i, n = gst_value_array_get_size (value);
+
+      GST_OBJECT_LOCK (conv);
+      g_array_set_size (conv->taps, n);
+      for (i = 0; i < n; i++)
+        g_array_index (conv->taps, gfloat, i) =
+            g_value_get_float (gst_value_array_get_value (value, i));
+      g_free (conv->location);
+      conv->location = NULL;
+      GST_OBJECT_UNLOCK (conv);
+      break;
+    }
+    case PROP_LOCATION:{
+      const gchar *location = g_value_get_string (value);
+      GArray *taps = NULL;
+      GError *err = NULL;
+
+      if (location && !(taps = gst_fir_convolver_load_taps (location, &err))) {
+        GST_ELEMENT_WARNING (conv, RESOURCE, READ, (NULL),
+            ("could not load taps: %s", err->message));
+        g_clear_error (&err);
+        return;
+      }
+
+      GST_OBJECT_LOCK (conv);
+      g_free (conv->location);
+      conv->location = g_strdup (location);
+      if (taps) {
+        g_array_free (conv->taps, TRUE);
+        conv->taps = taps;
+      }
+      GST_OBJECT_UNLOCK (conv);
+      break;
+    }
+    case PROP_BLOCK_SIZE:
+      GST_OBJECT_LOCK (conv);
+      conv->block_size = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (conv);
+      break;
+    case PROP_MAX_BLOCK_SIZE:
+      GST_OBJECT_LOCK (conv);
+      conv->max_block_size = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (conv);
+      break;
+    case PROP_PARTITIONING:
+      GST_OBJECT_LOCK (conv);
+      conv->partitioning = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (conv);
+      break;
+    case PROP_THREADS:
+      GST_OBJECT_LOCK (conv);
+      conv->threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (conv);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+  }
+
+  /* rebuilt by the streaming thread before the next buffer, which also
+   * decides whether the new taps leave passthrough */
+  g_atomic_int_set (&conv->engine_dirty, 1);
+}
+
+static void
+gst_fir_convolver_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (object);
+
+  GST_OBJECT_LOCK (conv);
+  switch (prop_id) {
+    case PROP_TAPS:{
+      GValue v = G_VALUE_INIT;
+      guint i;
+
+      g_value_init (&v, G_TYPE_FLOAT);
+      for (i = 0; i < conv->taps->len; i++) {
+        g_value_set_float (&v, g_array_index (conv->taps, gfloat, i));
+        gst_value_array_append_value (value, &v);
+      }
+      g_value_unset (&v);
+      break;
+    }
+    case PROP_LOCATION:
+      g_value_set_string (value, conv->location);
+      break;
+    case PROP_BLOCK_SIZE:
+      g_value_set_uint (value, conv->block_size);
+      break;
+    case PROP_MAX_BLOCK_SIZE:
+      g_value_set_uint (value, conv->max_block_size);
+      break;
+    case PROP_PARTITIONING:
+      g_value_set_enum (value, conv->partitioning);
+      break;
+    case PROP_THREADS:
+      g_value_set_uint (value, conv->threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (conv);
+}
+
+/* build the engine and the per-channel state for the current taps, and
+ * the workers. Runs in the streaming thread, or in setup */
+static void
+gst_fir_convolver_rebuild (GstFirConvolver * conv, guint n_channels)
+{
+  GstFirEngine *engine = NULL;
+  guint block_size, max_block_size, threads, latency, c;
+  gboolean non_uniform;
+
+  gst_fir_convolver_free_engine (conv);
+
+  GST_OBJECT_LOCK (conv);
+  if (conv->taps->len > 0)
+    engine = gst_fir_engine_new ((const gfloat *) conv->taps->data,
+        conv->taps->len, conv->block_size,
+        conv->partitioning == GST_FIR_CONVOLVER_PARTITIONING_NON_UNIFORM,
+        conv->max_block_size);
+  block_size = conv->block_size;
+  max_block_size = conv->max_block_size;
+  threads = conv->threads;
+  GST_OBJECT_UNLOCK (conv);
+
+  if (engine == NULL || n_channels == 0) {
+    gst_fir_engine_free (engine);
+    GST_DEBUG_OBJECT (conv, "no taps, passthrough");
+    gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (conv), TRUE);
+    return;
+  }
+
+  conv->engine = engine;
+  conv->n_channels = n_channels;
+  conv->channels = g_new (GstFirEngineChannel *, n_channels);
+  for (c = 0; c < n_channels; c++)
+    conv->channels[c] = gst_fir_engine_channel_new (engine);
+
+  latency = gst_fir_engine_get_latency (engine);
+  GST_INFO_OBJECT (conv, "block size %u, max block size %u, latency %u",
+      block_size, max_block_size, latency);
+  gst_audio_latency_update (GST_AUDIO_FILTER (conv), &conv->latency, latency);
+
+  /* one worker per channel at most */
+  if (threads == 0)
+    threads = g_get_num_processors ();
+  threads = CLAMP (threads, 1, n_channels);
+  if (threads != conv->n_jobs) {
+    guint i;
+
+    gst_fir_convolver_free_pool (conv);
+    conv->n_jobs = threads;
+    conv->jobs = g_new0 (GstFirConvolverJob, threads);
+    for (i = 0; i < threads; i++) {
+      conv->jobs[i].conv = conv;
+      conv->jobs[i].index = i;
+    }
+    if (threads > 1)
+      conv->pool = g_thread_pool_new (gst_fir_convolver_worker, conv,
+          threads - 1, TRUE, NULL);
+  }
+
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (conv), FALSE);
+}
+
+static gboolean
+gst_fir_convolver_setup (GstAudioFilter * filter, const GstAudioInfo * info)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (filter);
+
+  GST_INFO_OBJECT (conv, "rate %d, %d channels", GST_AUDIO_INFO_RATE (info),
+      GST_AUDIO_INFO_CHANNELS (info));
+
+  g_atomic_int_set (&conv->engine_dirty, 0);
+  gst_fir_convolver_rebuild (conv, GST_AUDIO_INFO_CHANNELS (info));
+  return TRUE;
+}
+
+static gboolean
+gst_fir_convolver_stop (GstBaseTransform * base_transform)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (base_transform);
+
+  gst_fir_convolver_free_engine (conv);
+  gst_fir_convolver_free_pool (conv);
+  conv->next_ts = GST_CLOCK_TIME_NONE;
+  return TRUE;
+}
+
+/* a single job filters the interleaved frames in place, several jobs
+ * work on their own planes in the scratch buffer */
+static void
+gst_fir_convolver_run_job (GstFirConvolverJob * job)
+{
+  GstFirConvolver *conv = job->conv;
+  gfloat *plane;
+  guint c;
+
+  for (c = job->index; c < conv->n_channels; c += conv->n_jobs) {
+    if (conv->n_jobs > 1) {
+      plane = conv->scratch + (gsize) c * conv->scratch_stride;
+      gst_fir_engine_channel_process (conv->channels[c], plane, plane,
+          job->frames, 1);
+    } else {
+      gst_fir_engine_channel_process (conv->channels[c], job->data + c,
+          job->data + c, job->frames, conv->n_channels);
+    }
+  }
+}
+
+static void
+gst_fir_convolver_worker (gpointer data, gpointer user_data)
+{
+  GstFirConvolver *conv = user_data;
+
+  gst_fir_convolver_run_job (data);
+
+  g_mutex_lock (&conv->jobs_lock);
+  if (--conv->jobs_pending == 0)
+    g_cond_signal (&conv->jobs_cond);
+  g_mutex_unlock (&conv->jobs_lock);
+}
+
+/* grow the scratch planes to hold at least frames samples each. The
+ * stride is a multiple of 16 floats so every plane starts on its own
+ * cache line */
+static void
+gst_fir_convolver_ensure_scratch (GstFirConvolver * conv, guint frames)
+{
+  guint stride = GST_ROUND_UP_16 (frames);
+
+  if (stride <= conv->scratch_stride)
+    return;
+
+  g_free (conv->scratch_mem);
+  conv->scratch_mem = g_malloc ((gsize) conv->n_channels * stride *
+      sizeof (gfloat) + 63);
+  conv->scratch = (gfloat *) (((guintptr) conv->scratch_mem + 63) &
+      ~(guintptr) 63);
+  conv->scratch_stride = stride;
+}
+
+/* filter interleaved frames in place, the channels in parallel */
+static void
+gst_fir_convolver_process (GstFirConvolver * conv, gfloat * data,
+    guint frames)
+{
+  guint n_channels = conv->n_channels, stride, i, c;
+
+  for (i = 0; i < conv->n_jobs; i++) {
+    conv->jobs[i].data = data;
+    conv->jobs[i].frames = frames;
+  }
+
+  if (conv->n_jobs > 1) {
+    gst_fir_convolver_ensure_scratch (conv, frames);
+    stride = conv->scratch_stride;
+    for (i = 0; i < frames; i++)
+      for (c = 0; c < n_channels; c++)
+        conv->scratch[(gsize) c * stride + i] = data[i * n_channels + c];
+
+    conv->jobs_pending = conv->n_jobs - 1;
+    for (i = 1; i < conv->n_jobs; i++)
+      g_thread_pool_push (conv->pool, &conv->jobs[i], NULL);
+  }
+
+  gst_fir_convolver_run_job (&conv->jobs[0]);
+
+  if (conv->n_jobs > 1) {
+    g_mutex_lock (&conv->jobs_lock);
+    while (conv->jobs_pending > 0)
+      g_cond_wait (&conv->jobs_cond, &conv->jobs_lock);
+    g_mutex_unlock (&conv->jobs_lock);
+
+    for (i = 0; i < frames; i++)
+      for (c = 0; c < n_channels; c++)
+        data[i * n_channels + c] = conv->scratch[(gsize) c * stride + i];
+  }
+}
+
+/* apply new taps before BaseTransform looks at the passthrough flag, so a
+ * buffer is only processed in place once it was made writable */
+static void
+gst_fir_convolver_before_transform (GstBaseTransform * base_transform,
+    GstBuffer * buf)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (base_transform);
+
+  if (g_atomic_int_compare_and_exchange (&conv->engine_dirty, 1, 0))
+    gst_fir_convolver_rebuild (conv,
+        GST_AUDIO_INFO_CHANNELS (GST_AUDIO_FILTER_INFO (conv)));
+
+  gst_audio_latency_track (&conv->next_ts, buf);
+}
+
+static GstFlowReturn
+gst_fir_convolver_transform_ip (GstBaseTransform * base_transform,
+    GstBuffer * buf)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (base_transform);
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (conv);
+  GstMapInfo map;
+
+  if (conv->engine == NULL)
+    return GST_FLOW_OK;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READWRITE))
+    return GST_FLOW_ERROR;
+
+  gst_fir_convolver_process (conv, (gfloat *) map.data,
+      map.size / GST_AUDIO_INFO_BPF (info));
+
+  gst_buffer_unmap (buf, &map);
+  return GST_FLOW_OK;
+}
+
+/* the samples still held back by the latency come out of silence */
+static void
+gst_fir_convolver_process_tail (GstAudioFilter * filter, gfloat * data,
+    guint frames)
+{
+  gst_fir_convolver_process (GST_FIR_CONVOLVER (filter), data, frames);
+}
+
+static gboolean
+gst_fir_convolver_sink_event (GstBaseTransform * base_transform,
+    GstEvent * event)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (base_transform);
+  GstAudioFilter *filter = GST_AUDIO_FILTER (base_transform);
+  guint c;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      if (conv->engine)
+        gst_audio_latency_drain (filter, gst_fir_engine_get_latency
+            (conv->engine), conv->next_ts, gst_fir_convolver_process_tail);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      for (c = 0; c < conv->n_channels; c++)
+        gst_fir_engine_channel_reset (conv->channels[c]);
+      conv->next_ts = GST_CLOCK_TIME_NONE;
+      break;
+    default:
+      break;
+  }
+
+  return
+      GST_BASE_TRANSFORM_CLASS (gst_fir_convolver_parent_class)->sink_event
+      (base_transform, event);
+}
+
+/* add the block latency to the upstream latency */
+static gboolean
+gst_fir_convolver_query (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstFirConvolver *conv = GST_FIR_CONVOLVER (base_transform);
+
+  if (!GST_BASE_TRANSFORM_CLASS (gst_fir_convolver_parent_class)->query
+      (base_transform, direction, query))
+    return FALSE;
+
+  gst_audio_latency_query (GST_AUDIO_FILTER (conv), &conv->latency,
+      direction, query);
+  return TRUE;
+}
@@ -0,0 +1,377 @@
+/* GStreamer partitioned FIR convolution engine
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Partitioned overlap-save convolution.
+ *
+ * The impulse response is cut into segments. A segment uses blocks of
+ * size L, covers taps [offset, offset + n_parts * L) and is split into
+ * n_parts partitions of L taps. Every L input samples the last 2L input
+ * samples are transformed once, stored in the segment's frequency domain
+ * delay line and multiplied with all partition spectra (uniformly
+ * partitioned overlap-save). The second half of the inverse transform is
+ * the segment's output for the L samples starting at T - L + offset.
+ *
+ * The first segment has L = block_size and offset 0 and sets the latency
+ * to block_size samples. In non-uniform mode later segments double their
+ * block size while offset >= L holds, so their output is always ready
+ * before it is due and big, cheap transforms handle the tail of long
+ * filters. The uniform mode uses a single segment: more multiplications
+ * per sample for long filters, but an even CPU load per block.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/fft/gstfftf32.h>
+
+#include "gstfirengine.h"
+
+/* partitions per block size before doubling in non-uniform mode */
+#define NON_UNIFORM_PARTS 2
+
+typedef struct
+{
+  guint size;
+  guint offset;
+  guint n_parts;
+  /* n_parts spectra of size + 1 bins, scaled for the inverse transform */
+  GstFFTF32Complex *spectra;
+} GstFirSegment;
+
+struct _GstFirEngine
+{
+  guint block_size;
+  guint n_segments;
+  GstFirSegment *segments;
+
+  guint history_mask;
+  guint output_mask;
+};
+
+typedef struct
+{
+  GstFFTF32 *fft;
+  GstFFTF32 *ifft;
+  GstFFTF32Complex *fdl;
+  guint fdl_pos;
+  GstFFTF32Complex *acc;
+  gfloat *time;
+} GstFirSegmentState;
+
+struct _GstFirEngineChannel
+{
+  const GstFirEngine *engine;
+  GstFirSegmentState *segs;
+
+  /* ring of the last inputs and of pending outputs, indexed by the
+   * absolute sample position */
+  gfloat *history;
+  gfloat *output;
+  guint64 pos;
+};
+
+static guint
+next_pow2 (guint v)
+{
+  return v <= 1 ? 1 : 1u << g_bit_storage (v - 1);
+}
+
+static void
+gst_fir_segment_init (GstFirSegment * seg, const gfloat * taps,
+    guint n_taps, guint size, guint offset, guint n_parts)
+{
+  GstFFTF32 *fft = gst_fft_f32_new (2 * size, FALSE);
+  gfloat *time = g_new (gfloat, 2 * size);
+  gfloat scale = 1.0f / (2 * size);
+  guint p, i;
+
+  seg->size = size;
+  seg->offset = offset;
+  seg->n_parts = n_parts;
+  seg->spectra = g_new (GstFFTF32Complex, n_parts * (size + 1));
+
+  for (p = 0; p < n_parts; p++) {
+    guint first = offset + p * size;
+    GstFFTF32Complex *spec = seg->spectra + p * (size + 1);
+
+    memset (time, 0, 2 * size * sizeof (gfloat));
+    for (i = 0; i < size && first + i < n_taps; i++)
+      time[i] = taps[first + i] * scale;
+    gst_fft_f32_fft (fft, time, spec);
+  }
+
+  g_free (time);
+  gst_fft_f32_free (fft);
+}
+
+GstFirEngine *
+gst_fir_engine_new (const gfloat * taps, guint n_taps, guint block_size,
+    gboolean non_uniform, guint max_block_size)
+{
+  GstFirEngine *engine;
+  GArray *segs;
+  guint offset = 0, size, max_size = 0, max_reach = 0, i;
+
+  g_return_val_if_fail (n_taps > 0, NULL);
+  g_return_val_if_fail (block_size > 0, NULL);
+
+  block_size = next_pow2 (block_size);
+  max_block_size = MAX (next_pow2 (max_block_size), block_size);
+
+  engine = g_new0 (GstFirEngine, 1);
+  engine->block_size = block_size;
+  segs = g_array_new (FALSE, TRUE, sizeof (GstFirSegment));
+
+  size = block_size;
+  while (offset < n_taps) {
+    GstFirSegment seg;
+    guint n_parts;
+
+    /* a segment may only grow while its output arrives in time */
+    if (non_uniform && size < max_block_size && offset >= 2 * size
+        && n_taps - offset > NON_UNIFORM_PARTS * 2 * size)
+      size *= 2;
+
+    if (non_uniform && size < max_block_size)
+      n_parts = NON_UNIFORM_PARTS;
+    else
+      n_parts = (n_taps - offset + size - 1) / size;
+    n_parts = MIN (n_parts, (n_taps - offset + size - 1) / size);
+
+    gst_fir_segment_init (&seg, taps, n_taps, size, offset, n_parts);
+    g_array_append_val (segs, seg);
+
+    offset += n_parts * size;
+    max_size = MAX (max_size, size);
+    max_reach = MAX (max_reach, seg.offset + size);
+  }
+
+  engine->n_segments = segs->len;
+  engine->segments = (GstFirSegment *) g_array_free (segs, FALSE);
+  engine->history_mask = next_pow2 (2 * max_size) - 1;
+  /* outputs are written up to offset + size ahead and read block_size
+   * behind the input position */
+  engine->output_mask = next_pow2 (max_reach + 2 * block_size) - 1;
+
+  for (i = 0; i < engine->n_segments; i++)
+    GST_DEBUG ("segment %u: block %u, offset %u, %u partitions", i,
+        engine->segments[i].size, engine->segments[i].offset,
+        engine->segments[i].n_parts);
+
+  return engine;
+}
+
+void
+gst_fir_engine_free (GstFirEngine * engine)
+{
+  guint i;
+
+  if (engine == NULL)
+    return;
+
+  for (i = 0; i < engine->n_segments; i++)
+    g_free (engine->segments[i].spectra);
+  g_free (engine->segments);
+  g_free (engine);
+}
+
+guint
+gst_fir_engine_get_latency (const GstFirEngine * engine)
+{
+  return engine->block_size;
+}
+
+GstFirEngineChannel *
+gst_fir_engine_channel_new (const GstFirEngine * engine)
+{
+  GstFirEngineChannel *channel = g_new0 (GstFirEngineChannel, 1);
+  guint i;
+
+  channel->engine = engine;
+  channel->segs = g_new0 (GstFirSegmentState, engine->n_segments);
+  for (i = 0; i < engine->n_segments; i++) {
+    const GstFirSegment *seg = &engine->segments[i];
+    GstFirSegmentState *st = &channel->segs[i];
+
+    st->fft = gst_fft_f32_new (2 * seg->size, FALSE);
+    st->ifft = gst_fft_f32_new (2 * seg->size, TRUE);
+    st->fdl = g_new0 (GstFFTF32Complex, seg->n_parts * (seg->size + 1));
+    st->acc = g_new (GstFFTF32Complex, seg->size + 1);
+    st->time = g_new (gfloat, 2 * seg->size);
+  }
+  channel->history = g_new0 (gfloat, engine->history_mask + 1);
+  channel->output = g_new0 (gfloat, engine->output_mask + 1);
+
+  return channel;
+}
+
+void
+gst_fir_engine_channel_free (GstFirEngineChannel * channel)
+{
+  guint i;
+
+  if (channel == NULL)
+    return;
+
+  for (i = 0; i < channel->engine->n_segments; i++) {
+    GstFirSegmentState *st = &channel->segs[i];
+
+    gst_fft_f32_free (st->fft);
+    gst_fft_f32_free (st->ifft);
+    g_free (st->fdl);
+    g_free (st->acc);
+    g_free (st->time);
+  }
+  g_free (channel->segs);
+  g_free (channel->history);
+  g_free (channel->output);
+  g_free (channel);
+}
+
+void
+gst_fir_engine_channel_reset (GstFirEngineChannel * channel)
+{
+  const GstFirEngine *engine = channel->engine;
+  guint i;
+
+  for (i = 0; i < engine->n_segments; i++) {
+    const GstFirSegment *seg = &engine->segments[i];
+
+    memset (channel->segs[i].fdl, 0,
+        seg->n_parts * (seg->size + 1) * sizeof (GstFFTF32Complex));
+    channel->segs[i].fdl_pos = 0;
+  }
+  memset (channel->history, 0, (engine->history_mask + 1) * sizeof (gfloat));
+  memset (channel->output, 0, (engine->output_mask + 1) * sizeof (gfloat));
+  channel->pos = 0;
+}
+
+/* acc += a * b over n complex bins */
+static inline void
+complex_mac (GstFFTF32Complex * acc, const GstFFTF32Complex * a,
+    const GstFFTF32Complex * b, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++) {
+    acc[i].r += a[i].r * b[i].r - a[i].i * b[i].i;
+    acc[i].i += a[i].r * b[i].i + a[i].i * b[i].r;
+  }
+}
+
+/* one block of a segment, at absolute input position end */
+static void
+gst_fir_segment_process (GstFirEngineChannel * channel, guint s, guint64 end)
+{
+  const GstFirEngine *engine = channel->engine;
+  const GstFirSegment *seg = &engine->segments[s];
+  GstFirSegmentState *st = &channel->segs[s];
+  guint size = seg->size, bins = size + 1, p, i;
+  guint64 start = end - 2 * size, out_pos;
+  GstFFTF32Complex *x;
+
+  /* the last 2L inputs, the ring holds zeros before the first sample */
+  for (i = 0; i < 2 * size; i++)
+    st->time[i] = channel->history[(start + i) & engine->history_mask];
+
+  x = st->fdl + st->fdl_pos * bins;
+  gst_fft_f32_fft (st->fft, st->time, x);
+
+  memset (st->acc, 0, bins * sizeof (GstFFTF32Complex));
+  for (p = 0; p < seg->n_parts; p++) {
+    guint slot = (st->fdl_pos + seg->n_parts - p) % seg->n_parts;
+
+    complex_mac (st->acc, st->fdl + slot * bins, seg->spectra + p * bins,
+        bins);
+  }
+  st->fdl_pos = (st->fdl_pos + 1) % seg->n_parts;
+
+  gst_fft_f32_inverse_fft (st->ifft, st->acc, st->time);
+
+  /* the second half is valid, it belongs offset samples later */
+  out_pos = end - size + seg->offset;
+  for (i = 0; i < size; i++)
+    channel->output[(out_pos + i) & engine->output_mask] +=
+        st->time[size + i];
+}
+
+/* stream n_samples through the filter. in and out may be the same, both
+ * are read and written every stride floats. The output is delayed by the
+ * engine latency */
+void
+gst_fir_engine_channel_process (GstFirEngineChannel * channel,
+    const gfloat * in, gfloat * out, guint n_samples, guint stride)
+{
+  const GstFirEngine *engine = channel->engine;
+  guint block = engine->block_size;
+  guint hmask = engine->history_mask, omask = engine->output_mask;
+
+  while (n_samples > 0) {
+    guint chunk = MIN (n_samples, block - (guint) (channel->pos % block));
+    guint64 pos = channel->pos;
+    guint i, s;
+
+    for (i = 0; i < chunk; i++) {
+      gfloat *y = &channel->output[(pos + i - block) & omask];
+
+      channel->history[(pos + i) & hmask] = in[i * stride];
+      out[i * stride] = *y;
+      *y = 0.0f;
+    }
+
+    in += chunk * stride;
+    out += chunk * stride;
+    n_samples -= chunk;
+    channel->pos += chunk;
+
+    if (channel->pos % block != 0)
+      continue;
+
+    for (s = 0; s < engine->n_segments; s++) {
+      if (channel->pos % engine->segments[s].size == 0)
+        gst_fir_segment_process (channel, s, channel->pos);
+    }
+  }
+}
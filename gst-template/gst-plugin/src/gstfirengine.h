@@ -0,0 +1,70 @@
+/* GStreamer partitioned FIR convolution engine
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_FIR_ENGINE_H__
+#define __GST_FIR_ENGINE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstFirEngine GstFirEngine;
+typedef struct _GstFirEngineChannel GstFirEngineChannel;
+
+/* filter spectra, shared read-only by all channels */
+GstFirEngine *gst_fir_engine_new (const gfloat * taps, guint n_taps,
+    guint block_size, gboolean non_uniform, guint max_block_size);
+void gst_fir_engine_free (GstFirEngine * engine);
+guint gst_fir_engine_get_latency (const GstFirEngine * engine);
+
+/* per-channel streaming state. Channels of one engine can be processed
+ * from different threads at the same time */
+GstFirEngineChannel *gst_fir_engine_channel_new (const GstFirEngine * engine);
+void gst_fir_engine_channel_free (GstFirEngineChannel * channel);
+void gst_fir_engine_channel_reset (GstFirEngineChannel * channel);
+void gst_fir_engine_channel_process (GstFirEngineChannel * channel,
+    const gfloat * in, gfloat * out, guint n_samples, guint stride);
+
+G_END_DECLS
+
+#endif /* __GST_FIR_ENGINE_H__ */
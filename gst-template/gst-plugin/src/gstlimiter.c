@@ -0,0 +1,516 @@
+/* GStreamer lookahead compressor / limiter
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/**
+ * SECTION:element-limiter
+ *
+ * Compresses or limits F32 audio with a lookahead, e.g. as the last
+ * element before a broadcast output. The signal is delayed by lookahead
+ * (rounded up to 32 frame blocks, plus two blocks) so the gain can ramp
+ * down before a peak arrives. In limiter mode with true-peak detection
+ * the output then stays below threshold + makeup-gain dBTP.
+ *
+ * The gain is computed once per block and interpolated in between, and
+ * the buffers are processed in place. All memory is allocated when the
+ * caps are set, nothing is allocated while streaming apart from the
+ * buffer that drains the delay on EOS. The delay is reported in the
+ * LATENCY query.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -v filesrc location=in.wav ! wavparse ! audioconvert ! limiter threshold=-1 lookahead=5 true-peak=true ! audioconvert ! autoaudiosink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstlimiter.h"
+#include "gstaudiolatency.h"
+
+GST_DEBUG_CATEGORY_STATIC (limiter_debug);
+#define GST_CAT_DEFAULT limiter_debug
+
+enum
+{
+  PROP_0,
+  PROP_MODE,
+  PROP_THRESHOLD,
+  PROP_RATIO,
+  PROP_KNEE,
+  PROP_MAKEUP_GAIN,
+  PROP_ATTACK,
+  PROP_RELEASE,
+  PROP_LOOKAHEAD,
+  PROP_LINK,
+  PROP_TRUE_PEAK
+};
+
+#define DEFAULT_MODE GST_LIMITER_MODE_LIMITER
+#define DEFAULT_THRESHOLD -1.0
+#define DEFAULT_RATIO 4.0
+#define DEFAULT_KNEE 0.0
+#define DEFAULT_MAKEUP_GAIN 0.0
+#define DEFAULT_ATTACK 5.0
+#define DEFAULT_RELEASE 100.0
+#define DEFAULT_LOOKAHEAD 5.0
+#define DEFAULT_LINK GST_LIMITER_LINK_LINKED
+#define DEFAULT_TRUE_PEAK TRUE
+
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE (GST_AUDIO_NE (F32)) ", layout = (string) interleaved"
+
+G_DEFINE_TYPE (GstLimiter, gst_limiter, GST_TYPE_AUDIO_FILTER);
+
+GST_ELEMENT_REGISTER_DEFINE (limiter, "limiter", GST_RANK_NONE,
+    GST_TYPE_LIMITER);
+
+#define GST_TYPE_LIMITER_MODE (gst_limiter_mode_get_type ())
+static GType
+gst_limiter_mode_get_type (void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode[] = {
+    {GST_LIMITER_MODE_COMPRESSOR, "Reduce by ratio above threshold",
+        "compressor"},
+    {GST_LIMITER_MODE_LIMITER, "Never exceed threshold", "limiter"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static ("GstLimiterMode", mode);
+  return mode_type;
+}
+
+#define GST_TYPE_LIMITER_LINK (gst_limiter_link_get_type ())
+static GType
+gst_limiter_link_get_type (void)
+{
+  static GType link_type = 0;
+  static const GEnumValue link[] = {
+    {GST_LIMITER_LINK_LINKED, "One gain from the loudest channel", "linked"},
+    {GST_LIMITER_LINK_INDEPENDENT, "Every channel on its own",
+        "independent"},
+    {0, NULL, NULL},
+  };
+
+  if (!link_type)
+    link_type = g_enum_register_static ("GstLimiterLink", link);
+  return link_type;
+}
+
+static void gst_limiter_finalize (GObject * object);
+static void gst_limiter_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_limiter_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static gboolean gst_limiter_setup (GstAudioFilter * filter,
+    const GstAudioInfo * info);
+static gboolean gst_limiter_stop (GstBaseTransform * base_transform);
+static gboolean gst_limiter_sink_event (GstBaseTransform * base_transform,
+    GstEvent * event);
+static gboolean gst_limiter_query (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstQuery * query);
+static GstFlowReturn gst_limiter_transform_ip (GstBaseTransform *
+    base_transform, GstBuffer * buf);
+
+static void
+gst_limiter_class_init (GstLimiterClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstBaseTransformClass *btrans_class = (GstBaseTransformClass *) klass;
+  GstAudioFilterClass *audio_filter_class = (GstAudioFilterClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (limiter_debug, "limiter", 0,
+      "Lookahead compressor / limiter");
+
+  gobject_class->finalize = gst_limiter_finalize;
+  gobject_class->set_property = gst_limiter_set_property;
+  gobject_class->get_property = gst_limiter_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode", "Compressor or limiter",
+          GST_TYPE_LIMITER_MODE, DEFAULT_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_THRESHOLD,
+      g_param_spec_double ("threshold", "Threshold",
+          "Level where gain reduction starts, in dBFS",
+          -60.0, 0.0, DEFAULT_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_RATIO,
+      g_param_spec_double ("ratio", "Ratio",
+          "Input to output level ratio above threshold in compressor mode",
+          1.0, 100.0, DEFAULT_RATIO,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_KNEE,
+      g_param_spec_double ("knee", "Knee",
+          "Width of the soft knee around threshold in dB",
+          0.0, 24.0, DEFAULT_KNEE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_MAKEUP_GAIN,
+      g_param_spec_double ("makeup-gain", "Makeup gain",
+          "Gain applied after the gain reduction in dB",
+          -24.0, 24.0, DEFAULT_MAKEUP_GAIN,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_ATTACK,
+      g_param_spec_double ("attack", "Attack",
+          "Time for the gain to fall in ms, at most the lookahead",
+          0.0, 100.0, DEFAULT_ATTACK,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_RELEASE,
+      g_param_spec_double ("release", "Release",
+          "Time constant of the gain recovery in ms",
+          0.0, 5000.0, DEFAULT_RELEASE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_LOOKAHEAD,
+      g_param_spec_double ("lookahead", "Lookahead",
+          "How far ahead peaks are seen in ms, adds to the latency",
+          0.0, 100.0, DEFAULT_LOOKAHEAD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_LINK,
+      g_param_spec_enum ("link", "Link",
+          "Whether all channels share one gain",
+          GST_TYPE_LIMITER_LINK, DEFAULT_LINK,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_TRUE_PEAK,
+      g_param_spec_boolean ("true-peak", "True peak",
+          "Detect 4x oversampled inter-sample peaks",
+          DEFAULT_TRUE_PEAK,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  audio_filter_class->setup = GST_DEBUG_FUNCPTR (gst_limiter_setup);
+
+  btrans_class->stop = GST_DEBUG_FUNCPTR (gst_limiter_stop);
+  btrans_class->sink_event = GST_DEBUG_FUNCPTR (gst_limiter_sink_event);
+  btrans_class->query = GST_DEBUG_FUNCPTR (gst_limiter_query);
+  btrans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_limiter_transform_ip);
+
+  gst_element_class_set_details_simple (element_class,
+      "Lookahead limiter", "Filter/Effect/Audio",
+      "Lookahead compressor and true peak limiter",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  caps = gst_caps_from_string (SUPPORTED_CAPS_STRING);
+  gst_audio_filter_class_add_pad_templates (audio_filter_class, caps);
+  gst_caps_unref (caps);
+}
+
+static void
+gst_limiter_init (GstLimiter * limiter)
+{
+  limiter->mode = DEFAULT_MODE;
+  limiter->threshold = DEFAULT_THRESHOLD;
+  limiter->ratio = DEFAULT_RATIO;
+  limiter->knee = DEFAULT_KNEE;
+  limiter->makeup_gain = DEFAULT_MAKEUP_GAIN;
+  limiter->attack = DEFAULT_ATTACK;
+  limiter->release = DEFAULT_RELEASE;
+  limiter->lookahead = DEFAULT_LOOKAHEAD;
+  limiter->link = DEFAULT_LINK;
+  limiter->true_peak = DEFAULT_TRUE_PEAK;
+  limiter->params_dirty = 0;
+
+  limiter->dyn = NULL;
+  limiter->latency = 0;
+  limiter->next_ts = GST_CLOCK_TIME_NONE;
+}
+
+static void
+gst_limiter_finalize (GObject * object)
+{
+  GstLimiter *limiter = GST_LIMITER (object);
+
+  gst_dynamics_free (limiter->dyn);
+
+  G_OBJECT_CLASS (gst_limiter_parent_class)->finalize (object);
+}
+
+static void
+gst_limiter_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstLimiter *limiter = GST_LIMITER (object);
+
+  GST_OBJECT_LOCK (limiter);
+  switch (prop_id) {
+    case PROP_MODE:
+      limiter->mode = g_value_get_enum (value);
+      break;
+    case PROP_THRESHOLD:
+      limiter->threshold = g_value_get_double (value);
+      break;
+    case PROP_RATIO:
+      limiter->ratio = g_value_get_double (value);
+      break;
+    case PROP_KNEE:
+      limiter->knee = g_value_get_double (value);
+      break;
+    case PROP_MAKEUP_GAIN:
+      limiter->makeup_gain = g_value_get_double (value);
+      break;
+    case PROP_ATTACK:
+      limiter->attack = g_value_get_double (value);
+      break;
+    case PROP_RELEASE:
+      limiter->release = g_value_get_double (value);
+      break;
+    case PROP_LOOKAHEAD:
+      limiter->lookahead = g_value_get_double (value);
+      break;
+    case PROP_LINK:
+      limiter->link = g_value_get_enum (value);
+      break;
+    case PROP_TRUE_PEAK:
+      limiter->true_peak = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (limiter);
+
+  /* picked up by the streaming thread before the next buffer */
+  g_atomic_int_set (&limiter->params_dirty, 1);
+}
+
+static void
+gst_limiter_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstLimiter *limiter = GST_LIMITER (object);
+
+  GST_OBJECT_LOCK (limiter);
+  switch (prop_id) {
+    case PROP_MODE:
+      g_value_set_enum (value, limiter->mode);
+      break;
+    case PROP_THRESHOLD:
+      g_value_set_double (value, limiter->threshold);
+      break;
+    case PROP_RATIO:
+      g_value_set_double (value, limiter->ratio);
+      break;
+    case PROP_KNEE:
+      g_value_set_double (value, limiter->knee);
+      break;
+    case PROP_MAKEUP_GAIN:
+      g_value_set_double (value, limiter->makeup_gain);
+      break;
+    case PROP_ATTACK:
+      g_value_set_double (value, limiter->attack);
+      break;
+    case PROP_RELEASE:
+      g_value_set_double (value, limiter->release);
+      break;
+    case PROP_LOOKAHEAD:
+      g_value_set_double (value, limiter->lookahead);
+      break;
+    case PROP_LINK:
+      g_value_set_enum (value, limiter->link);
+      break;
+    case PROP_TRUE_PEAK:
+      g_value_set_boolean (value, limiter->true_peak);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (limiter);
+}
+
+/* copy the properties into the processor, no allocation */
+static void
+gst_limiter_update_params (GstLimiter * limiter)
+{
+  GstDynamicsParams params;
+
+  GST_OBJECT_LOCK (limiter);
+  params.threshold = limiter->threshold;
+  params.ratio = limiter->mode == GST_LIMITER_MODE_LIMITER ?
+      0.0 : limiter->ratio;
+  params.knee = limiter->knee;
+  params.makeup = limiter->makeup_gain;
+  params.attack = limiter->attack;
+  params.release = limiter->release;
+  params.linked = limiter->link == GST_LIMITER_LINK_LINKED;
+  params.true_peak = limiter->true_peak;
+  GST_OBJECT_UNLOCK (limiter);
+
+  gst_dynamics_set_params (limiter->dyn, &params);
+}
+
+static gboolean
+gst_limiter_setup (GstAudioFilter * filter, const GstAudioInfo * info)
+{
+  GstLimiter *limiter = GST_LIMITER (filter);
+  gint rate = GST_AUDIO_INFO_RATE (info);
+  guint lookahead, latency;
+
+  GST_OBJECT_LOCK (limiter);
+  lookahead = (guint) (limiter->lookahead / 1000.0 * rate + 0.5);
+  GST_OBJECT_UNLOCK (limiter);
+
+  gst_dynamics_free (limiter->dyn);
+  limiter->dyn = gst_dynamics_new (rate, GST_AUDIO_INFO_CHANNELS (info),
+      lookahead);
+  g_atomic_int_set (&limiter->params_dirty, 0);
+  gst_limiter_update_params (limiter);
+
+  latency = gst_dynamics_get_latency (limiter->dyn);
+  GST_INFO_OBJECT (limiter, "rate %d, %d channels, latency %u frames", rate,
+      GST_AUDIO_INFO_CHANNELS (info), latency);
+
+  gst_audio_latency_update (filter, &limiter->latency, latency);
+  return TRUE;
+}
+
+static gboolean
+gst_limiter_stop (GstBaseTransform * base_transform)
+{
+  GstLimiter *limiter = GST_LIMITER (base_transform);
+
+  gst_dynamics_free (limiter->dyn);
+  limiter->dyn = NULL;
+  g_atomic_int_set (&limiter->latency, 0);
+  limiter->next_ts = GST_CLOCK_TIME_NONE;
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_limiter_transform_ip (GstBaseTransform * base_transform, GstBuffer * buf)
+{
+  GstLimiter *limiter = GST_LIMITER (base_transform);
+  GstMapInfo map;
+
+  if (limiter->dyn == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  if (g_atomic_int_compare_and_exchange (&limiter->params_dirty, 1, 0))
+    gst_limiter_update_params (limiter);
+
+  gst_audio_latency_track (&limiter->next_ts, buf);
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READWRITE))
+    return GST_FLOW_ERROR;
+
+  gst_dynamics_process (limiter->dyn, (gfloat *) map.data,
+      map.size / GST_AUDIO_INFO_BPF (GST_AUDIO_FILTER_INFO (limiter)));
+
+  gst_buffer_unmap (buf, &map);
+  return GST_FLOW_OK;
+}
+
+/* the samples still in the delay line come out of silence */
+static void
+gst_limiter_process_tail (GstAudioFilter * filter, gfloat * data,
+    guint frames)
+{
+  gst_dynamics_process (GST_LIMITER (filter)->dyn, data, frames);
+}
+
+static gboolean
+gst_limiter_sink_event (GstBaseTransform * base_transform, GstEvent * event)
+{
+  GstLimiter *limiter = GST_LIMITER (base_transform);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      if (limiter->dyn)
+        gst_audio_latency_drain (GST_AUDIO_FILTER (limiter),
+            gst_dynamics_get_latency (limiter->dyn), limiter->next_ts,
+            gst_limiter_process_tail);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      if (limiter->dyn)
+        gst_dynamics_reset (limiter->dyn);
+      limiter->next_ts = GST_CLOCK_TIME_NONE;
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (gst_limiter_parent_class)->sink_event
+      (base_transform, event);
+}
+
+/* add the lookahead delay to the upstream latency */
+static gboolean
+gst_limiter_query (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstLimiter *limiter = GST_LIMITER (base_transform);
+
+  if (!GST_BASE_TRANSFORM_CLASS (gst_limiter_parent_class)->query
+      (base_transform, direction, query))
+    return FALSE;
+
+  gst_audio_latency_query (GST_AUDIO_FILTER (limiter), &limiter->latency,
+      direction, query);
+  return TRUE;
+}
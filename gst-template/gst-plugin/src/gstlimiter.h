@@ -0,0 +1,98 @@
+/* GStreamer lookahead compressor / limiter
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_LIMITER_H__
+#define __GST_LIMITER_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/audio/gstaudiofilter.h>
+
+#include "gstdynamics.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_LIMITER_MODE_COMPRESSOR,
+  GST_LIMITER_MODE_LIMITER
+} GstLimiterMode;
+
+typedef enum
+{
+  GST_LIMITER_LINK_LINKED,
+  GST_LIMITER_LINK_INDEPENDENT
+} GstLimiterLink;
+
+#define GST_TYPE_LIMITER (gst_limiter_get_type())
+G_DECLARE_FINAL_TYPE (GstLimiter, gst_limiter, GST, LIMITER, GstAudioFilter)
+
+struct _GstLimiter
+{
+  GstAudioFilter audiofilter;
+
+  /* properties, protected by the object lock */
+  GstLimiterMode mode;
+  gdouble threshold;
+  gdouble ratio;
+  gdouble knee;
+  gdouble makeup_gain;
+  gdouble attack;
+  gdouble release;
+  gdouble lookahead;
+  GstLimiterLink link;
+  gboolean true_peak;
+  gint params_dirty;            /* atomic */
+
+  /* streaming thread */
+  GstDynamics *dyn;
+  gint latency;                 /* frames, atomic */
+  GstClockTime next_ts;
+};
+
+GST_ELEMENT_REGISTER_DECLARE (limiter);
+
+G_END_DECLS
+
+#endif /* __GST_LIMITER_H__ */
@@ -0,0 +1,483 @@
+/* GStreamer EBU R128 loudness measurement
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* ITU-R BS.1770-4 / EBU R128 loudness measurement.
+ *
+ * The K-weighting filter (shelving pre-filter and RLB high-pass) runs in
+ * double precision on channel pairs, one channel per SSE2 lane. Its
+ * output energy is summed in 100 ms sub-blocks: momentary loudness is the
+ * last 4 sub-blocks, short-term the last 30. Gating blocks for integrated
+ * loudness and short-term values for the loudness range (EBU Tech 3342)
+ * go into 0.1 LU histograms, so memory use does not grow with the
+ * measurement time.
+ *
+ * True peak comes from the 4x interpolator in gsttruepeak.c.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "gstloudness.h"
+#include "gsttruepeak.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define SUB_BLOCKS_MOMENTARY 4
+#define SUB_BLOCKS_SHORT_TERM 30
+
+#define HIST_MIN (-70.0)
+#define HIST_BINS 800           /* -70 to +10 LUFS in 0.1 LU steps */
+
+#define SCRATCH_FRAMES 256
+
+struct _GstLoudness
+{
+  guint rate;
+  guint channels;
+  guint n_pairs;
+  gdouble *weights;             /* n_pairs * 2, odd channel counts pad 0 */
+
+  /* K-weighting, direct form II transposed. a0 is 1 and the RLB
+   * high-pass numerator is always 1, -2, 1 */
+  gdouble pb[3], pa[3];
+  gdouble ra[3];
+  gdouble *state;               /* per pair: z1a, z2a, z1b, z2b, 2 lanes each */
+  gdouble *energy;              /* per channel, current sub-block */
+
+  guint sub_len;
+  guint sub_pos;
+  gdouble ring[SUB_BLOCKS_SHORT_TERM];
+  guint ring_pos;
+  guint64 n_sub;
+
+  guint hist_momentary[HIST_BINS];
+  guint hist_short_term[HIST_BINS];
+
+  GstTruePeak *tp;
+  gfloat *true_peak;
+  gfloat *sample_peak;
+
+  gfloat *scratch;
+};
+
+static void
+gst_loudness_init_kweighting (GstLoudness * l)
+{
+  gdouble f0, G, Q, K, Vh, Vb, a0;
+
+  /* coefficients of BS.1770 for any rate, from the analog prototypes */
+  f0 = 1681.974450955533;
+  G = 3.999843853973347;
+  Q = 0.7071752369554196;
+  K = tan (G_PI * f0 / l->rate);
+  Vh = pow (10.0, G / 20.0);
+  Vb = pow (Vh, 0.4996667741545416);
+  a0 = 1.0 + K / Q + K * K;
+  l->pb[0] = (Vh + Vb * K / Q + K * K) / a0;
+  l->pb[1] = 2.0 * (K * K - Vh) / a0;
+  l->pb[2] = (Vh - Vb * K / Q + K * K) / a0;
+  l->pa[0] = 1.0;
+  l->pa[1] = 2.0 * (K * K - 1.0) / a0;
+  l->pa[2] = (1.0 - K / Q + K * K) / a0;
+
+  f0 = 38.13547087602444;
+  Q = 0.5003270373238773;
+  K = tan (G_PI * f0 / l->rate);
+  a0 = 1.0 + K / Q + K * K;
+  l->ra[0] = 1.0;
+  l->ra[1] = 2.0 * (K * K - 1.0) / a0;
+  l->ra[2] = (1.0 - K / Q + K * K) / a0;
+}
+
+GstLoudness *
+gst_loudness_new (guint rate, guint channels, const gdouble * weights)
+{
+  GstLoudness *l;
+  guint c;
+
+  g_return_val_if_fail (rate > 0 && channels > 0, NULL);
+
+  l = g_new0 (GstLoudness, 1);
+  l->rate = rate;
+  l->channels = channels;
+  l->n_pairs = (channels + 1) / 2;
+  l->weights = g_new0 (gdouble, l->n_pairs * 2);
+  for (c = 0; c < channels; c++)
+    l->weights[c] = weights ? weights[c] : 1.0;
+
+  l->state = g_new0 (gdouble, l->n_pairs * 8);
+  l->energy = g_new0 (gdouble, l->n_pairs * 2);
+  l->sub_len = MAX (rate / 10, 1);
+
+  l->tp = gst_true_peak_new (channels);
+  l->true_peak = g_new0 (gfloat, channels);
+  l->sample_peak = g_new0 (gfloat, channels);
+  l->scratch = g_new (gfloat, SCRATCH_FRAMES * channels);
+
+  gst_loudness_init_kweighting (l);
+
+  return l;
+}
+
+void
+gst_loudness_free (GstLoudness * l)
+{
+  if (l == NULL)
+    return;
+
+  g_free (l->weights);
+  g_free (l->state);
+  g_free (l->energy);
+  gst_true_peak_free (l->tp);
+  g_free (l->true_peak);
+  g_free (l->sample_peak);
+  g_free (l->scratch);
+  g_free (l);
+}
+
+void
+gst_loudness_reset (GstLoudness * l)
+{
+  memset (l->state, 0, l->n_pairs * 8 * sizeof (gdouble));
+  memset (l->energy, 0, l->n_pairs * 2 * sizeof (gdouble));
+  l->sub_pos = 0;
+  memset (l->ring, 0, sizeof (l->ring));
+  l->ring_pos = 0;
+  l->n_sub = 0;
+  memset (l->hist_momentary, 0, sizeof (l->hist_momentary));
+  memset (l->hist_short_term, 0, sizeof (l->hist_short_term));
+  gst_true_peak_reset (l->tp);
+  memset (l->true_peak, 0, l->channels * sizeof (gfloat));
+  memset (l->sample_peak, 0, l->channels * sizeof (gfloat));
+}
+
+/* K-weight channels 2 * pair and 2 * pair + 1 and sum their energy */
+static void
+gst_loudness_kweight_pair (GstLoudness * l, guint pair, const gfloat * data,
+    guint frames)
+{
+  guint ch = l->channels, c = 2 * pair, f;
+  gboolean odd = c + 1 >= ch;
+  gdouble *z = l->state + pair * 8;
+
+#ifdef __SSE2__
+  __m128d pb0 = _mm_set1_pd (l->pb[0]), pb1 = _mm_set1_pd (l->pb[1]);
+  __m128d pb2 = _mm_set1_pd (l->pb[2]), pa1 = _mm_set1_pd (l->pa[1]);
+  __m128d pa2 = _mm_set1_pd (l->pa[2]), ra1 = _mm_set1_pd (l->ra[1]);
+  __m128d ra2 = _mm_set1_pd (l->ra[2]), two = _mm_set1_pd (2.0);
+  __m128d z1a = _mm_loadu_pd (z), z2a = _mm_loadu_pd (z + 2);
+  __m128d z1b = _mm_loadu_pd (z + 4), z2b = _mm_loadu_pd (z + 6);
+  __m128d e = _mm_loadu_pd (l->energy + c);
+
+  for (f = 0; f < frames; f++) {
+    const gfloat *s = data + f * ch + c;
+    __m128d x = _mm_set_pd (odd ? 0.0 : s[1], s[0]);
+    __m128d y1, y2;
+
+    y1 = _mm_add_pd (_mm_mul_pd (pb0, x), z1a);
+    z1a = _mm_add_pd (_mm_sub_pd (_mm_mul_pd (pb1, x), _mm_mul_pd (pa1, y1)),
+        z2a);
+    z2a = _mm_sub_pd (_mm_mul_pd (pb2, x), _mm_mul_pd (pa2, y1));
+
+    /* the RLB high-pass has b = 1, -2, 1 */
+    y2 = _mm_add_pd (y1, z1b);
+    z1b = _mm_sub_pd (_mm_sub_pd (z2b, _mm_mul_pd (two, y1)),
+        _mm_mul_pd (ra1, y2));
+    z2b = _mm_sub_pd (y1, _mm_mul_pd (ra2, y2));
+
+    e = _mm_add_pd (e, _mm_mul_pd (y2, y2));
+  }
+
+  _mm_storeu_pd (z, z1a);
+  _mm_storeu_pd (z + 2, z2a);
+  _mm_storeu_pd (z + 4, z1b);
+  _mm_storeu_pd (z + 6, z2b);
+  _mm_storeu_pd (l->energy + c, e);
+#else
+  guint lane;
+
+  for (lane = 0; lane < 2; lane++) {
+    gdouble z1a = z[lane], z2a = z[2 + lane];
+    gdouble z1b = z[4 + lane], z2b = z[6 + lane];
+    gdouble e = l->energy[c + lane];
+
+    if (lane == 1 && odd)
+      break;
+
+    for (f = 0; f < frames; f++) {
+      gdouble x = data[f * ch + c + lane], y1, y2;
+
+      y1 = l->pb[0] * x + z1a;
+      z1a = l->pb[1] * x - l->pa[1] * y1 + z2a;
+      z2a = l->pb[2] * x - l->pa[2] * y1;
+
+      y2 = y1 + z1b;
+      z1b = -2.0 * y1 - l->ra[1] * y2 + z2b;
+      z2b = y1 - l->ra[2] * y2;
+
+      e += y2 * y2;
+    }
+
+    z[lane] = z1a;
+    z[2 + lane] = z2a;
+    z[4 + lane] = z1b;
+    z[6 + lane] = z2b;
+    l->energy[c + lane] = e;
+  }
+#endif
+}
+
+static inline gdouble
+energy_to_lufs (gdouble energy)
+{
+  return energy > 0.0 ? 10.0 * log10 (energy) - 0.691 : -HUGE_VAL;
+}
+
+static inline gdouble
+lufs_to_energy (gdouble lufs)
+{
+  return pow (10.0, (lufs + 0.691) / 10.0);
+}
+
+static void
+hist_add (guint * hist, gdouble lufs)
+{
+  gint bin;
+
+  /* absolute gate */
+  if (lufs < HIST_MIN)
+    return;
+  bin = (gint) ((lufs - HIST_MIN) * 10.0);
+  hist[MIN (bin, HIST_BINS - 1)]++;
+}
+
+static inline gdouble
+hist_lufs (guint bin)
+{
+  return HIST_MIN + (bin + 0.5) / 10.0;
+}
+
+/* mean energy of the last n sub-blocks */
+static gdouble
+gst_loudness_window (const GstLoudness * l, guint n)
+{
+  gdouble sum = 0.0;
+  guint i;
+
+  for (i = 1; i <= n; i++)
+    sum += l->ring[(l->ring_pos + SUB_BLOCKS_SHORT_TERM - i) %
+        SUB_BLOCKS_SHORT_TERM];
+  return sum / n;
+}
+
+static void
+gst_loudness_end_sub_block (GstLoudness * l)
+{
+  gdouble e = 0.0;
+  guint c, i;
+
+  for (c = 0; c < l->channels; c++) {
+    e += l->weights[c] * l->energy[c];
+    l->energy[c] = 0.0;
+  }
+  l->ring[l->ring_pos] = e / l->sub_len;
+  l->ring_pos = (l->ring_pos + 1) % SUB_BLOCKS_SHORT_TERM;
+  l->n_sub++;
+  l->sub_pos = 0;
+
+  /* 400 ms gating blocks overlap by 75 %, one per sub-block */
+  if (l->n_sub >= SUB_BLOCKS_MOMENTARY)
+    hist_add (l->hist_momentary,
+        energy_to_lufs (gst_loudness_window (l, SUB_BLOCKS_MOMENTARY)));
+  if (l->n_sub >= SUB_BLOCKS_SHORT_TERM)
+    hist_add (l->hist_short_term,
+        energy_to_lufs (gst_loudness_window (l, SUB_BLOCKS_SHORT_TERM)));
+
+  /* keep the filters out of denormals during silence */
+  for (i = 0; i < l->n_pairs * 8; i++)
+    if (fabs (l->state[i]) < 1e-30)
+      l->state[i] = 0.0;
+}
+
+void
+gst_loudness_process_f32 (GstLoudness * l, const gfloat * data, guint frames)
+{
+  while (frames > 0) {
+    guint n = MIN (frames, l->sub_len - l->sub_pos), i;
+
+    for (i = 0; i < l->n_pairs; i++)
+      gst_loudness_kweight_pair (l, i, data, n);
+    gst_true_peak_process (l->tp, data, n, l->true_peak, l->sample_peak);
+
+    data += n * l->channels;
+    frames -= n;
+    l->sub_pos += n;
+    if (l->sub_pos == l->sub_len)
+      gst_loudness_end_sub_block (l);
+  }
+}
+
+void
+gst_loudness_process_s16 (GstLoudness * l, const gint16 * data, guint frames)
+{
+  while (frames > 0) {
+    guint n = MIN (frames, SCRATCH_FRAMES), i;
+
+    for (i = 0; i < n * l->channels; i++)
+      l->scratch[i] = data[i] * (1.0f / 32768.0f);
+    gst_loudness_process_f32 (l, l->scratch, n);
+
+    data += n * l->channels;
+    frames -= n;
+  }
+}
+
+gdouble
+gst_loudness_momentary (const GstLoudness * l)
+{
+  if (l->n_sub == 0)
+    return -HUGE_VAL;
+  return energy_to_lufs (gst_loudness_window (l, SUB_BLOCKS_MOMENTARY));
+}
+
+gdouble
+gst_loudness_short_term (const GstLoudness * l)
+{
+  if (l->n_sub == 0)
+    return -HUGE_VAL;
+  return energy_to_lufs (gst_loudness_window (l, SUB_BLOCKS_SHORT_TERM));
+}
+
+gdouble
+gst_loudness_integrated (const GstLoudness * l)
+{
+  gdouble sum = 0.0, gate;
+  guint64 n = 0;
+  guint i, first;
+
+  for (i = 0; i < HIST_BINS; i++) {
+    sum += l->hist_momentary[i] * lufs_to_energy (hist_lufs (i));
+    n += l->hist_momentary[i];
+  }
+  if (n == 0)
+    return -HUGE_VAL;
+
+  /* relative gate 10 LU below the absolute gated loudness */
+  gate = energy_to_lufs (sum / n) - 10.0;
+  first = gate <= HIST_MIN ? 0 : (guint) ceil ((gate - HIST_MIN) * 10.0 -
+      0.5);
+
+  sum = 0.0;
+  n = 0;
+  for (i = first; i < HIST_BINS; i++) {
+    sum += l->hist_momentary[i] * lufs_to_energy (hist_lufs (i));
+    n += l->hist_momentary[i];
+  }
+  return n ? energy_to_lufs (sum / n) : -HUGE_VAL;
+}
+
+gdouble
+gst_loudness_range (const GstLoudness * l)
+{
+  gdouble sum = 0.0, gate;
+  guint64 n = 0, seen, lo_rank, hi_rank;
+  guint i, first;
+  gdouble lo = 0.0, hi = 0.0;
+
+  for (i = 0; i < HIST_BINS; i++) {
+    sum += l->hist_short_term[i] * lufs_to_energy (hist_lufs (i));
+    n += l->hist_short_term[i];
+  }
+  if (n == 0)
+    return 0.0;
+
+  /* relative gate 20 LU below, then the 10 % to 95 % spread */
+  gate = energy_to_lufs (sum / n) - 20.0;
+  first = gate <= HIST_MIN ? 0 : (guint) ceil ((gate - HIST_MIN) * 10.0 -
+      0.5);
+
+  n = 0;
+  for (i = first; i < HIST_BINS; i++)
+    n += l->hist_short_term[i];
+  if (n == 0)
+    return 0.0;
+
+  lo_rank = (guint64) (0.10 * (n - 1));
+  hi_rank = (guint64) (0.95 * (n - 1));
+  seen = 0;
+  for (i = first; i < HIST_BINS; i++) {
+    guint64 next = seen + l->hist_short_term[i];
+
+    if (seen <= lo_rank && lo_rank < next)
+      lo = hist_lufs (i);
+    if (seen <= hi_rank && hi_rank < next) {
+      hi = hist_lufs (i);
+      break;
+    }
+    seen = next;
+  }
+  return hi - lo;
+}
+
+gdouble
+gst_loudness_true_peak (const GstLoudness * l, guint channel)
+{
+  g_return_val_if_fail (channel < l->channels, 0.0);
+
+  /* the interpolated peak can never be below the sample peak */
+  return MAX (l->true_peak[channel], l->sample_peak[channel]);
+}
+
+gdouble
+gst_loudness_sample_peak (const GstLoudness * l, guint channel)
+{
+  g_return_val_if_fail (channel < l->channels, 0.0);
+
+  return l->sample_peak[channel];
+}
@@ -0,0 +1,79 @@
+/* GStreamer EBU R128 loudness measurement
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_LOUDNESS_H__
+#define __GST_LOUDNESS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstLoudness GstLoudness;
+
+/* weights holds one ITU-R BS.1770 channel weight per channel, NULL for 1.0
+ * on every channel */
+GstLoudness *gst_loudness_new (guint rate, guint channels,
+    const gdouble * weights);
+void gst_loudness_free (GstLoudness * loudness);
+void gst_loudness_reset (GstLoudness * loudness);
+
+/* interleaved frames, processing never allocates */
+void gst_loudness_process_f32 (GstLoudness * loudness, const gfloat * data,
+    guint frames);
+void gst_loudness_process_s16 (GstLoudness * loudness, const gint16 * data,
+    guint frames);
+
+/* LUFS, -HUGE_VAL while there is nothing to measure */
+gdouble gst_loudness_momentary (const GstLoudness * loudness);
+gdouble gst_loudness_short_term (const GstLoudness * loudness);
+gdouble gst_loudness_integrated (const GstLoudness * loudness);
+/* LU */
+gdouble gst_loudness_range (const GstLoudness * loudness);
+/* linear, since the last reset */
+gdouble gst_loudness_true_peak (const GstLoudness * loudness, guint channel);
+gdouble gst_loudness_sample_peak (const GstLoudness * loudness,
+    guint channel);
+
+G_END_DECLS
+
+#endif /* __GST_LOUDNESS_H__ */
@@ -0,0 +1,440 @@
+/* GStreamer EBU R128 loudness meter
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/**
+ * SECTION:element-loudnessmeter
+ *
+ * Measures loudness as defined by EBU R128 / ITU-R BS.1770 and posts it
+ * on the bus. The audio passes through untouched, buffers are only mapped
+ * for reading.
+ *
+ * Every interval nanoseconds of audio an element message named
+ * "loudness" is posted with these fields:
+ * <itemizedlist>
+ * <listitem><para>
+ * #GstClockTime
+ * <classname>&quot;timestamp&quot;</classname>,
+ * <classname>&quot;stream-time&quot;</classname>,
+ * <classname>&quot;running-time&quot;</classname>:
+ * end of the measured audio
+ * </para></listitem>
+ * <listitem><para>
+ * #gdouble
+ * <classname>&quot;momentary&quot;</classname>,
+ * <classname>&quot;short-term&quot;</classname>,
+ * <classname>&quot;integrated&quot;</classname>:
+ * loudness over 400 ms, 3 s and since the start, in LUFS
+ * </para></listitem>
+ * <listitem><para>
+ * #gdouble
+ * <classname>&quot;loudness-range&quot;</classname>:
+ * EBU Tech 3342 loudness range in LU
+ * </para></listitem>
+ * <listitem><para>
+ * #GstValueArray of #gdouble
+ * <classname>&quot;true-peak&quot;</classname>,
+ * <classname>&quot;sample-peak&quot;</classname>:
+ * per channel peaks since the start in dBTP and dBFS, with the maximum
+ * over all channels in
+ * <classname>&quot;max-true-peak&quot;</classname> and
+ * <classname>&quot;max-sample-peak&quot;</classname>
+ * </para></listitem>
+ * </itemizedlist>
+ *
+ * Loudness values are -inf while there is nothing to measure. The
+ * measurement restarts on a flush and on caps changes.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -m uridecodebin uri=file:///path/to/file ! audioconvert ! loudnessmeter interval=1000000000 ! fakesink sync=false
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include "gstloudnessmeter.h"
+
+GST_DEBUG_CATEGORY_STATIC (loudness_meter_debug);
+#define GST_CAT_DEFAULT loudness_meter_debug
+
+enum
+{
+  PROP_0,
+  PROP_INTERVAL,
+  PROP_POST_MESSAGES
+};
+
+#define DEFAULT_INTERVAL (GST_SECOND / 10)
+#define DEFAULT_POST_MESSAGES TRUE
+
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE ("{ " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }") \
+    ", layout = (string) interleaved"
+
+G_DEFINE_TYPE (GstLoudnessMeter, gst_loudness_meter, GST_TYPE_AUDIO_FILTER);
+
+GST_ELEMENT_REGISTER_DEFINE (loudness_meter, "loudnessmeter", GST_RANK_NONE,
+    GST_TYPE_LOUDNESS_METER);
+
+static void gst_loudness_meter_finalize (GObject * object);
+static void gst_loudness_meter_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_loudness_meter_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static gboolean gst_loudness_meter_setup (GstAudioFilter * filter,
+    const GstAudioInfo * info);
+static gboolean gst_loudness_meter_stop (GstBaseTransform * base_transform);
+static gboolean gst_loudness_meter_sink_event (GstBaseTransform *
+    base_transform, GstEvent * event);
+static GstFlowReturn gst_loudness_meter_transform_ip (GstBaseTransform *
+    base_transform, GstBuffer * buf);
+
+static void
+gst_loudness_meter_class_init (GstLoudnessMeterClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstBaseTransformClass *btrans_class = (GstBaseTransformClass *) klass;
+  GstAudioFilterClass *audio_filter_class = (GstAudioFilterClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (loudness_meter_debug, "loudnessmeter", 0,
+      "EBU R128 loudness meter");
+
+  gobject_class->finalize = gst_loudness_meter_finalize;
+  gobject_class->set_property = gst_loudness_meter_set_property;
+  gobject_class->get_property = gst_loudness_meter_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_INTERVAL,
+      g_param_spec_uint64 ("interval", "Interval",
+          "Audio time between loudness messages in nanoseconds",
+          GST_MSECOND, G_MAXUINT64, DEFAULT_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_POST_MESSAGES,
+      g_param_spec_boolean ("post-messages", "Post messages",
+          "Post loudness messages on the bus",
+          DEFAULT_POST_MESSAGES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  audio_filter_class->setup = GST_DEBUG_FUNCPTR (gst_loudness_meter_setup);
+
+  btrans_class->stop = GST_DEBUG_FUNCPTR (gst_loudness_meter_stop);
+  btrans_class->sink_event = GST_DEBUG_FUNCPTR (gst_loudness_meter_sink_event);
+  btrans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_loudness_meter_transform_ip);
+
+  gst_element_class_set_details_simple (element_class, "Loudness meter",
+      "Filter/Analyzer/Audio",
+      "EBU R128 loudness and true peak measurement",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  caps = gst_caps_from_string (SUPPORTED_CAPS_STRING);
+  gst_audio_filter_class_add_pad_templates (audio_filter_class, caps);
+  gst_caps_unref (caps);
+}
+
+static void
+gst_loudness_meter_init (GstLoudnessMeter * meter)
+{
+  meter->interval = DEFAULT_INTERVAL;
+  meter->post_messages = DEFAULT_POST_MESSAGES;
+
+  meter->loudness = NULL;
+  meter->interval_frames = 0;
+  meter->frames_left = 0;
+
+  /* analysis only, transform_ip still runs on the untouched buffers */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (meter), TRUE);
+}
+
+static void
+gst_loudness_meter_finalize (GObject * object)
+{
+  GstLoudnessMeter *meter = GST_LOUDNESS_METER (object);
+
+  gst_loudness_free (meter->loudness);
+
+  G_OBJECT_CLASS (gst_loudness_meter_parent_class)->finalize (object);
+}
+
+static void
+gst_loudness_meter_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstLoudnessMeter *meter = GST_LOUDNESS_METER (object);
+
+  switch (prop_id) {
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (meter);
+      meter->interval = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (meter);
+      break;
+    case PROP_POST_MESSAGES:
+      GST_OBJECT_LOCK (meter);
+      meter->post_messages = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (meter);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_loudness_meter_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstLoudnessMeter *meter = GST_LOUDNESS_METER (object);
+
+  GST_OBJECT_LOCK (meter);
+  switch (prop_id) {
+    case PROP_INTERVAL:
+      g_value_set_uint64 (value, meter->interval);
+      break;
+    case PROP_POST_MESSAGES:
+      g_value_set_boolean (value, meter->post_messages);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (meter);
+}
+
+/* ITU-R BS.1770 channel weights: LFE is ignored and the surround channels
+ * count 1.5 dB more */
+static gdouble
+gst_loudness_meter_channel_weight (GstAudioChannelPosition position)
+{
+  switch (position) {
+    case GST_AUDIO_CHANNEL_POSITION_LFE1:
+    case GST_AUDIO_CHANNEL_POSITION_LFE2:
+      return 0.0;
+    case GST_AUDIO_CHANNEL_POSITION_REAR_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_REAR_RIGHT:
+    case GST_AUDIO_CHANNEL_POSITION_SIDE_LEFT:
+    case GST_AUDIO_CHANNEL_POSITION_SIDE_RIGHT:
+      return 1.41;
+    default:
+      return 1.0;
+  }
+}
+
+static gboolean
+gst_loudness_meter_setup (GstAudioFilter * filter, const GstAudioInfo * info)
+{
+  GstLoudnessMeter *meter = GST_LOUDNESS_METER (filter);
+  gint channels = GST_AUDIO_INFO_CHANNELS (info);
+  gdouble *weights;
+  gint c;
+
+  GST_INFO_OBJECT (meter, "rate %d, %d channels", GST_AUDIO_INFO_RATE (info),
+      channels);
+
+  weights = g_new (gdouble, channels);
+  for (c = 0; c < channels; c++)
+    weights[c] = gst_loudness_meter_channel_weight (info->position[c]);
+
+  gst_loudness_free (meter->loudness);
+  meter->loudness = gst_loudness_new (GST_AUDIO_INFO_RATE (info), channels,
+      weights);
+  g_free (weights);
+
+  meter->frames_left = 0;
+  return TRUE;
+}
+
+static gboolean
+gst_loudness_meter_stop (GstBaseTransform * base_transform)
+{
+  GstLoudnessMeter *meter = GST_LOUDNESS_METER (base_transform);
+
+  gst_loudness_free (meter->loudness);
+  meter->loudness = NULL;
+  return TRUE;
+}
+
+static gboolean
+gst_loudness_meter_sink_event (GstBaseTransform * base_transform,
+    GstEvent * event)
+{
+  GstLoudnessMeter *meter = GST_LOUDNESS_METER (base_transform);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP && meter->loudness) {
+    gst_loudness_reset (meter->loudness);
+    meter->frames_left = 0;
+  }
+
+  return
+      GST_BASE_TRANSFORM_CLASS (gst_loudness_meter_parent_class)->sink_event
+      (base_transform, event);
+}
+
+static gdouble
+to_db (gdouble linear)
+{
+  return linear > 0.0 ? 20.0 * log10 (linear) : -HUGE_VAL;
+}
+
+static void
+set_double_array (GstStructure * s, const gchar * field,
+    const GstLoudness * loudness, guint channels,
+    gdouble (*peak) (const GstLoudness *, guint))
+{
+  GValue array = G_VALUE_INIT, v = G_VALUE_INIT;
+  gdouble max = 0.0;
+  gchar *max_field;
+  guint c;
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (c = 0; c < channels; c++) {
+    gdouble p = peak (loudness, c);
+
+    max = MAX (max, p);
+    g_value_set_double (&v, to_db (p));
+    gst_value_array_append_value (&array, &v);
+  }
+  gst_structure_take_value (s, field, &array);
+
+  max_field = g_strconcat ("max-", field, NULL);
+  gst_structure_set (s, max_field, G_TYPE_DOUBLE, to_db (max), NULL);
+  g_free (max_field);
+  g_value_unset (&v);
+}
+
+static void
+gst_loudness_meter_post (GstLoudnessMeter * meter, GstClockTime ts)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM (meter);
+  GstSegment *segment = &trans->segment;
+  GstLoudness *l = meter->loudness;
+  guint channels = GST_AUDIO_INFO_CHANNELS (GST_AUDIO_FILTER_INFO (meter));
+  GstStructure *s;
+
+  s = gst_structure_new ("loudness",
+      "timestamp", G_TYPE_UINT64, ts,
+      "stream-time", G_TYPE_UINT64,
+      gst_segment_to_stream_time (segment, GST_FORMAT_TIME, ts),
+      "running-time", G_TYPE_UINT64,
+      gst_segment_to_running_time (segment, GST_FORMAT_TIME, ts),
+      "momentary", G_TYPE_DOUBLE, gst_loudness_momentary (l),
+      "short-term", G_TYPE_DOUBLE, gst_loudness_short_term (l),
+      "integrated", G_TYPE_DOUBLE, gst_loudness_integrated (l),
+      "loudness-range", G_TYPE_DOUBLE, gst_loudness_range (l), NULL);
+  set_double_array (s, "true-peak", l, channels, gst_loudness_true_peak);
+  set_double_array (s, "sample-peak", l, channels, gst_loudness_sample_peak);
+
+  gst_element_post_message (GST_ELEMENT (meter),
+      gst_message_new_element (GST_OBJECT (meter), s));
+}
+
+static GstFlowReturn
+gst_loudness_meter_transform_ip (GstBaseTransform * base_transform,
+    GstBuffer * buf)
+{
+  GstLoudnessMeter *meter = GST_LOUDNESS_METER (base_transform);
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (meter);
+  gint rate = GST_AUDIO_INFO_RATE (info);
+  guint bpf = GST_AUDIO_INFO_BPF (info);
+  GstClockTime interval;
+  gboolean post_messages;
+  GstMapInfo map;
+  guint8 *data;
+  guint frames, done = 0;
+
+  if (meter->loudness == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  GST_OBJECT_LOCK (meter);
+  interval = meter->interval;
+  post_messages = meter->post_messages;
+  GST_OBJECT_UNLOCK (meter);
+
+  meter->interval_frames =
+      MAX (gst_util_uint64_scale_round (interval, rate, GST_SECOND), 1);
+  if (meter->frames_left == 0 || meter->frames_left > meter->interval_frames)
+    meter->frames_left = meter->interval_frames;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+
+  data = map.data;
+  frames = map.size / bpf;
+
+  /* split at the message boundaries so every message covers exactly one
+   * interval */
+  while (done < frames) {
+    guint n = MIN (frames - done, meter->frames_left);
+
+    if (GST_AUDIO_INFO_FORMAT (info) == GST_AUDIO_FORMAT_S16)
+      gst_loudness_process_s16 (meter->loudness,
+          (const gint16 *) (data + done * bpf), n);
+    else
+      gst_loudness_process_f32 (meter->loudness,
+          (const gfloat *) (data + done * bpf), n);
+
+    done += n;
+    meter->frames_left -= n;
+    if (meter->frames_left == 0) {
+      meter->frames_left = meter->interval_frames;
+      if (post_messages && GST_BUFFER_PTS_IS_VALID (buf))
+        gst_loudness_meter_post (meter, GST_BUFFER_PTS (buf) +
+            gst_util_uint64_scale_int (done, GST_SECOND, rate));
+    }
+  }
+
+  gst_buffer_unmap (buf, &map);
+  return GST_FLOW_OK;
+}
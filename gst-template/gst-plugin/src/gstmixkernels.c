@@ -0,0 +1,287 @@
+/* GStreamer audio mixer kernels
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/* Accumulate kernels of the mixer, one variant per instruction set. Every
+ * input pad adds its samples times its volume into the output buffer.
+ *
+ * S16 is scaled in float, rounded to nearest even, saturated to 16 bit
+ * and then added with saturation, in that order in every variant so they
+ * all give the same samples. A volume of exactly 1 skips the float round
+ * trip and is a plain saturating add. F32 is not clipped, the AVX2
+ * variant uses FMA and may differ from the others in the last bit.
+ *
+ * The variants are compiled with target attributes so the file builds
+ * without special flags; which one runs is decided at runtime from CPUID.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include "gstcpufeatures.h"
+#include "gstmixkernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+static void
+accumulate_s16_scalar (gpointer dest, gconstpointer src, guint n_samples,
+    gfloat volume)
+{
+  gint16 *d = dest;
+  const gint16 *s = src;
+  guint i;
+
+  if (volume == 1.0f) {
+    for (i = 0; i < n_samples; i++)
+      d[i] = CLAMP (d[i] + s[i], G_MININT16, G_MAXINT16);
+    return;
+  }
+
+  for (i = 0; i < n_samples; i++) {
+    glong v = lrintf (s[i] * volume);
+
+    v = CLAMP (v, G_MININT16, G_MAXINT16);
+    d[i] = CLAMP (d[i] + v, G_MININT16, G_MAXINT16);
+  }
+}
+
+static void
+accumulate_f32_scalar (gpointer dest, gconstpointer src, guint n_samples,
+    gfloat volume)
+{
+  gfloat *d = dest;
+  const gfloat *s = src;
+  guint i;
+
+  for (i = 0; i < n_samples; i++)
+    d[i] += s[i] * volume;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__ ((target ("sse2")))
+static void
+accumulate_s16_sse2 (gpointer dest, gconstpointer src, guint n_samples,
+    gfloat volume)
+{
+  gint16 *d = dest;
+  const gint16 *s = src;
+  __m128 vol = _mm_set1_ps (volume);
+  guint i = 0;
+
+  if (volume == 1.0f) {
+    for (; i + 8 <= n_samples; i += 8)
+      _mm_storeu_si128 ((__m128i *) (d + i),
+          _mm_adds_epi16 (_mm_loadu_si128 ((const __m128i *) (d + i)),
+              _mm_loadu_si128 ((const __m128i *) (s + i))));
+  } else {
+    for (; i + 8 <= n_samples; i += 8) {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) (s + i));
+      __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+      __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+
+      lo = _mm_cvtps_epi32 (_mm_mul_ps (_mm_cvtepi32_ps (lo), vol));
+      hi = _mm_cvtps_epi32 (_mm_mul_ps (_mm_cvtepi32_ps (hi), vol));
+      _mm_storeu_si128 ((__m128i *) (d + i),
+          _mm_adds_epi16 (_mm_loadu_si128 ((const __m128i *) (d + i)),
+              _mm_packs_epi32 (lo, hi)));
+    }
+  }
+  accumulate_s16_scalar (d + i, s + i, n_samples - i, volume);
+}
+
+__attribute__ ((target ("sse2")))
+static void
+accumulate_f32_sse2 (gpointer dest, gconstpointer src, guint n_samples,
+    gfloat volume)
+{
+  gfloat *d = dest;
+  const gfloat *s = src;
+  __m128 vol = _mm_set1_ps (volume);
+  guint i = 0;
+
+  for (; i + 8 <= n_samples; i += 8) {
+    __m128 a = _mm_mul_ps (_mm_loadu_ps (s + i), vol);
+    __m128 b = _mm_mul_ps (_mm_loadu_ps (s + i + 4), vol);
+
+    _mm_storeu_ps (d + i, _mm_add_ps (_mm_loadu_ps (d + i), a));
+    _mm_storeu_ps (d + i + 4, _mm_add_ps (_mm_loadu_ps (d + i + 4), b));
+  }
+  accumulate_f32_scalar (d + i, s + i, n_samples - i, volume);
+}
+
+/* 16 samples, the 256 bit pack works per 128 bit lane so the quadwords
+ * are put back in order afterwards */
+__attribute__ ((target ("avx2")))
+static void
+accumulate_s16_avx2 (gpointer dest, gconstpointer src, guint n_samples,
+    gfloat volume)
+{
+  gint16 *d = dest;
+  const gint16 *s = src;
+  __m256 vol = _mm256_set1_ps (volume);
+  guint i = 0;
+
+  if (volume == 1.0f) {
+    for (; i + 16 <= n_samples; i += 16)
+      _mm256_storeu_si256 ((__m256i *) (d + i),
+          _mm256_adds_epi16 (_mm256_loadu_si256 ((const __m256i *) (d + i)),
+              _mm256_loadu_si256 ((const __m256i *) (s + i))));
+  } else {
+    for (; i + 16 <= n_samples; i += 16) {
+      __m128i v0 = _mm_loadu_si128 ((const __m128i *) (s + i));
+      __m128i v1 = _mm_loadu_si128 ((const __m128i *) (s + i + 8));
+      __m256i lo = _mm256_cvtepi16_epi32 (v0);
+      __m256i hi = _mm256_cvtepi16_epi32 (v1);
+      __m256i p;
+
+      lo = _mm256_cvtps_epi32 (_mm256_mul_ps (_mm256_cvtepi32_ps (lo), vol));
+      hi = _mm256_cvtps_epi32 (_mm256_mul_ps (_mm256_cvtepi32_ps (hi), vol));
+      p = _mm256_permute4x64_epi64 (_mm256_packs_epi32 (lo, hi),
+          _MM_SHUFFLE (3, 1, 2, 0));
+      _mm256_storeu_si256 ((__m256i *) (d + i),
+          _mm256_adds_epi16 (_mm256_loadu_si256 ((const __m256i *) (d + i)),
+              p));
+    }
+  }
+  accumulate_s16_scalar (d + i, s + i, n_samples - i, volume);
+}
+
+__attribute__ ((target ("avx2,fma")))
+static void
+accumulate_f32_avx2 (gpointer dest, gconstpointer src, guint n_samples,
+    gfloat volume)
+{
+  gfloat *d = dest;
+  const gfloat *s = src;
+  __m256 vol = _mm256_set1_ps (volume);
+  guint i = 0;
+
+  for (; i + 16 <= n_samples; i += 16) {
+    _mm256_storeu_ps (d + i, _mm256_fmadd_ps (_mm256_loadu_ps (s + i), vol,
+            _mm256_loadu_ps (d + i)));
+    _mm256_storeu_ps (d + i + 8, _mm256_fmadd_ps (_mm256_loadu_ps (s + i + 8),
+            vol, _mm256_loadu_ps (d + i + 8)));
+  }
+  accumulate_f32_scalar (d + i, s + i, n_samples - i, volume);
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+static const GstMixKernels kernels[] = {
+  {GST_MIX_ISA_SCALAR, "scalar", accumulate_s16_scalar,
+      accumulate_f32_scalar},
+#ifdef HAVE_X86_KERNELS
+  {GST_MIX_ISA_SSE2, "sse2", accumulate_s16_sse2, accumulate_f32_sse2},
+  {GST_MIX_ISA_AVX2, "avx2", accumulate_s16_avx2, accumulate_f32_avx2},
+#endif
+};
+
+gboolean
+gst_mix_isa_supported (GstMixIsa isa)
+{
+  switch (isa) {
+    case GST_MIX_ISA_AUTO:
+    case GST_MIX_ISA_SCALAR:
+      return TRUE;
+#ifdef HAVE_X86_KERNELS
+    case GST_MIX_ISA_SSE2:
+      return gst_cpu_features_have (GST_CPU_FEATURE_SSE2);
+    case GST_MIX_ISA_AVX2:
+      return gst_cpu_features_have (GST_CPU_FEATURE_AVX2 |
+          GST_CPU_FEATURE_FMA);
+#endif
+    default:
+      return FALSE;
+  }
+}
+
+/* scalar is always supported */
+GstMixIsa
+gst_mix_isa_best (void)
+{
+  GstMixIsa isa = GST_MIX_ISA_AVX2;
+
+  while (!gst_mix_isa_supported (isa))
+    isa--;
+  return isa;
+}
+
+/* the kernels for an ISA level, the best one for AUTO. Returns NULL when
+ * the level is not compiled in or not supported by this CPU */
+const GstMixKernels *
+gst_mix_kernels_get (GstMixIsa isa)
+{
+  guint i;
+
+  if (isa == GST_MIX_ISA_AUTO)
+    isa = gst_mix_isa_best ();
+  else if (!gst_mix_isa_supported (isa))
+    return NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (kernels); i++) {
+    if (kernels[i].isa == isa)
+      return &kernels[i];
+  }
+  return NULL;
+}
+
+GstMixAccumulateFunc
+gst_mix_kernels_accumulate (const GstMixKernels * set,
+    GstAudioFormat format)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return set->accumulate_s16;
+    case GST_AUDIO_FORMAT_F32:
+      return set->accumulate_f32;
+    default:
+      return NULL;
+  }
+}
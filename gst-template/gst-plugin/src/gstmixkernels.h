@@ -0,0 +1,86 @@
+/* GStreamer audio mixer kernels
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_MIX_KERNELS_H__
+#define __GST_MIX_KERNELS_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+
+/* instruction set levels, each one implies the ones before it */
+typedef enum
+{
+  GST_MIX_ISA_AUTO,
+  GST_MIX_ISA_SCALAR,
+  GST_MIX_ISA_SSE2,
+  GST_MIX_ISA_AVX2
+} GstMixIsa;
+
+/* dest[i] += src[i] * volume for n_samples native endian samples, integer
+ * formats saturate */
+typedef void (*GstMixAccumulateFunc) (gpointer dest, gconstpointer src,
+    guint n_samples, gfloat volume);
+
+typedef struct
+{
+  GstMixIsa isa;
+  const gchar *name;
+
+  GstMixAccumulateFunc accumulate_s16;
+  GstMixAccumulateFunc accumulate_f32;
+} GstMixKernels;
+
+GstMixIsa gst_mix_isa_best (void);
+gboolean gst_mix_isa_supported (GstMixIsa isa);
+const GstMixKernels *gst_mix_kernels_get (GstMixIsa isa);
+
+/* the kernel of a set for a format, NULL if unsupported */
+GstMixAccumulateFunc gst_mix_kernels_accumulate (const GstMixKernels *
+    set, GstAudioFormat format);
+
+G_END_DECLS
+
+#endif /* __GST_MIX_KERNELS_H__ */
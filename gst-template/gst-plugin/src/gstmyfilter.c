@@ -2,8 +2,15 @@
 #include <config.h>
 #endif
 
+#include <string.h>
 #include <gst/gst.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "gstmyfilter.h"
 
 GST_DEBUG_CATEGORY_STATIC(gst_my_filter_debug); // 定义静态调试类别
@@ -19,22 +26,105 @@ enum
 enum
 {
     PROP_0,
-    PROP_SILENT // 静默属性
+    PROP_SILENT,     // 静默属性
+    PROP_BATCH_SIZE, // 批大小
+    PROP_BATCH_TIME, // 批时间窗口
+    PROP_STATS_INTERVAL,
+    PROP_BUFFERS,
+    PROP_BYTES,
+    PROP_DROPS,
+    PROP_MIN_INTERVAL,
+    PROP_MAX_INTERVAL,
+    PROP_AVG_INTERVAL,
+    PROP_FPS,
+    PROP_BYTE_RATE,
+    PROP_TIMING_MODE,
+    PROP_LATENCY_COUNT,
+    PROP_LATENCY_P50,
+    PROP_LATENCY_P99,
+    PROP_LATENCY_P999,
+    PROP_WORKERS,
+    PROP_MAX_IN_FLIGHT,
+    PROP_INVERT,
+    PROP_SLICES,
+    PROP_QOS,
+    PROP_ROI_X,
+    PROP_ROI_Y,
+    PROP_ROI_WIDTH,
+    PROP_ROI_HEIGHT,
+    PROP_MOTION_THRESHOLD,
+    PROP_MOTION_ACTION
 };
 
+#define DEFAULT_BATCH_SIZE 1 // 默认不做批处理
+#define DEFAULT_BATCH_TIME 0 // 默认不限制批次时间跨度
+#define DEFAULT_STATS_INTERVAL 0 // 默认不发送统计消息
+#define DEFAULT_TIMING_MODE GST_MY_FILTER_TIMING_NONE
+#define DEFAULT_WORKERS 0       // 默认在流线程中处理
+#define DEFAULT_MAX_IN_FLIGHT 4 // 默认最多 4 帧同时在处理中
+#define DEFAULT_INVERT FALSE
+#define DEFAULT_SLICES 1        // 默认不切分
+#define MAX_SLICES 64
+#define MIN_SLICE_LINES 16      // 每个条带至少的行数，帧太小时不切分
+#define ALLOC_ALIGN 63          // 提议缓冲池的内存和行对齐（64 字节，满足 AVX-512）
+#define ALLOC_MIN_BUFFERS 2     // 提议缓冲池的最少缓冲区数
+#define DEFAULT_QOS TRUE
+#define DEFAULT_ROI 0           // ROI 宽或高为 0 表示不裁剪
+#define DEFAULT_MOTION_THRESHOLD 0.0 // 默认关闭运动门限
+#define DEFAULT_MOTION_ACTION GST_MY_FILTER_MOTION_DROP
+#define MOTION_ROW_STEP 4       // 运动检测每隔几行抽样一行
+#define MOTION_RUN 16           // 行内每次抽样的连续字节数，正好一次 psadbw
+#define MOTION_RUN_STEP 4       // 行内每隔几段抽样一段
+
+#define GST_TYPE_MY_FILTER_TIMING_MODE (gst_my_filter_timing_mode_get_type())
+static GType
+gst_my_filter_timing_mode_get_type(void)
+{
+    static GType timing_mode_type = 0;
+    static const GEnumValue timing_modes[] = {
+        {GST_MY_FILTER_TIMING_NONE, "Do not touch timing metadata", "none"},
+        {GST_MY_FILTER_TIMING_STAMP, "Stamp buffers with the current time", "stamp"},
+        {GST_MY_FILTER_TIMING_MEASURE, "Measure latency since the stamp", "measure"},
+        {0, NULL, NULL},
+    };
+
+    if (!timing_mode_type)
+        timing_mode_type = g_enum_register_static("GstMyFilterTimingMode", timing_modes);
+    return timing_mode_type;
+}
+
+#define GST_TYPE_MY_FILTER_MOTION_ACTION (gst_my_filter_motion_action_get_type())
+static GType
+gst_my_filter_motion_action_get_type(void)
+{
+    static GType motion_action_type = 0;
+    static const GEnumValue motion_actions[] = {
+        {GST_MY_FILTER_MOTION_DROP, "Drop static frames", "drop"},
+        {GST_MY_FILTER_MOTION_GAP, "Replace static frames with GAP events", "gap"},
+        {0, NULL, NULL},
+    };
+
+    if (!motion_action_type)
+        motion_action_type = g_enum_register_static("GstMyFilterMotionAction", motion_actions);
+    return motion_action_type;
+}
+
 /* 输入和输出的能力描述
  *
- * 在这里描述实际的格式
+ * 只支持每个分量 8 位的格式，这样逐字节处理每一行即可，不需要关心像素布局
  */
+#define MY_FILTER_VIDEO_CAPS \
+    GST_VIDEO_CAPS_MAKE("{ I420, YV12, Y42B, Y444, NV12, NV21, GRAY8, RGBx, BGRx, xRGB, xBGR }")
+
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE("sink",
                                                                    GST_PAD_SINK,
                                                                    GST_PAD_ALWAYS,
-                                                                   GST_STATIC_CAPS("ANY")); // 定义静态Pad模板，类型为sink，始终存在，支持任意格式
+                                                                   GST_STATIC_CAPS(MY_FILTER_VIDEO_CAPS)); // 定义静态Pad模板，类型为sink，始终存在，支持原始视频
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE("src",
                                                                   GST_PAD_SRC,
                                                                   GST_PAD_ALWAYS,
-                                                                  GST_STATIC_CAPS("ANY")); // 定义静态Pad模板，类型为src，始终存在，支持任意格式
+                                                                  GST_STATIC_CAPS(MY_FILTER_VIDEO_CAPS)); // 定义静态Pad模板，类型为src，始终存在，支持原始视频
 
 static gboolean gst_my_filter_src_query(GstPad *pad,
                                         GstObject *parent,
@@ -52,8 +142,24 @@ static void gst_my_filter_get_property(GObject *object,
 
 static gboolean gst_my_filter_sink_event(GstPad *pad,
                                          GstObject *parent, GstEvent *event); // 处理sink事件函数声明
+static gboolean gst_my_filter_src_event(GstPad *pad,
+                                        GstObject *parent, GstEvent *event); // 处理src事件函数声明
 static GstFlowReturn gst_my_filter_chain(GstPad *pad,
                                          GstObject *parent, GstBuffer *buf); // 处理数据链函数声明
+static GstFlowReturn gst_my_filter_chain_list(GstPad *pad,
+                                              GstObject *parent, GstBufferList *list); // 处理缓冲区列表函数声明
+static gboolean gst_my_filter_sink_query(GstPad *pad,
+                                         GstObject *parent, GstQuery *query); // 处理sink查询函数声明
+
+static gboolean gst_my_filter_src_activate_mode(GstPad *pad, GstObject *parent,
+                                                GstPadMode mode, gboolean active); // 处理src pad激活函数声明
+
+static void gst_my_filter_qos_reset(GstMyFilter *filter);
+static void gst_my_filter_position_reset(GstMyFilter *filter);
+
+static void gst_my_filter_finalize(GObject *object);
+static GstStateChangeReturn gst_my_filter_change_state(GstElement *element,
+                                                       GstStateChange transition);
 
 /* GObject 虚方法实现 */
 
@@ -70,6 +176,9 @@ gst_my_filter_class_init(GstMyFilterClass *klass)
 
     gobject_class->set_property = gst_my_filter_set_property; // 设置属性函数
     gobject_class->get_property = gst_my_filter_get_property; // 获取属性函数
+    gobject_class->finalize = gst_my_filter_finalize;         // 析构函数
+
+    gstelement_class->change_state = GST_DEBUG_FUNCPTR(gst_my_filter_change_state); // 状态切换函数
 
     // 设置一个bool类型的属性，名称为"silent"，默认值为FALSE
     g_object_class_install_property(
@@ -83,6 +192,238 @@ gst_my_filter_class_init(GstMyFilterClass *klass)
             G_PARAM_READWRITE)         // 读写属性
     );
 
+    // 批大小：累计多少个缓冲区后用 gst_pad_push_list 一次推送，1 表示逐个推送
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BATCH_SIZE,
+        g_param_spec_uint(
+            "batch-size",
+            "Batch size",
+            "Number of buffers collected into one buffer list before pushing (1 = no batching)",
+            1, G_MAXINT, DEFAULT_BATCH_SIZE,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    // 批时间窗口：批次中缓冲区时间戳跨度达到该值时提前推送，0 表示只按数量推送
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BATCH_TIME,
+        g_param_spec_uint64(
+            "batch-time",
+            "Batch time",
+            "Maximum timestamp span of one batch in nanoseconds, only used when batch-size > 1 (0 = unlimited)",
+            0, G_MAXUINT64, DEFAULT_BATCH_TIME,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    // 统计消息间隔：按该间隔在总线上发送 "my-filter-stats" 元素消息
+    g_object_class_install_property(
+        gobject_class,
+        PROP_STATS_INTERVAL,
+        g_param_spec_uint(
+            "stats-interval",
+            "Stats interval",
+            "Interval in milliseconds between my-filter-stats element messages (0 = disabled)",
+            0, G_MAXUINT, DEFAULT_STATS_INTERVAL,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    // 以下为只读统计属性，读取时不加锁，可以在生产环境中随时轮询
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BUFFERS,
+        g_param_spec_uint64(
+            "buffers", "Buffers", "Number of buffers received",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BYTES,
+        g_param_spec_uint64(
+            "bytes", "Bytes", "Number of bytes received",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_DROPS,
+        g_param_spec_uint64(
+            "drops", "Drops", "Number of buffers dropped",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_MIN_INTERVAL,
+        g_param_spec_uint64(
+            "min-interval", "Min interval",
+            "Minimum buffer inter-arrival time in nanoseconds (-1 = unknown)",
+            0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_MAX_INTERVAL,
+        g_param_spec_uint64(
+            "max-interval", "Max interval",
+            "Maximum buffer inter-arrival time in nanoseconds (-1 = unknown)",
+            0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_AVG_INTERVAL,
+        g_param_spec_uint64(
+            "avg-interval", "Average interval",
+            "Average buffer inter-arrival time in nanoseconds (-1 = unknown)",
+            0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FPS,
+        g_param_spec_double(
+            "fps", "FPS", "Buffers per second over the last second",
+            0, G_MAXDOUBLE, 0,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BYTE_RATE,
+        g_param_spec_double(
+            "byte-rate", "Byte rate", "Bytes per second over the last second",
+            0, G_MAXDOUBLE, 0,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    // 计时模式：stamp 给缓冲区附加计时元数据，measure 读取元数据并统计延迟
+    g_object_class_install_property(
+        gobject_class,
+        PROP_TIMING_MODE,
+        g_param_spec_enum(
+            "timing-mode", "Timing mode",
+            "Stamp buffers with timing metadata or measure the latency since the stamp",
+            GST_TYPE_MY_FILTER_TIMING_MODE, DEFAULT_TIMING_MODE,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    // 以下为 measure 模式下的延迟百分位，单位为纳秒
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LATENCY_COUNT,
+        g_param_spec_uint64(
+            "latency-count", "Latency count", "Number of latency samples",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LATENCY_P50,
+        g_param_spec_uint64(
+            "latency-p50", "Latency p50", "Median latency in nanoseconds (-1 = no samples)",
+            0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LATENCY_P99,
+        g_param_spec_uint64(
+            "latency-p99", "Latency p99", "99th percentile latency in nanoseconds (-1 = no samples)",
+            0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LATENCY_P999,
+        g_param_spec_uint64(
+            "latency-p999", "Latency p99.9", "99.9th percentile latency in nanoseconds (-1 = no samples)",
+            0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
+            G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    // 工作线程数：大于 0 时帧处理交给线程池，输出仍保持输入顺序
+    g_object_class_install_property(
+        gobject_class,
+        PROP_WORKERS,
+        g_param_spec_uint(
+            "workers", "Workers",
+            "Number of worker threads processing frames in parallel (0 = process on the streaming thread)",
+            0, 256, DEFAULT_WORKERS,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+    // 最大在途帧数：超过时阻塞上游，限制内存占用和延迟
+    g_object_class_install_property(
+        gobject_class,
+        PROP_MAX_IN_FLIGHT,
+        g_param_spec_uint(
+            "max-in-flight", "Max in flight",
+            "Maximum number of frames queued or being processed by the workers",
+            1, G_MAXINT, DEFAULT_MAX_IN_FLIGHT,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    // 反色：模板元素的示例像素处理
+    g_object_class_install_property(
+        gobject_class,
+        PROP_INVERT,
+        g_param_spec_boolean(
+            "invert", "Invert", "Invert all pixel values",
+            DEFAULT_INVERT,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    // 条带数：每帧按水平条带切分，由常驻线程池并发处理后再推送
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SLICES,
+        g_param_spec_uint(
+            "slices", "Slices",
+            "Number of horizontal slices processed in parallel per frame (0 = number of CPUs)",
+            0, MAX_SLICES, DEFAULT_SLICES,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+    // QoS：根据下游的 QoS 事件丢弃已经迟到的帧
+    g_object_class_install_property(
+        gobject_class,
+        PROP_QOS,
+        g_param_spec_boolean(
+            "qos", "QoS", "Drop frames that are already late according to downstream QoS events",
+            DEFAULT_QOS,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    // ROI：只输出帧中的一个矩形区域，运行时可以修改
+    g_object_class_install_property(
+        gobject_class,
+        PROP_ROI_X,
+        g_param_spec_uint(
+            "roi-x", "ROI x", "Left edge of the region of interest",
+            0, G_MAXINT, DEFAULT_ROI,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_ROI_Y,
+        g_param_spec_uint(
+            "roi-y", "ROI y", "Top edge of the region of interest",
+            0, G_MAXINT, DEFAULT_ROI,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_ROI_WIDTH,
+        g_param_spec_uint(
+            "roi-width", "ROI width", "Width of the region of interest (0 = no cropping)",
+            0, G_MAXINT, DEFAULT_ROI,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+    g_object_class_install_property(
+        gobject_class,
+        PROP_ROI_HEIGHT,
+        g_param_spec_uint(
+            "roi-height", "ROI height", "Height of the region of interest (0 = no cropping)",
+            0, G_MAXINT, DEFAULT_ROI,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+
+    // 运动门限：与上一个保留帧的平均绝对差低于门限的帧视为静止
+    g_object_class_install_property(
+        gobject_class,
+        PROP_MOTION_THRESHOLD,
+        g_param_spec_double(
+            "motion-threshold", "Motion threshold",
+            "Mean absolute pixel difference against the last kept frame below which a frame "
+            "is considered static (0 = disabled)",
+            0.0, 255.0, DEFAULT_MOTION_THRESHOLD,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+
+    // 静止帧的处理方式
+    g_object_class_install_property(
+        gobject_class,
+        PROP_MOTION_ACTION,
+        g_param_spec_enum(
+            "motion-action", "Motion action", "What to do with static frames",
+            GST_TYPE_MY_FILTER_MOTION_ACTION, DEFAULT_MOTION_ACTION,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING));
+
     // 设置元素详细信息，元素名称为"MyFilter"，分类为"FIXME:Generic"，描述为"FIXME:Generic Template Element"，作者为"ytkj <<user@hostname.org>>"
     gst_element_class_set_details_simple(gstelement_class,
                                          "MyFilter",
@@ -111,10 +452,10 @@ gst_my_filter_init(GstMyFilter *filter)
                                GST_DEBUG_FUNCPTR(gst_my_filter_sink_event)); // 设置sink pad事件函数
     gst_pad_set_chain_function(filter->sinkpad,
                                GST_DEBUG_FUNCPTR(gst_my_filter_chain)); // 设置sink pad链函数
-
-    // 在将pad添加到元素之前，在pad上配置事件函数
-    gst_pad_set_query_function(filter->srcpad,
-                               gst_my_filter_src_query);
+    gst_pad_set_chain_list_function(filter->sinkpad,
+                                    GST_DEBUG_FUNCPTR(gst_my_filter_chain_list)); // 设置sink pad缓冲区列表链函数
+    gst_pad_set_query_function(filter->sinkpad,
+                               GST_DEBUG_FUNCPTR(gst_my_filter_sink_query)); // 设置sink pad查询函数
 
     // filter->sinkpad 将会自动代理其连接的srcpad 的 caps。
     // 这意味着 sinkpad 将继承并传播其上游元素的 caps，从而确保数据格式的一致性和兼容性
@@ -122,12 +463,99 @@ gst_my_filter_init(GstMyFilter *filter)
     gst_element_add_pad(GST_ELEMENT(filter), filter->sinkpad); // 将sink pad添加到元素中
 
     filter->srcpad = gst_pad_new_from_static_template(&src_factory, "src"); // 从静态模板创建src pad
+    gst_pad_set_activatemode_function(filter->srcpad,
+                                      GST_DEBUG_FUNCPTR(gst_my_filter_src_activate_mode)); // 使用工作线程时启停输出任务
+    gst_pad_set_event_function(filter->srcpad,
+                               GST_DEBUG_FUNCPTR(gst_my_filter_src_event)); // 设置src pad事件函数
+    gst_pad_set_query_function(filter->srcpad,
+                               GST_DEBUG_FUNCPTR(gst_my_filter_src_query)); // 设置src pad查询函数
     // filter->srcpad 将会自动代理其连接的 sinkpad 的 caps。
     // 这意味着 srcpad 将继承并传播其下游元素的 caps，从而确保数据格式的一致性和兼容性
     GST_PAD_SET_PROXY_CAPS(filter->srcpad);                   // 设置代理能力
     gst_element_add_pad(GST_ELEMENT(filter), filter->srcpad); // 将src pad添加到元素中
 
     filter->silent = FALSE; // 初始化静默属性为FALSE
+
+    filter->batch_size = DEFAULT_BATCH_SIZE;
+    filter->batch_time = DEFAULT_BATCH_TIME;
+    filter->batch = NULL;
+    filter->batch_start = GST_CLOCK_TIME_NONE;
+
+    filter->stats_interval = DEFAULT_STATS_INTERVAL;
+    filter->last_stats_post = GST_CLOCK_TIME_NONE;
+    gst_my_filter_stats_reset(&filter->stats);
+
+    filter->timing_mode = DEFAULT_TIMING_MODE;
+    gst_my_filter_histogram_reset(&filter->latency);
+
+    filter->workers = DEFAULT_WORKERS;
+    filter->max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+    filter->pool = NULL;
+    g_mutex_init(&filter->pool_lock);
+    g_cond_init(&filter->pool_cond);
+    g_queue_init(&filter->pool_queue);
+    filter->pool_in_flight = 0;
+    filter->pool_processing = 0;
+    filter->pool_busy = FALSE;
+    filter->pool_flushing = TRUE;
+    filter->pool_flow = GST_FLOW_OK;
+
+    gst_video_info_init(&filter->info);
+    filter->invert = DEFAULT_INVERT;
+    filter->slices = DEFAULT_SLICES;
+    filter->n_slices = 1;
+    filter->slice_pool = NULL;
+
+    filter->alloc_pool = NULL;
+    filter->alloc_caps = NULL;
+
+    filter->qos = DEFAULT_QOS;
+    filter->qos_frame_duration = 0;
+    gst_segment_init(&filter->segment, GST_FORMAT_TIME);
+    gst_my_filter_qos_reset(filter);
+
+    filter->duration_cookie = 0;
+    gst_my_filter_position_reset(filter);
+
+    filter->roi_x = filter->roi_y = DEFAULT_ROI;
+    filter->roi_width = filter->roi_height = DEFAULT_ROI;
+    filter->roi_dirty = FALSE;
+    filter->crop_mode = GST_MY_FILTER_CROP_NONE;
+    filter->crop_x = filter->crop_y = 0;
+    filter->crop_width = filter->crop_height = 0;
+    gst_video_info_init(&filter->out_info);
+    filter->crop_pool = NULL;
+
+    filter->motion_threshold = DEFAULT_MOTION_THRESHOLD;
+    filter->motion_action = DEFAULT_MOTION_ACTION;
+    filter->motion_ref = NULL;
+    filter->motion_ref_size = 0;
+    filter->motion_active = TRUE;
+}
+
+static void
+gst_my_filter_finalize(GObject *object)
+{
+    GstMyFilter *filter = GST_MYFILTER(object);
+
+    if (filter->batch)
+        gst_buffer_list_unref(filter->batch); // 释放未推送的批次
+
+    if (filter->alloc_pool)
+        gst_object_unref(filter->alloc_pool);
+    if (filter->alloc_caps)
+        gst_caps_unref(filter->alloc_caps);
+    if (filter->crop_pool)
+        gst_object_unref(filter->crop_pool);
+    g_free(filter->motion_ref);
+    if (filter->pool)
+        g_thread_pool_free(filter->pool, TRUE, TRUE);
+    if (filter->slice_pool)
+        g_thread_pool_free(filter->slice_pool, TRUE, TRUE);
+    g_mutex_clear(&filter->pool_lock);
+    g_cond_clear(&filter->pool_cond);
+
+    G_OBJECT_CLASS(parent_class)->finalize(object);
 }
 
 static void
@@ -141,6 +569,76 @@ gst_my_filter_set_property(GObject *object, guint prop_id,
     case PROP_SILENT:
         filter->silent = g_value_get_boolean(value); // 设置静默属性
         break;
+    case PROP_BATCH_SIZE:
+        GST_OBJECT_LOCK(filter);
+        filter->batch_size = g_value_get_uint(value); // 设置批大小，下一个缓冲区生效
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_BATCH_TIME:
+        GST_OBJECT_LOCK(filter);
+        filter->batch_time = g_value_get_uint64(value); // 设置批时间窗口
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_STATS_INTERVAL:
+        g_atomic_int_set(&filter->stats_interval, g_value_get_uint(value));
+        break;
+    case PROP_TIMING_MODE:
+        g_atomic_int_set(&filter->timing_mode, g_value_get_enum(value));
+        break;
+    case PROP_WORKERS:
+        GST_OBJECT_LOCK(filter);
+        filter->workers = g_value_get_uint(value); // 下次进入 PAUSED 时生效
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_MAX_IN_FLIGHT:
+        g_mutex_lock(&filter->pool_lock);
+        filter->max_in_flight = g_value_get_uint(value);
+        g_cond_broadcast(&filter->pool_cond); // 上限变大时唤醒阻塞的流线程
+        g_mutex_unlock(&filter->pool_lock);
+        break;
+    case PROP_INVERT:
+        g_atomic_int_set(&filter->invert, g_value_get_boolean(value));
+        break;
+    case PROP_SLICES:
+        GST_OBJECT_LOCK(filter);
+        filter->slices = g_value_get_uint(value); // 下次进入 PAUSED 时生效
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_QOS:
+        g_atomic_int_set(&filter->qos, g_value_get_boolean(value));
+        break;
+    case PROP_ROI_X:
+        GST_OBJECT_LOCK(filter);
+        filter->roi_x = g_value_get_uint(value);
+        GST_OBJECT_UNLOCK(filter);
+        g_atomic_int_set(&filter->roi_dirty, TRUE); // 下一个缓冲区到来时在流线程中重新协商
+        break;
+    case PROP_ROI_Y:
+        GST_OBJECT_LOCK(filter);
+        filter->roi_y = g_value_get_uint(value);
+        GST_OBJECT_UNLOCK(filter);
+        g_atomic_int_set(&filter->roi_dirty, TRUE); // 下一个缓冲区到来时在流线程中重新协商
+        break;
+    case PROP_ROI_WIDTH:
+        GST_OBJECT_LOCK(filter);
+        filter->roi_width = g_value_get_uint(value);
+        GST_OBJECT_UNLOCK(filter);
+        g_atomic_int_set(&filter->roi_dirty, TRUE); // 下一个缓冲区到来时在流线程中重新协商
+        break;
+    case PROP_ROI_HEIGHT:
+        GST_OBJECT_LOCK(filter);
+        filter->roi_height = g_value_get_uint(value);
+        GST_OBJECT_UNLOCK(filter);
+        g_atomic_int_set(&filter->roi_dirty, TRUE); // 下一个缓冲区到来时在流线程中重新协商
+        break;
+    case PROP_MOTION_THRESHOLD:
+        GST_OBJECT_LOCK(filter);
+        filter->motion_threshold = g_value_get_double(value);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_MOTION_ACTION:
+        g_atomic_int_set(&filter->motion_action, g_value_get_enum(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec); // 无效属性ID警告
         break;
@@ -152,131 +650,2023 @@ gst_my_filter_get_property(GObject *object, guint prop_id,
                            GValue *value, GParamSpec *pspec)
 {
     GstMyFilter *filter = GST_MYFILTER(object);
+    GstMyFilterStatsSnapshot snapshot;
 
     switch (prop_id)
     {
     case PROP_SILENT:
         g_value_set_boolean(value, filter->silent); // 获取静默属性
         break;
+    case PROP_BATCH_SIZE:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint(value, filter->batch_size);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_BATCH_TIME:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint64(value, filter->batch_time);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_STATS_INTERVAL:
+        g_value_set_uint(value, g_atomic_int_get(&filter->stats_interval));
+        break;
+    case PROP_BUFFERS:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_uint64(value, snapshot.buffers);
+        break;
+    case PROP_BYTES:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_uint64(value, snapshot.bytes);
+        break;
+    case PROP_DROPS:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_uint64(value, snapshot.drops);
+        break;
+    case PROP_MIN_INTERVAL:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_uint64(value, snapshot.min_interval);
+        break;
+    case PROP_MAX_INTERVAL:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_uint64(value, snapshot.max_interval);
+        break;
+    case PROP_AVG_INTERVAL:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_uint64(value, snapshot.avg_interval);
+        break;
+    case PROP_FPS:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_double(value, snapshot.fps);
+        break;
+    case PROP_BYTE_RATE:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_value_set_double(value, snapshot.byte_rate);
+        break;
+    case PROP_TIMING_MODE:
+        g_value_set_enum(value, g_atomic_int_get(&filter->timing_mode));
+        break;
+    case PROP_LATENCY_COUNT:
+        g_value_set_uint64(value, gst_my_filter_histogram_count(&filter->latency));
+        break;
+    case PROP_LATENCY_P50:
+        g_value_set_uint64(value, gst_my_filter_histogram_percentile(&filter->latency, 0.5));
+        break;
+    case PROP_LATENCY_P99:
+        g_value_set_uint64(value, gst_my_filter_histogram_percentile(&filter->latency, 0.99));
+        break;
+    case PROP_LATENCY_P999:
+        g_value_set_uint64(value, gst_my_filter_histogram_percentile(&filter->latency, 0.999));
+        break;
+    case PROP_WORKERS:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint(value, filter->workers);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_MAX_IN_FLIGHT:
+        g_mutex_lock(&filter->pool_lock);
+        g_value_set_uint(value, filter->max_in_flight);
+        g_mutex_unlock(&filter->pool_lock);
+        break;
+    case PROP_INVERT:
+        g_value_set_boolean(value, g_atomic_int_get(&filter->invert));
+        break;
+    case PROP_SLICES:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint(value, filter->slices);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_QOS:
+        g_value_set_boolean(value, g_atomic_int_get(&filter->qos));
+        break;
+    case PROP_ROI_X:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint(value, filter->roi_x);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_ROI_Y:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint(value, filter->roi_y);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_ROI_WIDTH:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint(value, filter->roi_width);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_ROI_HEIGHT:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_uint(value, filter->roi_height);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_MOTION_THRESHOLD:
+        GST_OBJECT_LOCK(filter);
+        g_value_set_double(value, filter->motion_threshold);
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    case PROP_MOTION_ACTION:
+        g_value_set_enum(value, g_atomic_int_get(&filter->motion_action));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec); // 无效属性ID警告
         break;
     }
 }
 
-/* GstElement 虚方法实现 */
-
-/* 处理sink事件的函数 */
-static gboolean
-gst_my_filter_sink_event(GstPad *pad, GstObject *parent,
-                         GstEvent *event)
+/* 统计一个到达的缓冲区，非静默模式下每个统计窗口打印一次摘要 */
+static void
+gst_my_filter_record_buffer(GstMyFilter *filter, GstBuffer *buf, GstClockTime now)
 {
-    GstMyFilter *filter;
-    gboolean ret;
-
-    filter = GST_MYFILTER(parent);
+    gsize size = gst_buffer_get_size(buf);
+    GstMyFilterStatsSnapshot snapshot;
 
-    GST_LOG_OBJECT(filter, "receive %s event: %" GST_PTR_FORMAT,
-                   GST_EVENT_TYPE_NAME(event), event); // 记录收到的事件
+    GST_LOG_OBJECT(filter, "have data of size %" G_GSIZE_FORMAT " bytes", size);
 
-    switch (GST_EVENT_TYPE(event))
+    // 避免逐帧 g_print 拖慢流线程
+    if (gst_my_filter_stats_record_buffer(&filter->stats, size, now) && !filter->silent)
     {
-    case GST_EVENT_CAPS:
+        gst_my_filter_stats_read(&filter->stats, &snapshot);
+        g_print("Have %" G_GUINT64_FORMAT " buffers, %.2f fps, %.0f bytes/s\n",
+                snapshot.buffers, snapshot.fps, snapshot.byte_rate);
+    }
+}
+
+/* 按 stats-interval 在总线上发送统计消息和延迟消息 */
+static void
+gst_my_filter_post_stats(GstMyFilter *filter, GstClockTime now)
+{
+    GstMyFilterStatsSnapshot snapshot;
+    const GstMyFilterHistogram *latency = &filter->latency;
+    guint interval;
+
+    interval = g_atomic_int_get(&filter->stats_interval);
+    if (interval == 0)
+        return;
+
+    if (!GST_CLOCK_TIME_IS_VALID(filter->last_stats_post))
     {
-        GstCaps *caps;
+        filter->last_stats_post = now;
+        return;
+    }
+    if (now - filter->last_stats_post < interval * GST_MSECOND)
+        return;
 
-        gst_event_parse_caps(event, &caps); // 解析事件中的caps
-        /* 处理caps：例如检查 caps 的格式、调整管道中的元素等。 */
+    filter->last_stats_post = now;
+    gst_my_filter_stats_read(&filter->stats, &snapshot);
+    gst_element_post_message(GST_ELEMENT(filter),
+                             gst_message_new_element(GST_OBJECT(filter),
+                                                     gst_my_filter_stats_to_structure(&snapshot, "my-filter-stats")));
+
+    if (g_atomic_int_get(&filter->timing_mode) != GST_MY_FILTER_TIMING_MEASURE)
+        return;
+
+    gst_element_post_message(GST_ELEMENT(filter),
+                             gst_message_new_element(GST_OBJECT(filter),
+                                                     gst_structure_new("my-filter-latency",
+                                                                       "count", G_TYPE_UINT64, gst_my_filter_histogram_count(latency),
+                                                                       "p50", G_TYPE_UINT64, gst_my_filter_histogram_percentile(latency, 0.5),
+                                                                       "p99", G_TYPE_UINT64, gst_my_filter_histogram_percentile(latency, 0.99),
+                                                                       "p999", G_TYPE_UINT64, gst_my_filter_histogram_percentile(latency, 0.999),
+                                                                       NULL)));
+}
 
-        /* 转发事件 */
-        ret = gst_pad_event_default(pad, parent, event); // 默认事件处理
+/* 计时：stamp 模式附加计时元数据，measure 模式统计从打戳到此处的延迟
+ * 已经带有时间戳的缓冲区保留最早的戳，这样多个 stamp 实例串联时测量的是完整链路
+ */
+static GstBuffer *
+gst_my_filter_timing(GstMyFilter *filter, GstBuffer *buf, GstClockTime now)
+{
+    GstMyFilterTimingMeta *meta;
+
+    switch (g_atomic_int_get(&filter->timing_mode))
+    {
+    case GST_MY_FILTER_TIMING_STAMP:
+        if (gst_buffer_get_my_filter_timing_meta(buf) == NULL)
+        {
+            buf = gst_buffer_make_writable(buf); // 只复制缓冲区结构，不复制数据
+            gst_buffer_add_my_filter_timing_meta(buf, now);
+        }
+        break;
+    case GST_MY_FILTER_TIMING_MEASURE:
+        meta = gst_buffer_get_my_filter_timing_meta(buf);
+        if (meta && GST_CLOCK_TIME_IS_VALID(meta->stamp) && now >= meta->stamp)
+            gst_my_filter_histogram_record(&filter->latency, now - meta->stamp);
         break;
-    }
     default:
-        ret = gst_pad_event_default(pad, parent, event); // 默认事件处理
         break;
     }
-    return ret;
+    return buf;
 }
 
-/* 链函数
- * 这个函数进行实际处理
- */
-static GstFlowReturn
-gst_my_filter_chain(GstPad *pad, GstObject *parent, GstBuffer *buf)
+/* QoS 辅助函数 */
+
+/* 清空 QoS 状态（启动、flush 时调用） */
+static void
+gst_my_filter_qos_reset(GstMyFilter *filter)
 {
-    GstMyFilter *filter;
+    GST_OBJECT_LOCK(filter);
+    filter->qos_proportion = 1.0;
+    filter->earliest_time = GST_CLOCK_TIME_NONE;
+    GST_OBJECT_UNLOCK(filter);
 
-    filter = GST_MYFILTER(parent);
+    filter->qos_processed = 0;
+    filter->qos_dropped = 0;
+}
 
-    if (!filter->silent)
-        g_print("Have data of size %" G_GSIZE_FORMAT " bytes!\n",
-                gst_buffer_get_size(buf));
+/* 根据下游的 QoS 事件更新最早可用时间，算法与 GstVideoDecoder 相同：
+ * 迟到时预留两倍的迟到量加一帧时长，让处理能力有机会追上
+ */
+static void
+gst_my_filter_qos_update(GstMyFilter *filter, gdouble proportion,
+                         GstClockTimeDiff diff, GstClockTime timestamp)
+{
+    GST_OBJECT_LOCK(filter);
+    filter->qos_proportion = proportion;
+    if (GST_CLOCK_TIME_IS_VALID(timestamp))
+    {
+        if (diff > 0)
+            filter->earliest_time = timestamp + 2 * diff + filter->qos_frame_duration;
+        else
+            filter->earliest_time = timestamp + diff;
+    }
+    else
+    {
+        filter->earliest_time = GST_CLOCK_TIME_NONE;
+    }
+    GST_OBJECT_UNLOCK(filter);
 
-    /* 直接推送输入缓冲区，不做任何处理 */
-    return gst_pad_push(filter->srcpad, buf);
+    GST_LOG_OBJECT(filter, "qos proportion %g, earliest time %" GST_TIME_FORMAT,
+                   proportion, GST_TIME_ARGS(filter->earliest_time));
 }
 
-/**
- * @brief 处理源查询的回调函数。
- *
- * 这个函数用于处理从src pad 发出的查询请求。
- *
- * @param pad 指向 GstPad 的指针，表示源 pad。
- * @param parent 指向 GstObject 的指针，表示父对象。
- * @param query 指向 GstQuery 的指针，表示查询请求。
- *
- * @return gboolean 如果查询处理成功，返回 TRUE；否则返回 FALSE。
- */
+/* 判断缓冲区是否已经迟到，迟到时发送 QoS 消息并返回 TRUE */
 static gboolean
-gst_my_filter_src_query(GstPad *pad,
-                        GstObject *parent,
-                        GstQuery *query)
+gst_my_filter_qos_drop(GstMyFilter *filter, GstBuffer *buf)
 {
-    gboolean ret;
+    GstClockTime ts = GST_BUFFER_PTS(buf);
+    GstClockTime duration = GST_BUFFER_DURATION(buf);
+    GstClockTime running_time, earliest_time;
+    gdouble proportion;
+    GstMessage *msg;
 
-    switch (GST_QUERY_TYPE(query))
-    {
-    case GST_QUERY_POSITION:
-        /* we should report the current position */
-        gint64 position;
+    if (!g_atomic_int_get(&filter->qos) ||
+        filter->segment.format != GST_FORMAT_TIME || filter->segment.rate < 0.0 ||
+        !GST_CLOCK_TIME_IS_VALID(ts))
+        goto keep;
 
-        if (gst_element_query_position(GST_ELEMENT(parent), GST_FORMAT_TIME, &position))
-        {
-            gst_query_set_position(query, GST_FORMAT_TIME, position);
-            ret = TRUE;
-        }
-        else
-        {
-            ret = FALSE;
-        }
+    running_time = gst_segment_to_running_time(&filter->segment, GST_FORMAT_TIME, ts);
+    if (!GST_CLOCK_TIME_IS_VALID(running_time))
+        goto keep;
 
-        break;
-    case GST_QUERY_DURATION:
-        /* we should report the duration here */
-        // 获取时长
-        gint64 duration;
+    GST_OBJECT_LOCK(filter);
+    earliest_time = filter->earliest_time;
+    proportion = filter->qos_proportion;
+    GST_OBJECT_UNLOCK(filter);
 
-        if (gst_element_query_duration(GST_ELEMENT(parent), GST_FORMAT_TIME, &duration))
-        {
-            gst_query_set_duration(query, GST_FORMAT_TIME, duration);
-            ret = TRUE;
-        }
-        else
-        {
-            ret = FALSE;
-        }
-        break;
-    case GST_QUERY_CAPS:
-        /* we should report the supported caps here */
-        // 获取能力
-        GstCaps *caps;
+    if (!GST_CLOCK_TIME_IS_VALID(earliest_time) ||
+        running_time + (GST_CLOCK_TIME_IS_VALID(duration) ? duration : 0) > earliest_time)
+        goto keep;
+
+    filter->qos_dropped++;
+    gst_my_filter_stats_record_drops(&filter->stats, 1);
+
+    GST_DEBUG_OBJECT(filter, "dropping late frame %" GST_TIME_FORMAT ", earliest %" GST_TIME_FORMAT,
+                     GST_TIME_ARGS(running_time), GST_TIME_ARGS(earliest_time));
+
+    msg = gst_message_new_qos(GST_OBJECT(filter), FALSE, running_time,
+                              gst_segment_to_stream_time(&filter->segment, GST_FORMAT_TIME, ts),
+                              ts, duration);
+    gst_message_set_qos_values(msg, GST_CLOCK_DIFF(running_time, earliest_time), proportion, 1000000);
+    gst_message_set_qos_stats(msg, GST_FORMAT_BUFFERS, filter->qos_processed, filter->qos_dropped);
+    gst_element_post_message(GST_ELEMENT(filter), msg);
+
+    return TRUE;
 
-        caps = gst_pad_get_current_caps(pad);
-        gst_query_set_caps_result(query, caps);
+keep:
+    filter->qos_processed++;
+    return FALSE;
+}
+
+/* 运动门限辅助函数 */
+
+/* 两行像素的绝对差之和 */
+static guint64
+gst_my_filter_sad_row(const guint8 *a, const guint8 *b, gsize n)
+{
+    guint64 sum = 0;
+    gsize i = 0;
+
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    guint64 lanes[2];
+
+    // psadbw 一次处理 16 个字节，结果累加在两个 64 位通道中
+    for (; i + 16 <= n; i += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                              _mm_loadu_si128((const __m128i *)(b + i))));
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum = lanes[0] + lanes[1];
+#elif defined(__ARM_NEON)
+    uint32x4_t acc = vdupq_n_u32(0);
+
+    for (; i + 16 <= n; i += 16)
+        acc = vpadalq_u16(acc, vpaddlq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i))));
+    sum = (guint64)vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+          vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+
+    for (; i < n; i++)
+        sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    return sum;
+}
+
+/* 一行中被抽样的字节数：每 MOTION_RUN_STEP 段取一段 MOTION_RUN 字节 */
+static gsize
+gst_my_filter_motion_row_size(gsize line)
+{
+    gsize span = MOTION_RUN * MOTION_RUN_STEP;
+
+    return line / span * MOTION_RUN + MIN(line % span, MOTION_RUN);
+}
+
+/* 抽样行与参考行的绝对差之和，参考行只保存抽样的字节 */
+static guint64
+gst_my_filter_motion_sad(const guint8 *row, const guint8 *ref, gsize line)
+{
+    guint64 sum = 0;
+    gsize x, n;
+
+    for (x = 0; x < line; x += MOTION_RUN * MOTION_RUN_STEP, ref += n)
+    {
+        n = MIN(MOTION_RUN, line - x);
+        sum += gst_my_filter_sad_row(row + x, ref, n);
+    }
+    return sum;
+}
+
+/* 把一行中抽样的字节保存到参考行 */
+static void
+gst_my_filter_motion_store(guint8 *ref, const guint8 *row, gsize line)
+{
+    gsize x, n;
+
+    for (x = 0; x < line; x += MOTION_RUN * MOTION_RUN_STEP, ref += n)
+    {
+        n = MIN(MOTION_RUN, line - x);
+        memcpy(ref, row + x, n);
+    }
+}
+
+/* 丢弃参考帧，下一帧重新作为参考 */
+static void
+gst_my_filter_motion_reset(GstMyFilter *filter)
+{
+    g_free(filter->motion_ref);
+    filter->motion_ref = NULL;
+    filter->motion_ref_size = 0;
+    filter->motion_active = TRUE;
+}
+
+/* 运动状态改变时发送总线消息 */
+static void
+gst_my_filter_post_motion(GstMyFilter *filter, GstBuffer *buf, gboolean active, gdouble score)
+{
+    GstClockTime ts = GST_BUFFER_PTS(buf);
+    GstClockTime running_time = GST_CLOCK_TIME_NONE;
+
+    if (filter->segment.format == GST_FORMAT_TIME && GST_CLOCK_TIME_IS_VALID(ts))
+        running_time = gst_segment_to_running_time(&filter->segment, GST_FORMAT_TIME, ts);
+
+    GST_DEBUG_OBJECT(filter, "motion %s at %" GST_TIME_FORMAT ", score %.2f",
+                     active ? "started" : "stopped", GST_TIME_ARGS(ts), score);
+
+    gst_element_post_message(GST_ELEMENT(filter),
+                             gst_message_new_element(GST_OBJECT(filter),
+                                                     gst_structure_new("my-filter-motion",
+                                                                       "active", G_TYPE_BOOLEAN, active,
+                                                                       "score", G_TYPE_DOUBLE, score,
+                                                                       "timestamp", G_TYPE_UINT64, ts,
+                                                                       "running-time", G_TYPE_UINT64, running_time,
+                                                                       NULL)));
+}
+
+/* 判断帧是否静止
+ * 只比较第一个平面（YUV 的亮度，RGB 的全部分量）中每隔 MOTION_ROW_STEP 行抽样的一行，
+ * 行内每隔 MOTION_RUN_STEP 段抽样一段连续的 MOTION_RUN 字节，总共只读约 1/16 的数据。
+ * 参考帧保存为连续的抽样数据，只在判定为运动时更新，缓慢的变化会累积到超过门限
+ */
+static gboolean
+gst_my_filter_motion_static(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstVideoFrame frame;
+    gdouble threshold, score;
+    const guint8 *data;
+    guint8 *ref;
+    gsize line, sampled, size;
+    guint64 sad = 0;
+    gint stride, height, row;
+    gboolean active;
+
+    GST_OBJECT_LOCK(filter);
+    threshold = filter->motion_threshold;
+    GST_OBJECT_UNLOCK(filter);
+
+    if (threshold <= 0.0)
+    {
+        if (filter->motion_ref)
+            gst_my_filter_motion_reset(filter);
+        return FALSE;
+    }
+
+    if (GST_VIDEO_INFO_FORMAT(&filter->info) == GST_VIDEO_FORMAT_UNKNOWN ||
+        !gst_video_frame_map(&frame, &filter->info, buf, GST_MAP_READ))
+        return FALSE;
+
+    data = GST_VIDEO_FRAME_PLANE_DATA(&frame, 0);
+    stride = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0);
+    line = (gsize)GST_VIDEO_FRAME_COMP_WIDTH(&frame, 0) * GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, 0);
+    height = GST_VIDEO_FRAME_COMP_HEIGHT(&frame, 0);
+    sampled = gst_my_filter_motion_row_size(line);
+    size = sampled * ((height + MOTION_ROW_STEP - 1) / MOTION_ROW_STEP);
+
+    // 第一帧或格式变化后的第一帧只作为参考
+    if (filter->motion_ref == NULL || filter->motion_ref_size != size)
+    {
+        g_free(filter->motion_ref);
+        filter->motion_ref = g_malloc(size);
+        filter->motion_ref_size = size;
+        for (row = 0, ref = filter->motion_ref; row < height; row += MOTION_ROW_STEP, ref += sampled)
+            gst_my_filter_motion_store(ref, data + row * stride, line);
+        gst_video_frame_unmap(&frame);
+        return FALSE;
+    }
+
+    for (row = 0, ref = filter->motion_ref; row < height; row += MOTION_ROW_STEP, ref += sampled)
+        sad += gst_my_filter_motion_sad(data + row * stride, ref, line);
+
+    score = (gdouble)sad / size;
+    active = score >= threshold;
+    if (active)
+    {
+        for (row = 0, ref = filter->motion_ref; row < height; row += MOTION_ROW_STEP, ref += sampled)
+            gst_my_filter_motion_store(ref, data + row * stride, line);
+    }
+    gst_video_frame_unmap(&frame);
+
+    if (active != filter->motion_active)
+    {
+        filter->motion_active = active;
+        gst_my_filter_post_motion(filter, buf, active, score);
+    }
+
+    return !active;
+}
+
+/* 逐个缓冲区的处理步骤
+ * 接管 buf 的所有权，返回需要继续推送的缓冲区，丢弃时返回 NULL
+ */
+static GstBuffer *
+gst_my_filter_process_buffer(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstClockTime now = gst_util_get_timestamp();
+
+    gst_my_filter_record_buffer(filter, buf, now);
+
+    // 在做任何处理之前丢弃已经迟到的帧
+    if (gst_my_filter_qos_drop(filter, buf))
+    {
+        gst_buffer_unref(buf);
+        gst_my_filter_post_stats(filter, now);
+        return NULL;
+    }
+
+    buf = gst_my_filter_timing(filter, buf, now);
+    gst_my_filter_post_stats(filter, now);
+
+    return buf;
+}
+
+/* 帧内并行：条带处理
+ *
+ * 每帧切分为 n_slices 个水平条带，调用线程处理第一个条带，其余条带交给常驻线程池，
+ * 所有条带完成（屏障）后才推送该帧。屏障在调用线程的栈上，多个帧可以同时使用线程池。
+ */
+typedef struct
+{
+    GMutex lock;
+    GCond cond;
+    guint remaining; // 尚未完成的条带数
+} GstMyFilterSliceBarrier;
+
+typedef struct
+{
+    GstVideoFrame *frame;
+    guint slice;
+    guint n_slices;
+    GstMyFilterSliceBarrier *barrier;
+} GstMyFilterSliceJob;
+
+/* 处理一个条带：每个平面按比例取对应的行，逐字节反色
+ * 所支持格式的第 i 个平面与第 i 个分量的行数相同，因此用分量宏取平面尺寸
+ */
+static void
+gst_my_filter_process_slice(GstVideoFrame *frame, guint slice, guint n_slices)
+{
+    guint plane, x, y;
+
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(frame); plane++)
+    {
+        guint height = GST_VIDEO_FRAME_COMP_HEIGHT(frame, plane);
+        guint row_bytes = GST_VIDEO_FRAME_COMP_WIDTH(frame, plane) *
+                          GST_VIDEO_FRAME_COMP_PSTRIDE(frame, plane);
+        gint stride = GST_VIDEO_FRAME_PLANE_STRIDE(frame, plane);
+        guint y0 = height * slice / n_slices;
+        guint y1 = height * (slice + 1) / n_slices;
+        guint8 *row = (guint8 *)GST_VIDEO_FRAME_PLANE_DATA(frame, plane) + (gsize)y0 * stride;
+
+        for (y = y0; y < y1; y++, row += stride)
+        {
+            // 简单循环，编译器会自动向量化
+            for (x = 0; x < row_bytes; x++)
+                row[x] ^= 0xff;
+        }
+    }
+}
+
+/* 条带线程池的线程函数 */
+static void
+gst_my_filter_slice_work(gpointer data, gpointer user_data)
+{
+    GstMyFilterSliceJob *job = data;
+    GstMyFilterSliceBarrier *barrier = job->barrier;
+
+    gst_my_filter_process_slice(job->frame, job->slice, job->n_slices);
+
+    g_mutex_lock(&barrier->lock);
+    if (--barrier->remaining == 0)
+        g_cond_signal(&barrier->cond);
+    g_mutex_unlock(&barrier->lock);
+}
+
+/* 处理一帧，在所有条带完成后返回 */
+static void
+gst_my_filter_process_frame(GstMyFilter *filter, GstVideoFrame *frame)
+{
+    GstMyFilterSliceJob jobs[MAX_SLICES];
+    GstMyFilterSliceBarrier barrier;
+    guint n_slices = filter->n_slices;
+    guint i;
+
+    // 帧太小时切分的调度开销大于收益
+    if (filter->slice_pool == NULL ||
+        GST_VIDEO_FRAME_HEIGHT(frame) < n_slices * MIN_SLICE_LINES)
+    {
+        gst_my_filter_process_slice(frame, 0, 1);
+        return;
+    }
+
+    g_mutex_init(&barrier.lock);
+    g_cond_init(&barrier.cond);
+    barrier.remaining = n_slices - 1;
+
+    for (i = 1; i < n_slices; i++)
+    {
+        jobs[i].frame = frame;
+        jobs[i].slice = i;
+        jobs[i].n_slices = n_slices;
+        jobs[i].barrier = &barrier;
+        g_thread_pool_push(filter->slice_pool, &jobs[i], NULL);
+    }
+
+    gst_my_filter_process_slice(frame, 0, n_slices);
+
+    g_mutex_lock(&barrier.lock);
+    while (barrier.remaining > 0)
+        g_cond_wait(&barrier.cond, &barrier.lock);
+    g_mutex_unlock(&barrier.lock);
+
+    g_mutex_clear(&barrier.lock);
+    g_cond_clear(&barrier.cond);
+}
+
+/* ROI 裁剪辅助函数 */
+
+/* 附加（或收紧已有的）GstVideoCropMeta，像素数据不动
+ * 接管 buf 的所有权
+ */
+static GstBuffer *
+gst_my_filter_crop_meta(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstVideoCropMeta *meta;
+    guint x, y;
+
+    buf = gst_buffer_make_writable(buf); // 必要时只复制缓冲区结构，内存仍然共享
+    meta = gst_buffer_get_video_crop_meta(buf);
+    if (meta == NULL)
+    {
+        meta = gst_buffer_add_video_crop_meta(buf);
+        meta->x = 0;
+        meta->y = 0;
+        meta->width = GST_VIDEO_INFO_WIDTH(&filter->info);
+        meta->height = GST_VIDEO_INFO_HEIGHT(&filter->info);
+    }
+
+    // 上游已经裁剪过时，ROI 相对于已有的区域
+    x = MIN(filter->crop_x, meta->width);
+    y = MIN(filter->crop_y, meta->height);
+    meta->x += x;
+    meta->y += y;
+    meta->width = MIN(filter->crop_width, meta->width - x);
+    meta->height = MIN(filter->crop_height, meta->height - y);
+
+    return buf;
+}
+
+/* 逐平面按步长复制 ROI 区域，行连续时合并为一次 memcpy */
+static void
+gst_my_filter_copy_roi(GstMyFilter *filter, const GstVideoFrame *in, GstVideoFrame *out)
+{
+    const GstVideoFormatInfo *finfo = in->info.finfo;
+    gint comp[GST_VIDEO_MAX_COMPONENTS];
+    guint plane, row;
+
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(out); plane++)
+    {
+        const guint8 *src;
+        guint8 *dst;
+        gint in_stride, out_stride, pstride, line, lines;
+
+        // 平面中第一个分量决定该平面的子采样和像素步长（NV12 的 UV 平面为 2）
+        gst_video_format_info_component(finfo, plane, comp);
+        pstride = GST_VIDEO_FRAME_COMP_PSTRIDE(in, comp[0]);
+        line = GST_VIDEO_FRAME_COMP_WIDTH(out, comp[0]) * pstride;
+        lines = GST_VIDEO_FRAME_COMP_HEIGHT(out, comp[0]);
+        in_stride = GST_VIDEO_FRAME_PLANE_STRIDE(in, plane);
+        out_stride = GST_VIDEO_FRAME_PLANE_STRIDE(out, plane);
+
+        src = (const guint8 *)GST_VIDEO_FRAME_PLANE_DATA(in, plane) +
+              GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT(finfo, comp[0], filter->crop_y) * in_stride +
+              GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(finfo, comp[0], filter->crop_x) * pstride;
+        dst = GST_VIDEO_FRAME_PLANE_DATA(out, plane);
+
+        if (line == in_stride && line == out_stride)
+        {
+            memcpy(dst, src, (gsize)line * lines);
+            continue;
+        }
+
+        for (row = 0; row < (guint)lines; row++)
+            memcpy(dst + row * out_stride, src + row * in_stride, line);
+    }
+}
+
+/* 下游不支持裁剪元数据时，把 ROI 复制到输出缓冲池的缓冲区中
+ * 接管 buf 的所有权，失败时丢弃该帧并返回 NULL
+ */
+static GstBuffer *
+gst_my_filter_crop_copy(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstVideoFrame in, out;
+    GstBuffer *outbuf = NULL;
+    GstMyFilterTimingMeta *timing;
+    GstFlowReturn ret;
+
+    ret = gst_buffer_pool_acquire_buffer(filter->crop_pool, &outbuf, NULL);
+    if (ret != GST_FLOW_OK)
+    {
+        GST_DEBUG_OBJECT(filter, "could not acquire output buffer: %s", gst_flow_get_name(ret));
+        gst_buffer_unref(buf);
+        return NULL;
+    }
+
+    if (!gst_video_frame_map(&in, &filter->info, buf, GST_MAP_READ))
+    {
+        GST_WARNING_OBJECT(filter, "could not map video frame");
+        gst_buffer_unref(outbuf);
+        gst_buffer_unref(buf);
+        return NULL;
+    }
+    if (!gst_video_frame_map(&out, &filter->out_info, outbuf, GST_MAP_WRITE))
+    {
+        GST_WARNING_OBJECT(filter, "could not map output frame");
+        gst_video_frame_unmap(&in);
+        gst_buffer_unref(outbuf);
+        gst_buffer_unref(buf);
+        return NULL;
+    }
+
+    gst_my_filter_copy_roi(filter, &in, &out);
+
+    gst_video_frame_unmap(&out);
+    gst_video_frame_unmap(&in);
+
+    // 其他元数据（GstVideoMeta 等）描述的是整帧，只保留时间戳、标志和计时元数据
+    gst_buffer_copy_into(outbuf, buf, GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+    timing = gst_buffer_get_my_filter_timing_meta(buf);
+    if (timing)
+        gst_buffer_add_my_filter_timing_meta(outbuf, timing->stamp);
+
+    gst_buffer_unref(buf);
+    return outbuf;
+}
+
+/* 实际的帧处理
+ * 启用工作线程时会在多个线程中并发调用，只能访问缓冲区本身和只读的配置
+ * （filter->info 和裁剪配置只在排空之后才会改变）
+ * 接管 buf 的所有权，返回处理后的缓冲区，帧被丢弃时返回 NULL
+ */
+static GstBuffer *
+gst_my_filter_transform(GstMyFilter *filter, GstBuffer *buf)
+{
+    const GstVideoInfo *info = &filter->info;
+    GstVideoFrame frame;
+
+    // 先裁剪：复制 ROI 时后续处理只需要处理较小的帧
+    switch (filter->crop_mode)
+    {
+    case GST_MY_FILTER_CROP_META:
+        buf = gst_my_filter_crop_meta(filter, buf);
+        break;
+    case GST_MY_FILTER_CROP_COPY:
+        buf = gst_my_filter_crop_copy(filter, buf);
+        if (buf == NULL)
+            return NULL;
+        info = &filter->out_info;
+        break;
+    default:
+        break;
+    }
+
+    if (!g_atomic_int_get(&filter->invert))
+        return buf;
+
+    buf = gst_buffer_make_writable(buf);
+    if (!gst_video_frame_map(&frame, info, buf, GST_MAP_READWRITE))
+    {
+        GST_WARNING_OBJECT(filter, "could not map video frame");
+        return buf;
+    }
+
+    gst_my_filter_process_frame(filter, &frame);
+
+    gst_video_frame_unmap(&frame);
+    return buf;
+}
+
+/* gst_buffer_list_foreach 回调：原地替换列表中的缓冲区，返回 NULL 时从列表中移除
+ * 使用工作线程时帧处理留给工作线程
+ */
+static gboolean
+gst_my_filter_process_list_item(GstBuffer **buffer, guint idx, gpointer user_data)
+{
+    GstMyFilter *filter = GST_MYFILTER(user_data);
+
+    *buffer = gst_my_filter_process_buffer(filter, *buffer);
+    if (*buffer && filter->pool == NULL)
+        *buffer = gst_my_filter_transform(filter, *buffer);
+    return TRUE;
+}
+
+/* 位置/时长辅助函数
+ * POSITION 和 DURATION 查询在本地应答，不再每次都向上游往返查询
+ */
+
+/* 清空位置和时长缓存 */
+static void
+gst_my_filter_position_reset(GstMyFilter *filter)
+{
+    GST_OBJECT_LOCK(filter);
+    gst_segment_init(&filter->out_segment, GST_FORMAT_TIME);
+    filter->position = GST_CLOCK_TIME_NONE;
+    filter->duration = GST_CLOCK_TIME_NONE;
+    filter->duration_cookie++;
+    GST_OBJECT_UNLOCK(filter);
+}
+
+/* 记录即将推送到下游的缓冲区时间戳 */
+static void
+gst_my_filter_track_position(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstClockTime ts = GST_BUFFER_PTS(buf);
+
+    if (!GST_CLOCK_TIME_IS_VALID(ts))
+        return;
+
+    GST_OBJECT_LOCK(filter);
+    filter->position = ts;
+    GST_OBJECT_UNLOCK(filter);
+}
+
+/* 跟踪即将推送到下游的串行事件，新的 segment 或流会使缓存失效 */
+static void
+gst_my_filter_track_event(GstMyFilter *filter, GstEvent *event)
+{
+    switch (GST_EVENT_TYPE(event))
+    {
+    case GST_EVENT_STREAM_START:
+        gst_my_filter_position_reset(filter);
+        break;
+    case GST_EVENT_SEGMENT:
+        GST_OBJECT_LOCK(filter);
+        gst_event_copy_segment(event, &filter->out_segment);
+        filter->position = GST_CLOCK_TIME_NONE;
+        // segment 中带有时长时直接使用，否则在下次查询时向上游获取一次
+        if (filter->out_segment.format == GST_FORMAT_TIME)
+            filter->duration = filter->out_segment.duration;
+        else
+            filter->duration = GST_CLOCK_TIME_NONE;
+        filter->duration_cookie++;
+        GST_OBJECT_UNLOCK(filter);
+        break;
+    default:
+        break;
+    }
+}
+
+/* 批处理辅助函数
+ * 批次只在输出线程中访问（不使用工作线程时是流线程，否则是 src pad 任务），
+ * 另一个线程只会在输出线程空闲时（排空之后或 pad 停用之后）访问，因此不需要额外加锁
+ */
+
+/* 丢弃尚未推送的批次（FLUSH_STOP 和停止时调用） */
+static void
+gst_my_filter_batch_clear(GstMyFilter *filter)
+{
+    if (filter->batch)
+    {
+        GST_DEBUG_OBJECT(filter, "discarding batch of %u buffers",
+                         gst_buffer_list_length(filter->batch));
+        gst_my_filter_stats_record_drops(&filter->stats,
+                                         gst_buffer_list_length(filter->batch));
+        gst_buffer_list_unref(filter->batch);
+        filter->batch = NULL;
+    }
+    filter->batch_start = GST_CLOCK_TIME_NONE;
+}
+
+/* 将当前批次作为一个 GstBufferList 推送到下游 */
+static GstFlowReturn
+gst_my_filter_batch_flush(GstMyFilter *filter)
+{
+    GstBufferList *list = filter->batch;
+
+    if (list == NULL)
+        return GST_FLOW_OK;
+
+    filter->batch = NULL;
+    filter->batch_start = GST_CLOCK_TIME_NONE;
+
+    GST_LOG_OBJECT(filter, "pushing batch of %u buffers",
+                   gst_buffer_list_length(list));
+
+    gst_my_filter_track_position(filter,
+                                 gst_buffer_list_get(list, gst_buffer_list_length(list) - 1));
+
+    return gst_pad_push_list(filter->srcpad, list);
+}
+
+/* 将缓冲区加入当前批次，达到批大小或时间窗口时推送整个批次
+ * 接管 buf 的所有权
+ */
+static GstFlowReturn
+gst_my_filter_batch_add(GstMyFilter *filter, GstBuffer *buf,
+                        guint batch_size, GstClockTime batch_time)
+{
+    GstClockTime ts = GST_BUFFER_DTS_OR_PTS(buf);
+
+    if (filter->batch == NULL)
+    {
+        filter->batch = gst_buffer_list_new_sized(batch_size);
+        filter->batch_start = ts;
+    }
+    else if (!GST_CLOCK_TIME_IS_VALID(filter->batch_start))
+    {
+        filter->batch_start = ts;
+    }
+
+    gst_buffer_list_add(filter->batch, buf);
+
+    if (gst_buffer_list_length(filter->batch) >= batch_size)
+        return gst_my_filter_batch_flush(filter);
+
+    // 时间窗口：以缓冲区时间戳衡量，而不是挂钟时间，保证结果可复现
+    if (batch_time > 0 && GST_CLOCK_TIME_IS_VALID(ts) &&
+        GST_CLOCK_TIME_IS_VALID(filter->batch_start) &&
+        ts >= filter->batch_start && ts - filter->batch_start >= batch_time)
+        return gst_my_filter_batch_flush(filter);
+
+    return GST_FLOW_OK;
+}
+
+/* 输出辅助函数 */
+
+/* 按顺序输出一个处理完成的缓冲区，按需并入批次
+ * 接管 buf 的所有权
+ */
+static GstFlowReturn
+gst_my_filter_output(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstFlowReturn ret;
+    guint batch_size;
+    GstClockTime batch_time;
+
+    GST_OBJECT_LOCK(filter);
+    batch_size = filter->batch_size;
+    batch_time = filter->batch_time;
+    GST_OBJECT_UNLOCK(filter);
+
+    if (batch_size > 1)
+        return gst_my_filter_batch_add(filter, buf, batch_size, batch_time);
+
+    // 运行时关闭了批处理：先推送剩余批次以保持顺序
+    ret = gst_my_filter_batch_flush(filter);
+    if (ret != GST_FLOW_OK)
+    {
+        gst_buffer_unref(buf);
+        return ret;
+    }
+
+    gst_my_filter_track_position(filter, buf);
+    return gst_pad_push(filter->srcpad, buf);
+}
+
+/* 按顺序输出一个串行事件，必须排在已收到的缓冲区之后，所以先推送当前批次 */
+static gboolean
+gst_my_filter_output_event(GstMyFilter *filter, GstEvent *event)
+{
+    GstFlowReturn ret = gst_my_filter_batch_flush(filter);
+
+    // 正在 flush：事件随批次一起作废
+    if (ret == GST_FLOW_FLUSHING)
+    {
+        gst_event_unref(event);
+        return FALSE;
+    }
+    // 批次推送出错时上报，EOS 等事件仍然转发，管道不会停在这里
+    if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS)
+        GST_ELEMENT_FLOW_ERROR(filter, ret);
+
+    gst_my_filter_track_event(filter, event);
+    return gst_pad_push_event(filter->srcpad, event);
+}
+
+/* 帧级并行：工作线程池 + 按序重组
+ *
+ * 流线程按到达顺序把缓冲区和串行事件放入 pool_queue，缓冲区交给 GThreadPool 处理，
+ * src pad 任务只在队头条目完成后才输出，因此下游看到的顺序与输入完全一致。
+ * 已入队未输出的缓冲区数受 max-in-flight 限制，超过时流线程阻塞，形成反压。
+ */
+typedef struct
+{
+    GstMiniObject *object; // 缓冲区或串行事件，处理后丢弃的缓冲区为 NULL
+    gboolean done;         // 是否可以输出（事件入队即完成）
+} GstMyFilterWorkItem;
+
+static void
+gst_my_filter_work_item_free(GstMyFilterWorkItem *item)
+{
+    if (item->object)
+        gst_mini_object_unref(item->object);
+    g_free(item);
+}
+
+/* 工作线程函数：处理一个缓冲区并标记完成 */
+static void
+gst_my_filter_pool_work(gpointer data, gpointer user_data)
+{
+    GstMyFilterWorkItem *item = data;
+    GstMyFilter *filter = GST_MYFILTER(user_data);
+    GstBuffer *buf;
+
+    buf = gst_my_filter_transform(filter, GST_BUFFER_CAST(item->object));
+
+    g_mutex_lock(&filter->pool_lock);
+    item->object = GST_MINI_OBJECT_CAST(buf);
+    item->done = TRUE;
+    filter->pool_processing--;
+    g_cond_broadcast(&filter->pool_cond);
+    g_mutex_unlock(&filter->pool_lock);
+}
+
+/* 把缓冲区交给工作线程，达到 max-in-flight 时阻塞
+ * 接管 buf 的所有权
+ */
+static GstFlowReturn
+gst_my_filter_pool_push(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstMyFilterWorkItem *item;
+    GstFlowReturn ret;
+
+    g_mutex_lock(&filter->pool_lock);
+    while (!filter->pool_flushing && filter->pool_flow == GST_FLOW_OK &&
+           filter->pool_in_flight >= filter->max_in_flight)
+        g_cond_wait(&filter->pool_cond, &filter->pool_lock);
+
+    if (filter->pool_flushing)
+        ret = GST_FLOW_FLUSHING;
+    else
+        ret = filter->pool_flow;
+
+    if (ret != GST_FLOW_OK)
+    {
+        g_mutex_unlock(&filter->pool_lock);
+        GST_LOG_OBJECT(filter, "not queueing buffer, %s", gst_flow_get_name(ret));
+        gst_buffer_unref(buf);
+        return ret;
+    }
+
+    item = g_new0(GstMyFilterWorkItem, 1);
+    item->object = GST_MINI_OBJECT_CAST(buf);
+    g_queue_push_tail(&filter->pool_queue, item);
+    filter->pool_in_flight++;
+    filter->pool_processing++;
+    g_mutex_unlock(&filter->pool_lock);
+
+    g_thread_pool_push(filter->pool, item, NULL);
+    return GST_FLOW_OK;
+}
+
+/* 把串行事件排在已入队的缓冲区之后 */
+static gboolean
+gst_my_filter_pool_push_event(GstMyFilter *filter, GstEvent *event)
+{
+    GstMyFilterWorkItem *item;
+
+    g_mutex_lock(&filter->pool_lock);
+    if (filter->pool_flushing)
+    {
+        g_mutex_unlock(&filter->pool_lock);
+        gst_event_unref(event);
+        return FALSE;
+    }
+
+    item = g_new0(GstMyFilterWorkItem, 1);
+    item->object = GST_MINI_OBJECT_CAST(event);
+    item->done = TRUE;
+    g_queue_push_tail(&filter->pool_queue, item);
+    g_cond_broadcast(&filter->pool_cond);
+    g_mutex_unlock(&filter->pool_lock);
+
+    return TRUE;
+}
+
+/* 等待队列中的所有条目都已输出（CAPS 变化和串行查询之前调用） */
+static void
+gst_my_filter_pool_drain(GstMyFilter *filter)
+{
+    g_mutex_lock(&filter->pool_lock);
+    while (!filter->pool_flushing && filter->pool_flow == GST_FLOW_OK &&
+           (!g_queue_is_empty(&filter->pool_queue) || filter->pool_busy))
+        g_cond_wait(&filter->pool_cond, &filter->pool_lock);
+    g_mutex_unlock(&filter->pool_lock);
+}
+
+/* 进入或离开 flushing 状态，唤醒所有等待者 */
+static void
+gst_my_filter_pool_set_flushing(GstMyFilter *filter, gboolean flushing)
+{
+    g_mutex_lock(&filter->pool_lock);
+    filter->pool_flushing = flushing;
+    if (!flushing)
+        filter->pool_flow = GST_FLOW_OK;
+    g_cond_broadcast(&filter->pool_cond);
+    g_mutex_unlock(&filter->pool_lock);
+}
+
+/* 丢弃队列中的全部条目，必须在输出任务暂停后调用
+ * 仍在工作线程中处理的缓冲区要等它们完成后才能释放
+ */
+static void
+gst_my_filter_pool_clear(GstMyFilter *filter)
+{
+    GstMyFilterWorkItem *item;
+    guint dropped = 0;
+
+    g_mutex_lock(&filter->pool_lock);
+    while (filter->pool_processing > 0)
+        g_cond_wait(&filter->pool_cond, &filter->pool_lock);
+
+    while ((item = g_queue_pop_head(&filter->pool_queue)) != NULL)
+    {
+        if (item->object && GST_IS_BUFFER(item->object))
+            dropped++;
+        gst_my_filter_work_item_free(item);
+    }
+    filter->pool_in_flight = 0;
+    g_mutex_unlock(&filter->pool_lock);
+
+    gst_my_filter_stats_record_drops(&filter->stats, dropped);
+}
+
+/* src pad 任务：按顺序输出完成的条目 */
+static void
+gst_my_filter_pool_loop(gpointer user_data)
+{
+    GstMyFilter *filter = GST_MYFILTER(user_data);
+    GstMyFilterWorkItem *item = NULL;
+    GstMiniObject *object;
+    gboolean is_buffer;
+    GstFlowReturn ret = GST_FLOW_OK;
+
+    g_mutex_lock(&filter->pool_lock);
+    while (!filter->pool_flushing &&
+           ((item = g_queue_peek_head(&filter->pool_queue)) == NULL || !item->done))
+        g_cond_wait(&filter->pool_cond, &filter->pool_lock);
+
+    if (filter->pool_flushing)
+    {
+        g_mutex_unlock(&filter->pool_lock);
+        GST_LOG_OBJECT(filter, "flushing, pausing task");
+        gst_pad_pause_task(filter->srcpad);
+        return;
+    }
+
+    g_queue_pop_head(&filter->pool_queue);
+    filter->pool_busy = TRUE;
+    g_mutex_unlock(&filter->pool_lock);
+
+    object = item->object;
+    is_buffer = object == NULL || GST_IS_BUFFER(object);
+    item->object = NULL;
+    gst_my_filter_work_item_free(item);
+
+    if (object == NULL)
+    {
+        // 缓冲区在处理时被丢弃
+    }
+    else if (is_buffer)
+    {
+        ret = gst_my_filter_output(filter, GST_BUFFER_CAST(object));
+    }
+    else
+    {
+        gst_my_filter_output_event(filter, GST_EVENT_CAST(object));
+    }
+
+    g_mutex_lock(&filter->pool_lock);
+    if (is_buffer)
+        filter->pool_in_flight--;
+    filter->pool_busy = FALSE;
+    if (ret != GST_FLOW_OK && !filter->pool_flushing)
+        filter->pool_flow = ret; // 下一次 chain 把结果返回给上游
+    g_cond_broadcast(&filter->pool_cond);
+    g_mutex_unlock(&filter->pool_lock);
+
+    if (ret == GST_FLOW_OK)
+        return;
+
+    GST_DEBUG_OBJECT(filter, "pausing task, reason %s", gst_flow_get_name(ret));
+    if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS)
+    {
+        // 与 queue 相同：致命错误时报告错误并向下游发送 EOS
+        GST_ELEMENT_FLOW_ERROR(filter, ret);
+        gst_pad_push_event(filter->srcpad, gst_event_new_eos());
+    }
+    gst_pad_pause_task(filter->srcpad);
+}
+
+/* src pad 激活：使用工作线程时启动或停止输出任务 */
+static gboolean
+gst_my_filter_src_activate_mode(GstPad *pad, GstObject *parent,
+                                GstPadMode mode, gboolean active)
+{
+    GstMyFilter *filter = GST_MYFILTER(parent);
+
+    if (mode != GST_PAD_MODE_PUSH)
+        return FALSE;
+
+    if (filter->pool == NULL)
+        return TRUE;
+
+    if (active)
+    {
+        gst_my_filter_pool_set_flushing(filter, FALSE);
+        return gst_pad_start_task(pad, gst_my_filter_pool_loop, filter, NULL);
+    }
+
+    gst_my_filter_pool_set_flushing(filter, TRUE);
+    return gst_pad_stop_task(pad);
+}
+
+/* ROI 协商辅助函数 */
+
+/* 创建一个 64 字节对齐的视频缓冲池
+ * 只有下游支持 GstVideoMeta 时才在行尾填充以对齐每一行，否则只对齐内存起始地址
+ */
+static GstBufferPool *
+gst_my_filter_new_video_pool(GstMyFilter *filter, GstCaps *caps,
+                             const GstVideoInfo *info, guint min_buffers,
+                             gboolean video_meta)
+{
+    GstBufferPool *pool;
+    GstStructure *config;
+    GstAllocationParams params;
+    GstVideoAlignment align;
+    guint i;
+
+    pool = gst_video_buffer_pool_new();
+    config = gst_buffer_pool_get_config(pool);
+    gst_buffer_pool_config_set_params(config, caps, GST_VIDEO_INFO_SIZE(info), min_buffers, 0);
+
+    gst_allocation_params_init(&params);
+    params.align = ALLOC_ALIGN;
+    gst_buffer_pool_config_set_allocator(config, NULL, &params);
+
+    if (video_meta)
+    {
+        gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+        gst_video_alignment_reset(&align);
+        for (i = 0; i < GST_VIDEO_MAX_PLANES; i++)
+            align.stride_align[i] = ALLOC_ALIGN;
+        gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+        gst_buffer_pool_config_set_video_alignment(config, &align);
+    }
+
+    if (!gst_buffer_pool_set_config(pool, config))
+    {
+        // 缓冲池可能调整了参数，接受调整后的配置
+        config = gst_buffer_pool_get_config(pool);
+        if (!gst_buffer_pool_config_validate_params(config, caps, GST_VIDEO_INFO_SIZE(info), min_buffers, 0) ||
+            !gst_buffer_pool_set_config(pool, config))
+        {
+            GST_WARNING_OBJECT(filter, "failed to configure buffer pool");
+            gst_object_unref(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+/* 释放复制模式的输出缓冲池并停止裁剪 */
+static void
+gst_my_filter_crop_clear(GstMyFilter *filter)
+{
+    if (filter->crop_pool)
+    {
+        gst_buffer_pool_set_active(filter->crop_pool, FALSE);
+        gst_object_unref(filter->crop_pool);
+        filter->crop_pool = NULL;
+    }
+    filter->crop_mode = GST_MY_FILTER_CROP_NONE;
+}
+
+/* 根据 ROI 属性和下游能力选择裁剪方式，返回输出 caps，失败时返回 NULL
+ * 调用前 filter->info 已经是新的输入格式，工作线程已经排空
+ */
+static GstCaps *
+gst_my_filter_roi_configure(GstMyFilter *filter, GstCaps *caps)
+{
+    const GstVideoFormatInfo *finfo = filter->info.finfo;
+    guint width = GST_VIDEO_INFO_WIDTH(&filter->info);
+    guint height = GST_VIDEO_INFO_HEIGHT(&filter->info);
+    guint x, y, w, h, w_sub = 0, h_sub = 0, i;
+    GstQuery *query;
+    GstCaps *outcaps;
+    gboolean crop_meta;
+
+    // 先清除标志：协商期间再次修改的属性会在下一个缓冲区生效
+    g_atomic_int_set(&filter->roi_dirty, FALSE);
+    GST_OBJECT_LOCK(filter);
+    x = filter->roi_x;
+    y = filter->roi_y;
+    w = filter->roi_width;
+    h = filter->roi_height;
+    GST_OBJECT_UNLOCK(filter);
+
+    gst_my_filter_crop_clear(filter);
+
+    // ROI 限制在帧内，宽或高为 0 或覆盖整帧时不裁剪
+    x = MIN(x, width);
+    y = MIN(y, height);
+    w = MIN(w, width - x);
+    h = MIN(h, height - y);
+    if (w == 0 || h == 0 || (w == width && h == height))
+        return gst_caps_ref(caps);
+
+    // 下游在 ALLOCATION 查询中声明支持 GstVideoCropMeta 时只附加元数据，不复制像素
+    query = gst_query_new_allocation(caps, FALSE);
+    crop_meta = gst_pad_peer_query(filter->srcpad, query) &&
+                gst_query_find_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, NULL);
+    gst_query_unref(query);
+
+    if (crop_meta)
+    {
+        GST_DEBUG_OBJECT(filter, "cropping %ux%u+%u+%u with crop meta", w, h, x, y);
+        filter->crop_x = x;
+        filter->crop_y = y;
+        filter->crop_width = w;
+        filter->crop_height = h;
+        filter->crop_mode = GST_MY_FILTER_CROP_META;
+        return gst_caps_ref(caps);
+    }
+
+    // 复制时起点对齐到色度子采样，保证每个平面的偏移都是整数个采样
+    for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS(finfo); i++)
+    {
+        w_sub = MAX(w_sub, GST_VIDEO_FORMAT_INFO_W_SUB(finfo, i));
+        h_sub = MAX(h_sub, GST_VIDEO_FORMAT_INFO_H_SUB(finfo, i));
+    }
+    x &= ~((1u << w_sub) - 1);
+    y &= ~((1u << h_sub) - 1);
+
+    outcaps = gst_caps_copy(caps);
+    gst_caps_set_simple(outcaps, "width", G_TYPE_INT, (gint)w, "height", G_TYPE_INT, (gint)h, NULL);
+    if (!gst_video_info_from_caps(&filter->out_info, outcaps))
+    {
+        GST_ERROR_OBJECT(filter, "invalid output caps %" GST_PTR_FORMAT, outcaps);
+        gst_caps_unref(outcaps);
+        return NULL;
+    }
+
+    filter->crop_pool = gst_my_filter_new_video_pool(filter, outcaps, &filter->out_info,
+                                                     ALLOC_MIN_BUFFERS, FALSE);
+    if (filter->crop_pool == NULL || !gst_buffer_pool_set_active(filter->crop_pool, TRUE))
+    {
+        GST_ERROR_OBJECT(filter, "failed to activate output buffer pool");
+        gst_my_filter_crop_clear(filter);
+        gst_caps_unref(outcaps);
+        return NULL;
+    }
+
+    GST_DEBUG_OBJECT(filter, "cropping %ux%u+%u+%u by copying", w, h, x, y);
+    filter->crop_x = x;
+    filter->crop_y = y;
+    filter->crop_width = w;
+    filter->crop_height = h;
+    filter->crop_mode = GST_MY_FILTER_CROP_COPY;
+    return outcaps;
+}
+
+/* 运行时修改了 ROI：在流线程中按顺序重新协商，必要时向下游发送新的 caps */
+static GstFlowReturn
+gst_my_filter_roi_update(GstMyFilter *filter)
+{
+    GstCaps *caps, *outcaps, *current;
+    GstEvent *event = NULL;
+
+    if (!g_atomic_int_get(&filter->roi_dirty))
+        return GST_FLOW_OK;
+
+    caps = gst_pad_get_current_caps(filter->sinkpad);
+    if (caps == NULL)
+        return GST_FLOW_OK; // 尚未协商，CAPS 事件到来时再配置
+
+    // 工作线程可能还在按旧的裁剪区域处理
+    if (filter->pool)
+        gst_my_filter_pool_drain(filter);
+
+    outcaps = gst_my_filter_roi_configure(filter, caps);
+    gst_caps_unref(caps);
+    if (outcaps == NULL)
+        return GST_FLOW_NOT_NEGOTIATED;
+
+    current = gst_pad_get_current_caps(filter->srcpad);
+    if (current == NULL || !gst_caps_is_equal(current, outcaps))
+        event = gst_event_new_caps(outcaps);
+    if (current)
+        gst_caps_unref(current);
+    gst_caps_unref(outcaps);
+
+    if (event == NULL)
+        return GST_FLOW_OK;
+
+    if (filter->pool)
+        gst_my_filter_pool_push_event(filter, event);
+    else
+        gst_my_filter_output_event(filter, event);
+    return GST_FLOW_OK;
+}
+
+/* 去掉 caps 中的宽高 */
+static GstCaps *
+gst_my_filter_strip_size(GstCaps *caps)
+{
+    GstCaps *res = gst_caps_copy(caps);
+    guint i;
+
+    for (i = 0; i < gst_caps_get_size(res); i++)
+        gst_structure_remove_fields(gst_caps_get_structure(res, i), "width", "height", NULL);
+    return res;
+}
+
+/* 设置了 ROI 时输入输出的尺寸可以不同，不能再直接代理对端的 caps */
+static gboolean
+gst_my_filter_roi_query_caps(GstMyFilter *filter, GstPad *pad, GstQuery *query)
+{
+    GstPad *otherpad = pad == filter->sinkpad ? filter->srcpad : filter->sinkpad;
+    GstCaps *filt, *peer_filter = NULL, *peercaps, *stripped, *templ, *result;
+
+    gst_query_parse_caps(query, &filt);
+    if (filt)
+        peer_filter = gst_my_filter_strip_size(filt);
+
+    peercaps = gst_pad_peer_query_caps(otherpad, peer_filter);
+    stripped = gst_my_filter_strip_size(peercaps);
+    templ = gst_pad_get_pad_template_caps(pad);
+    result = gst_caps_intersect(stripped, templ);
+
+    if (filt)
+    {
+        GstCaps *tmp = gst_caps_intersect_full(filt, result, GST_CAPS_INTERSECT_FIRST);
+
+        gst_caps_unref(result);
+        result = tmp;
+        gst_caps_unref(peer_filter);
+    }
+
+    gst_query_set_caps_result(query, result);
+
+    gst_caps_unref(result);
+    gst_caps_unref(templ);
+    gst_caps_unref(stripped);
+    gst_caps_unref(peercaps);
+    return TRUE;
+}
+
+/* 是否设置了 ROI 属性（不考虑是否已经生效） */
+static gboolean
+gst_my_filter_roi_enabled(GstMyFilter *filter)
+{
+    gboolean enabled;
+
+    GST_OBJECT_LOCK(filter);
+    enabled = filter->roi_width > 0 && filter->roi_height > 0;
+    GST_OBJECT_UNLOCK(filter);
+    return enabled;
+}
+
+/* 静止帧：按 motion-action 丢弃，或者在原位置发送 GAP 事件
+ * 两种情况下帧都不会到达下游，都计入 drops。接管 buf 的所有权
+ */
+static GstFlowReturn
+gst_my_filter_motion_suppress(GstMyFilter *filter, GstBuffer *buf)
+{
+    GstClockTime ts = GST_BUFFER_PTS(buf);
+    GstEvent *event;
+
+    gst_my_filter_stats_record_drops(&filter->stats, 1);
+
+    if (g_atomic_int_get(&filter->motion_action) != GST_MY_FILTER_MOTION_GAP ||
+        !GST_CLOCK_TIME_IS_VALID(ts))
+    {
+        gst_buffer_unref(buf);
+        return GST_FLOW_OK;
+    }
+
+    event = gst_event_new_gap(ts, GST_BUFFER_DURATION(buf));
+    gst_buffer_unref(buf);
+
+    if (filter->pool)
+        gst_my_filter_pool_push_event(filter, event);
+    else
+        gst_my_filter_output_event(filter, event);
+    return GST_FLOW_OK;
+}
+
+/* GstElement 虚方法实现 */
+
+static GstStateChangeReturn
+gst_my_filter_change_state(GstElement *element, GstStateChange transition)
+{
+    GstMyFilter *filter = GST_MYFILTER(element);
+    GstStateChangeReturn ret;
+    GError *error = NULL;
+    guint workers;
+
+    switch (transition)
+    {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+        // pad 尚未激活，流线程不会访问统计，可以安全地清空
+        gst_my_filter_stats_reset(&filter->stats);
+        gst_my_filter_histogram_reset(&filter->latency);
+        filter->last_stats_post = GST_CLOCK_TIME_NONE;
+        gst_segment_init(&filter->segment, GST_FORMAT_TIME);
+        gst_my_filter_qos_reset(filter);
+        gst_my_filter_position_reset(filter);
+        gst_my_filter_motion_reset(filter);
+
+        // 工作线程池必须在 src pad 激活之前创建，激活时据此决定是否启动输出任务
+        GST_OBJECT_LOCK(filter);
+        workers = filter->workers;
+        filter->n_slices = filter->slices > 0 ? filter->slices : g_get_num_processors();
+        filter->n_slices = MIN(filter->n_slices, MAX_SLICES);
+        GST_OBJECT_UNLOCK(filter);
+
+        if (filter->n_slices > 1)
+        {
+            filter->slice_pool = g_thread_pool_new(gst_my_filter_slice_work, filter,
+                                                   filter->n_slices - 1, TRUE, &error);
+            if (filter->slice_pool == NULL)
+            {
+                GST_ELEMENT_ERROR(filter, RESOURCE, FAILED,
+                                  ("Could not create slice threads"), ("%s", error->message));
+                g_clear_error(&error);
+                return GST_STATE_CHANGE_FAILURE;
+            }
+        }
+        if (workers > 0)
+        {
+            filter->pool = g_thread_pool_new(gst_my_filter_pool_work, filter,
+                                             workers, TRUE, &error);
+            if (filter->pool == NULL)
+            {
+                GST_ELEMENT_ERROR(filter, RESOURCE, FAILED,
+                                  ("Could not create worker threads"), ("%s", error->message));
+                g_clear_error(&error);
+                return GST_STATE_CHANGE_FAILURE;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    ret = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
+    if (ret == GST_STATE_CHANGE_FAILURE)
+        return ret;
+
+    switch (transition)
+    {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+        // pad 已经停用，输出任务已停止，等待工作线程结束后丢弃剩余条目和批次
+        if (filter->pool)
+        {
+            gst_my_filter_pool_clear(filter);
+            g_thread_pool_free(filter->pool, FALSE, TRUE);
+            filter->pool = NULL;
+        }
+        if (filter->slice_pool)
+        {
+            g_thread_pool_free(filter->slice_pool, FALSE, TRUE);
+            filter->slice_pool = NULL;
+        }
+        gst_my_filter_batch_clear(filter);
+        gst_my_filter_crop_clear(filter);
+        break;
+    case GST_STATE_CHANGE_READY_TO_NULL:
+        if (filter->alloc_pool)
+        {
+            gst_buffer_pool_set_active(filter->alloc_pool, FALSE);
+            gst_clear_object(&filter->alloc_pool);
+        }
+        gst_clear_caps(&filter->alloc_caps);
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
+/* 处理sink事件的函数 */
+static gboolean
+gst_my_filter_sink_event(GstPad *pad, GstObject *parent,
+                         GstEvent *event)
+{
+    GstMyFilter *filter;
+    gboolean ret;
+
+    filter = GST_MYFILTER(parent);
+
+    GST_LOG_OBJECT(filter, "receive %s event: %" GST_PTR_FORMAT,
+                   GST_EVENT_TYPE_NAME(event), event); // 记录收到的事件
+
+    switch (GST_EVENT_TYPE(event))
+    {
+    case GST_EVENT_FLUSH_START:
+        ret = gst_pad_event_default(pad, parent, event);
+        if (filter->pool)
+        {
+            // 下游已经开始 flush，唤醒阻塞的流线程和输出任务
+            gst_my_filter_pool_set_flushing(filter, TRUE);
+            gst_pad_pause_task(filter->srcpad);
+        }
+        return ret;
+    case GST_EVENT_FLUSH_STOP:
+        if (filter->pool)
+            gst_my_filter_pool_clear(filter);
+        gst_my_filter_batch_clear(filter); // 丢弃尚未推送的批次
+        gst_segment_init(&filter->segment, GST_FORMAT_TIME);
+        gst_my_filter_qos_reset(filter);
+        gst_my_filter_motion_reset(filter);
+        // flush 之后上游会重新发送 segment，时长缓存保留
+        GST_OBJECT_LOCK(filter);
+        filter->position = GST_CLOCK_TIME_NONE;
+        GST_OBJECT_UNLOCK(filter);
+        ret = gst_pad_event_default(pad, parent, event);
+        if (filter->pool)
+        {
+            gst_my_filter_pool_set_flushing(filter, FALSE);
+            gst_pad_start_task(filter->srcpad, gst_my_filter_pool_loop, filter, NULL);
+        }
+        return ret;
+    case GST_EVENT_CAPS:
+    {
+        GstCaps *caps, *outcaps;
+
+        // 工作线程可能还在按旧格式处理缓冲区，先排空
+        if (filter->pool)
+            gst_my_filter_pool_drain(filter);
+
+        gst_event_parse_caps(event, &caps); // 解析事件中的caps
+        if (!gst_video_info_from_caps(&filter->info, caps))
+        {
+            GST_ERROR_OBJECT(filter, "invalid caps %" GST_PTR_FORMAT, caps);
+            gst_event_unref(event);
+            return FALSE;
+        }
+
+        GST_OBJECT_LOCK(filter);
+        if (GST_VIDEO_INFO_FPS_N(&filter->info) > 0)
+            filter->qos_frame_duration = gst_util_uint64_scale(GST_SECOND, GST_VIDEO_INFO_FPS_D(&filter->info),
+                                                               GST_VIDEO_INFO_FPS_N(&filter->info));
+        else
+            filter->qos_frame_duration = 0;
+        GST_OBJECT_UNLOCK(filter);
+
+        gst_my_filter_motion_reset(filter); // 参考帧按旧格式保存
+
+        // 复制 ROI 时输出尺寸与输入不同，用新的 caps 替换事件
+        outcaps = gst_my_filter_roi_configure(filter, caps);
+        if (outcaps == NULL)
+        {
+            gst_event_unref(event);
+            return FALSE;
+        }
+        if (!gst_caps_is_equal(outcaps, caps))
+        {
+            gst_event_unref(event);
+            event = gst_event_new_caps(outcaps);
+        }
+        gst_caps_unref(outcaps);
+        break;
+    }
+    case GST_EVENT_SEGMENT:
+        // 记录 segment，用于把时间戳换算为运行时间
+        gst_event_copy_segment(event, &filter->segment);
+        break;
+    default:
+        break;
+    }
+
+    if (!GST_EVENT_IS_SERIALIZED(event))
+        return gst_pad_event_default(pad, parent, event); // 默认事件处理
+
+    // 串行事件（CAPS、SEGMENT、EOS 等）必须排在已收到的缓冲区之后
+    if (filter->pool)
+        return gst_my_filter_pool_push_event(filter, event);
+
+    return gst_my_filter_output_event(filter, event);
+}
+
+/* 处理src事件的函数（来自下游） */
+static gboolean
+gst_my_filter_src_event(GstPad *pad, GstObject *parent, GstEvent *event)
+{
+    GstMyFilter *filter = GST_MYFILTER(parent);
+
+    switch (GST_EVENT_TYPE(event))
+    {
+    case GST_EVENT_QOS:
+    {
+        GstQOSType type;
+        gdouble proportion;
+        GstClockTimeDiff diff;
+        GstClockTime timestamp;
+
+        gst_event_parse_qos(event, &type, &proportion, &diff, &timestamp);
+        gst_my_filter_qos_update(filter, proportion, diff, timestamp);
+        break;
+    }
+    default:
+        break;
+    }
+
+    /* 继续向上游转发，让解码器等元素也能丢帧 */
+    return gst_pad_event_default(pad, parent, event);
+}
+
+/* 链函数
+ * 这个函数进行实际处理
+ */
+static GstFlowReturn
+gst_my_filter_chain(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstMyFilter *filter;
+    GstFlowReturn ret;
+
+    filter = GST_MYFILTER(parent);
+
+    ret = gst_my_filter_roi_update(filter);
+    if (ret != GST_FLOW_OK)
+    {
+        gst_buffer_unref(buf);
+        return ret;
+    }
+
+    buf = gst_my_filter_process_buffer(filter, buf);
+    if (buf == NULL)
+        return GST_FLOW_OK;
+
+    // 静止帧不再进入后续处理
+    if (gst_my_filter_motion_static(filter, buf))
+        return gst_my_filter_motion_suppress(filter, buf);
+
+    if (filter->pool)
+        return gst_my_filter_pool_push(filter, buf);
+
+    buf = gst_my_filter_transform(filter, buf);
+    if (buf == NULL)
+        return GST_FLOW_OK;
+
+    return gst_my_filter_output(filter, buf);
+}
+
+/* 缓冲区列表链函数
+ * 上游一次推送多个缓冲区时调用，不做批处理时原样转发整个列表
+ */
+static GstFlowReturn
+gst_my_filter_chain_list(GstPad *pad, GstObject *parent, GstBufferList *list)
+{
+    GstMyFilter *filter;
+    GstFlowReturn ret = GST_FLOW_OK;
+    guint batch_size, i, len;
+    gboolean motion;
+
+    filter = GST_MYFILTER(parent);
+
+    ret = gst_my_filter_roi_update(filter);
+    if (ret != GST_FLOW_OK)
+    {
+        gst_buffer_list_unref(list);
+        return ret;
+    }
+
+    // 运动门限可能把列表中的帧替换为 GAP 事件，只能逐个处理以保持顺序
+    GST_OBJECT_LOCK(filter);
+    motion = filter->motion_threshold > 0.0;
+    GST_OBJECT_UNLOCK(filter);
+    if (motion)
+    {
+        len = gst_buffer_list_length(list);
+        for (i = 0; i < len && ret == GST_FLOW_OK; i++)
+            ret = gst_my_filter_chain(pad, parent, gst_buffer_ref(gst_buffer_list_get(list, i)));
+        gst_buffer_list_unref(list);
+        return ret;
+    }
+
+    list = gst_buffer_list_make_writable(list);
+    gst_buffer_list_foreach(list, gst_my_filter_process_list_item, filter);
+    len = gst_buffer_list_length(list);
+
+    GST_OBJECT_LOCK(filter);
+    batch_size = filter->batch_size;
+    GST_OBJECT_UNLOCK(filter);
+
+    if (filter->pool == NULL && batch_size <= 1)
+    {
+        ret = gst_my_filter_batch_flush(filter);
+        if (ret != GST_FLOW_OK || len == 0)
+        {
+            gst_buffer_list_unref(list);
+            return ret;
+        }
+        gst_my_filter_track_position(filter, gst_buffer_list_get(list, len - 1));
+        return gst_pad_push_list(filter->srcpad, list);
+    }
+
+    // 逐个交给工作线程或并入当前批次
+    for (i = 0; i < len && ret == GST_FLOW_OK; i++)
+    {
+        GstBuffer *buf = gst_buffer_ref(gst_buffer_list_get(list, i));
+
+        if (filter->pool)
+            ret = gst_my_filter_pool_push(filter, buf);
+        else
+            ret = gst_my_filter_output(filter, buf);
+    }
+    gst_buffer_list_unref(list);
+
+    return ret;
+}
+
+/* 创建（或复用）向上游提议的视频缓冲池 */
+static GstBufferPool *
+gst_my_filter_get_alloc_pool(GstMyFilter *filter, GstCaps *caps,
+                             const GstVideoInfo *info, guint min_buffers,
+                             gboolean video_meta)
+{
+    GstBufferPool *pool;
+
+    if (filter->alloc_pool && filter->alloc_caps &&
+        gst_caps_is_equal(caps, filter->alloc_caps))
+        return gst_object_ref(filter->alloc_pool);
+
+    pool = gst_my_filter_new_video_pool(filter, caps, info, min_buffers, video_meta);
+    if (pool == NULL)
+        return NULL;
+
+    if (filter->alloc_pool)
+        gst_object_unref(filter->alloc_pool);
+    gst_caps_replace(&filter->alloc_caps, caps);
+    filter->alloc_pool = gst_object_ref(pool);
+
+    return pool;
+}
+
+/* 处理 ALLOCATION 查询
+ * 先询问下游：下游提供了缓冲池就直接透传（零拷贝），否则提议自己的视频缓冲池，
+ * 这样上游每帧都从池中复用缓冲区，稳态下不再分配内存
+ * 复制 ROI 时输入缓冲区不会到达下游，输出来自 crop_pool 且尺寸不同，
+ * 不询问下游，直接提议按输入尺寸分配的缓冲池
+ */
+static gboolean
+gst_my_filter_propose_allocation(GstMyFilter *filter, GstQuery *query)
+{
+    GstCaps *caps;
+    GstVideoInfo info;
+    GstBufferPool *pool;
+    gboolean need_pool, video_meta, crop_copy;
+    guint extra = 0, size, min, max;
+
+    // 在工作线程中处理的帧会同时占用缓冲区
+    if (filter->pool)
+    {
+        g_mutex_lock(&filter->pool_lock);
+        extra = filter->max_in_flight;
+        g_mutex_unlock(&filter->pool_lock);
+    }
+
+    crop_copy = filter->crop_mode == GST_MY_FILTER_CROP_COPY;
+    if (!crop_copy && gst_pad_peer_query(filter->srcpad, query) &&
+        gst_query_get_n_allocation_pools(query) > 0)
+    {
+        gst_query_parse_nth_allocation_pool(query, 0, &pool, &size, &min, &max);
+        if (extra > 0 && (max == 0 || max >= min + extra))
+            gst_query_set_nth_allocation_pool(query, 0, pool, size, min + extra, max);
+        if (pool)
+            gst_object_unref(pool);
+        GST_DEBUG_OBJECT(filter, "using downstream allocation");
+        return TRUE;
+    }
+
+    gst_query_parse_allocation(query, &caps, &need_pool);
+    if (caps == NULL || !gst_video_info_from_caps(&info, caps))
+        return FALSE;
+
+    // 本元素通过 gst_video_frame_map 访问数据，自身支持带步长的 GstVideoMeta，
+    // 下游在查询中声明了支持时（已保留在查询结果中）才能使用填充后的步长；
+    // 复制 ROI 时输入缓冲区只由本元素读取，总是可以使用
+    if (crop_copy && !gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL))
+        gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+    video_meta = gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+
+    if (need_pool)
+    {
+        pool = gst_my_filter_get_alloc_pool(filter, caps, &info,
+                                            ALLOC_MIN_BUFFERS + extra, video_meta);
+        if (pool)
+        {
+            GST_DEBUG_OBJECT(filter, "proposing own video buffer pool");
+            gst_query_add_allocation_pool(query, pool, GST_VIDEO_INFO_SIZE(&info),
+                                          ALLOC_MIN_BUFFERS + extra, 0);
+            gst_object_unref(pool);
+        }
+    }
+
+    return TRUE;
+}
+
+/* 处理sink查询的函数 */
+static gboolean
+gst_my_filter_sink_query(GstPad *pad, GstObject *parent, GstQuery *query)
+{
+    GstMyFilter *filter = GST_MYFILTER(parent);
+
+    // 串行查询（DRAIN、ALLOCATION）必须在已收到的数据全部推送之后再转发
+    if (GST_QUERY_IS_SERIALIZED(query))
+    {
+        if (filter->pool)
+            gst_my_filter_pool_drain(filter);
+        if (GST_QUERY_TYPE(query) == GST_QUERY_DRAIN)
+            gst_my_filter_batch_flush(filter);
+    }
+
+    switch (GST_QUERY_TYPE(query))
+    {
+    case GST_QUERY_ALLOCATION:
+        return gst_my_filter_propose_allocation(filter, query);
+    case GST_QUERY_CAPS:
+        if (gst_my_filter_roi_enabled(filter))
+            return gst_my_filter_roi_query_caps(filter, pad, query);
+        break;
+    case GST_QUERY_ACCEPT_CAPS:
+        if (gst_my_filter_roi_enabled(filter))
+        {
+            GstCaps *caps, *allowed;
+
+            // 代理 caps 会让下游检查输入尺寸，ROI 生效时改为检查本元素能接受的 caps
+            gst_query_parse_accept_caps(query, &caps);
+            allowed = gst_pad_query_caps(pad, caps);
+            gst_query_set_accept_caps_result(query, gst_caps_is_subset(caps, allowed));
+            gst_caps_unref(allowed);
+            return TRUE;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return gst_pad_query_default(pad, parent, query);
+}
+
+/**
+ * @brief 处理源查询的回调函数。
+ *
+ * 这个函数用于处理从src pad 发出的查询请求。
+ * POSITION 由最后推送的缓冲区和 segment 在本地计算；DURATION 取自 segment，
+ * 或向上游查询一次后缓存，直到新的 segment 或 STREAM_START 到来。
+ *
+ * @param pad 指向 GstPad 的指针，表示源 pad。
+ * @param parent 指向 GstObject 的指针，表示父对象。
+ * @param query 指向 GstQuery 的指针，表示查询请求。
+ *
+ * @return gboolean 如果查询处理成功，返回 TRUE；否则返回 FALSE。
+ */
+static gboolean
+gst_my_filter_src_query(GstPad *pad,
+                        GstObject *parent,
+                        GstQuery *query)
+{
+    GstMyFilter *filter = GST_MYFILTER(parent);
+    GstFormat format;
+    gboolean ret;
+
+    switch (GST_QUERY_TYPE(query))
+    {
+    case GST_QUERY_POSITION:
+    {
+        GstClockTime position = GST_CLOCK_TIME_NONE;
+
+        gst_query_parse_position(query, &format, NULL);
+        if (format != GST_FORMAT_TIME)
+            return gst_pad_query_default(pad, parent, query);
+
+        // 用最后推送的缓冲区时间戳换算出流时间，不再向上游查询
+        GST_OBJECT_LOCK(filter);
+        if (GST_CLOCK_TIME_IS_VALID(filter->position) &&
+            filter->out_segment.format == GST_FORMAT_TIME)
+            position = gst_segment_to_stream_time(&filter->out_segment, GST_FORMAT_TIME,
+                                                  filter->position);
+        GST_OBJECT_UNLOCK(filter);
+
+        // 还没有推送过缓冲区时交给上游回答
+        if (!GST_CLOCK_TIME_IS_VALID(position))
+            return gst_pad_query_default(pad, parent, query);
+
+        gst_query_set_position(query, GST_FORMAT_TIME, position);
+        ret = TRUE;
+        break;
+    }
+    case GST_QUERY_DURATION:
+    {
+        GstClockTime duration;
+        gint64 upstream;
+        guint cookie;
+
+        gst_query_parse_duration(query, &format, NULL);
+        if (format != GST_FORMAT_TIME)
+            return gst_pad_query_default(pad, parent, query);
+
+        GST_OBJECT_LOCK(filter);
+        duration = filter->duration;
+        cookie = filter->duration_cookie;
+        GST_OBJECT_UNLOCK(filter);
+
+        if (!GST_CLOCK_TIME_IS_VALID(duration))
+        {
+            // 缓存为空：向上游查询一次，在新的 segment 或流到来之前一直使用该结果
+            if (!gst_pad_peer_query_duration(filter->sinkpad, GST_FORMAT_TIME, &upstream) ||
+                upstream < 0)
+                return FALSE;
+
+            duration = upstream;
+            GST_OBJECT_LOCK(filter);
+            if (filter->duration_cookie == cookie)
+                filter->duration = duration;
+            GST_OBJECT_UNLOCK(filter);
+        }
+
+        gst_query_set_duration(query, GST_FORMAT_TIME, duration);
+        ret = TRUE;
+        break;
+    }
+    case GST_QUERY_CAPS:
+        if (gst_my_filter_roi_enabled(filter))
+            return gst_my_filter_roi_query_caps(filter, pad, query);
+        ret = gst_pad_query_default(pad, parent, query); // 未设置 ROI 时代理下游的 caps
         break;
     default:
-        /* just call the default handler */
         ret = gst_pad_query_default(pad, parent, query);
         break;
     }
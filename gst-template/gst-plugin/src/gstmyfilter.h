@@ -2,9 +2,36 @@
 #define __GST_MYFILTER_H__
 
 #include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "gstmyfilterstats.h"
+#include "gstmyfiltermeta.h"
 
 G_BEGIN_DECLS
 
+/* 计时模式：打戳或测量，见 gstmyfiltermeta.h */
+typedef enum
+{
+  GST_MY_FILTER_TIMING_NONE,
+  GST_MY_FILTER_TIMING_STAMP,
+  GST_MY_FILTER_TIMING_MEASURE
+} GstMyFilterTimingMode;
+
+/* ROI 的实现方式，在协商时根据下游能力选择 */
+typedef enum
+{
+  GST_MY_FILTER_CROP_NONE,       /* 不裁剪 */
+  GST_MY_FILTER_CROP_META,       /* 附加 GstVideoCropMeta，由下游裁剪 */
+  GST_MY_FILTER_CROP_COPY        /* 下游不支持裁剪元数据时复制 ROI 区域 */
+} GstMyFilterCropMode;
+
+/* 运动门限判定为静止的帧如何处理 */
+typedef enum
+{
+  GST_MY_FILTER_MOTION_DROP,     /* 直接丢弃 */
+  GST_MY_FILTER_MOTION_GAP       /* 用 GAP 事件替换，下游仍能推进时间 */
+} GstMyFilterMotionAction;
+
 #define GST_TYPE_MYFILTER (gst_my_filter_get_type())
 G_DECLARE_FINAL_TYPE(GstMyFilter, gst_my_filter, GST, MYFILTER, GstElement)
 
@@ -15,6 +42,76 @@ struct _GstMyFilter
   GstPad *sinkpad, *srcpad;
 
   gboolean silent;
+
+  /* 批处理：将多个缓冲区合并为 GstBufferList 一次推送 */
+  guint batch_size;         /* 每批缓冲区数量，1 表示关闭批处理 */
+  GstClockTime batch_time;  /* 每批覆盖的最大时间跨度，0 表示不限制 */
+  GstBufferList *batch;     /* 当前尚未推送的批次 */
+  GstClockTime batch_start; /* 当前批次第一个缓冲区的时间戳 */
+
+  /* 吞吐量统计，流线程无锁写入，属性读取无锁 */
+  GstMyFilterStats stats;
+  guint stats_interval;          /* 统计消息间隔（毫秒），0 表示不发送，原子访问 */
+  GstClockTime last_stats_post;  /* 上次发送统计消息的时间，只在流线程访问 */
+
+  /* 端到端延迟测量 */
+  gint timing_mode;              /* GstMyFilterTimingMode，原子访问 */
+  GstMyFilterHistogram latency;  /* measure 模式下的延迟直方图 */
+
+  /* 帧级并行：工作线程池和按序重组队列，由 pool_lock 保护 */
+  guint workers;                 /* 工作线程数，0 表示在流线程中处理 */
+  guint max_in_flight;           /* 已入队但尚未输出的最大缓冲区数 */
+  GThreadPool *pool;             /* 仅在 PAUSED 及以上状态且 workers > 0 时存在 */
+  GMutex pool_lock;
+  GCond pool_cond;
+  GQueue pool_queue;             /* 按到达顺序排列的缓冲区和串行事件 */
+  guint pool_in_flight;          /* 已入队但尚未输出的缓冲区数 */
+  guint pool_processing;         /* 工作线程中尚未处理完的缓冲区数 */
+  gboolean pool_busy;            /* 输出任务正在推送一个条目 */
+  gboolean pool_flushing;
+  GstFlowReturn pool_flow;       /* 输出任务最近一次推送的结果 */
+
+  /* 帧内并行：按水平条带切分，由常驻线程池并发处理 */
+  GstVideoInfo info;             /* 当前视频格式，CAPS 事件中解析 */
+  gboolean invert;               /* 反色处理，原子访问 */
+  guint slices;                  /* 每帧条带数，0 表示使用 CPU 核数 */
+  guint n_slices;                /* PAUSED 时实际使用的条带数 */
+  GThreadPool *slice_pool;       /* n_slices - 1 个常驻线程，调用线程处理第一个条带 */
+
+  /* 下游不提供缓冲池时向上游提议的缓冲池，caps 不变时重复使用 */
+  GstBufferPool *alloc_pool;
+  GstCaps *alloc_caps;
+
+  /* QoS：根据下游反馈提前丢弃已经迟到的帧 */
+  gboolean qos;                  /* 是否启用 QoS 丢帧，原子访问 */
+  GstSegment segment;            /* 当前 segment，只在流线程访问 */
+  gdouble qos_proportion;        /* 由 GST_OBJECT_LOCK 保护 */
+  GstClockTime earliest_time;    /* 运行时间早于此值的帧已经迟到 */
+  GstClockTime qos_frame_duration; /* 由 CAPS 中的帧率计算，同样由 GST_OBJECT_LOCK 保护 */
+  guint64 qos_processed;         /* 以下两项只在流线程访问 */
+  guint64 qos_dropped;
+
+  /* 在本地应答 POSITION/DURATION 查询，以下各项由 GST_OBJECT_LOCK 保护 */
+  GstSegment out_segment;        /* 已推送到下游的 segment */
+  GstClockTime position;         /* 最后推送的缓冲区的时间戳 */
+  GstClockTime duration;         /* 缓存的时长，NONE 表示需要重新获取 */
+  guint duration_cookie;         /* 缓存失效时递增，避免回填过期的查询结果 */
+
+  /* ROI 裁剪：属性由 GST_OBJECT_LOCK 保护，修改后置位 roi_dirty，由流线程重新协商 */
+  guint roi_x, roi_y, roi_width, roi_height;
+  gint roi_dirty;
+  /* 协商结果，只在流线程中修改（修改前先排空工作线程） */
+  gint crop_mode;
+  guint crop_x, crop_y, crop_width, crop_height;
+  GstVideoInfo out_info;         /* 复制模式下的输出格式 */
+  GstBufferPool *crop_pool;      /* 复制模式下的输出缓冲池 */
+
+  /* 运动门限：静止的帧在进入后续处理之前被丢弃或替换为 GAP 事件 */
+  gdouble motion_threshold;      /* 由 GST_OBJECT_LOCK 保护，0 表示关闭 */
+  gint motion_action;            /* GstMyFilterMotionAction，原子访问 */
+  guint8 *motion_ref;            /* 以下各项只在流线程访问：上一个保留帧的抽样行 */
+  gsize motion_ref_size;
+  gboolean motion_active;        /* 当前是否处于运动状态 */
 };
 
 G_END_DECLS
@@ -0,0 +1,75 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstmyfiltermeta.h"
+
+GType
+gst_my_filter_timing_meta_api_get_type(void)
+{
+    static GType type = 0;
+    static const gchar *tags[] = {NULL}; // 没有标签：与内容无关，任何变换都应保留
+
+    if (g_once_init_enter(&type))
+    {
+        GType _type = gst_meta_api_type_register("GstMyFilterTimingMetaAPI", tags);
+        g_once_init_leave(&type, _type);
+    }
+    return type;
+}
+
+static gboolean
+gst_my_filter_timing_meta_init(GstMeta *meta, gpointer params, GstBuffer *buffer)
+{
+    GstMyFilterTimingMeta *tmeta = (GstMyFilterTimingMeta *)meta;
+
+    tmeta->stamp = GST_CLOCK_TIME_NONE;
+    return TRUE;
+}
+
+/* 缓冲区被拷贝或转换时，把时间戳带到新缓冲区上 */
+static gboolean
+gst_my_filter_timing_meta_transform(GstBuffer *dest, GstMeta *meta,
+                                    GstBuffer *buffer, GQuark type, gpointer data)
+{
+    GstMyFilterTimingMeta *smeta = (GstMyFilterTimingMeta *)meta;
+
+    if (gst_buffer_get_my_filter_timing_meta(dest) != NULL)
+        return TRUE;
+
+    return gst_buffer_add_my_filter_timing_meta(dest, smeta->stamp) != NULL;
+}
+
+const GstMetaInfo *
+gst_my_filter_timing_meta_get_info(void)
+{
+    static const GstMetaInfo *meta_info = NULL;
+
+    if (g_once_init_enter((GstMetaInfo **)&meta_info))
+    {
+        const GstMetaInfo *mi = gst_meta_register(GST_MY_FILTER_TIMING_META_API_TYPE,
+                                                  "GstMyFilterTimingMeta",
+                                                  sizeof(GstMyFilterTimingMeta),
+                                                  gst_my_filter_timing_meta_init,
+                                                  (GstMetaFreeFunction)NULL,
+                                                  gst_my_filter_timing_meta_transform);
+        g_once_init_leave((GstMetaInfo **)&meta_info, (GstMetaInfo *)mi);
+    }
+    return meta_info;
+}
+
+/* 给缓冲区添加计时元数据，缓冲区必须可写 */
+GstMyFilterTimingMeta *
+gst_buffer_add_my_filter_timing_meta(GstBuffer *buffer, GstClockTime stamp)
+{
+    GstMyFilterTimingMeta *meta;
+
+    g_return_val_if_fail(GST_IS_BUFFER(buffer), NULL);
+
+    meta = (GstMyFilterTimingMeta *)gst_buffer_add_meta(buffer,
+                                                        GST_MY_FILTER_TIMING_META_INFO, NULL);
+    if (meta)
+        meta->stamp = stamp;
+
+    return meta;
+}
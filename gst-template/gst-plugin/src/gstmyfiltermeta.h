@@ -0,0 +1,36 @@
+#ifndef __GST_MYFILTER_META_H__
+#define __GST_MYFILTER_META_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* 计时元数据：由 timing-mode=stamp 的 my_filter 打戳，
+ * 下游 timing-mode=measure 的 my_filter 或应用程序的 pad 探针读取。
+ *
+ * 元数据 API 不带任何标签，因此 videoconvert 等 GstBaseTransform 元素会自动拷贝它。
+ * 应用程序不链接插件时可以用 g_type_from_name ("GstMyFilterTimingMetaAPI")
+ * 取得 API 类型，再用 gst_buffer_get_meta() 读取。
+ */
+#define GST_MY_FILTER_TIMING_META_API_TYPE (gst_my_filter_timing_meta_api_get_type())
+#define GST_MY_FILTER_TIMING_META_INFO (gst_my_filter_timing_meta_get_info())
+
+typedef struct _GstMyFilterTimingMeta
+{
+  GstMeta meta;
+
+  GstClockTime stamp; /* 打戳时的单调时钟时间 (gst_util_get_timestamp) */
+} GstMyFilterTimingMeta;
+
+GType gst_my_filter_timing_meta_api_get_type(void);
+const GstMetaInfo *gst_my_filter_timing_meta_get_info(void);
+
+#define gst_buffer_get_my_filter_timing_meta(b) \
+  ((GstMyFilterTimingMeta *)gst_buffer_get_meta((b), GST_MY_FILTER_TIMING_META_API_TYPE))
+
+GstMyFilterTimingMeta *gst_buffer_add_my_filter_timing_meta(GstBuffer *buffer,
+                                                            GstClockTime stamp);
+
+G_END_DECLS
+
+#endif /* __GST_MYFILTER_META_H__ */
@@ -0,0 +1,235 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstmyfilterstats.h"
+
+#define STATS_WINDOW GST_SECOND // 计算帧率和字节率的窗口长度
+
+/* 序列锁写端：进入写区间后序列号为奇数，离开后为偶数
+ * g_atomic_int_inc 是完整内存屏障，保证快照字段的写入不会越过序列号
+ */
+static inline void
+stats_write_begin(GstMyFilterStats *stats)
+{
+    g_atomic_int_inc(&stats->seq);
+}
+
+static inline void
+stats_write_end(GstMyFilterStats *stats)
+{
+    g_atomic_int_inc(&stats->seq);
+}
+
+/* 清空所有计数，只能在流线程不运行时调用（例如状态切换中） */
+void
+gst_my_filter_stats_reset(GstMyFilterStats *stats)
+{
+    stats->last_arrival = GST_CLOCK_TIME_NONE;
+    stats->interval_sum = 0;
+    stats->interval_count = 0;
+    stats->window_start = GST_CLOCK_TIME_NONE;
+    stats->window_buffers = 0;
+    stats->window_bytes = 0;
+
+    stats_write_begin(stats);
+    stats->snapshot.buffers = 0;
+    stats->snapshot.bytes = 0;
+    stats->snapshot.drops = 0;
+    stats->snapshot.min_interval = GST_CLOCK_TIME_NONE;
+    stats->snapshot.max_interval = GST_CLOCK_TIME_NONE;
+    stats->snapshot.avg_interval = GST_CLOCK_TIME_NONE;
+    stats->snapshot.fps = 0.0;
+    stats->snapshot.byte_rate = 0.0;
+    stats_write_end(stats);
+}
+
+/* 记录一个到达的缓冲区，now 为单调时钟时间
+ * 返回 TRUE 表示刚结束一个统计窗口，fps 和字节率已更新
+ */
+gboolean
+gst_my_filter_stats_record_buffer(GstMyFilterStats *stats, gsize size,
+                                  GstClockTime now)
+{
+    GstMyFilterStatsSnapshot *snap = &stats->snapshot;
+    GstClockTime interval = GST_CLOCK_TIME_NONE;
+    gboolean window_done = FALSE;
+    gdouble fps = 0.0, byte_rate = 0.0;
+
+    if (GST_CLOCK_TIME_IS_VALID(stats->last_arrival) && now >= stats->last_arrival)
+    {
+        interval = now - stats->last_arrival;
+        stats->interval_sum += interval;
+        stats->interval_count++;
+    }
+    stats->last_arrival = now;
+
+    if (!GST_CLOCK_TIME_IS_VALID(stats->window_start))
+        stats->window_start = now;
+    stats->window_buffers++;
+    stats->window_bytes += size;
+
+    if (now - stats->window_start >= STATS_WINDOW)
+    {
+        gdouble elapsed = (gdouble)(now - stats->window_start) / GST_SECOND;
+
+        fps = stats->window_buffers / elapsed;
+        byte_rate = stats->window_bytes / elapsed;
+        stats->window_start = now;
+        stats->window_buffers = 0;
+        stats->window_bytes = 0;
+        window_done = TRUE;
+    }
+
+    stats_write_begin(stats);
+    snap->buffers++;
+    snap->bytes += size;
+    if (GST_CLOCK_TIME_IS_VALID(interval))
+    {
+        if (!GST_CLOCK_TIME_IS_VALID(snap->min_interval) || interval < snap->min_interval)
+            snap->min_interval = interval;
+        if (!GST_CLOCK_TIME_IS_VALID(snap->max_interval) || interval > snap->max_interval)
+            snap->max_interval = interval;
+        snap->avg_interval = stats->interval_sum / stats->interval_count;
+    }
+    if (window_done)
+    {
+        snap->fps = fps;
+        snap->byte_rate = byte_rate;
+    }
+    stats_write_end(stats);
+
+    return window_done;
+}
+
+/* 记录丢弃的缓冲区，与 record_buffer 一样只能由流线程调用 */
+void
+gst_my_filter_stats_record_drops(GstMyFilterStats *stats, guint count)
+{
+    if (count == 0)
+        return;
+
+    stats_write_begin(stats);
+    stats->snapshot.drops += count;
+    stats_write_end(stats);
+}
+
+/* 读取一致的快照，可以在任意线程调用，不会阻塞写者 */
+void
+gst_my_filter_stats_read(const GstMyFilterStats *stats,
+                         GstMyFilterStatsSnapshot *snapshot)
+{
+    for (;;)
+    {
+        gint seq = g_atomic_int_get(&stats->seq);
+
+        if (seq & 1)
+        {
+            // 写者正在更新，稍后重试
+            g_thread_yield();
+            continue;
+        }
+
+        *snapshot = stats->snapshot;
+
+        if (g_atomic_int_get(&stats->seq) == seq)
+            break;
+    }
+}
+
+/* 将快照转换为 GstStructure，用于总线消息 */
+GstStructure *
+gst_my_filter_stats_to_structure(const GstMyFilterStatsSnapshot *snapshot,
+                                 const gchar *name)
+{
+    return gst_structure_new(name,
+                             "buffers", G_TYPE_UINT64, snapshot->buffers,
+                             "bytes", G_TYPE_UINT64, snapshot->bytes,
+                             "drops", G_TYPE_UINT64, snapshot->drops,
+                             "min-interval", G_TYPE_UINT64, snapshot->min_interval,
+                             "max-interval", G_TYPE_UINT64, snapshot->max_interval,
+                             "avg-interval", G_TYPE_UINT64, snapshot->avg_interval,
+                             "fps", G_TYPE_DOUBLE, snapshot->fps,
+                             "byte-rate", G_TYPE_DOUBLE, snapshot->byte_rate,
+                             NULL);
+}
+
+/* 直方图桶索引：低于 2^(SUB_BITS+1) 的值一一对应，
+ * 更大的值按最高位所在的 2 的幂区间分组，区间内保留 SUB_BITS 位精度
+ */
+static inline guint
+histogram_bucket_index(guint64 value)
+{
+    gint msb = g_bit_nth_msf(value, -1);
+    guint shift = msb > GST_MY_FILTER_HISTOGRAM_SUB_BITS ? msb - GST_MY_FILTER_HISTOGRAM_SUB_BITS : 0;
+
+    return (shift << GST_MY_FILTER_HISTOGRAM_SUB_BITS) + (guint)(value >> shift);
+}
+
+/* 桶索引对应的数值区间上界（用于报告百分位） */
+static guint64
+histogram_bucket_upper(guint index)
+{
+    guint sub = 1 << GST_MY_FILTER_HISTOGRAM_SUB_BITS;
+    guint shift;
+
+    if (index < 2 * sub)
+        return index;
+
+    shift = (index >> GST_MY_FILTER_HISTOGRAM_SUB_BITS) - 1;
+    return (((guint64)(index - (shift << GST_MY_FILTER_HISTOGRAM_SUB_BITS)) + 1) << shift) - 1;
+}
+
+void
+gst_my_filter_histogram_reset(GstMyFilterHistogram *histogram)
+{
+    guint i;
+
+    for (i = 0; i < GST_MY_FILTER_HISTOGRAM_BUCKETS; i++)
+        g_atomic_int_set(&histogram->buckets[i], 0);
+}
+
+void
+gst_my_filter_histogram_record(GstMyFilterHistogram *histogram,
+                               GstClockTime value)
+{
+    g_atomic_int_inc(&histogram->buckets[histogram_bucket_index(value)]);
+}
+
+guint64
+gst_my_filter_histogram_count(const GstMyFilterHistogram *histogram)
+{
+    guint64 count = 0;
+    guint i;
+
+    for (i = 0; i < GST_MY_FILTER_HISTOGRAM_BUCKETS; i++)
+        count += (guint)g_atomic_int_get(&histogram->buckets[i]);
+
+    return count;
+}
+
+/* 返回百分位（0.0 - 1.0）所在桶的上界，没有样本时返回 GST_CLOCK_TIME_NONE
+ * 读取期间写者可能继续记录，结果是近似值，对百分位统计足够
+ */
+GstClockTime
+gst_my_filter_histogram_percentile(const GstMyFilterHistogram *histogram,
+                                   gdouble percentile)
+{
+    guint64 count, target, seen = 0;
+    guint i;
+
+    count = gst_my_filter_histogram_count(histogram);
+    if (count == 0)
+        return GST_CLOCK_TIME_NONE;
+
+    target = (guint64)(percentile * count + 0.5);
+    target = CLAMP(target, 1, count);
+
+    for (i = 0; i < GST_MY_FILTER_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += (guint)g_atomic_int_get(&histogram->buckets[i]);
+        if (seen >= target)
+            return histogram_bucket_upper(i);
+    }
+    return histogram_bucket_upper(GST_MY_FILTER_HISTOGRAM_BUCKETS - 1);
+}
@@ -0,0 +1,80 @@
+#ifndef __GST_MYFILTER_STATS_H__
+#define __GST_MYFILTER_STATS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* 对外发布的统计快照 */
+typedef struct _GstMyFilterStatsSnapshot
+{
+  guint64 buffers;           /* 收到的缓冲区数 */
+  guint64 bytes;             /* 收到的字节数 */
+  guint64 drops;             /* 丢弃的缓冲区数 */
+  GstClockTime min_interval; /* 最小到达间隔 */
+  GstClockTime max_interval; /* 最大到达间隔 */
+  GstClockTime avg_interval; /* 平均到达间隔 */
+  gdouble fps;               /* 最近一个统计窗口的帧率 */
+  gdouble byte_rate;         /* 最近一个统计窗口的字节率 (bytes/s) */
+} GstMyFilterStatsSnapshot;
+
+/* 元素内部的统计状态
+ *
+ * 只有流线程写入（单写者），快照通过序列锁发布：
+ * 写者从不等待，读者在读取期间如果快照被改写则重试，双方都不加锁。
+ */
+typedef struct _GstMyFilterStats
+{
+  /* 以下字段只在流线程中访问 */
+  GstClockTime last_arrival;
+  GstClockTime interval_sum;
+  guint64 interval_count;
+  GstClockTime window_start;
+  guint64 window_buffers;
+  guint64 window_bytes;
+
+  /* 序列号为奇数表示快照正在更新 */
+  gint seq;
+  GstMyFilterStatsSnapshot snapshot;
+} GstMyFilterStats;
+
+void gst_my_filter_stats_reset(GstMyFilterStats *stats);
+
+gboolean gst_my_filter_stats_record_buffer(GstMyFilterStats *stats,
+                                           gsize size, GstClockTime now);
+
+void gst_my_filter_stats_record_drops(GstMyFilterStats *stats, guint count);
+
+void gst_my_filter_stats_read(const GstMyFilterStats *stats,
+                              GstMyFilterStatsSnapshot *snapshot);
+
+GstStructure *gst_my_filter_stats_to_structure(const GstMyFilterStatsSnapshot *snapshot,
+                                               const gchar *name);
+
+/* 对数分桶的延迟直方图（HDR 风格）
+ *
+ * 每个 2 的幂区间再线性划分为 2^GST_MY_FILTER_HISTOGRAM_SUB_BITS 个子桶，
+ * 相对误差约为 1/16，覆盖完整的 64 位纳秒范围。
+ * 每个桶单独原子递增，记录和读取都不需要加锁。
+ */
+#define GST_MY_FILTER_HISTOGRAM_SUB_BITS 4
+#define GST_MY_FILTER_HISTOGRAM_BUCKETS (64 << GST_MY_FILTER_HISTOGRAM_SUB_BITS)
+
+typedef struct _GstMyFilterHistogram
+{
+  gint buckets[GST_MY_FILTER_HISTOGRAM_BUCKETS];
+} GstMyFilterHistogram;
+
+void gst_my_filter_histogram_reset(GstMyFilterHistogram *histogram);
+
+void gst_my_filter_histogram_record(GstMyFilterHistogram *histogram,
+                                    GstClockTime value);
+
+guint64 gst_my_filter_histogram_count(const GstMyFilterHistogram *histogram);
+
+GstClockTime gst_my_filter_histogram_percentile(const GstMyFilterHistogram *histogram,
+                                                gdouble percentile);
+
+G_END_DECLS
+
+#endif /* __GST_MYFILTER_STATS_H__ */
@@ -46,12 +46,21 @@
 /**
  * SECTION:element-plugin
  *
- * FIXME:Describe plugin here.
+ * Fans one stream out to any number of src_%u request pads. Every branch
+ * gets a reference to the same buffer, never a copy, and has its own
+ * bounded queue and streaming thread, so a slow branch cannot stall the
+ * others: with the default leaky=downstream it just loses its oldest
+ * queued buffers.
+ *
+ * ALLOCATION queries are answered with what all linked branches can
+ * handle (common metas, the largest size and alignment) so upstream never
+ * produces a buffer one of the branches would have to copy.
  *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
- * gst-launch -v -m fakesrc ! plugin ! fakesink silent=TRUE
+ * gst-launch -v -m videotestsrc ! plugin_template name=t silent=TRUE \
+ *     t. ! autovideosink  t. ! fakesink
  * ]|
  * </refsect2>
  */
@@ -60,9 +69,11 @@
 #  include <config.h>
 #endif
 
+#include <stdio.h>
 #include <gst/gst.h>
 
 #include "gstplugin.h"
+#include "gstringqueue.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_plugin_template_debug);
 #define GST_CAT_DEFAULT gst_plugin_template_debug
@@ -77,9 +88,33 @@ enum
 enum
 {
   PROP_0,
-  PROP_SILENT
+  PROP_SILENT,
+  PROP_MAX_SIZE_BUFFERS,
+  PROP_LEAKY,
+  PROP_DROPPED
 };
 
+#define DEFAULT_MAX_SIZE_BUFFERS 16
+#define DEFAULT_LEAKY GST_PLUGIN_TEMPLATE_LEAKY_DOWNSTREAM
+
+/* per src pad state, stored as the pad's element private data */
+typedef struct
+{
+  GstPluginTemplate *filter;
+  GstPad *pad;
+
+  GQueue queue;                 /* GstBuffer and serialized GstEvent, oldest first */
+  guint n_buffers;
+  gboolean flushing;            /* pad inactive or upstream flushing */
+  gboolean busy;                /* task is pushing an item it dequeued */
+  GstFlowReturn flow;           /* result of the last push on this branch */
+  guint64 seq;                  /* last chain call that handled this branch */
+} GstPluginTemplateBranch;
+
+/* a branch whose task still runs; not-linked and flushing downstream
+ * branches keep consuming their queue so they recover when relinked */
+#define BRANCH_IS_RUNNING(b) (!(b)->flushing && (b)->flow > GST_FLOW_EOS)
+
 /* the capabilities of the inputs and outputs.
  *
  * describe the real formats here.
@@ -90,9 +125,9 @@ static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_STATIC_CAPS ("ANY")
     );
 
-static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
+static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src_%u",
     GST_PAD_SRC,
-    GST_PAD_ALWAYS,
+    GST_PAD_REQUEST,
     GST_STATIC_CAPS ("ANY")
     );
 
@@ -102,15 +137,44 @@ G_DEFINE_TYPE (GstPluginTemplate, gst_plugin_template, GST_TYPE_ELEMENT);
 GST_ELEMENT_REGISTER_DEFINE (plugin_template, "plugin_template", GST_RANK_NONE,
     GST_TYPE_PLUGIN_TEMPLATE);
 
+#define GST_TYPE_PLUGIN_TEMPLATE_LEAKY (gst_plugin_template_leaky_get_type ())
+static GType
+gst_plugin_template_leaky_get_type (void)
+{
+  static GType leaky_type = 0;
+  static const GEnumValue leaky[] = {
+    {GST_PLUGIN_TEMPLATE_LEAKY_NO, "Not Leaky", "no"},
+    {GST_PLUGIN_TEMPLATE_LEAKY_UPSTREAM, "Leaky on upstream (new buffers)",
+        "upstream"},
+    {GST_PLUGIN_TEMPLATE_LEAKY_DOWNSTREAM,
+        "Leaky on downstream (old buffers)", "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (!leaky_type)
+    leaky_type = g_enum_register_static ("GstPluginTemplateLeaky", leaky);
+  return leaky_type;
+}
+
+static void gst_plugin_template_finalize (GObject * object);
 static void gst_plugin_template_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
 static void gst_plugin_template_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
 
+static GstPad *gst_plugin_template_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_plugin_template_release_pad (GstElement * element,
+    GstPad * pad);
+
 static gboolean gst_plugin_template_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
+static gboolean gst_plugin_template_sink_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
 static GstFlowReturn gst_plugin_template_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
+static gboolean gst_plugin_template_src_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
 
 /* GObject vmethod implementations */
 
@@ -124,6 +188,7 @@ gst_plugin_template_class_init (GstPluginTemplateClass * klass)
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
 
+  gobject_class->finalize = gst_plugin_template_finalize;
   gobject_class->set_property = gst_plugin_template_set_property;
   gobject_class->get_property = gst_plugin_template_get_property;
 
@@ -131,15 +196,40 @@ gst_plugin_template_class_init (GstPluginTemplateClass * klass)
       g_param_spec_boolean ("silent", "Silent", "Produce verbose output ?",
           FALSE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BUFFERS,
+      g_param_spec_uint ("max-size-buffers", "Max. size (buffers)",
+          "Max. number of buffers queued per branch (0=unlimited)",
+          0, G_MAXUINT, DEFAULT_MAX_SIZE_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where a full branch queue drops buffers instead of blocking "
+          "upstream", GST_TYPE_PLUGIN_TEMPLATE_LEAKY, DEFAULT_LEAKY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped",
+          "Number of buffers dropped by leaky branch queues",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_details_simple (gstelement_class,
       "Plugin",
-      "FIXME:Generic",
-      "FIXME:Generic Template Element", "AUTHOR_NAME AUTHOR_EMAIL");
+      "Generic",
+      "Fans a stream out to request pads with per-branch queues",
+      "AUTHOR_NAME AUTHOR_EMAIL");
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&src_factory));
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&sink_factory));
+
+  gstelement_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_plugin_template_request_new_pad);
+  gstelement_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_plugin_template_release_pad);
 }
 
 /* initialize the new element
@@ -153,16 +243,36 @@ gst_plugin_template_init (GstPluginTemplate * filter)
   filter->sinkpad = gst_pad_new_from_static_template (&sink_factory, "sink");
   gst_pad_set_event_function (filter->sinkpad,
       GST_DEBUG_FUNCPTR (gst_plugin_template_sink_event));
+  gst_pad_set_query_function (filter->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_plugin_template_sink_query));
   gst_pad_set_chain_function (filter->sinkpad,
       GST_DEBUG_FUNCPTR (gst_plugin_template_chain));
   GST_PAD_SET_PROXY_CAPS (filter->sinkpad);
   gst_element_add_pad (GST_ELEMENT (filter), filter->sinkpad);
 
-  filter->srcpad = gst_pad_new_from_static_template (&src_factory, "src");
-  GST_PAD_SET_PROXY_CAPS (filter->srcpad);
-  gst_element_add_pad (GST_ELEMENT (filter), filter->srcpad);
+  g_mutex_init (&filter->lock);
+  g_cond_init (&filter->cond);
+  filter->branches = NULL;
+  filter->branches_cookie = 0;
+  filter->chain_seq = 0;
+  filter->next_pad_index = 0;
 
   filter->silent = FALSE;
+  filter->max_size_buffers = DEFAULT_MAX_SIZE_BUFFERS;
+  filter->leaky = DEFAULT_LEAKY;
+  filter->dropped = 0;
+}
+
+static void
+gst_plugin_template_finalize (GObject * object)
+{
+  GstPluginTemplate *filter = GST_PLUGIN_TEMPLATE (object);
+
+  /* request pads, and with them all branches, were released in dispose */
+  g_mutex_clear (&filter->lock);
+  g_cond_clear (&filter->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static void
@@ -175,6 +285,19 @@ gst_plugin_template_set_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       filter->silent = g_value_get_boolean (value);
       break;
+    case PROP_MAX_SIZE_BUFFERS:
+      g_mutex_lock (&filter->lock);
+      filter->max_size_buffers = g_value_get_uint (value);
+      /* a larger limit may unblock the streaming thread */
+      g_cond_broadcast (&filter->cond);
+      g_mutex_unlock (&filter->lock);
+      break;
+    case PROP_LEAKY:
+      g_mutex_lock (&filter->lock);
+      filter->leaky = g_value_get_enum (value);
+      g_cond_broadcast (&filter->cond);
+      g_mutex_unlock (&filter->lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -191,14 +314,276 @@ gst_plugin_template_get_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       g_value_set_boolean (value, filter->silent);
       break;
+    case PROP_MAX_SIZE_BUFFERS:
+      g_mutex_lock (&filter->lock);
+      g_value_set_uint (value, filter->max_size_buffers);
+      g_mutex_unlock (&filter->lock);
+      break;
+    case PROP_LEAKY:
+      g_mutex_lock (&filter->lock);
+      g_value_set_enum (value, filter->leaky);
+      g_mutex_unlock (&filter->lock);
+      break;
+    case PROP_DROPPED:
+      g_mutex_lock (&filter->lock);
+      g_value_set_uint64 (value, filter->dropped);
+      g_mutex_unlock (&filter->lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* branch helpers */
+
+/* drop everything queued on a branch, called with the lock held */
+static void
+gst_plugin_template_branch_clear (GstPluginTemplateBranch * branch)
+{
+  GstMiniObject *obj;
+
+  while ((obj = g_queue_pop_head (&branch->queue)))
+    gst_mini_object_unref (obj);
+  branch->n_buffers = 0;
+}
+
+/* leaky=downstream: drop the oldest queued buffer, keeping events */
+static gboolean
+gst_plugin_template_branch_drop_oldest (GstPluginTemplateBranch * branch)
+{
+  GList *l;
+
+  for (l = branch->queue.head; l; l = l->next) {
+    if (GST_IS_BUFFER (l->data)) {
+      gst_buffer_unref (GST_BUFFER_CAST (l->data));
+      g_queue_delete_link (&branch->queue, l);
+      branch->n_buffers--;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* wait until every running branch pushed all it has queued, so that a
+ * serialized query is answered after the data before it */
+static void
+gst_plugin_template_drain (GstPluginTemplate * filter)
+{
+  GList *l;
+
+  g_mutex_lock (&filter->lock);
+again:
+  for (l = filter->branches; l; l = l->next) {
+    GstPluginTemplateBranch *branch = l->data;
+
+    if (BRANCH_IS_RUNNING (branch) &&
+        (branch->busy || !g_queue_is_empty (&branch->queue))) {
+      g_cond_wait (&filter->cond, &filter->lock);
+      goto again;
+    }
+  }
+  g_mutex_unlock (&filter->lock);
+}
+
+/* src pad task: push one queued item of a branch */
+static void
+gst_plugin_template_src_loop (gpointer user_data)
+{
+  GstPluginTemplateBranch *branch = user_data;
+  GstPluginTemplate *filter = branch->filter;
+  GstMiniObject *obj;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  g_mutex_lock (&filter->lock);
+  while (!branch->flushing && g_queue_is_empty (&branch->queue))
+    g_cond_wait (&filter->cond, &filter->lock);
+
+  if (branch->flushing) {
+    g_mutex_unlock (&filter->lock);
+    GST_LOG_OBJECT (branch->pad, "flushing, pausing task");
+    gst_pad_pause_task (branch->pad);
+    return;
+  }
+
+  obj = g_queue_pop_head (&branch->queue);
+  if (GST_IS_BUFFER (obj))
+    branch->n_buffers--;
+  branch->busy = TRUE;
+  g_cond_broadcast (&filter->cond);
+  g_mutex_unlock (&filter->lock);
+
+  if (GST_IS_BUFFER (obj)) {
+    ret = gst_pad_push (branch->pad, GST_BUFFER_CAST (obj));
+  } else {
+    GstEvent *event = GST_EVENT_CAST (obj);
+    gboolean eos = GST_EVENT_TYPE (event) == GST_EVENT_EOS;
+
+    gst_pad_push_event (branch->pad, event);
+    if (eos)
+      ret = GST_FLOW_EOS;
+  }
+
+  g_mutex_lock (&filter->lock);
+  branch->busy = FALSE;
+  if (!branch->flushing)
+    branch->flow = ret;
+  g_cond_broadcast (&filter->cond);
+  g_mutex_unlock (&filter->lock);
+
+  if (ret > GST_FLOW_EOS)
+    return;
+
+  GST_DEBUG_OBJECT (branch->pad, "pausing task, reason %s",
+      gst_flow_get_name (ret));
+  if (ret < GST_FLOW_EOS) {
+    GST_ELEMENT_FLOW_ERROR (filter, ret);
+    gst_pad_push_event (branch->pad, gst_event_new_eos ());
+  }
+  gst_pad_pause_task (branch->pad);
+}
+
+static gboolean
+gst_plugin_template_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  /* the pad may not have a parent yet when activated from request_new_pad */
+  GstPluginTemplateBranch *branch = gst_pad_get_element_private (pad);
+  GstPluginTemplate *filter = branch->filter;
+  gboolean res;
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  g_mutex_lock (&filter->lock);
+  branch->flushing = !active;
+  branch->flow = GST_FLOW_OK;
+  g_cond_broadcast (&filter->cond);
+  g_mutex_unlock (&filter->lock);
+
+  if (active)
+    return gst_pad_start_task (pad, gst_plugin_template_src_loop, branch,
+        NULL);
+
+  res = gst_pad_stop_task (pad);
+
+  g_mutex_lock (&filter->lock);
+  gst_plugin_template_branch_clear (branch);
+  g_mutex_unlock (&filter->lock);
+
+  return res;
+}
+
+static gboolean
+gst_plugin_template_copy_sticky (GstPad * pad, GstEvent ** event,
+    gpointer user_data)
+{
+  GstPad *srcpad = GST_PAD_CAST (user_data);
+  GstFlowReturn ret;
+
+  ret = gst_pad_store_sticky_event (srcpad, *event);
+  if (ret != GST_FLOW_OK)
+    GST_DEBUG_OBJECT (srcpad, "storing sticky event %s failed: %s",
+        GST_EVENT_TYPE_NAME (*event), gst_flow_get_name (ret));
+
+  return TRUE;
+}
+
+static gboolean
+gst_plugin_template_pause_task (GstElement * element, GstPad * pad,
+    gpointer user_data)
+{
+  gst_pad_pause_task (pad);
+  return TRUE;
+}
+
 /* GstElement vmethod implementations */
 
+static GstPad *
+gst_plugin_template_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstPluginTemplate *filter = GST_PLUGIN_TEMPLATE (element);
+  GstPluginTemplateBranch *branch;
+  GstPad *srcpad;
+  gchar *pad_name;
+  guint index;
+
+  GST_OBJECT_LOCK (filter);
+  if (name && sscanf (name, "src_%u", &index) == 1) {
+    if (index >= filter->next_pad_index)
+      filter->next_pad_index = index + 1;
+  } else {
+    index = filter->next_pad_index++;
+  }
+  GST_OBJECT_UNLOCK (filter);
+
+  pad_name = g_strdup_printf ("src_%u", index);
+  srcpad = gst_pad_new_from_template (templ, pad_name);
+  g_free (pad_name);
+
+  branch = g_new0 (GstPluginTemplateBranch, 1);
+  branch->filter = filter;
+  branch->pad = srcpad;
+  g_queue_init (&branch->queue);
+  branch->flushing = TRUE;
+  branch->flow = GST_FLOW_OK;
+
+  gst_pad_set_element_private (srcpad, branch);
+  gst_pad_set_activatemode_function (srcpad,
+      GST_DEBUG_FUNCPTR (gst_plugin_template_src_activate_mode));
+  GST_PAD_SET_PROXY_CAPS (srcpad);
+
+  /* a branch added while streaming starts from the current sticky events */
+  if (GST_PAD_IS_ACTIVE (filter->sinkpad)) {
+    gst_pad_set_active (srcpad, TRUE);
+    gst_pad_sticky_events_foreach (filter->sinkpad,
+        gst_plugin_template_copy_sticky, srcpad);
+  }
+
+  g_mutex_lock (&filter->lock);
+  filter->branches = g_list_append (filter->branches, branch);
+  filter->branches_cookie++;
+  g_mutex_unlock (&filter->lock);
+
+  if (!gst_element_add_pad (element, srcpad)) {
+    GST_WARNING_OBJECT (filter, "could not add pad %s",
+        GST_PAD_NAME (srcpad));
+    g_mutex_lock (&filter->lock);
+    filter->branches = g_list_remove (filter->branches, branch);
+    filter->branches_cookie++;
+    g_mutex_unlock (&filter->lock);
+    gst_pad_set_active (srcpad, FALSE);
+    gst_object_unref (srcpad);
+    g_free (branch);
+    return NULL;
+  }
+
+  return srcpad;
+}
+
+static void
+gst_plugin_template_release_pad (GstElement * element, GstPad * pad)
+{
+  GstPluginTemplate *filter = GST_PLUGIN_TEMPLATE (element);
+  GstPluginTemplateBranch *branch = gst_pad_get_element_private (pad);
+
+  /* the streaming thread may be waiting on this branch; the cookie makes it
+   * restart its walk over the branches instead of touching this one */
+  g_mutex_lock (&filter->lock);
+  filter->branches = g_list_remove (filter->branches, branch);
+  filter->branches_cookie++;
+  branch->flushing = TRUE;
+  g_cond_broadcast (&filter->cond);
+  g_mutex_unlock (&filter->lock);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+
+  gst_plugin_template_branch_clear (branch);
+  g_free (branch);
+}
+
 /* this function handles sink events */
 static gboolean
 gst_plugin_template_sink_event (GstPad * pad, GstObject * parent,
@@ -206,6 +591,7 @@ gst_plugin_template_sink_event (GstPad * pad, GstObject * parent,
 {
   GstPluginTemplate *filter;
   gboolean ret;
+  GList *l;
 
   filter = GST_PLUGIN_TEMPLATE (parent);
 
@@ -213,41 +599,335 @@ gst_plugin_template_sink_event (GstPad * pad, GstObject * parent,
       GST_EVENT_TYPE_NAME (event), event);
 
   switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_CAPS:
-    {
-      GstCaps *caps;
-
-      gst_event_parse_caps (event, &caps);
-      /* do something with the caps */
-
-      /* and forward */
+    case GST_EVENT_FLUSH_START:
+      /* unblock downstream first, then the branch tasks and the chain */
+      ret = gst_pad_event_default (pad, parent, event);
+      g_mutex_lock (&filter->lock);
+      for (l = filter->branches; l; l = l->next)
+        ((GstPluginTemplateBranch *) l->data)->flushing = TRUE;
+      g_cond_broadcast (&filter->cond);
+      g_mutex_unlock (&filter->lock);
+      gst_element_foreach_src_pad (GST_ELEMENT (filter),
+          gst_plugin_template_pause_task, NULL);
+      return ret;
+    case GST_EVENT_FLUSH_STOP:
+      g_mutex_lock (&filter->lock);
+      for (l = filter->branches; l; l = l->next) {
+        GstPluginTemplateBranch *branch = l->data;
+
+        gst_plugin_template_branch_clear (branch);
+        branch->flushing = !GST_PAD_IS_ACTIVE (branch->pad);
+        branch->flow = GST_FLOW_OK;
+      }
+      g_mutex_unlock (&filter->lock);
       ret = gst_pad_event_default (pad, parent, event);
+      g_mutex_lock (&filter->lock);
+      for (l = filter->branches; l; l = l->next) {
+        GstPluginTemplateBranch *branch = l->data;
+
+        if (!branch->flushing)
+          gst_pad_start_task (branch->pad, gst_plugin_template_src_loop,
+              branch, NULL);
+      }
+      g_mutex_unlock (&filter->lock);
+      return ret;
+    default:
       break;
+  }
+
+  if (!GST_EVENT_IS_SERIALIZED (event))
+    return gst_pad_event_default (pad, parent, event);
+
+  /* serialized events (caps, segment, eos...) queue behind the buffers
+   * already queued on each branch */
+  g_mutex_lock (&filter->lock);
+  for (l = filter->branches; l; l = l->next) {
+    GstPluginTemplateBranch *branch = l->data;
+
+    if (BRANCH_IS_RUNNING (branch))
+      g_queue_push_tail (&branch->queue, gst_event_ref (event));
+  }
+  g_cond_broadcast (&filter->cond);
+  g_mutex_unlock (&filter->lock);
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+/* add all pools, params and metas of one allocation answer to another */
+static void
+gst_plugin_template_copy_allocation (GstQuery * dest, GstQuery * src)
+{
+  GstBufferPool *pool;
+  GstAllocator *allocator;
+  GstAllocationParams params;
+  const GstStructure *meta_params;
+  GType api;
+  guint i, size, min, max;
+
+  for (i = 0; i < gst_query_get_n_allocation_pools (src); i++) {
+    gst_query_parse_nth_allocation_pool (src, i, &pool, &size, &min, &max);
+    gst_query_add_allocation_pool (dest, pool, size, min, max);
+    if (pool)
+      gst_object_unref (pool);
+  }
+
+  for (i = 0; i < gst_query_get_n_allocation_params (src); i++) {
+    gst_query_parse_nth_allocation_param (src, i, &allocator, &params);
+    gst_query_add_allocation_param (dest, allocator, &params);
+    if (allocator)
+      gst_object_unref (allocator);
+  }
+
+  for (i = 0; i < gst_query_get_n_allocation_metas (src); i++) {
+    api = gst_query_parse_nth_allocation_meta (src, i, &meta_params);
+    gst_query_add_allocation_meta (dest, api, meta_params);
+  }
+}
+
+/* restrict an aggregated allocation answer to what another branch handles */
+static void
+gst_plugin_template_merge_allocation (GstQuery * dest, GstQuery * src)
+{
+  GstBufferPool *pool;
+  GstAllocator *dest_alloc, *src_alloc;
+  GstAllocationParams dest_params, src_params;
+  guint i, size, min, max, src_size, src_min, src_max;
+
+  /* metas: only those every branch understands */
+  for (i = gst_query_get_n_allocation_metas (dest); i > 0; i--) {
+    GType api = gst_query_parse_nth_allocation_meta (dest, i - 1, NULL);
+
+    if (!gst_query_find_allocation_meta (src, api, NULL))
+      gst_query_remove_nth_allocation_meta (dest, i - 1);
+  }
+
+  /* pools: one downstream pool cannot serve another branch, keep the
+   * requirements only and let upstream allocate. This applies as soon as
+   * a second branch answers, also when it answers without a pool */
+  for (i = 0; i < gst_query_get_n_allocation_pools (dest); i++) {
+    gst_query_parse_nth_allocation_pool (dest, i, &pool, &size, &min, &max);
+    if (pool) {
+      gst_query_set_nth_allocation_pool (dest, i, NULL, size, min, max);
+      gst_object_unref (pool);
     }
+  }
+
+  if (gst_query_get_n_allocation_pools (src) > 0) {
+    gst_query_parse_nth_allocation_pool (src, 0, &pool, &src_size, &src_min,
+        &src_max);
+    if (pool)
+      gst_object_unref (pool);
+
+    if (gst_query_get_n_allocation_pools (dest) > 0) {
+      gst_query_parse_nth_allocation_pool (dest, 0, NULL, &size, &min, &max);
+      size = MAX (size, src_size);
+      min = MAX (min, src_min);
+      max = (max == 0 || src_max == 0) ? 0 : MAX (max, src_max);
+      gst_query_set_nth_allocation_pool (dest, 0, NULL, size, min, max);
+    } else {
+      gst_query_add_allocation_pool (dest, NULL, src_size, src_min, src_max);
+    }
+  }
+
+  /* params: the strictest alignment and the largest prefix and padding */
+  if (gst_query_get_n_allocation_params (src) > 0) {
+    gst_query_parse_nth_allocation_param (src, 0, &src_alloc, &src_params);
+
+    if (gst_query_get_n_allocation_params (dest) > 0) {
+      gst_query_parse_nth_allocation_param (dest, 0, &dest_alloc,
+          &dest_params);
+      dest_params.align = MAX (dest_params.align, src_params.align);
+      dest_params.prefix = MAX (dest_params.prefix, src_params.prefix);
+      dest_params.padding = MAX (dest_params.padding, src_params.padding);
+      dest_params.flags |= src_params.flags;
+      gst_query_set_nth_allocation_param (dest, 0,
+          dest_alloc == src_alloc ? dest_alloc : NULL, &dest_params);
+      if (dest_alloc)
+        gst_object_unref (dest_alloc);
+    } else {
+      gst_query_add_allocation_param (dest, NULL, &src_params);
+    }
+
+    if (src_alloc)
+      gst_object_unref (src_alloc);
+  }
+}
+
+/* ask every linked branch and answer with what all of them can handle,
+ * so that sharing a buffer never forces a branch into a copy */
+static gboolean
+gst_plugin_template_sink_query_allocation (GstPluginTemplate * filter,
+    GstQuery * query)
+{
+  GstCaps *caps;
+  GstBufferPool *pool;
+  gboolean need_pool;
+  GList *pads, *l;
+  guint n_answers = 0, max_size_buffers, size, min, max;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+
+  GST_OBJECT_LOCK (filter);
+  pads = g_list_copy_deep (GST_ELEMENT (filter)->srcpads,
+      (GCopyFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (filter);
+
+  for (l = pads; l; l = l->next) {
+    GstQuery *branch_query = gst_query_new_allocation (caps, need_pool);
+
+    /* unlinked branches do not constrain the allocation */
+    if (gst_pad_peer_query (GST_PAD_CAST (l->data), branch_query)) {
+      if (n_answers == 0)
+        gst_plugin_template_copy_allocation (query, branch_query);
+      else
+        gst_plugin_template_merge_allocation (query, branch_query);
+      n_answers++;
+    }
+    gst_query_unref (branch_query);
+  }
+  g_list_free_full (pads, gst_object_unref);
+
+  if (n_answers == 0)
+    return FALSE;
+
+  /* the branch queues keep up to max-size-buffers buffers alive on top
+   * of what downstream holds; the buffers are shared, not per branch */
+  if (gst_query_get_n_allocation_pools (query) > 0) {
+    g_mutex_lock (&filter->lock);
+    max_size_buffers = filter->max_size_buffers;
+    g_mutex_unlock (&filter->lock);
+
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+    if (max_size_buffers == 0) {
+      max = 0;
+    } else {
+      min += max_size_buffers;
+      if (max != 0)
+        max = MAX (max + max_size_buffers, min);
+    }
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+    if (pool)
+      gst_object_unref (pool);
+  }
+
+  GST_DEBUG_OBJECT (filter, "aggregated allocation of %u branches: %"
+      GST_PTR_FORMAT, n_answers, query);
+
+  return TRUE;
+}
+
+/* this function handles sink queries */
+static gboolean
+gst_plugin_template_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstPluginTemplate *filter = GST_PLUGIN_TEMPLATE (parent);
+
+  if (GST_QUERY_IS_SERIALIZED (query))
+    gst_plugin_template_drain (filter);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_ALLOCATION:
+      return gst_plugin_template_sink_query_allocation (filter, query);
     default:
-      ret = gst_pad_event_default (pad, parent, event);
-      break;
+      return gst_pad_query_default (pad, parent, query);
   }
-  return ret;
 }
 
 /* chain function
- * this function does the actual processing
+ * this function does the actual processing: queue a reference to the
+ * buffer on every branch
  */
 static GstFlowReturn
 gst_plugin_template_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstPluginTemplate *filter;
+  GstFlowReturn ret, error = GST_FLOW_OK;
+  guint n_branches = 0, n_flushing = 0, n_eos = 0, n_not_linked = 0;
+  guint cookie;
+  guint64 seq;
+  GList *l;
 
   filter = GST_PLUGIN_TEMPLATE (parent);
 
   if (filter->silent == FALSE)
     g_print ("I'm plugged, therefore I'm in.\n");
 
-  /* just push out the incoming buffer without touching it */
-  return gst_pad_push (filter->srcpad, buf);
-}
+  g_mutex_lock (&filter->lock);
+  seq = ++filter->chain_seq;
+
+restart:
+  cookie = filter->branches_cookie;
+  for (l = filter->branches; l; l = l->next) {
+    GstPluginTemplateBranch *branch = l->data;
+
+    /* already handled before a pad was added or released */
+    if (branch->seq == seq)
+      continue;
+
+    /* only a non-leaky branch blocks upstream when full */
+    while (filter->leaky == GST_PLUGIN_TEMPLATE_LEAKY_NO &&
+        BRANCH_IS_RUNNING (branch) && filter->max_size_buffers > 0 &&
+        branch->n_buffers >= filter->max_size_buffers) {
+      g_cond_wait (&filter->cond, &filter->lock);
+      if (filter->branches_cookie != cookie)
+        goto restart;
+    }
 
+    branch->seq = seq;
+    n_branches++;
+
+    if (branch->flushing) {
+      n_flushing++;
+      continue;
+    }
+    if (branch->flow == GST_FLOW_EOS) {
+      n_eos++;
+      continue;
+    }
+    if (branch->flow < GST_FLOW_EOS) {
+      error = branch->flow;
+      continue;
+    }
+    if (branch->flow == GST_FLOW_NOT_LINKED)
+      n_not_linked++;
+
+    if (filter->max_size_buffers > 0 &&
+        branch->n_buffers >= filter->max_size_buffers) {
+      filter->dropped++;
+      if (filter->leaky == GST_PLUGIN_TEMPLATE_LEAKY_UPSTREAM ||
+          !gst_plugin_template_branch_drop_oldest (branch)) {
+        GST_LOG_OBJECT (branch->pad, "queue full, dropping new buffer");
+        continue;
+      }
+      GST_LOG_OBJECT (branch->pad, "queue full, dropped oldest buffer");
+    }
+
+    g_queue_push_tail (&branch->queue, gst_buffer_ref (buf));
+    branch->n_buffers++;
+  }
+  g_cond_broadcast (&filter->cond);
+  g_mutex_unlock (&filter->lock);
+
+  gst_buffer_unref (buf);
+
+  /* like tee: fine as long as one branch can still take data */
+  if (n_branches == 0)
+    ret = GST_FLOW_NOT_LINKED;
+  else if (error != GST_FLOW_OK)
+    ret = error;
+  else if (n_flushing == n_branches)
+    ret = GST_FLOW_FLUSHING;
+  else if (n_eos + n_flushing == n_branches)
+    ret = GST_FLOW_EOS;
+  else if (n_not_linked + n_eos + n_flushing == n_branches)
+    ret = GST_FLOW_NOT_LINKED;
+  else
+    ret = GST_FLOW_OK;
+
+  return ret;
+}
 
 /* entry point to initialize the plug-in
  * initialize the plug-in itself
@@ -263,7 +943,10 @@ plugin_init (GstPlugin * plugin)
   GST_DEBUG_CATEGORY_INIT (gst_plugin_template_debug, "plugin",
       0, "Template plugin");
 
-  return GST_ELEMENT_REGISTER (plugin_template, plugin);
+  if (!GST_ELEMENT_REGISTER (plugin_template, plugin))
+    return FALSE;
+
+  return GST_ELEMENT_REGISTER (ring_queue, plugin);
 }
 
 /* PACKAGE: this is usually set by meson depending on some _INIT macro
@@ -51,6 +51,13 @@
 
 G_BEGIN_DECLS
 
+typedef enum
+{
+  GST_PLUGIN_TEMPLATE_LEAKY_NO,
+  GST_PLUGIN_TEMPLATE_LEAKY_UPSTREAM,
+  GST_PLUGIN_TEMPLATE_LEAKY_DOWNSTREAM
+} GstPluginTemplateLeaky;
+
 #define GST_TYPE_PLUGIN_TEMPLATE (gst_plugin_template_get_type())
 G_DECLARE_FINAL_TYPE (GstPluginTemplate, gst_plugin_template,
     GST, PLUGIN_TEMPLATE, GstElement)
@@ -59,9 +66,21 @@ struct _GstPluginTemplate
 {
   GstElement element;
 
-  GstPad *sinkpad, *srcpad;
+  GstPad *sinkpad;
+
+  /* one GstPluginTemplateBranch per src_%u pad, all protected by lock.
+   * cond is broadcast whenever a branch queue or state changes */
+  GMutex lock;
+  GCond cond;
+  GList *branches;
+  guint branches_cookie;
+  guint64 chain_seq;
+  guint next_pad_index;
 
   gboolean silent;
+  guint max_size_buffers;
+  GstPluginTemplateLeaky leaky;
+  guint64 dropped;
 };
 
 G_END_DECLS
@@ -0,0 +1,525 @@
+/* GStreamer polyphase sample rate conversion
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Rational polyphase resampling. For out_rate / in_rate = L / M reduced,
+ * a Kaiser windowed sinc low-pass at L times the input rate is split into
+ * L phases of taps coefficients each. Output n sits at n * M / L input
+ * samples, so it is the dot product of phase (n * M) % L with the taps
+ * input samples ending at (n * M) / L.
+ *
+ * Each phase is stored reversed, oldest input sample first, so the dot
+ * product runs over contiguous memory in both arrays. The input is
+ * deinterleaved into a per-channel history for the same reason. The taps
+ * are a multiple of 8 so the vector loops need no tail.
+ *
+ * Banks are cached by ratio and quality. Integer ratios get their own
+ * loops: decimation (L = 1) has a single phase, interpolation (M = 1)
+ * walks every phase for each input sample.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "gstcpufeatures.h"
+#include "gstpolyphase.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define MAX_PHASES 4096
+#define MAX_COEFFS (1 << 22)
+#define CHUNK_FRAMES 1024
+
+typedef gfloat (*GstPolyphaseDotFunc) (const gfloat * a, const gfloat * b,
+    guint n);
+
+struct _GstPolyphaseBank
+{
+  gint ref_count;               /* protected by the cache lock */
+  gchar *key;
+
+  guint up;                     /* L */
+  guint down;                   /* M */
+  guint taps;
+  gfloat *coeffs;               /* up phases of taps coefficients */
+
+  GstPolyphaseDotFunc dot;
+  const gchar *kernel_name;
+};
+
+struct _GstPolyphase
+{
+  GstPolyphaseBank *bank;
+  guint channels;
+
+  /* per channel taps - 1 samples of history followed by a chunk */
+  gfloat *history;
+  guint history_len;
+
+  /* next output relative to the current chunk in 1 / L input samples */
+  guint64 pos;
+  guint64 in_total;
+  guint64 out_total;
+};
+
+static const struct
+{
+  guint taps;
+  gdouble beta;
+  gdouble rolloff;
+} quality_presets[] = {
+  [GST_POLYPHASE_QUALITY_LOW] = {16, 6.0, 0.80},
+  [GST_POLYPHASE_QUALITY_MEDIUM] = {32, 8.0, 0.88},
+  [GST_POLYPHASE_QUALITY_HIGH] = {64, 10.0, 0.92},
+  [GST_POLYPHASE_QUALITY_BEST] = {128, 12.0, 0.95},
+};
+
+G_LOCK_DEFINE_STATIC (bank_cache);
+static GHashTable *bank_cache = NULL;
+
+static gfloat
+dot_scalar (const gfloat * a, const gfloat * b, guint n)
+{
+  gfloat s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  guint i;
+
+  for (i = 0; i < n; i += 4) {
+    s0 += a[i] * b[i];
+    s1 += a[i + 1] * b[i + 1];
+    s2 += a[i + 2] * b[i + 2];
+    s3 += a[i + 3] * b[i + 3];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__ ((target ("sse2")))
+static gfloat
+dot_sse2 (const gfloat * a, const gfloat * b, guint n)
+{
+  __m128 s0 = _mm_setzero_ps (), s1 = _mm_setzero_ps ();
+  gfloat lanes[4];
+  guint i;
+
+  for (i = 0; i < n; i += 8) {
+    s0 = _mm_add_ps (s0, _mm_mul_ps (_mm_loadu_ps (a + i),
+            _mm_loadu_ps (b + i)));
+    s1 = _mm_add_ps (s1, _mm_mul_ps (_mm_loadu_ps (a + i + 4),
+            _mm_loadu_ps (b + i + 4)));
+  }
+  _mm_storeu_ps (lanes, _mm_add_ps (s0, s1));
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+__attribute__ ((target ("avx2,fma")))
+static gfloat
+dot_avx2 (const gfloat * a, const gfloat * b, guint n)
+{
+  __m256 s0 = _mm256_setzero_ps (), s1 = _mm256_setzero_ps ();
+  __m128 s;
+  guint i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm256_fmadd_ps (_mm256_loadu_ps (a + i), _mm256_loadu_ps (b + i),
+        s0);
+    s1 = _mm256_fmadd_ps (_mm256_loadu_ps (a + i + 8),
+        _mm256_loadu_ps (b + i + 8), s1);
+  }
+  if (i < n)
+    s0 = _mm256_fmadd_ps (_mm256_loadu_ps (a + i), _mm256_loadu_ps (b + i),
+        s0);
+
+  s0 = _mm256_add_ps (s0, s1);
+  s = _mm_add_ps (_mm256_castps256_ps128 (s0), _mm256_extractf128_ps (s0, 1));
+  s = _mm_add_ps (s, _mm_movehl_ps (s, s));
+  s = _mm_add_ss (s, _mm_shuffle_ps (s, s, 1));
+  return _mm_cvtss_f32 (s);
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+static void
+gst_polyphase_bank_pick_kernel (GstPolyphaseBank * bank)
+{
+  bank->dot = dot_scalar;
+  bank->kernel_name = "scalar";
+
+#ifdef HAVE_X86_KERNELS
+  if (gst_cpu_features_have (GST_CPU_FEATURE_AVX2 | GST_CPU_FEATURE_FMA)) {
+    bank->dot = dot_avx2;
+    bank->kernel_name = "avx2";
+  } else if (gst_cpu_features_have (GST_CPU_FEATURE_SSE2)) {
+    bank->dot = dot_sse2;
+    bank->kernel_name = "sse2";
+  }
+#endif
+}
+
+/* zeroth order modified Bessel function of the first kind */
+static gdouble
+bessel_i0 (gdouble x)
+{
+  gdouble sum = 1.0, term = 1.0;
+  guint k;
+
+  for (k = 1; k < 64 && term > 1e-12 * sum; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+static void
+gst_polyphase_bank_design (GstPolyphaseBank * bank, GstPolyphaseQuality q)
+{
+  guint up = bank->up, taps = bank->taps, n = up * taps, i;
+  gdouble beta = quality_presets[q].beta;
+  /* cutoff in cycles per sample at up times the input rate, below the
+   * lower of the two Nyquist frequencies */
+  gdouble fc = 0.5 * quality_presets[q].rolloff / MAX (up, bank->down);
+  /* centered on a whole sample, the start position in reset() */
+  gdouble center = n / 2, i0_beta = bessel_i0 (beta);
+
+  for (i = 0; i < n; i++) {
+    gdouble t = i - center, r = t / center;
+    gdouble sinc = t == 0.0 ? 1.0 : sin (2.0 * G_PI * fc * t) /
+        (2.0 * G_PI * fc * t);
+    gdouble w = bessel_i0 (beta * sqrt (MAX (1.0 - r * r, 0.0))) / i0_beta;
+    /* gain up makes up for the zeros stuffed between input samples */
+    gdouble h = 2.0 * fc * sinc * w * up;
+
+    bank->coeffs[(i % up) * taps + (taps - 1 - i / up)] = (gfloat) h;
+  }
+}
+
+static GstPolyphaseBank *
+gst_polyphase_bank_new (guint up, guint down, GstPolyphaseQuality q,
+    gchar * key)
+{
+  GstPolyphaseBank *bank;
+  guint taps;
+
+  /* longer filters when decimating keep the transition band as sharp
+   * relative to the output rate */
+  taps = quality_presets[q].taps;
+  if (down > up)
+    taps = (guint) ceil ((gdouble) taps * down / up);
+  taps = (taps + 7) & ~7u;
+
+  if (up > MAX_PHASES || (guint64) up * taps > MAX_COEFFS)
+    return NULL;
+
+  bank = g_new0 (GstPolyphaseBank, 1);
+  bank->ref_count = 1;
+  bank->key = key;
+  bank->up = up;
+  bank->down = down;
+  bank->taps = taps;
+  bank->coeffs = g_new (gfloat, up * taps);
+  gst_polyphase_bank_design (bank, q);
+  gst_polyphase_bank_pick_kernel (bank);
+
+  return bank;
+}
+
+static guint
+gcd (guint a, guint b)
+{
+  while (b) {
+    guint t = a % b;
+
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+GstPolyphaseBank *
+gst_polyphase_bank_get (guint in_rate, guint out_rate,
+    GstPolyphaseQuality quality)
+{
+  GstPolyphaseBank *bank;
+  guint g, up, down;
+  gchar *key;
+
+  g_return_val_if_fail (in_rate > 0 && out_rate > 0, NULL);
+  g_return_val_if_fail (quality <= GST_POLYPHASE_QUALITY_BEST, NULL);
+
+  g = gcd (in_rate, out_rate);
+  up = out_rate / g;
+  down = in_rate / g;
+  key = g_strdup_printf ("%u/%u/%d", up, down, quality);
+
+  G_LOCK (bank_cache);
+  if (bank_cache == NULL)
+    bank_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  bank = g_hash_table_lookup (bank_cache, key);
+  if (bank) {
+    bank->ref_count++;
+    g_free (key);
+  } else {
+    bank = gst_polyphase_bank_new (up, down, quality, key);
+    if (bank)
+      g_hash_table_insert (bank_cache, bank->key, bank);
+    else
+      g_free (key);
+  }
+  G_UNLOCK (bank_cache);
+
+  return bank;
+}
+
+void
+gst_polyphase_bank_unref (GstPolyphaseBank * bank)
+{
+  gboolean last;
+
+  if (bank == NULL)
+    return;
+
+  G_LOCK (bank_cache);
+  last = --bank->ref_count == 0;
+  if (last)
+    g_hash_table_remove (bank_cache, bank->key);
+  G_UNLOCK (bank_cache);
+
+  if (last) {
+    g_free (bank->coeffs);
+    g_free (bank->key);
+    g_free (bank);
+  }
+}
+
+guint
+gst_polyphase_bank_get_taps (const GstPolyphaseBank * bank)
+{
+  return bank->taps;
+}
+
+const gchar *
+gst_polyphase_bank_get_kernel_name (const GstPolyphaseBank * bank)
+{
+  return bank->kernel_name;
+}
+
+GstPolyphase *
+gst_polyphase_new (GstPolyphaseBank * bank, guint channels)
+{
+  GstPolyphase *r;
+
+  g_return_val_if_fail (bank != NULL && channels > 0, NULL);
+
+  G_LOCK (bank_cache);
+  bank->ref_count++;
+  G_UNLOCK (bank_cache);
+
+  r = g_new0 (GstPolyphase, 1);
+  r->bank = bank;
+  r->channels = channels;
+  r->history_len = bank->taps - 1 + CHUNK_FRAMES;
+  r->history = g_new (gfloat, (gsize) channels * r->history_len);
+  gst_polyphase_reset (r);
+
+  return r;
+}
+
+void
+gst_polyphase_free (GstPolyphase * r)
+{
+  if (r == NULL)
+    return;
+
+  gst_polyphase_bank_unref (r->bank);
+  g_free (r->history);
+  g_free (r);
+}
+
+void
+gst_polyphase_reset (GstPolyphase * r)
+{
+  memset (r->history, 0, (gsize) r->channels * r->history_len *
+      sizeof (gfloat));
+  /* start at the filter center so output 0 lines up with input 0 */
+  r->pos = (guint64) r->bank->taps * r->bank->up / 2;
+  r->in_total = 0;
+  r->out_total = 0;
+}
+
+static guint
+outputs_before (guint64 pos, guint64 end, guint down)
+{
+  return pos < end ? (guint) ((end - pos + down - 1) / down) : 0;
+}
+
+guint
+gst_polyphase_get_max_output (const GstPolyphase * r, guint in_frames)
+{
+  return outputs_before (r->pos, (guint64) in_frames * r->bank->up,
+      r->bank->down);
+}
+
+guint
+gst_polyphase_get_delay (const GstPolyphase * r)
+{
+  guint up = r->bank->up;
+
+  return (guint) (((guint64) r->bank->taps * up / 2 + up - 1) / up);
+}
+
+/* n_out outputs of one channel, the first at input index i and phase p */
+static void
+resample_channel (const GstPolyphaseBank * bank, const gfloat * h,
+    gfloat * out, guint stride, guint64 i, guint p, guint n_out)
+{
+  const gfloat *coeffs = bank->coeffs;
+  guint taps = bank->taps, up = bank->up, down = bank->down, k;
+  GstPolyphaseDotFunc dot = bank->dot;
+
+  if (up == 1) {
+    for (k = 0; k < n_out; k++, i += down)
+      out[k * stride] = dot (coeffs, h + i, taps);
+  } else if (down == 1) {
+    for (k = 0; k < n_out; k++) {
+      out[k * stride] = dot (coeffs + p * taps, h + i, taps);
+      if (++p == up) {
+        p = 0;
+        i++;
+      }
+    }
+  } else {
+    guint step_i = down / up, step_p = down % up;
+
+    for (k = 0; k < n_out; k++) {
+      out[k * stride] = dot (coeffs + p * taps, h + i, taps);
+      i += step_i;
+      p += step_p;
+      if (p >= up) {
+        p -= up;
+        i++;
+      }
+    }
+  }
+}
+
+/* in NULL feeds silence */
+static guint
+gst_polyphase_process_chunk (GstPolyphase * r, const gfloat * in,
+    guint frames, gfloat * out)
+{
+  GstPolyphaseBank *bank = r->bank;
+  guint keep = bank->taps - 1, ch = r->channels, n_out, c, f;
+  guint64 end = (guint64) frames * bank->up;
+
+  n_out = outputs_before (r->pos, end, bank->down);
+
+  for (c = 0; c < ch; c++) {
+    gfloat *h = r->history + (gsize) c * r->history_len;
+
+    if (in) {
+      for (f = 0; f < frames; f++)
+        h[keep + f] = in[f * ch + c];
+    } else {
+      memset (h + keep, 0, frames * sizeof (gfloat));
+    }
+
+    if (n_out > 0)
+      resample_channel (bank, h, out + c, ch, r->pos / bank->up,
+          (guint) (r->pos % bank->up), n_out);
+
+    memmove (h, h + frames, keep * sizeof (gfloat));
+  }
+
+  r->pos += (guint64) n_out * bank->down;
+  r->pos -= end;
+  return n_out;
+}
+
+guint
+gst_polyphase_process (GstPolyphase * r, const gfloat * in, guint in_frames,
+    gfloat * out)
+{
+  guint written = 0;
+
+  while (in_frames > 0) {
+    guint n = MIN (in_frames, CHUNK_FRAMES);
+
+    written += gst_polyphase_process_chunk (r, in, n,
+        out + (gsize) written * r->channels);
+    in += (gsize) n * r->channels;
+    in_frames -= n;
+    r->in_total += n;
+  }
+  r->out_total += written;
+
+  return written;
+}
+
+guint
+gst_polyphase_drain (GstPolyphase * r, gfloat * out)
+{
+  guint64 expected;
+  guint written = 0, left = gst_polyphase_get_delay (r);
+
+  /* one output per L / M input samples, rounded up */
+  expected = (r->in_total * r->bank->up + r->bank->down - 1) /
+      r->bank->down;
+  while (left > 0) {
+    guint n = MIN (left, CHUNK_FRAMES);
+
+    written += gst_polyphase_process_chunk (r, NULL, n,
+        out + (gsize) written * r->channels);
+    left -= n;
+  }
+  written = (guint) MIN ((guint64) written, expected - r->out_total);
+
+  gst_polyphase_reset (r);
+  return written;
+}
@@ -0,0 +1,94 @@
+/* GStreamer polyphase sample rate conversion
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_POLYPHASE_H__
+#define __GST_POLYPHASE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_POLYPHASE_QUALITY_LOW,
+  GST_POLYPHASE_QUALITY_MEDIUM,
+  GST_POLYPHASE_QUALITY_HIGH,
+  GST_POLYPHASE_QUALITY_BEST
+} GstPolyphaseQuality;
+
+typedef struct _GstPolyphaseBank GstPolyphaseBank;
+typedef struct _GstPolyphase GstPolyphase;
+
+/* The filter bank for a rate ratio is shared by every resampler using the
+ * same ratio and quality and freed with the last reference. NULL if the
+ * reduced ratio needs too many phases */
+GstPolyphaseBank *gst_polyphase_bank_get (guint in_rate, guint out_rate,
+    GstPolyphaseQuality quality);
+void gst_polyphase_bank_unref (GstPolyphaseBank * bank);
+guint gst_polyphase_bank_get_taps (const GstPolyphaseBank * bank);
+const gchar *gst_polyphase_bank_get_kernel_name (const GstPolyphaseBank *
+    bank);
+
+/* takes its own reference to bank */
+GstPolyphase *gst_polyphase_new (GstPolyphaseBank * bank, guint channels);
+void gst_polyphase_free (GstPolyphase * resampler);
+void gst_polyphase_reset (GstPolyphase * resampler);
+
+/* output frames produced by the next in_frames input frames, at most */
+guint gst_polyphase_get_max_output (const GstPolyphase * resampler,
+    guint in_frames);
+/* input frames the output lags behind the input */
+guint gst_polyphase_get_delay (const GstPolyphase * resampler);
+
+/* interleaved F32, returns the number of output frames written */
+guint gst_polyphase_process (GstPolyphase * resampler, const gfloat * in,
+    guint in_frames, gfloat * out);
+/* output the frames still held back by the delay, out must hold
+ * gst_polyphase_get_max_output (resampler, gst_polyphase_get_delay
+ * (resampler)) frames. The resampler is reset afterwards */
+guint gst_polyphase_drain (GstPolyphase * resampler, gfloat * out);
+
+G_END_DECLS
+
+#endif /* __GST_POLYPHASE_H__ */
@@ -0,0 +1,500 @@
+/* GStreamer polyphase resampler
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/**
+ * SECTION:element-polyresample
+ *
+ * Converts F32 audio between sample rates with the polyphase filter banks
+ * of gstpolyphase.c. A bank is designed once per reduced rate ratio and
+ * quality and shared by all instances in the process, so opening many
+ * 44.1 kHz to 48 kHz streams costs one filter design. Integer ratios such
+ * as 48 kHz to 96 kHz or back skip the phase bookkeeping.
+ *
+ * Ratios that reduce to more than 4096 phases, like 44100 to 48017, are
+ * refused during caps negotiation.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -v audiotestsrc ! audio/x-raw,rate=44100 ! audioconvert ! polyresample quality=high ! audio/x-raw,rate=48000 ! autoaudiosink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpolyresample.h"
+#include "gstaudiolatency.h"
+
+GST_DEBUG_CATEGORY_STATIC (poly_resample_debug);
+#define GST_CAT_DEFAULT poly_resample_debug
+
+enum
+{
+  PROP_0,
+  PROP_QUALITY
+};
+
+#define DEFAULT_QUALITY GST_POLYPHASE_QUALITY_MEDIUM
+
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE (GST_AUDIO_NE (F32)) ", layout = (string) interleaved"
+
+G_DEFINE_TYPE (GstPolyResample, gst_poly_resample, GST_TYPE_AUDIO_FILTER);
+
+GST_ELEMENT_REGISTER_DEFINE (poly_resample, "polyresample", GST_RANK_NONE,
+    GST_TYPE_POLY_RESAMPLE);
+
+#define GST_TYPE_POLY_RESAMPLE_QUALITY (gst_poly_resample_quality_get_type ())
+static GType
+gst_poly_resample_quality_get_type (void)
+{
+  static GType quality_type = 0;
+  static const GEnumValue quality[] = {
+    {GST_POLYPHASE_QUALITY_LOW, "16 taps per phase", "low"},
+    {GST_POLYPHASE_QUALITY_MEDIUM, "32 taps per phase", "medium"},
+    {GST_POLYPHASE_QUALITY_HIGH, "64 taps per phase", "high"},
+    {GST_POLYPHASE_QUALITY_BEST, "128 taps per phase", "best"},
+    {0, NULL, NULL},
+  };
+
+  if (!quality_type)
+    quality_type = g_enum_register_static ("GstPolyResampleQuality", quality);
+  return quality_type;
+}
+
+static void gst_poly_resample_finalize (GObject * object);
+static void gst_poly_resample_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_poly_resample_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static GstCaps *gst_poly_resample_transform_caps (GstBaseTransform *
+    base_transform, GstPadDirection direction, GstCaps * caps,
+    GstCaps * filter);
+static GstCaps *gst_poly_resample_fixate_caps (GstBaseTransform *
+    base_transform, GstPadDirection direction, GstCaps * caps,
+    GstCaps * othercaps);
+static gboolean gst_poly_resample_transform_size (GstBaseTransform *
+    base_transform, GstPadDirection direction, GstCaps * caps, gsize size,
+    GstCaps * othercaps, gsize * othersize);
+static gboolean gst_poly_resample_set_caps (GstBaseTransform *
+    base_transform, GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_poly_resample_stop (GstBaseTransform * base_transform);
+static gboolean gst_poly_resample_sink_event (GstBaseTransform *
+    base_transform, GstEvent * event);
+static gboolean gst_poly_resample_query (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstQuery * query);
+static GstFlowReturn gst_poly_resample_transform (GstBaseTransform *
+    base_transform, GstBuffer * inbuf, GstBuffer * outbuf);
+
+static void
+gst_poly_resample_class_init (GstPolyResampleClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstBaseTransformClass *btrans_class = (GstBaseTransformClass *) klass;
+  GstAudioFilterClass *audio_filter_class = (GstAudioFilterClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (poly_resample_debug, "polyresample", 0,
+      "Polyphase resampler");
+
+  gobject_class->finalize = gst_poly_resample_finalize;
+  gobject_class->set_property = gst_poly_resample_set_property;
+  gobject_class->get_property = gst_poly_resample_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_QUALITY,
+      g_param_spec_enum ("quality", "Quality",
+          "Filter length and stopband attenuation, applied on the next caps",
+          GST_TYPE_POLY_RESAMPLE_QUALITY, DEFAULT_QUALITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  btrans_class->transform_caps =
+      GST_DEBUG_FUNCPTR (gst_poly_resample_transform_caps);
+  btrans_class->fixate_caps = GST_DEBUG_FUNCPTR (gst_poly_resample_fixate_caps);
+  btrans_class->transform_size =
+      GST_DEBUG_FUNCPTR (gst_poly_resample_transform_size);
+  btrans_class->set_caps = GST_DEBUG_FUNCPTR (gst_poly_resample_set_caps);
+  btrans_class->stop = GST_DEBUG_FUNCPTR (gst_poly_resample_stop);
+  btrans_class->sink_event = GST_DEBUG_FUNCPTR (gst_poly_resample_sink_event);
+  btrans_class->query = GST_DEBUG_FUNCPTR (gst_poly_resample_query);
+  btrans_class->transform = GST_DEBUG_FUNCPTR (gst_poly_resample_transform);
+  /* same rate in and out */
+  btrans_class->passthrough_on_same_caps = TRUE;
+
+  gst_element_class_set_details_simple (element_class, "Polyphase resampler",
+      "Filter/Converter/Audio",
+      "Resamples audio with cached polyphase filter banks",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  caps = gst_caps_from_string (SUPPORTED_CAPS_STRING);
+  gst_audio_filter_class_add_pad_templates (audio_filter_class, caps);
+  gst_caps_unref (caps);
+}
+
+static void
+gst_poly_resample_init (GstPolyResample * resample)
+{
+  resample->quality = DEFAULT_QUALITY;
+
+  resample->resampler = NULL;
+  resample->latency = 0;
+  gst_audio_info_init (&resample->out_info);
+  resample->need_sync = TRUE;
+  resample->t0 = GST_CLOCK_TIME_NONE;
+  resample->out_offset = 0;
+}
+
+static void
+gst_poly_resample_finalize (GObject * object)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (object);
+
+  gst_polyphase_free (resample->resampler);
+
+  G_OBJECT_CLASS (gst_poly_resample_parent_class)->finalize (object);
+}
+
+static void
+gst_poly_resample_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (object);
+
+  switch (prop_id) {
+    case PROP_QUALITY:
+      GST_OBJECT_LOCK (resample);
+      resample->quality = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (resample);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_poly_resample_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (object);
+
+  GST_OBJECT_LOCK (resample);
+  switch (prop_id) {
+    case PROP_QUALITY:
+      g_value_set_enum (value, resample->quality);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (resample);
+}
+
+/* any rate on the other side, everything else unchanged */
+static GstCaps *
+gst_poly_resample_transform_caps (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter)
+{
+  GstCaps *res = gst_caps_copy (caps);
+  guint i;
+
+  for (i = 0; i < gst_caps_get_size (res); i++)
+    gst_structure_set (gst_caps_get_structure (res, i), "rate",
+        GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+
+  if (filter) {
+    GstCaps *tmp = gst_caps_intersect_full (filter, res,
+        GST_CAPS_INTERSECT_FIRST);
+
+    gst_caps_unref (res);
+    res = tmp;
+  }
+
+  return res;
+}
+
+/* keep the rate if downstream allows it */
+static GstCaps *
+gst_poly_resample_fixate_caps (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstCaps * caps, GstCaps * othercaps)
+{
+  gint rate;
+
+  othercaps = gst_caps_make_writable (gst_caps_truncate (othercaps));
+  if (gst_structure_get_int (gst_caps_get_structure (caps, 0), "rate", &rate))
+    gst_structure_fixate_field_nearest_int (gst_caps_get_structure
+        (othercaps, 0), "rate", rate);
+
+  return gst_caps_fixate (othercaps);
+}
+
+/* an upper bound: every input frame gives out_rate / in_rate output
+ * frames, plus one for the fractional position */
+static gboolean
+gst_poly_resample_transform_size (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstCaps * caps, gsize size,
+    GstCaps * othercaps, gsize * othersize)
+{
+  GstAudioInfo info, other;
+  guint64 frames;
+
+  if (!gst_audio_info_from_caps (&info, caps) ||
+      !gst_audio_info_from_caps (&other, othercaps))
+    return FALSE;
+
+  frames = gst_util_uint64_scale_int_ceil (size / GST_AUDIO_INFO_BPF (&info),
+      GST_AUDIO_INFO_RATE (&other), GST_AUDIO_INFO_RATE (&info)) + 1;
+  *othersize = frames * GST_AUDIO_INFO_BPF (&other);
+  return TRUE;
+}
+
+static gboolean
+gst_poly_resample_set_caps (GstBaseTransform * base_transform,
+    GstCaps * incaps, GstCaps * outcaps)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (base_transform);
+  GstPolyphaseBank *bank;
+  GstPolyphaseQuality quality;
+  gint in_rate, out_rate, channels;
+
+  if (!GST_BASE_TRANSFORM_CLASS (gst_poly_resample_parent_class)->set_caps
+      (base_transform, incaps, outcaps))
+    return FALSE;
+  if (!gst_audio_info_from_caps (&resample->out_info, outcaps))
+    return FALSE;
+
+  in_rate = GST_AUDIO_INFO_RATE (GST_AUDIO_FILTER_INFO (resample));
+  out_rate = GST_AUDIO_INFO_RATE (&resample->out_info);
+  channels = GST_AUDIO_INFO_CHANNELS (&resample->out_info);
+
+  gst_polyphase_free (resample->resampler);
+  resample->resampler = NULL;
+  resample->need_sync = TRUE;
+
+  if (in_rate == out_rate) {
+    GST_INFO_OBJECT (resample, "same rate %d, passthrough", in_rate);
+    gst_audio_latency_update (GST_AUDIO_FILTER (resample),
+        &resample->latency, 0);
+    return TRUE;
+  }
+
+  GST_OBJECT_LOCK (resample);
+  quality = resample->quality;
+  GST_OBJECT_UNLOCK (resample);
+
+  bank = gst_polyphase_bank_get (in_rate, out_rate, quality);
+  if (bank == NULL) {
+    GST_WARNING_OBJECT (resample, "ratio %d:%d needs too many phases",
+        in_rate, out_rate);
+    g_atomic_int_set (&resample->latency, 0);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (resample, "%d Hz to %d Hz, %d channels, %u taps, %s",
+      in_rate, out_rate, channels, gst_polyphase_bank_get_taps (bank),
+      gst_polyphase_bank_get_kernel_name (bank));
+
+  resample->resampler = gst_polyphase_new (bank, channels);
+  gst_polyphase_bank_unref (bank);
+  gst_audio_latency_update (GST_AUDIO_FILTER (resample), &resample->latency,
+      gst_polyphase_get_delay (resample->resampler));
+  return TRUE;
+}
+
+static gboolean
+gst_poly_resample_stop (GstBaseTransform * base_transform)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (base_transform);
+
+  gst_polyphase_free (resample->resampler);
+  resample->resampler = NULL;
+  resample->need_sync = TRUE;
+  g_atomic_int_set (&resample->latency, 0);
+  return TRUE;
+}
+
+/* output timestamps count output frames from the first input timestamp,
+ * so rounding never accumulates */
+static void
+gst_poly_resample_stamp (GstPolyResample * resample, GstBuffer * buf,
+    guint frames)
+{
+  gint rate = GST_AUDIO_INFO_RATE (&resample->out_info);
+
+  if (GST_CLOCK_TIME_IS_VALID (resample->t0)) {
+    GstClockTime start = resample->t0 +
+        gst_util_uint64_scale_int (resample->out_offset, GST_SECOND, rate);
+    GstClockTime end = resample->t0 +
+        gst_util_uint64_scale_int (resample->out_offset + frames, GST_SECOND,
+        rate);
+
+    GST_BUFFER_PTS (buf) = start;
+    GST_BUFFER_DURATION (buf) = end - start;
+  } else {
+    GST_BUFFER_PTS (buf) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DURATION (buf) = GST_CLOCK_TIME_NONE;
+  }
+  GST_BUFFER_OFFSET (buf) = resample->out_offset;
+  GST_BUFFER_OFFSET_END (buf) = resample->out_offset + frames;
+
+  resample->out_offset += frames;
+}
+
+static GstFlowReturn
+gst_poly_resample_transform (GstBaseTransform * base_transform,
+    GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (base_transform);
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (resample);
+  GstMapInfo in_map, out_map;
+  guint frames;
+
+  if (resample->resampler == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  /* a gap in the input restarts the filter and the timeline */
+  if (resample->need_sync || GST_BUFFER_IS_DISCONT (inbuf)) {
+    gst_polyphase_reset (resample->resampler);
+    resample->t0 = GST_BUFFER_PTS (inbuf);
+    resample->out_offset = 0;
+    resample->need_sync = FALSE;
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+  }
+
+  if (!gst_buffer_map (inbuf, &in_map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+  if (!gst_buffer_map (outbuf, &out_map, GST_MAP_WRITE)) {
+    gst_buffer_unmap (inbuf, &in_map);
+    return GST_FLOW_ERROR;
+  }
+
+  frames = gst_polyphase_process (resample->resampler,
+      (const gfloat *) in_map.data, in_map.size / GST_AUDIO_INFO_BPF (info),
+      (gfloat *) out_map.data);
+
+  gst_buffer_unmap (outbuf, &out_map);
+  gst_buffer_unmap (inbuf, &in_map);
+
+  gst_buffer_set_size (outbuf, frames *
+      GST_AUDIO_INFO_BPF (&resample->out_info));
+  gst_poly_resample_stamp (resample, outbuf, frames);
+
+  /* the first buffers only fill the filter */
+  if (frames == 0)
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+  return GST_FLOW_OK;
+}
+
+/* push the frames still held back by the filter delay */
+static void
+gst_poly_resample_drain (GstPolyResample * resample)
+{
+  GstPolyphase *r = resample->resampler;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint frames;
+
+  if (r == NULL || resample->need_sync)
+    return;
+
+  frames = gst_polyphase_get_max_output (r, gst_polyphase_get_delay (r));
+  buf = gst_buffer_new_allocate (NULL, frames *
+      GST_AUDIO_INFO_BPF (&resample->out_info), NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  frames = gst_polyphase_drain (r, (gfloat *) map.data);
+  gst_buffer_unmap (buf, &map);
+  resample->need_sync = TRUE;
+
+  if (frames == 0) {
+    gst_buffer_unref (buf);
+    return;
+  }
+
+  gst_buffer_set_size (buf, frames * GST_AUDIO_INFO_BPF (&resample->out_info));
+  gst_poly_resample_stamp (resample, buf, frames);
+  gst_audio_latency_push_tail (GST_AUDIO_FILTER (resample), buf);
+}
+
+static gboolean
+gst_poly_resample_sink_event (GstBaseTransform * base_transform,
+    GstEvent * event)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (base_transform);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      gst_poly_resample_drain (resample);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      resample->need_sync = TRUE;
+      break;
+    default:
+      break;
+  }
+
+  return
+      GST_BASE_TRANSFORM_CLASS (gst_poly_resample_parent_class)->sink_event
+      (base_transform, event);
+}
+
+/* add the filter delay to the upstream latency */
+static gboolean
+gst_poly_resample_query (GstBaseTransform * base_transform,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstPolyResample *resample = GST_POLY_RESAMPLE (base_transform);
+
+  if (!GST_BASE_TRANSFORM_CLASS (gst_poly_resample_parent_class)->query
+      (base_transform, direction, query))
+    return FALSE;
+
+  gst_audio_latency_query (GST_AUDIO_FILTER (resample), &resample->latency,
+      direction, query);
+  return TRUE;
+}
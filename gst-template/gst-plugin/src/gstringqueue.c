@@ -0,0 +1,854 @@
+/*
+ * GStreamer
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:element-ring_queue
+ *
+ * A thread boundary like queue, built around a fixed-capacity lock-free
+ * single-producer/single-consumer ring. The streaming thread only writes
+ * the tail index and the src pad task only writes the head index, so
+ * handing over a buffer costs two atomic loads and one release store
+ * instead of a mutex and a condition variable. The mutex is only taken
+ * when one side has nothing to do and goes to sleep.
+ *
+ * Serialized events and queries travel through the ring so they stay in
+ * order with the buffers. Events and queries are never dropped, only
+ * buffers are, depending on the leaky mode.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -v videotestsrc ! ring_queue max-size-buffers=32 ! fakesink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <gst/gst.h>
+
+#include "gstringqueue.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_ring_queue_debug);
+#define GST_CAT_DEFAULT gst_ring_queue_debug
+
+enum
+{
+  PROP_0,
+  PROP_MAX_SIZE_BUFFERS,
+  PROP_LEAKY,
+  PROP_DROPPED,
+  PROP_CURRENT_LEVEL_BUFFERS
+};
+
+#define DEFAULT_MAX_SIZE_BUFFERS 64
+#define DEFAULT_LEAKY GST_RING_QUEUE_LEAKY_NO
+
+/* how often a side polls the ring before it goes to sleep */
+#define RING_SPIN 128
+
+/* buffers are tagged in the low pointer bit so that the producer can tell
+ * whether the oldest item may be dropped without dereferencing it.
+ * Serialized queries are queued as a ticket carrying their sequence number
+ * instead of a pointer, so a query given up by its caller can stay in the
+ * ring without being dereferenced later */
+#define RING_TAG_BUFFER ((guintptr) 1)
+#define RING_TAG_QUERY ((guintptr) 2)
+#define RING_UNTAG(item) ((GstMiniObject *) ((guintptr) (item) & ~RING_TAG_BUFFER))
+#define RING_QUERY_TICKET(seq) ((gpointer) (((guintptr) (seq) << 2) | RING_TAG_QUERY))
+#define RING_TICKET_SEQ(item) ((guint) ((guintptr) (item) >> 2))
+#define RING_IS_TICKET(item) (((guintptr) (item) & RING_TAG_QUERY) != 0)
+
+#if defined(__GNUC__)
+#define RING_LOAD(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define RING_STORE(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+#define RING_FENCE() __atomic_thread_fence (__ATOMIC_SEQ_CST)
+#else
+/* GLib atomics are full barriers */
+#define RING_LOAD(p) ((guint) g_atomic_int_get ((gint *) (p)))
+#define RING_STORE(p, v) g_atomic_int_set ((gint *) (p), (gint) (v))
+#define RING_FENCE() G_STMT_START { } G_STMT_END
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RING_RELAX() __builtin_ia32_pause ()
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define RING_RELAX() __asm__ __volatile__ ("yield")
+#else
+#define RING_RELAX() G_STMT_START { } G_STMT_END
+#endif
+
+static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("ANY")
+    );
+
+static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("ANY")
+    );
+
+#define gst_ring_queue_parent_class parent_class
+G_DEFINE_TYPE (GstRingQueue, gst_ring_queue, GST_TYPE_ELEMENT);
+
+GST_ELEMENT_REGISTER_DEFINE (ring_queue, "ring_queue", GST_RANK_NONE,
+    GST_TYPE_RING_QUEUE);
+
+#define GST_TYPE_RING_QUEUE_LEAKY (gst_ring_queue_leaky_get_type ())
+static GType
+gst_ring_queue_leaky_get_type (void)
+{
+  static GType leaky_type = 0;
+  static const GEnumValue leaky[] = {
+    {GST_RING_QUEUE_LEAKY_NO, "Not Leaky", "no"},
+    {GST_RING_QUEUE_LEAKY_UPSTREAM, "Leaky on upstream (new buffers)",
+        "upstream"},
+    {GST_RING_QUEUE_LEAKY_DOWNSTREAM, "Leaky on downstream (old buffers)",
+        "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (!leaky_type)
+    leaky_type = g_enum_register_static ("GstRingQueueLeaky", leaky);
+  return leaky_type;
+}
+
+static void gst_ring_queue_finalize (GObject * object);
+static void gst_ring_queue_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_ring_queue_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+static GstStateChangeReturn gst_ring_queue_change_state (GstElement *
+    element, GstStateChange transition);
+
+static GstFlowReturn gst_ring_queue_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buf);
+static gboolean gst_ring_queue_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static gboolean gst_ring_queue_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query);
+static gboolean gst_ring_queue_sink_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+static gboolean gst_ring_queue_src_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+
+/* GObject vmethod implementations */
+
+static void
+gst_ring_queue_class_init (GstRingQueueClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = (GstElementClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (gst_ring_queue_debug, "ring_queue", 0,
+      "Lock-free ring buffer queue");
+
+  gobject_class->finalize = gst_ring_queue_finalize;
+  gobject_class->set_property = gst_ring_queue_set_property;
+  gobject_class->get_property = gst_ring_queue_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BUFFERS,
+      g_param_spec_uint ("max-size-buffers", "Max. size (buffers)",
+          "Capacity of the ring in buffers, rounded up to a power of two",
+          2, 1 << 20, DEFAULT_MAX_SIZE_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where the queue drops buffers when full instead of blocking "
+          "upstream", GST_TYPE_RING_QUEUE_LEAKY, DEFAULT_LEAKY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint ("dropped", "Dropped",
+          "Number of buffers dropped because the queue was full",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_CURRENT_LEVEL_BUFFERS,
+      g_param_spec_uint ("current-level-buffers", "Current level (buffers)",
+          "Current number of items in the queue",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Ring queue",
+      "Generic",
+      "Lock-free single-producer/single-consumer queue",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&src_factory));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&sink_factory));
+
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_ring_queue_change_state);
+}
+
+static void
+gst_ring_queue_init (GstRingQueue * q)
+{
+  q->sinkpad = gst_pad_new_from_static_template (&sink_factory, "sink");
+  gst_pad_set_chain_function (q->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_ring_queue_chain));
+  gst_pad_set_event_function (q->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_ring_queue_sink_event));
+  gst_pad_set_query_function (q->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_ring_queue_sink_query));
+  gst_pad_set_activatemode_function (q->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_ring_queue_sink_activate_mode));
+  GST_PAD_SET_PROXY_CAPS (q->sinkpad);
+  gst_element_add_pad (GST_ELEMENT (q), q->sinkpad);
+
+  q->srcpad = gst_pad_new_from_static_template (&src_factory, "src");
+  gst_pad_set_activatemode_function (q->srcpad,
+      GST_DEBUG_FUNCPTR (gst_ring_queue_src_activate_mode));
+  GST_PAD_SET_PROXY_CAPS (q->srcpad);
+  gst_element_add_pad (GST_ELEMENT (q), q->srcpad);
+
+  q->head = 0;
+  q->tail = 0;
+  q->slots = NULL;
+  q->mask = 0;
+
+  g_mutex_init (&q->lock);
+  g_cond_init (&q->item_added);
+  g_cond_init (&q->item_removed);
+  q->consumer_waiting = 0;
+  q->producer_waiting = 0;
+  q->flushing = TRUE;
+  q->srcresult = GST_FLOW_FLUSHING;
+
+  q->query = NULL;
+  q->query_seq = 0;
+  q->query_busy = FALSE;
+  q->query_done = FALSE;
+  q->query_result = FALSE;
+
+  q->max_size_buffers = DEFAULT_MAX_SIZE_BUFFERS;
+  q->leaky = DEFAULT_LEAKY;
+  q->ring_leaky = DEFAULT_LEAKY;
+  q->dropped = 0;
+}
+
+static void
+gst_ring_queue_finalize (GObject * object)
+{
+  GstRingQueue *q = GST_RING_QUEUE (object);
+
+  g_free (q->slots);
+  g_mutex_clear (&q->lock);
+  g_cond_clear (&q->item_added);
+  g_cond_clear (&q->item_removed);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_ring_queue_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRingQueue *q = GST_RING_QUEUE (object);
+
+  switch (prop_id) {
+    case PROP_MAX_SIZE_BUFFERS:
+      GST_OBJECT_LOCK (q);
+      q->max_size_buffers = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (q);
+      break;
+    case PROP_LEAKY:
+      GST_OBJECT_LOCK (q);
+      q->leaky = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (q);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_ring_queue_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRingQueue *q = GST_RING_QUEUE (object);
+
+  switch (prop_id) {
+    case PROP_MAX_SIZE_BUFFERS:
+      GST_OBJECT_LOCK (q);
+      g_value_set_uint (value, q->max_size_buffers);
+      GST_OBJECT_UNLOCK (q);
+      break;
+    case PROP_LEAKY:
+      GST_OBJECT_LOCK (q);
+      g_value_set_enum (value, q->leaky);
+      GST_OBJECT_UNLOCK (q);
+      break;
+    case PROP_DROPPED:
+      g_value_set_uint (value, g_atomic_int_get (&q->dropped));
+      break;
+    case PROP_CURRENT_LEVEL_BUFFERS:
+      g_value_set_uint (value, RING_LOAD (&q->tail) - RING_LOAD (&q->head));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* ring helpers */
+
+/* producer: store an item if there is room, without waking the consumer */
+static inline gboolean
+gst_ring_queue_put (GstRingQueue * q, gpointer item)
+{
+  guint tail = q->tail;
+
+  if (tail - RING_LOAD (&q->head) > q->mask)
+    return FALSE;
+
+  q->slots[tail & q->mask] = item;
+  RING_STORE (&q->tail, tail + 1);
+  return TRUE;
+}
+
+/* consumer: take the oldest item, NULL when the ring is empty */
+static inline gpointer
+gst_ring_queue_take (GstRingQueue * q)
+{
+  guint head;
+  gpointer item;
+
+  do {
+    head = RING_LOAD (&q->head);
+    if (head == RING_LOAD (&q->tail))
+      return NULL;
+    item = q->slots[head & q->mask];
+
+    if (q->ring_leaky != GST_RING_QUEUE_LEAKY_DOWNSTREAM) {
+      RING_STORE (&q->head, head + 1);
+      return item;
+    }
+    /* the producer may drop the same item concurrently */
+  } while (!g_atomic_int_compare_and_exchange ((gint *) & q->head,
+          (gint) head, (gint) (head + 1)));
+
+  return item;
+}
+
+/* wake the other side if it announced that it went to sleep. The fence
+ * orders our index update before reading the flag; the sleeper sets the
+ * flag before it checks the index one last time */
+static inline void
+gst_ring_queue_wake (GstRingQueue * q, gint * waiting, GCond * cond)
+{
+  RING_FENCE ();
+  if (G_UNLIKELY (g_atomic_int_get (waiting))) {
+    g_mutex_lock (&q->lock);
+    g_cond_signal (cond);
+    g_mutex_unlock (&q->lock);
+  }
+}
+
+static inline gboolean
+gst_ring_queue_stopped (GstRingQueue * q)
+{
+  return g_atomic_int_get (&q->flushing) ||
+      g_atomic_int_get (&q->srcresult) != GST_FLOW_OK;
+}
+
+/* producer: store an item, sleeping while the ring is full.
+ * Returns FALSE when flushing or when the task stopped on an error */
+static gboolean
+gst_ring_queue_push (GstRingQueue * q, gpointer item)
+{
+  guint spin;
+  gboolean res = TRUE;
+
+  for (spin = 0; spin < RING_SPIN; spin++) {
+    if (G_LIKELY (gst_ring_queue_put (q, item)))
+      goto done;
+    if (gst_ring_queue_stopped (q))
+      return FALSE;
+    RING_RELAX ();
+  }
+
+  g_mutex_lock (&q->lock);
+  while (TRUE) {
+    if (gst_ring_queue_stopped (q)) {
+      res = FALSE;
+      break;
+    }
+    g_atomic_int_set (&q->producer_waiting, 1);
+    RING_FENCE ();
+    if (gst_ring_queue_put (q, item))
+      break;
+    g_cond_wait (&q->item_removed, &q->lock);
+  }
+  g_atomic_int_set (&q->producer_waiting, 0);
+  g_mutex_unlock (&q->lock);
+
+  if (!res)
+    return FALSE;
+
+done:
+  gst_ring_queue_wake (q, &q->consumer_waiting, &q->item_added);
+  return TRUE;
+}
+
+/* consumer: take the oldest item, sleeping while the ring is empty.
+ * Returns NULL when flushing */
+static gpointer
+gst_ring_queue_pop (GstRingQueue * q)
+{
+  gpointer item;
+  guint spin;
+
+  for (spin = 0; spin < RING_SPIN; spin++) {
+    if (G_LIKELY ((item = gst_ring_queue_take (q))))
+      goto done;
+    if (g_atomic_int_get (&q->flushing))
+      return NULL;
+    RING_RELAX ();
+  }
+
+  g_mutex_lock (&q->lock);
+  while (TRUE) {
+    if (q->flushing) {
+      item = NULL;
+      break;
+    }
+    g_atomic_int_set (&q->consumer_waiting, 1);
+    RING_FENCE ();
+    if ((item = gst_ring_queue_take (q)))
+      break;
+    g_cond_wait (&q->item_added, &q->lock);
+  }
+  g_atomic_int_set (&q->consumer_waiting, 0);
+  g_mutex_unlock (&q->lock);
+
+  if (item == NULL)
+    return NULL;
+
+done:
+  gst_ring_queue_wake (q, &q->producer_waiting, &q->item_removed);
+  return item;
+}
+
+/* producer, leaky=downstream: drop the oldest item if it is a buffer.
+ * Events and queries are never dropped */
+static void
+gst_ring_queue_drop_oldest (GstRingQueue * q)
+{
+  guint head;
+  gpointer item;
+
+  head = RING_LOAD (&q->head);
+  while (head != q->tail) {
+    /* only we write the slots, so the value for this index is valid even
+     * if the consumer takes it meanwhile; the CAS decides who owns it */
+    item = q->slots[head & q->mask];
+    if (!((guintptr) item & RING_TAG_BUFFER))
+      return;
+
+    if (g_atomic_int_compare_and_exchange ((gint *) & q->head, (gint) head,
+            (gint) (head + 1))) {
+      gst_mini_object_unref (RING_UNTAG (item));
+      g_atomic_int_inc (&q->dropped);
+      return;
+    }
+    head = RING_LOAD (&q->head);
+  }
+}
+
+/* drop everything queued; only called while the task is not running */
+static void
+gst_ring_queue_clear (GstRingQueue * q)
+{
+  GstMiniObject *obj;
+  gpointer item;
+
+  if (q->slots == NULL)
+    return;
+
+  while ((item = gst_ring_queue_take (q))) {
+    /* queries are owned by the thread waiting for the answer */
+    if (RING_IS_TICKET (item))
+      continue;
+    obj = RING_UNTAG (item);
+    gst_mini_object_unref (obj);
+  }
+}
+
+/* mark the queue flushing and wake both sides */
+static void
+gst_ring_queue_set_flushing (GstRingQueue * q, gboolean flushing)
+{
+  g_mutex_lock (&q->lock);
+  g_atomic_int_set (&q->flushing, flushing);
+  g_atomic_int_set (&q->srcresult,
+      flushing ? GST_FLOW_FLUSHING : GST_FLOW_OK);
+  g_cond_broadcast (&q->item_added);
+  g_cond_broadcast (&q->item_removed);
+  g_mutex_unlock (&q->lock);
+}
+
+/* src pad task */
+
+static void
+gst_ring_queue_handle_query (GstRingQueue * q, guint seq)
+{
+  GstQuery *query;
+  gboolean res;
+
+  g_mutex_lock (&q->lock);
+  if (q->flushing) {
+    /* the waiting thread gives up on its own */
+    g_mutex_unlock (&q->lock);
+    return;
+  }
+  if (q->query == NULL || seq != q->query_seq) {
+    /* the caller gave up on this query and may have freed it */
+    GST_DEBUG_OBJECT (q, "skipping withdrawn query %u", seq);
+    g_mutex_unlock (&q->lock);
+    return;
+  }
+  query = q->query;
+  q->query_busy = TRUE;
+  g_mutex_unlock (&q->lock);
+
+  res = gst_pad_peer_query (q->srcpad, query);
+
+  g_mutex_lock (&q->lock);
+  q->query_busy = FALSE;
+  q->query_done = TRUE;
+  q->query_result = res;
+  g_cond_broadcast (&q->item_removed);
+  g_mutex_unlock (&q->lock);
+}
+
+static void
+gst_ring_queue_loop (gpointer user_data)
+{
+  GstRingQueue *q = GST_RING_QUEUE (user_data);
+  GstMiniObject *obj;
+  gpointer item;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  item = gst_ring_queue_pop (q);
+  if (item == NULL) {
+    GST_LOG_OBJECT (q, "flushing, pausing task");
+    gst_pad_pause_task (q->srcpad);
+    return;
+  }
+
+  if (RING_IS_TICKET (item)) {
+    gst_ring_queue_handle_query (q, RING_TICKET_SEQ (item));
+    return;
+  }
+
+  obj = RING_UNTAG (item);
+  if (GST_IS_BUFFER (obj)) {
+    ret = gst_pad_push (q->srcpad, GST_BUFFER_CAST (obj));
+  } else if (GST_IS_EVENT (obj)) {
+    GstEvent *event = GST_EVENT_CAST (obj);
+    gboolean eos = GST_EVENT_TYPE (event) == GST_EVENT_EOS;
+
+    gst_pad_push_event (q->srcpad, event);
+    if (eos)
+      ret = GST_FLOW_EOS;
+  }
+
+  if (G_LIKELY (ret == GST_FLOW_OK))
+    return;
+
+  /* a producer blocked on a full ring must see the result */
+  g_mutex_lock (&q->lock);
+  if (!q->flushing)
+    g_atomic_int_set (&q->srcresult, ret);
+  g_cond_broadcast (&q->item_removed);
+  g_mutex_unlock (&q->lock);
+
+  GST_DEBUG_OBJECT (q, "pausing task, reason %s", gst_flow_get_name (ret));
+  if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+    GST_ELEMENT_FLOW_ERROR (q, ret);
+    gst_pad_push_event (q->srcpad, gst_event_new_eos ());
+  }
+  gst_pad_pause_task (q->srcpad);
+}
+
+/* pad functions */
+
+static GstFlowReturn
+gst_ring_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstRingQueue *q = GST_RING_QUEUE (parent);
+  gpointer item = (gpointer) ((guintptr) buf | RING_TAG_BUFFER);
+  GstFlowReturn ret;
+
+  ret = g_atomic_int_get (&q->srcresult);
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    gst_buffer_unref (buf);
+    return ret;
+  }
+
+  /* fast path: room in the ring */
+  if (G_LIKELY (gst_ring_queue_put (q, item))) {
+    gst_ring_queue_wake (q, &q->consumer_waiting, &q->item_added);
+    return GST_FLOW_OK;
+  }
+
+  switch (q->ring_leaky) {
+    case GST_RING_QUEUE_LEAKY_DOWNSTREAM:
+      gst_ring_queue_drop_oldest (q);
+      if (gst_ring_queue_put (q, item)) {
+        gst_ring_queue_wake (q, &q->consumer_waiting, &q->item_added);
+        return GST_FLOW_OK;
+      }
+      /* the oldest item is an event, drop the new buffer instead */
+      /* fall through */
+    case GST_RING_QUEUE_LEAKY_UPSTREAM:
+      GST_LOG_OBJECT (q, "queue full, dropping buffer");
+      g_atomic_int_inc (&q->dropped);
+      gst_buffer_unref (buf);
+      return GST_FLOW_OK;
+    default:
+      break;
+  }
+
+  if (!gst_ring_queue_push (q, item)) {
+    gst_buffer_unref (buf);
+    return g_atomic_int_get (&q->srcresult);
+  }
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_ring_queue_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstRingQueue *q = GST_RING_QUEUE (parent);
+  gboolean ret;
+
+  GST_LOG_OBJECT (q, "Received %s event: %" GST_PTR_FORMAT,
+      GST_EVENT_TYPE_NAME (event), event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      ret = gst_pad_event_default (pad, parent, event);
+      gst_ring_queue_set_flushing (q, TRUE);
+      gst_pad_pause_task (q->srcpad);
+      return ret;
+    case GST_EVENT_FLUSH_STOP:
+      /* the task is paused, this thread is the only one touching the ring */
+      gst_ring_queue_clear (q);
+      gst_ring_queue_set_flushing (q, FALSE);
+      ret = gst_pad_event_default (pad, parent, event);
+      if (GST_PAD_MODE (q->srcpad) == GST_PAD_MODE_PUSH)
+        gst_pad_start_task (q->srcpad, gst_ring_queue_loop, q, NULL);
+      return ret;
+    case GST_EVENT_STREAM_START:
+    case GST_EVENT_SEGMENT:
+      /* a new stream after EOS restarts the task */
+      g_mutex_lock (&q->lock);
+      if (!q->flushing && q->srcresult == GST_FLOW_EOS) {
+        g_atomic_int_set (&q->srcresult, GST_FLOW_OK);
+        g_mutex_unlock (&q->lock);
+        gst_pad_start_task (q->srcpad, gst_ring_queue_loop, q, NULL);
+      } else {
+        g_mutex_unlock (&q->lock);
+      }
+      break;
+    default:
+      break;
+  }
+
+  if (!GST_EVENT_IS_SERIALIZED (event))
+    return gst_pad_event_default (pad, parent, event);
+
+  if (!gst_ring_queue_push (q, event)) {
+    GST_DEBUG_OBJECT (q, "dropping %s event, %s",
+        GST_EVENT_TYPE_NAME (event),
+        gst_flow_get_name (g_atomic_int_get (&q->srcresult)));
+    gst_event_unref (event);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_ring_queue_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstRingQueue *q = GST_RING_QUEUE (parent);
+  gpointer ticket;
+  gboolean res;
+
+  if (!GST_QUERY_IS_SERIALIZED (query))
+    return gst_pad_query_default (pad, parent, query);
+
+  /* serialized queries are answered by the task, after the data before it.
+   * After EOS or an error the task is not running, nobody would answer */
+  g_mutex_lock (&q->lock);
+  if (gst_ring_queue_stopped (q)) {
+    g_mutex_unlock (&q->lock);
+    GST_DEBUG_OBJECT (q, "not queueing %s query, %s",
+        GST_QUERY_TYPE_NAME (query),
+        gst_flow_get_name (g_atomic_int_get (&q->srcresult)));
+    return FALSE;
+  }
+  q->query_seq = (q->query_seq + 1) & (G_MAXUINT >> 2);
+  q->query = query;
+  q->query_done = FALSE;
+  ticket = RING_QUERY_TICKET (q->query_seq);
+  g_mutex_unlock (&q->lock);
+
+  res = gst_ring_queue_push (q, ticket);
+
+  g_mutex_lock (&q->lock);
+  while (res && !q->query_done && !(gst_ring_queue_stopped (q)
+          && !q->query_busy))
+    g_cond_wait (&q->item_removed, &q->lock);
+  res = res && q->query_done && q->query_result;
+  /* the ticket may still be queued when the task stopped before reaching
+   * it; withdraw the query so that a restarted task skips the ticket */
+  q->query = NULL;
+  g_mutex_unlock (&q->lock);
+
+  GST_LOG_OBJECT (q, "%s query answered: %d", GST_QUERY_TYPE_NAME (query),
+      res);
+  return res;
+}
+
+static gboolean
+gst_ring_queue_sink_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstRingQueue *q = GST_RING_QUEUE (parent);
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (!active) {
+    gst_ring_queue_set_flushing (q, TRUE);
+    /* wait for the chain function to return */
+    GST_PAD_STREAM_LOCK (pad);
+    GST_PAD_STREAM_UNLOCK (pad);
+    gst_pad_stop_task (q->srcpad);
+    gst_ring_queue_clear (q);
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_ring_queue_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstRingQueue *q = GST_RING_QUEUE (parent);
+  gboolean res;
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (active) {
+    gst_ring_queue_set_flushing (q, FALSE);
+    return gst_pad_start_task (pad, gst_ring_queue_loop, q, NULL);
+  }
+
+  gst_ring_queue_set_flushing (q, TRUE);
+  res = gst_pad_stop_task (pad);
+  gst_ring_queue_clear (q);
+  return res;
+}
+
+/* GstElement vmethod implementations */
+
+static GstStateChangeReturn
+gst_ring_queue_change_state (GstElement * element, GstStateChange transition)
+{
+  GstRingQueue *q = GST_RING_QUEUE (element);
+  GstStateChangeReturn ret;
+  guint capacity;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      /* pads are not active yet, nobody touches the ring */
+      GST_OBJECT_LOCK (q);
+      capacity = q->max_size_buffers;
+      q->ring_leaky = q->leaky;
+      GST_OBJECT_UNLOCK (q);
+
+      capacity = 1u << g_bit_storage (capacity - 1);
+      g_free (q->slots);
+      q->slots = g_new0 (gpointer, capacity);
+      q->mask = capacity - 1;
+      q->head = 0;
+      q->tail = 0;
+      g_atomic_int_set (&q->dropped, 0);
+      GST_DEBUG_OBJECT (q, "ring capacity %u", capacity);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* both pads are inactive and the ring was cleared */
+      g_free (q->slots);
+      q->slots = NULL;
+      q->mask = 0;
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
@@ -0,0 +1,111 @@
+/*
+ * GStreamer
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_RING_QUEUE_H__
+#define __GST_RING_QUEUE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* keeps producer and consumer indices on separate cache lines */
+#define GST_RING_QUEUE_CACHE_LINE 64
+
+typedef enum
+{
+  GST_RING_QUEUE_LEAKY_NO,
+  GST_RING_QUEUE_LEAKY_UPSTREAM,
+  GST_RING_QUEUE_LEAKY_DOWNSTREAM
+} GstRingQueueLeaky;
+
+#define GST_TYPE_RING_QUEUE (gst_ring_queue_get_type())
+G_DECLARE_FINAL_TYPE (GstRingQueue, gst_ring_queue,
+    GST, RING_QUEUE, GstElement)
+
+struct _GstRingQueue
+{
+  GstElement element;
+
+  GstPad *sinkpad, *srcpad;
+
+  /* single-producer/single-consumer ring of GstMiniObject pointers.
+   * head and tail are free running and only written by their owner:
+   * head by the src pad task, tail by the streaming thread. In
+   * leaky=downstream mode the producer may also advance head with a CAS. */
+  guint8 _pad0[GST_RING_QUEUE_CACHE_LINE];
+  guint head;
+  guint8 _pad1[GST_RING_QUEUE_CACHE_LINE - sizeof (guint)];
+  guint tail;
+  guint8 _pad2[GST_RING_QUEUE_CACHE_LINE - sizeof (guint)];
+  gpointer *slots;
+  guint mask;
+
+  /* slow path: only used when one side has to sleep */
+  GMutex lock;
+  GCond item_added;
+  GCond item_removed;
+  gint consumer_waiting;
+  gint producer_waiting;
+  gboolean flushing;            /* protected by lock, read atomically */
+
+  GstFlowReturn srcresult;      /* atomic */
+
+  /* serialized query handed to the task, protected by lock. The ring only
+   * holds a ticket for it, the query itself stays with the waiting thread */
+  GstQuery *query;
+  guint query_seq;
+  gboolean query_busy;
+  gboolean query_done;
+  gboolean query_result;
+
+  guint max_size_buffers;       /* capacity, rounded up to a power of two */
+  GstRingQueueLeaky leaky;      /* property, protected by the object lock */
+  GstRingQueueLeaky ring_leaky; /* copied from leaky when the ring is set up */
+  gint dropped;                 /* atomic */
+};
+
+GST_ELEMENT_REGISTER_DECLARE (ring_queue);
+
+G_END_DECLS
+
+#endif /* __GST_RING_QUEUE_H__ */
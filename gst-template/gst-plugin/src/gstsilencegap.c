@@ -0,0 +1,507 @@
+/* GStreamer silence to gap converter
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+
+/**
+ * SECTION:element-silencegap
+ *
+ * Detects speech by its energy and replaces the buffers in the silence
+ * between it with gaps, so encoders and analyzers downstream can skip
+ * them. A buffer becomes a gap when it starts after the silence has
+ * lasted the hangover and contains no speech window, so the pauses
+ * between words and the tail of every utterance are kept.
+ *
+ * With mode=event a silent buffer is replaced by a GAP event with its
+ * timestamp and duration. With mode=buffer, or when the buffer has no
+ * timestamp, it is replaced by a buffer of the same size flagged
+ * GST_BUFFER_FLAG_GAP whose memory is shared zeroes, so nothing is copied.
+ *
+ * When post-messages is TRUE element messages named "speech-start" and
+ * "speech-stop" are posted with these fields:
+ * <itemizedlist>
+ * <listitem><para>
+ * #GstClockTime
+ * <classname>&quot;timestamp&quot;</classname>,
+ * <classname>&quot;stream-time&quot;</classname>,
+ * <classname>&quot;running-time&quot;</classname>:
+ * the start of the first speech window, or the end of the last one
+ * </para></listitem>
+ * </itemizedlist>
+ * A stop is posted once the hangover has passed, so its timestamp lies
+ * the hangover before the audio that triggered it.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -m filesrc location=speech.wav ! wavparse ! audioconvert ! silencegap threshold=-45 hangover=300000000 ! audioconvert ! opusenc ! oggmux ! filesink location=speech.ogg
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstsilencegap.h"
+
+GST_DEBUG_CATEGORY_STATIC (silence_gap_debug);
+#define GST_CAT_DEFAULT silence_gap_debug
+
+enum
+{
+  PROP_0,
+  PROP_THRESHOLD,
+  PROP_HANGOVER,
+  PROP_MODE,
+  PROP_POST_MESSAGES
+};
+
+#define DEFAULT_THRESHOLD -50.0
+#define DEFAULT_HANGOVER (500 * GST_MSECOND)
+#define DEFAULT_MODE GST_SILENCE_GAP_MODE_EVENT
+#define DEFAULT_POST_MESSAGES TRUE
+
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE ("{ " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }") \
+    ", layout = (string) interleaved"
+
+G_DEFINE_TYPE (GstSilenceGap, gst_silence_gap, GST_TYPE_AUDIO_FILTER);
+
+GST_ELEMENT_REGISTER_DEFINE (silence_gap, "silencegap", GST_RANK_NONE,
+    GST_TYPE_SILENCE_GAP);
+
+#define GST_TYPE_SILENCE_GAP_MODE (gst_silence_gap_mode_get_type ())
+static GType
+gst_silence_gap_mode_get_type (void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode[] = {
+    {GST_SILENCE_GAP_MODE_EVENT, "Replace silence with GAP events", "event"},
+    {GST_SILENCE_GAP_MODE_BUFFER, "Replace silence with GAP flagged buffers",
+        "buffer"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static ("GstSilenceGapMode", mode);
+  return mode_type;
+}
+
+static void gst_silence_gap_finalize (GObject * object);
+static void gst_silence_gap_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_silence_gap_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
+
+static gboolean gst_silence_gap_setup (GstAudioFilter * filter,
+    const GstAudioInfo * info);
+static gboolean gst_silence_gap_stop (GstBaseTransform * base_transform);
+static gboolean gst_silence_gap_sink_event (GstBaseTransform *
+    base_transform, GstEvent * event);
+static GstFlowReturn gst_silence_gap_transform_ip (GstBaseTransform *
+    base_transform, GstBuffer * buf);
+static GstFlowReturn gst_silence_gap_generate_output (GstBaseTransform *
+    base_transform, GstBuffer ** outbuf);
+
+static void
+gst_silence_gap_class_init (GstSilenceGapClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstBaseTransformClass *btrans_class = (GstBaseTransformClass *) klass;
+  GstAudioFilterClass *audio_filter_class = (GstAudioFilterClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (silence_gap_debug, "silencegap", 0,
+      "Silence to gap converter");
+
+  gobject_class->finalize = gst_silence_gap_finalize;
+  gobject_class->set_property = gst_silence_gap_set_property;
+  gobject_class->get_property = gst_silence_gap_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_THRESHOLD,
+      g_param_spec_double ("threshold", "Threshold",
+          "RMS level over 10 ms in dBFS from which on audio is speech",
+          -90.0, 0.0, DEFAULT_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_HANGOVER,
+      g_param_spec_uint64 ("hangover", "Hangover",
+          "Silence after speech in nanoseconds before it counts as silence",
+          0, G_MAXUINT64, DEFAULT_HANGOVER,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode", "How silent buffers are replaced",
+          GST_TYPE_SILENCE_GAP_MODE, DEFAULT_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_POST_MESSAGES,
+      g_param_spec_boolean ("post-messages", "Post messages",
+          "Post speech-start and speech-stop element messages",
+          DEFAULT_POST_MESSAGES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  audio_filter_class->setup = GST_DEBUG_FUNCPTR (gst_silence_gap_setup);
+
+  btrans_class->stop = GST_DEBUG_FUNCPTR (gst_silence_gap_stop);
+  btrans_class->sink_event = GST_DEBUG_FUNCPTR (gst_silence_gap_sink_event);
+  btrans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_silence_gap_transform_ip);
+  btrans_class->generate_output =
+      GST_DEBUG_FUNCPTR (gst_silence_gap_generate_output);
+
+  gst_element_class_set_details_simple (element_class,
+      "Silence gap", "Filter/Analyzer/Audio",
+      "Detects speech and replaces the silence in between with gaps",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  caps = gst_caps_from_string (SUPPORTED_CAPS_STRING);
+  gst_audio_filter_class_add_pad_templates (audio_filter_class, caps);
+  gst_caps_unref (caps);
+}
+
+static void
+gst_silence_gap_init (GstSilenceGap * gap)
+{
+  gap->threshold = DEFAULT_THRESHOLD;
+  gap->hangover = DEFAULT_HANGOVER;
+  gap->mode = DEFAULT_MODE;
+  gap->post_messages = DEFAULT_POST_MESSAGES;
+
+  gap->vad = NULL;
+  gap->silence = NULL;
+  gap->gap_frames = 0;
+
+  /* speech is never written to, silence is replaced by new buffers */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (gap), TRUE);
+}
+
+static void
+gst_silence_gap_finalize (GObject * object)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (object);
+
+  gst_vad_free (gap->vad);
+  if (gap->silence)
+    gst_memory_unref (gap->silence);
+
+  G_OBJECT_CLASS (gst_silence_gap_parent_class)->finalize (object);
+}
+
+static void
+gst_silence_gap_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (object);
+
+  GST_OBJECT_LOCK (gap);
+  switch (prop_id) {
+    case PROP_THRESHOLD:
+      gap->threshold = g_value_get_double (value);
+      break;
+    case PROP_HANGOVER:
+      gap->hangover = g_value_get_uint64 (value);
+      break;
+    case PROP_MODE:
+      gap->mode = g_value_get_enum (value);
+      break;
+    case PROP_POST_MESSAGES:
+      gap->post_messages = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (gap);
+}
+
+static void
+gst_silence_gap_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (object);
+
+  GST_OBJECT_LOCK (gap);
+  switch (prop_id) {
+    case PROP_THRESHOLD:
+      g_value_set_double (value, gap->threshold);
+      break;
+    case PROP_HANGOVER:
+      g_value_set_uint64 (value, gap->hangover);
+      break;
+    case PROP_MODE:
+      g_value_set_enum (value, gap->mode);
+      break;
+    case PROP_POST_MESSAGES:
+      g_value_set_boolean (value, gap->post_messages);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (gap);
+}
+
+static gboolean
+gst_silence_gap_setup (GstAudioFilter * filter, const GstAudioInfo * info)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (filter);
+
+  GST_INFO_OBJECT (gap, "format %s, rate %d, %d channels",
+      GST_AUDIO_INFO_NAME (info), GST_AUDIO_INFO_RATE (info),
+      GST_AUDIO_INFO_CHANNELS (info));
+
+  gst_vad_free (gap->vad);
+  gap->vad = gst_vad_new (GST_AUDIO_INFO_FORMAT (info),
+      GST_AUDIO_INFO_RATE (info), GST_AUDIO_INFO_CHANNELS (info));
+
+  return gap->vad != NULL;
+}
+
+static gboolean
+gst_silence_gap_stop (GstBaseTransform * base_transform)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (base_transform);
+
+  gst_vad_free (gap->vad);
+  gap->vad = NULL;
+  if (gap->silence) {
+    gst_memory_unref (gap->silence);
+    gap->silence = NULL;
+  }
+  gap->gap_frames = 0;
+  return TRUE;
+}
+
+static gboolean
+gst_silence_gap_sink_event (GstBaseTransform * base_transform,
+    GstEvent * event)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (base_transform);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP && gap->vad)
+    gst_vad_reset (gap->vad);
+
+  return GST_BASE_TRANSFORM_CLASS (gst_silence_gap_parent_class)->sink_event
+      (base_transform, event);
+}
+
+/* time of a frame relative to pts, which can lie before it */
+static GstClockTime
+gst_silence_gap_frame_time (GstClockTime pts, gint64 frame, gint rate)
+{
+  GstClockTime offset;
+
+  if (frame >= 0)
+    return pts + gst_util_uint64_scale_int (frame, GST_SECOND, rate);
+
+  offset = gst_util_uint64_scale_int (-frame, GST_SECOND, rate);
+  return pts > offset ? pts - offset : 0;
+}
+
+static void
+gst_silence_gap_post (GstSilenceGap * gap, GstVadEvent event,
+    GstClockTime ts)
+{
+  GstSegment *segment = &GST_BASE_TRANSFORM (gap)->segment;
+  GstStructure *s;
+
+  GST_DEBUG_OBJECT (gap, "speech %s at %" GST_TIME_FORMAT,
+      event == GST_VAD_EVENT_SPEECH_START ? "start" : "stop",
+      GST_TIME_ARGS (ts));
+
+  s = gst_structure_new (event == GST_VAD_EVENT_SPEECH_START ?
+      "speech-start" : "speech-stop",
+      "timestamp", G_TYPE_UINT64, ts,
+      "stream-time", G_TYPE_UINT64,
+      gst_segment_to_stream_time (segment, GST_FORMAT_TIME, ts),
+      "running-time", G_TYPE_UINT64,
+      gst_segment_to_running_time (segment, GST_FORMAT_TIME, ts), NULL);
+
+  gst_element_post_message (GST_ELEMENT (gap),
+      gst_message_new_element (GST_OBJECT (gap), s));
+}
+
+/* the replacement of a silent buffer: a GAP event, pushed here in place
+ * of the buffer, or a gap buffer for the base class to push */
+static GstFlowReturn
+gst_silence_gap_replace (GstSilenceGap * gap, GstBuffer * buf,
+    GstSilenceGapMode mode, guint frames, GstBuffer ** outbuf)
+{
+  GstPad *srcpad = GST_BASE_TRANSFORM_SRC_PAD (gap);
+  gsize size = gst_buffer_get_size (buf);
+  GstBuffer *out;
+
+  if (mode == GST_SILENCE_GAP_MODE_EVENT && GST_BUFFER_PTS_IS_VALID (buf)) {
+    GstClockTime duration = GST_BUFFER_DURATION (buf);
+
+    if (!GST_CLOCK_TIME_IS_VALID (duration))
+      duration = gst_util_uint64_scale_int (frames, GST_SECOND,
+          GST_AUDIO_INFO_RATE (GST_AUDIO_FILTER_INFO (gap)));
+
+    *outbuf = NULL;
+    if (!gst_pad_push_event (srcpad, gst_event_new_gap (GST_BUFFER_PTS (buf),
+                duration)) && GST_PAD_IS_FLUSHING (srcpad))
+      return GST_FLOW_FLUSHING;
+    return GST_FLOW_OK;
+  }
+
+  /* zeroes are silence for both formats, grown only for bigger buffers */
+  if (gap->silence == NULL || gap->silence->size < size) {
+    GstMapInfo map;
+
+    if (gap->silence)
+      gst_memory_unref (gap->silence);
+    gap->silence = gst_allocator_alloc (NULL, size, NULL);
+    gst_memory_map (gap->silence, &map, GST_MAP_WRITE);
+    memset (map.data, 0, map.size);
+    gst_memory_unmap (gap->silence, &map);
+  }
+
+  out = gst_buffer_new ();
+  gst_buffer_copy_into (out, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_append_memory (out, gst_memory_share (gap->silence, 0, size));
+  GST_BUFFER_FLAG_SET (out, GST_BUFFER_FLAG_GAP);
+
+  *outbuf = out;
+  return GST_FLOW_OK;
+}
+
+/* analysis only, a silent buffer is replaced in generate_output */
+static GstFlowReturn
+gst_silence_gap_transform_ip (GstBaseTransform * base_transform,
+    GstBuffer * buf)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (base_transform);
+  GstAudioInfo *info = GST_AUDIO_FILTER_INFO (gap);
+  gint rate = GST_AUDIO_INFO_RATE (info);
+  guint bpf = GST_AUDIO_INFO_BPF (info);
+  gboolean post_messages, silent;
+  GstMapInfo map;
+  guint frames, done = 0;
+
+  if (gap->vad == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  GST_OBJECT_LOCK (gap);
+  gst_vad_set_threshold (gap->vad, gap->threshold);
+  gst_vad_set_hangover (gap->vad,
+      gst_util_uint64_scale_round (gap->hangover, rate, GST_SECOND));
+  post_messages = gap->post_messages;
+  GST_OBJECT_UNLOCK (gap);
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+
+  frames = map.size / bpf;
+  if (frames == 0) {
+    gst_buffer_unmap (buf, &map);
+    return GST_FLOW_OK;
+  }
+
+  /* only a buffer that starts in silence and never leaves it is a gap,
+   * speech stopping inside it keeps the buffer */
+  silent = !gst_vad_is_speech (gap->vad);
+  while (done < frames) {
+    GstVadEvent event;
+    gint64 event_frame;
+    guint n;
+
+    n = gst_vad_process (gap->vad, map.data + done * bpf, frames - done,
+        &event, &event_frame);
+
+    if (event == GST_VAD_EVENT_SPEECH_START)
+      silent = FALSE;
+    if (event != GST_VAD_EVENT_NONE && post_messages
+        && GST_BUFFER_PTS_IS_VALID (buf))
+      gst_silence_gap_post (gap, event,
+          gst_silence_gap_frame_time (GST_BUFFER_PTS (buf),
+              done + event_frame, rate));
+    done += n;
+  }
+
+  gst_buffer_unmap (buf, &map);
+
+  if (silent)
+    gap->gap_frames = frames;
+  return GST_FLOW_OK;
+}
+
+/* the base class hands out the analysed input buffer, silence is swapped
+ * for its replacement before it is pushed */
+static GstFlowReturn
+gst_silence_gap_generate_output (GstBaseTransform * base_transform,
+    GstBuffer ** outbuf)
+{
+  GstSilenceGap *gap = GST_SILENCE_GAP (base_transform);
+  GstSilenceGapMode mode;
+  GstFlowReturn ret;
+  GstBuffer *buf;
+  guint frames;
+
+  gap->gap_frames = 0;
+  ret = GST_BASE_TRANSFORM_CLASS (gst_silence_gap_parent_class)->
+      generate_output (base_transform, outbuf);
+  frames = gap->gap_frames;
+  gap->gap_frames = 0;
+  if (ret != GST_FLOW_OK || *outbuf == NULL || frames == 0)
+    return ret;
+
+  GST_OBJECT_LOCK (gap);
+  mode = gap->mode;
+  GST_OBJECT_UNLOCK (gap);
+
+  GST_LOG_OBJECT (gap, "replacing %u silent frames", frames);
+  buf = *outbuf;
+  ret = gst_silence_gap_replace (gap, buf, mode, frames, outbuf);
+  gst_buffer_unref (buf);
+  return ret;
+}
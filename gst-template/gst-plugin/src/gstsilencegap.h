@@ -0,0 +1,86 @@
+/* GStreamer silence to gap converter
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_SILENCE_GAP_H__
+#define __GST_SILENCE_GAP_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/audio/gstaudiofilter.h>
+
+#include "gstvad.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_SILENCE_GAP_MODE_EVENT,
+  GST_SILENCE_GAP_MODE_BUFFER
+} GstSilenceGapMode;
+
+#define GST_TYPE_SILENCE_GAP (gst_silence_gap_get_type())
+G_DECLARE_FINAL_TYPE (GstSilenceGap, gst_silence_gap,
+    GST, SILENCE_GAP, GstAudioFilter)
+
+struct _GstSilenceGap
+{
+  GstAudioFilter audiofilter;
+
+  /* properties, protected by the object lock */
+  gdouble threshold;
+  GstClockTime hangover;
+  GstSilenceGapMode mode;
+  gboolean post_messages;
+
+  /* streaming thread */
+  GstVad *vad;
+  GstMemory *silence;           /* zeroes shared by the gap buffers */
+  guint gap_frames;             /* the last analysed buffer is silent */
+};
+
+GST_ELEMENT_REGISTER_DECLARE (silence_gap);
+
+G_END_DECLS
+
+#endif /* __GST_SILENCE_GAP_H__ */
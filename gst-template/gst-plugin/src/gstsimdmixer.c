@@ -0,0 +1,291 @@
+/* GStreamer audio mixer
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/**
+ * SECTION:element-simdmixer
+ *
+ * Mixes any number of S16 or F32 inputs into one output, built on
+ * #GstAudioAggregator. The inputs are aligned by their timestamps, missing
+ * input is silence, and inputs in another format or channel layout are
+ * converted to the output format on their pad.
+ *
+ * Every sink pad has a volume and a mute property. Each input is added
+ * into the output with one pass of a SIMD accumulate kernel (AVX2, SSE2
+ * or scalar, picked at runtime), S16 saturates. Muted pads, a volume of
+ * 0 and GAP buffers or events skip the input entirely, and when nothing
+ * was added the output buffer goes out flagged as GAP.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -v simdmixer name=mix sink_1::volume=0.5 ! audioconvert ! autoaudiosink audiotestsrc freq=440 ! mix. audiotestsrc freq=660 ! mix.
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsimdmixer.h"
+
+GST_DEBUG_CATEGORY_STATIC (simd_mixer_debug);
+#define GST_CAT_DEFAULT simd_mixer_debug
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_VOLUME,
+  PROP_PAD_MUTE
+};
+
+#define DEFAULT_PAD_VOLUME 1.0
+#define DEFAULT_PAD_MUTE FALSE
+
+/* the same formats as the audio filter elements, interleaved only since
+ * every input is added as one run of samples */
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE ("{ " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }") \
+    ", layout = (string) interleaved"
+
+static GstStaticPadTemplate gst_simd_mixer_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SUPPORTED_CAPS_STRING));
+
+static GstStaticPadTemplate gst_simd_mixer_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (SUPPORTED_CAPS_STRING));
+
+G_DEFINE_TYPE (GstSimdMixerPad, gst_simd_mixer_pad,
+    GST_TYPE_AUDIO_AGGREGATOR_CONVERT_PAD);
+
+G_DEFINE_TYPE (GstSimdMixer, gst_simd_mixer, GST_TYPE_AUDIO_AGGREGATOR);
+
+GST_ELEMENT_REGISTER_DEFINE (simd_mixer, "simdmixer", GST_RANK_NONE,
+    GST_TYPE_SIMD_MIXER);
+
+static void
+gst_simd_mixer_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSimdMixerPad *pad = GST_SIMD_MIXER_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_VOLUME:
+      pad->volume = g_value_get_double (value);
+      break;
+    case PROP_PAD_MUTE:
+      pad->mute = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_simd_mixer_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSimdMixerPad *pad = GST_SIMD_MIXER_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_VOLUME:
+      g_value_set_double (value, pad->volume);
+      break;
+    case PROP_PAD_MUTE:
+      g_value_set_boolean (value, pad->mute);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_simd_mixer_pad_class_init (GstSimdMixerPadClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->set_property = gst_simd_mixer_pad_set_property;
+  gobject_class->get_property = gst_simd_mixer_pad_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_PAD_VOLUME,
+      g_param_spec_double ("volume", "Volume", "Linear volume of this input",
+          0.0, 10.0, DEFAULT_PAD_VOLUME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, PROP_PAD_MUTE,
+      g_param_spec_boolean ("mute", "Mute", "Leave this input out of the mix",
+          DEFAULT_PAD_MUTE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+}
+
+static void
+gst_simd_mixer_pad_init (GstSimdMixerPad * pad)
+{
+  pad->volume = DEFAULT_PAD_VOLUME;
+  pad->mute = DEFAULT_PAD_MUTE;
+}
+
+static gboolean gst_simd_mixer_negotiated_src_caps (GstAggregator * agg,
+    GstCaps * caps);
+static gboolean gst_simd_mixer_aggregate_one_buffer (GstAudioAggregator *
+    aagg, GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf,
+    guint in_offset, GstBuffer * outbuf, guint out_offset, guint num_frames);
+
+static void
+gst_simd_mixer_class_init (GstSimdMixerClass * klass)
+{
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstAggregatorClass *agg_class = (GstAggregatorClass *) klass;
+  GstAudioAggregatorClass *aagg_class = (GstAudioAggregatorClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (simd_mixer_debug, "simdmixer", 0,
+      "SIMD audio mixer");
+
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &gst_simd_mixer_src_template, GST_TYPE_AUDIO_AGGREGATOR_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &gst_simd_mixer_sink_template, GST_TYPE_SIMD_MIXER_PAD);
+
+  agg_class->negotiated_src_caps =
+      GST_DEBUG_FUNCPTR (gst_simd_mixer_negotiated_src_caps);
+  aagg_class->aggregate_one_buffer =
+      GST_DEBUG_FUNCPTR (gst_simd_mixer_aggregate_one_buffer);
+
+  gst_element_class_set_details_simple (element_class,
+      "SIMD audio mixer", "Generic/Audio",
+      "Mixes any number of audio inputs with per input volume",
+      "AUTHOR_NAME AUTHOR_EMAIL");
+
+  gst_type_mark_as_plugin_api (GST_TYPE_SIMD_MIXER_PAD, 0);
+}
+
+static void
+gst_simd_mixer_init (GstSimdMixer * mixer)
+{
+  mixer->kernels = gst_mix_kernels_get (GST_MIX_ISA_AUTO);
+  mixer->accumulate = NULL;
+}
+
+/* pick the kernel once for the output format */
+static gboolean
+gst_simd_mixer_negotiated_src_caps (GstAggregator * agg, GstCaps * caps)
+{
+  GstSimdMixer *mixer = GST_SIMD_MIXER (agg);
+  GstAudioInfo info;
+
+  if (!gst_audio_info_from_caps (&info, caps))
+    return FALSE;
+
+  mixer->accumulate = gst_mix_kernels_accumulate (mixer->kernels,
+      GST_AUDIO_INFO_FORMAT (&info));
+  if (mixer->accumulate == NULL) {
+    GST_ERROR_OBJECT (mixer, "unsupported format %s",
+        GST_AUDIO_INFO_NAME (&info));
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (mixer, "format %s, rate %d, %d channels, %s kernels",
+      GST_AUDIO_INFO_NAME (&info), GST_AUDIO_INFO_RATE (&info),
+      GST_AUDIO_INFO_CHANNELS (&info), mixer->kernels->name);
+
+  return GST_AGGREGATOR_CLASS (gst_simd_mixer_parent_class)->
+      negotiated_src_caps (agg, caps);
+}
+
+/* Adds num_frames of one input into the output. The base class has
+ * already converted inbuf to the output format and skips GAP buffers;
+ * returning FALSE leaves the output untouched, so a cycle with only
+ * silent inputs stays a GAP buffer */
+static gboolean
+gst_simd_mixer_aggregate_one_buffer (GstAudioAggregator * aagg,
+    GstAudioAggregatorPad * aaggpad, GstBuffer * inbuf, guint in_offset,
+    GstBuffer * outbuf, guint out_offset, guint num_frames)
+{
+  GstSimdMixer *mixer = GST_SIMD_MIXER (aagg);
+  GstSimdMixerPad *pad = GST_SIMD_MIXER_PAD (aaggpad);
+  GstAudioAggregatorPad *srcpad =
+      GST_AUDIO_AGGREGATOR_PAD (GST_AGGREGATOR_SRC_PAD (aagg));
+  guint bpf = GST_AUDIO_INFO_BPF (&srcpad->info);
+  GstMapInfo inmap, outmap;
+  gdouble volume;
+  gboolean mute;
+
+  GST_OBJECT_LOCK (pad);
+  volume = pad->volume;
+  mute = pad->mute;
+  GST_OBJECT_UNLOCK (pad);
+
+  if (mute || volume == 0.0) {
+    GST_LOG_OBJECT (pad, "muted, skipping %u frames", num_frames);
+    return FALSE;
+  }
+
+  if (!gst_buffer_map (outbuf, &outmap, GST_MAP_READWRITE))
+    return FALSE;
+  if (!gst_buffer_map (inbuf, &inmap, GST_MAP_READ)) {
+    gst_buffer_unmap (outbuf, &outmap);
+    return FALSE;
+  }
+
+  mixer->accumulate (outmap.data + out_offset * bpf,
+      inmap.data + in_offset * bpf,
+      num_frames * GST_AUDIO_INFO_CHANNELS (&srcpad->info), (gfloat) volume);
+
+  gst_buffer_unmap (inbuf, &inmap);
+  gst_buffer_unmap (outbuf, &outmap);
+  return TRUE;
+}
@@ -0,0 +1,110 @@
+/* GStreamer audio mixer
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_SIMD_MIXER_H__
+#define __GST_SIMD_MIXER_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/audio/gstaudioaggregator.h>
+
+#include "gstmixkernels.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_SIMD_MIXER_PAD (gst_simd_mixer_pad_get_type())
+#define GST_SIMD_MIXER_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_SIMD_MIXER_PAD,GstSimdMixerPad))
+#define GST_IS_SIMD_MIXER_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_SIMD_MIXER_PAD))
+
+typedef struct _GstSimdMixerPad GstSimdMixerPad;
+typedef struct _GstSimdMixerPadClass GstSimdMixerPadClass;
+
+struct _GstSimdMixerPad
+{
+  GstAudioAggregatorConvertPad parent;
+
+  /* properties, protected by the object lock */
+  gdouble volume;
+  gboolean mute;
+};
+
+struct _GstSimdMixerPadClass
+{
+  GstAudioAggregatorConvertPadClass parent_class;
+};
+
+GType gst_simd_mixer_pad_get_type (void);
+
+#define GST_TYPE_SIMD_MIXER (gst_simd_mixer_get_type())
+#define GST_SIMD_MIXER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_SIMD_MIXER,GstSimdMixer))
+#define GST_IS_SIMD_MIXER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_SIMD_MIXER))
+
+typedef struct _GstSimdMixer GstSimdMixer;
+typedef struct _GstSimdMixerClass GstSimdMixerClass;
+
+struct _GstSimdMixer
+{
+  GstAudioAggregator parent;
+
+  /* picked when the output caps are negotiated */
+  const GstMixKernels *kernels;
+  GstMixAccumulateFunc accumulate;
+};
+
+struct _GstSimdMixerClass
+{
+  GstAudioAggregatorClass parent_class;
+};
+
+GType gst_simd_mixer_get_type (void);
+
+GST_ELEMENT_REGISTER_DECLARE (simd_mixer);
+
+G_END_DECLS
+
+#endif /* __GST_SIMD_MIXER_H__ */
@@ -20,14 +20,23 @@
  */
 
 /**
- * SECTION:element-plugin
+ * SECTION:element-transform_template
  *
- * FIXME:Describe plugin here.
+ * Applies a controllable gain to F32 audio.
+ *
+ * With control-interval=0 the controller is synced once per buffer, so
+ * automation moves in buffer sized steps. With a non-zero control-interval
+ * the gain curve is sampled at that rate with gst_object_get_value_array(),
+ * GST_TRANSFORM_TEMPLATE_CONTROL_POINTS points at a time, and the kernel ramps
+ * linearly between the points sample by sample. The controller, and its
+ * object lock, is then only visited once per block of control points
+ * instead of once per buffer.
  *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
- * gst-launch -v -m fakesrc ! plugin ! fakesink silent=TRUE
+ * gst-launch -v -m audiotestsrc ! audioconvert ! transform_template gain=0.5 \
+ *     control-interval=5000000 ! fakesink silent=TRUE
  * ]|
  * </refsect2>
  */
@@ -42,8 +51,8 @@
 
 #include "gsttransform.h"
 
-GST_DEBUG_CATEGORY_STATIC (gst_plugin_template_debug);
-#define GST_CAT_DEFAULT gst_plugin_template_debug
+GST_DEBUG_CATEGORY_STATIC (gst_transform_template_debug);
+#define GST_CAT_DEFAULT gst_transform_template_debug
 
 /* Filter signals and args */
 enum
@@ -56,42 +65,77 @@ enum
 {
   PROP_0,
   PROP_SILENT,
+  PROP_GAIN,
+  PROP_CONTROL_INTERVAL,
+  PROP_ISA,
 };
 
+#define DEFAULT_GAIN 1.0
+#define DEFAULT_CONTROL_INTERVAL 0
+#define DEFAULT_ISA GST_PLUGIN_TEMPLATE_ISA_AUTO
+
+#define GST_TYPE_TRANSFORM_TEMPLATE_ISA (gst_transform_template_isa_get_type ())
+static GType
+gst_transform_template_isa_get_type (void)
+{
+  static GType isa_type = 0;
+  static const GEnumValue isa[] = {
+    {GST_PLUGIN_TEMPLATE_ISA_AUTO, "Best level supported by the CPU", "auto"},
+    {GST_PLUGIN_TEMPLATE_ISA_SCALAR, "Plain C", "scalar"},
+    {GST_PLUGIN_TEMPLATE_ISA_SSE2, "SSE2", "sse2"},
+    {GST_PLUGIN_TEMPLATE_ISA_AVX2, "AVX2", "avx2"},
+    {GST_PLUGIN_TEMPLATE_ISA_AVX512, "AVX-512", "avx512"},
+    {0, NULL, NULL},
+  };
+
+  if (!isa_type)
+    isa_type = g_enum_register_static ("GstTransformTemplateIsa", isa);
+  return isa_type;
+}
+
 /* the capabilities of the inputs and outputs.
- *
- * FIXME:describe the real formats here.
  */
+#define SUPPORTED_CAPS_STRING \
+    GST_AUDIO_CAPS_MAKE (GST_AUDIO_NE (F32)) ", layout = (string) interleaved"
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("ANY")
+    GST_STATIC_CAPS (SUPPORTED_CAPS_STRING)
     );
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("ANY")
+    GST_STATIC_CAPS (SUPPORTED_CAPS_STRING)
     );
 
-#define gst_plugin_template_parent_class parent_class
-G_DEFINE_TYPE (GstPluginTemplate, gst_plugin_template, GST_TYPE_BASE_TRANSFORM);
-GST_ELEMENT_REGISTER_DEFINE (plugin_template, "plugin_template", GST_RANK_NONE,
-    GST_TYPE_PLUGIN_TEMPLATE);
+#define gst_transform_template_parent_class parent_class
+G_DEFINE_TYPE (GstTransformTemplate, gst_transform_template,
+    GST_TYPE_BASE_TRANSFORM);
+GST_ELEMENT_REGISTER_DEFINE (transform_template, "transform_template",
+    GST_RANK_NONE, GST_TYPE_TRANSFORM_TEMPLATE);
 
-static void gst_plugin_template_set_property (GObject * object,
+static void gst_transform_template_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
-static void gst_plugin_template_get_property (GObject * object,
+static void gst_transform_template_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
 
-static GstFlowReturn gst_plugin_template_transform_ip (GstBaseTransform *
+static gboolean gst_transform_template_start (GstBaseTransform * base);
+static void gst_transform_template_update_passthrough (GstTransformTemplate *
+    filter);
+static gboolean gst_transform_template_set_caps (GstBaseTransform * base,
+    GstCaps * incaps, GstCaps * outcaps);
+static void gst_transform_template_before_transform (GstBaseTransform * base,
+    GstBuffer * buf);
+static GstFlowReturn gst_transform_template_transform_ip (GstBaseTransform *
     base, GstBuffer * outbuf);
 
 /* GObject vmethod implementations */
 
 /* initialize the plugin's class */
 static void
-gst_plugin_template_class_init (GstPluginTemplateClass * klass)
+gst_transform_template_class_init (GstTransformTemplateClass * klass)
 {
   GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
@@ -99,15 +143,36 @@ gst_plugin_template_class_init (GstPluginTemplateClass * klass)
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
 
-  gobject_class->set_property = gst_plugin_template_set_property;
-  gobject_class->get_property = gst_plugin_template_get_property;
+  gobject_class->set_property = gst_transform_template_set_property;
+  gobject_class->get_property = gst_transform_template_get_property;
 
   g_object_class_install_property (gobject_class, PROP_SILENT,
       g_param_spec_boolean ("silent", "Silent", "Produce verbose output ?",
           FALSE, G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE));
 
+  g_object_class_install_property (gobject_class, PROP_GAIN,
+      g_param_spec_double ("gain", "Gain", "Linear gain applied to samples",
+          0.0, 10.0, DEFAULT_GAIN,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CONTROL_INTERVAL,
+      g_param_spec_uint64 ("control-interval", "Control interval",
+          "Distance between controller samples in ns, the gain is ramped "
+          "between them. 0 syncs the controller once per buffer",
+          0, GST_SECOND, DEFAULT_CONTROL_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ISA,
+      g_param_spec_enum ("isa", "ISA",
+          "Instruction set level of the kernels, picked when the element "
+          "starts. Levels the CPU lacks fall back to the best supported one",
+          GST_TYPE_TRANSFORM_TEMPLATE_ISA, DEFAULT_ISA,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   gst_element_class_set_details_simple (gstelement_class,
-      "Plugin",
+      "TransformTemplate",
       "Generic/Filter",
       "FIXME:Generic Template Filter", "AUTHOR_NAME AUTHOR_EMAIL");
 
@@ -116,36 +181,67 @@ gst_plugin_template_class_init (GstPluginTemplateClass * klass)
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&sink_template));
 
+  GST_BASE_TRANSFORM_CLASS (klass)->start =
+      GST_DEBUG_FUNCPTR (gst_transform_template_start);
+  GST_BASE_TRANSFORM_CLASS (klass)->set_caps =
+      GST_DEBUG_FUNCPTR (gst_transform_template_set_caps);
+  GST_BASE_TRANSFORM_CLASS (klass)->before_transform =
+      GST_DEBUG_FUNCPTR (gst_transform_template_before_transform);
   GST_BASE_TRANSFORM_CLASS (klass)->transform_ip =
-      GST_DEBUG_FUNCPTR (gst_plugin_template_transform_ip);
+      GST_DEBUG_FUNCPTR (gst_transform_template_transform_ip);
+  /* passthrough means there is nothing to do, skip transform_ip entirely */
+  GST_BASE_TRANSFORM_CLASS (klass)->transform_ip_on_passthrough = FALSE;
 
   /* debug category for fltering log messages
    *
    * FIXME:exchange the string 'Template plugin' with your description
    */
-  GST_DEBUG_CATEGORY_INIT (gst_plugin_template_debug, "plugin", 0,
-      "Template plugin");
+  GST_DEBUG_CATEGORY_INIT (gst_transform_template_debug, "transform_template",
+      0, "Template plugin");
 }
 
 /* initialize the new element
  * initialize instance structure
  */
 static void
-gst_plugin_template_init (GstPluginTemplate * filter)
+gst_transform_template_init (GstTransformTemplate * filter)
 {
   filter->silent = FALSE;
+  filter->gain = DEFAULT_GAIN;
+  filter->control_interval = DEFAULT_CONTROL_INTERVAL;
+  filter->isa = DEFAULT_ISA;
+  filter->kernels =
+      gst_plugin_template_kernels_get (GST_PLUGIN_TEMPLATE_ISA_SCALAR);
+  gst_audio_info_init (&filter->info);
+  filter->ctrl_start = GST_CLOCK_TIME_NONE;
+  filter->ctrl_interval = 0;
+  filter->ctrl_controlled = FALSE;
+  filter->last_gain = DEFAULT_GAIN;
+
+  gst_base_transform_set_in_place (GST_BASE_TRANSFORM (filter), TRUE);
+  gst_transform_template_update_passthrough (filter);
 }
 
 static void
-gst_plugin_template_set_property (GObject * object, guint prop_id,
+gst_transform_template_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
-  GstPluginTemplate *filter = GST_PLUGIN_TEMPLATE (object);
+  GstTransformTemplate *filter = GST_TRANSFORM_TEMPLATE (object);
 
   switch (prop_id) {
     case PROP_SILENT:
       filter->silent = g_value_get_boolean (value);
       break;
+    case PROP_GAIN:
+      filter->gain = g_value_get_double (value);
+      gst_transform_template_update_passthrough (filter);
+      break;
+    case PROP_CONTROL_INTERVAL:
+      filter->control_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_ISA:
+      filter->isa = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -153,15 +249,24 @@ gst_plugin_template_set_property (GObject * object, guint prop_id,
 }
 
 static void
-gst_plugin_template_get_property (GObject * object, guint prop_id,
+gst_transform_template_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
-  GstPluginTemplate *filter = GST_PLUGIN_TEMPLATE (object);
+  GstTransformTemplate *filter = GST_TRANSFORM_TEMPLATE (object);
 
   switch (prop_id) {
     case PROP_SILENT:
       g_value_set_boolean (value, filter->silent);
       break;
+    case PROP_GAIN:
+      g_value_set_double (value, filter->gain);
+      break;
+    case PROP_CONTROL_INTERVAL:
+      g_value_set_uint64 (value, filter->control_interval);
+      break;
+    case PROP_ISA:
+      g_value_set_enum (value, filter->isa);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -170,21 +275,207 @@ gst_plugin_template_get_property (GObject * object, guint prop_id,
 
 /* GstBaseTransform vmethod implementations */
 
+static gboolean
+gst_transform_template_start (GstBaseTransform * base)
+{
+  GstTransformTemplate *filter = GST_TRANSFORM_TEMPLATE (base);
+  const GstPluginTemplateKernels *kernels;
+
+  /* pick the kernels once, the processing functions never check the CPU */
+  kernels = gst_plugin_template_kernels_get (filter->isa);
+  if (kernels == NULL) {
+    GST_WARNING_OBJECT (filter, "ISA level %d not supported, using the best "
+        "available", filter->isa);
+    kernels = gst_plugin_template_kernels_get (GST_PLUGIN_TEMPLATE_ISA_AUTO);
+  }
+  filter->kernels = kernels;
+  GST_INFO_OBJECT (filter, "using %s kernels", kernels->name);
+
+  /* force a refill on the first buffer */
+  filter->ctrl_start = GST_CLOCK_TIME_NONE;
+  filter->ctrl_interval = 0;
+  filter->last_gain = filter->gain;
+  return TRUE;
+}
+
+static gboolean
+gst_transform_template_set_caps (GstBaseTransform * base, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstTransformTemplate *filter = GST_TRANSFORM_TEMPLATE (base);
+
+  if (!gst_audio_info_from_caps (&filter->info, incaps)) {
+    GST_ERROR_OBJECT (filter, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* the element is a no-op while the gain is 1.0, nothing is controlled and
+ * no ramp towards a new gain is pending. BaseTransform then pushes buffers
+ * through without mapping them or making them writable */
+static void
+gst_transform_template_update_passthrough (GstTransformTemplate * filter)
+{
+  GstBaseTransform *base = GST_BASE_TRANSFORM (filter);
+  gboolean passthrough;
+
+  passthrough = !filter->ctrl_controlled && filter->gain == 1.0
+      && filter->last_gain == 1.0;
+
+  if (passthrough == gst_base_transform_is_passthrough (base))
+    return;
+
+  GST_DEBUG_OBJECT (filter, "switching to %s",
+      passthrough ? "passthrough" : "in-place processing");
+  if (!passthrough)
+    gst_base_transform_set_in_place (base, TRUE);
+  gst_base_transform_set_passthrough (base, passthrough);
+}
+
+/* make sure the cached control points cover ts. Returns FALSE when gain is
+ * not controlled, a binding added later is picked up at the next refill */
+static gboolean
+gst_transform_template_control_fill (GstTransformTemplate * filter,
+    GstClockTime ts, GstClockTime interval)
+{
+  if (filter->ctrl_interval == interval
+      && GST_CLOCK_TIME_IS_VALID (filter->ctrl_start)
+      && ts >= filter->ctrl_start
+      && ts - filter->ctrl_start <
+      GST_TRANSFORM_TEMPLATE_CONTROL_POINTS * interval)
+    return filter->ctrl_controlled;
+
+  filter->ctrl_start = ts;
+  filter->ctrl_interval = interval;
+  /* one point more than the window so the last segment has an end value */
+  filter->ctrl_controlled =
+      gst_object_get_value_array (GST_OBJECT (filter), "gain", ts, interval,
+      GST_TRANSFORM_TEMPLATE_CONTROL_POINTS + 1, filter->ctrl_values);
+
+  GST_LOG_OBJECT (filter, "refilled control points at %" GST_TIME_FORMAT
+      ", controlled %d", GST_TIME_ARGS (ts), filter->ctrl_controlled);
+  return filter->ctrl_controlled;
+}
+
+/* apply the gain property. A changed value is ramped to over the buffer so
+ * leaving passthrough, or changing the gain, does not click */
+static void
+gst_transform_template_process_static (GstTransformTemplate * filter,
+    gfloat * data, guint frames)
+{
+  guint channels = GST_AUDIO_INFO_CHANNELS (&filter->info);
+  gdouble gain = filter->gain;
+
+  if (frames == 0)
+    return;
+
+  if (filter->last_gain != gain) {
+    filter->kernels->gain_ramp (data, channels, frames, filter->last_gain,
+        (gain - filter->last_gain) / frames);
+    filter->last_gain = gain;
+  } else {
+    filter->kernels->gain_ramp (data, channels, frames, gain, 0.0);
+  }
+}
+
+/* apply the gain curve to frames starting at stream time ts, ramping
+ * between the control points */
+static void
+gst_transform_template_process_controlled (GstTransformTemplate * filter,
+    gfloat * data, guint frames, GstClockTime ts, GstClockTime interval)
+{
+  guint channels = GST_AUDIO_INFO_CHANNELS (&filter->info);
+  gint rate = GST_AUDIO_INFO_RATE (&filter->info);
+
+  while (frames > 0) {
+    GstClockTime offset, seg_start;
+    gdouble v0, v1, gain, step;
+    guint k, n;
+
+    if (!gst_transform_template_control_fill (filter, ts, interval)) {
+      gst_transform_template_process_static (filter, data, frames);
+      return;
+    }
+
+    offset = ts - filter->ctrl_start;
+    k = offset / interval;
+    seg_start = k * interval;
+    v0 = filter->ctrl_values[k];
+    v1 = filter->ctrl_values[k + 1];
+
+    /* frames up to the next control point, at least one */
+    n = gst_util_uint64_scale_int_ceil (seg_start + interval - offset, rate,
+        GST_SECOND);
+    n = CLAMP (n, 1, frames);
+
+    step = (v1 - v0) / interval;
+    gain = v0 + step * (offset - seg_start);
+    filter->kernels->gain_ramp (data, channels, n, gain,
+        step * GST_SECOND / rate);
+    filter->last_gain = gain + step * GST_SECOND / rate * (n - 1);
+
+    data += n * channels;
+    frames -= n;
+    ts += gst_util_uint64_scale_int (n, GST_SECOND, rate);
+  }
+}
+
+/* sync the controller and decide whether this buffer needs processing at
+ * all, before BaseTransform looks at the passthrough flag */
+static void
+gst_transform_template_before_transform (GstBaseTransform * base,
+    GstBuffer * buf)
+{
+  GstTransformTemplate *filter = GST_TRANSFORM_TEMPLATE (base);
+  GstClockTime interval = filter->control_interval;
+  GstClockTime ts;
+
+  ts = gst_segment_to_stream_time (&base->segment, GST_FORMAT_TIME,
+      GST_BUFFER_TIMESTAMP (buf));
+
+  if (interval == 0) {
+    if (GST_CLOCK_TIME_IS_VALID (ts))
+      gst_object_sync_values (GST_OBJECT (filter), ts);
+    filter->ctrl_controlled =
+        gst_object_has_active_control_bindings (GST_OBJECT (filter));
+  } else if (GST_CLOCK_TIME_IS_VALID (ts)) {
+    /* only visits the controller when ts leaves the cached window */
+    gst_transform_template_control_fill (filter, ts, interval);
+  }
+
+  gst_transform_template_update_passthrough (filter);
+}
+
 /* this function does the actual processing
  */
 static GstFlowReturn
-gst_plugin_template_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
+gst_transform_template_transform_ip (GstBaseTransform * base,
+    GstBuffer * outbuf)
 {
-  GstPluginTemplate *filter = GST_PLUGIN_TEMPLATE (base);
+  GstTransformTemplate *filter = GST_TRANSFORM_TEMPLATE (base);
+  GstClockTime interval = filter->control_interval;
+  GstClockTime ts;
+  GstMapInfo map;
+  guint frames;
 
-  if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_TIMESTAMP (outbuf)))
-    gst_object_sync_values (GST_OBJECT (filter), GST_BUFFER_TIMESTAMP (outbuf));
+  ts = gst_segment_to_stream_time (&base->segment, GST_FORMAT_TIME,
+      GST_BUFFER_TIMESTAMP (outbuf));
 
   if (filter->silent == FALSE)
     g_print ("I'm plugged, therefore I'm in.\n");
 
-  /* FIXME: do something interesting here.  This simply copies the source
-   * to the destination. */
+  if (!gst_buffer_map (outbuf, &map, GST_MAP_READWRITE))
+    return GST_FLOW_ERROR;
+
+  frames = map.size / GST_AUDIO_INFO_BPF (&filter->info);
+  if (interval > 0 && GST_CLOCK_TIME_IS_VALID (ts))
+    gst_transform_template_process_controlled (filter, (gfloat *) map.data,
+        frames, ts, interval);
+  else
+    gst_transform_template_process_static (filter, (gfloat *) map.data, frames);
+
+  gst_buffer_unmap (outbuf, &map);
 
   return GST_FLOW_OK;
 }
@@ -197,7 +488,7 @@ gst_plugin_template_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
-  return GST_ELEMENT_REGISTER (plugin_template, plugin);
+  return GST_ELEMENT_REGISTER (transform_template, plugin);
 }
 
 /* gstreamer looks for this structure to register plugins
@@ -206,7 +497,7 @@ plugin_init (GstPlugin * plugin)
  */
 GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
     GST_VERSION_MINOR,
-    plugin,
-    "plugin_template",
+    transformtemplate,
+    "transform_template",
     plugin_init,
     PACKAGE_VERSION, GST_LICENSE, GST_PACKAGE_NAME, GST_PACKAGE_ORIGIN)
@@ -20,24 +20,49 @@
  * Boston, MA 02111-1307, USA.
  */
  
-#ifndef __GST_PLUGIN_TEMPLATE_H__
-#define __GST_PLUGIN_TEMPLATE_H__
+#ifndef __GST_TRANSFORM_TEMPLATE_H__
+#define __GST_TRANSFORM_TEMPLATE_H__
 
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
+
+#include "gsttransformkernels.h"
 
 G_BEGIN_DECLS
 
-#define GST_TYPE_PLUGIN_TEMPLATE (gst_plugin_template_get_type())
-G_DECLARE_FINAL_TYPE (GstPluginTemplate, gst_plugin_template,
-    GST, PLUGIN_TEMPLATE, GstBaseTransform)
+#define GST_TYPE_TRANSFORM_TEMPLATE (gst_transform_template_get_type())
+G_DECLARE_FINAL_TYPE (GstTransformTemplate, gst_transform_template,
+    GST, TRANSFORM_TEMPLATE, GstBaseTransform)
+
+/* number of control points fetched from the controller at once */
+#define GST_TRANSFORM_TEMPLATE_CONTROL_POINTS 64
 
-struct _GstPluginTemplate {
+struct _GstTransformTemplate {
   GstBaseTransform element;
 
   gboolean silent;
+  gdouble gain;
+  GstClockTime control_interval;  /* 0: sync once per buffer */
+  GstPluginTemplateIsa isa;       /* requested level, applied on start */
+
+  const GstPluginTemplateKernels *kernels;
+
+  GstAudioInfo info;
+
+  /* gain values sampled every ctrl_interval from ctrl_start on, refilled
+   * when a buffer leaves the window. ctrl_controlled is FALSE when gain had
+   * no control binding at the last refill, or at the last buffer when the
+   * controller is synced per buffer */
+  gdouble ctrl_values[GST_TRANSFORM_TEMPLATE_CONTROL_POINTS + 1];
+  GstClockTime ctrl_start;
+  GstClockTime ctrl_interval;
+  gboolean ctrl_controlled;
+
+  /* gain applied to the last sample, property changes ramp from here */
+  gdouble last_gain;
 };
 
 G_END_DECLS
 
-#endif /* __GST_PLUGIN_TEMPLATE_H__ */
+#endif /* __GST_TRANSFORM_TEMPLATE_H__ */
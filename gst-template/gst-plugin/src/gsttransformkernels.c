@@ -0,0 +1,221 @@
+/*
+ * GStreamer
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Gain kernels of the transform template, one variant per instruction set.
+ * The variants are compiled with target attributes so the file builds
+ * without special flags; which one runs is decided at runtime from CPUID.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstcpufeatures.h"
+#include "gsttransformkernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+static void
+gain_ramp_scalar (gfloat * data, guint channels, guint frames, gdouble gain,
+    gdouble step)
+{
+  guint i, c;
+
+  for (i = 0; i < frames; i++) {
+    gfloat g = (gfloat) (gain + step * i);
+
+    for (c = 0; c < channels; c++)
+      data[c] *= g;
+    data += channels;
+  }
+}
+
+/* samples [start, n) of a buffer, for the vector tails */
+static inline void
+gain_ramp_tail (gfloat * data, guint channels, guint start, guint n,
+    gdouble gain, gdouble step)
+{
+  guint i;
+
+  for (i = start; i < n; i++)
+    data[i] *= (gfloat) (gain + step * (i / channels));
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/* The vector variants handle a constant gain for any layout. A ramp is
+ * vectorized when a whole number of frames fits in a vector, so every
+ * vector starts on a frame boundary and the lane pattern repeats; other
+ * channel counts use the scalar loop. */
+
+__attribute__ ((target ("sse2")))
+static void
+gain_ramp_sse2 (gfloat * data, guint channels, guint frames, gdouble gain,
+    gdouble step)
+{
+  guint n = frames * channels, i = 0, j, fpv;
+  gfloat off[4];
+  __m128 voff;
+
+  if (step == 0.0) {
+    __m128 g = _mm_set1_ps ((gfloat) gain);
+
+    for (; i + 4 <= n; i += 4)
+      _mm_storeu_ps (data + i, _mm_mul_ps (_mm_loadu_ps (data + i), g));
+  } else if (4 % channels == 0) {
+    fpv = 4 / channels;
+    for (j = 0; j < 4; j++)
+      off[j] = (gfloat) (step * (j / channels));
+    voff = _mm_loadu_ps (off);
+
+    for (; i + 4 <= n; i += 4) {
+      __m128 g = _mm_add_ps (_mm_set1_ps ((gfloat) (gain +
+                  step * (i / 4 * fpv))), voff);
+      _mm_storeu_ps (data + i, _mm_mul_ps (_mm_loadu_ps (data + i), g));
+    }
+  }
+  gain_ramp_tail (data, channels, i, n, gain, step);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+gain_ramp_avx2 (gfloat * data, guint channels, guint frames, gdouble gain,
+    gdouble step)
+{
+  guint n = frames * channels, i = 0, j, fpv;
+  gfloat off[8];
+  __m256 voff;
+
+  if (step == 0.0) {
+    __m256 g = _mm256_set1_ps ((gfloat) gain);
+
+    for (; i + 8 <= n; i += 8)
+      _mm256_storeu_ps (data + i, _mm256_mul_ps (_mm256_loadu_ps (data + i),
+              g));
+  } else if (8 % channels == 0) {
+    fpv = 8 / channels;
+    for (j = 0; j < 8; j++)
+      off[j] = (gfloat) (step * (j / channels));
+    voff = _mm256_loadu_ps (off);
+
+    for (; i + 8 <= n; i += 8) {
+      __m256 g = _mm256_add_ps (_mm256_set1_ps ((gfloat) (gain +
+                  step * (i / 8 * fpv))), voff);
+      _mm256_storeu_ps (data + i, _mm256_mul_ps (_mm256_loadu_ps (data + i),
+              g));
+    }
+  }
+  gain_ramp_tail (data, channels, i, n, gain, step);
+}
+
+__attribute__ ((target ("avx512f")))
+static void
+gain_ramp_avx512 (gfloat * data, guint channels, guint frames, gdouble gain,
+    gdouble step)
+{
+  guint n = frames * channels, i = 0, j, fpv;
+  gfloat off[16];
+  __m512 voff;
+
+  if (step == 0.0) {
+    __m512 g = _mm512_set1_ps ((gfloat) gain);
+
+    for (; i + 16 <= n; i += 16)
+      _mm512_storeu_ps (data + i, _mm512_mul_ps (_mm512_loadu_ps (data + i),
+              g));
+  } else if (16 % channels == 0) {
+    fpv = 16 / channels;
+    for (j = 0; j < 16; j++)
+      off[j] = (gfloat) (step * (j / channels));
+    voff = _mm512_loadu_ps (off);
+
+    for (; i + 16 <= n; i += 16) {
+      __m512 g = _mm512_add_ps (_mm512_set1_ps ((gfloat) (gain +
+                  step * (i / 16 * fpv))), voff);
+      _mm512_storeu_ps (data + i, _mm512_mul_ps (_mm512_loadu_ps (data + i),
+              g));
+    }
+  }
+  gain_ramp_tail (data, channels, i, n, gain, step);
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+static const GstPluginTemplateKernels kernels[] = {
+  {GST_PLUGIN_TEMPLATE_ISA_SCALAR, "scalar", gain_ramp_scalar},
+#ifdef HAVE_X86_KERNELS
+  {GST_PLUGIN_TEMPLATE_ISA_SSE2, "sse2", gain_ramp_sse2},
+  {GST_PLUGIN_TEMPLATE_ISA_AVX2, "avx2", gain_ramp_avx2},
+  {GST_PLUGIN_TEMPLATE_ISA_AVX512, "avx512", gain_ramp_avx512},
+#endif
+};
+
+gboolean
+gst_plugin_template_isa_supported (GstPluginTemplateIsa isa)
+{
+  switch (isa) {
+    case GST_PLUGIN_TEMPLATE_ISA_AUTO:
+    case GST_PLUGIN_TEMPLATE_ISA_SCALAR:
+      return TRUE;
+#ifdef HAVE_X86_KERNELS
+    case GST_PLUGIN_TEMPLATE_ISA_SSE2:
+      return gst_cpu_features_have (GST_CPU_FEATURE_SSE2);
+    case GST_PLUGIN_TEMPLATE_ISA_AVX2:
+      return gst_cpu_features_have (GST_CPU_FEATURE_AVX2);
+    case GST_PLUGIN_TEMPLATE_ISA_AVX512:
+      return gst_cpu_features_have (GST_CPU_FEATURE_AVX512F);
+#endif
+    default:
+      return FALSE;
+  }
+}
+
+/* scalar is always supported */
+GstPluginTemplateIsa
+gst_plugin_template_isa_best (void)
+{
+  GstPluginTemplateIsa isa = GST_PLUGIN_TEMPLATE_ISA_AVX512;
+
+  while (!gst_plugin_template_isa_supported (isa))
+    isa--;
+  return isa;
+}
+
+/* the kernels for an ISA level, the best one for AUTO. Returns NULL when
+ * the level is not compiled in or not supported by this CPU */
+const GstPluginTemplateKernels *
+gst_plugin_template_kernels_get (GstPluginTemplateIsa isa)
+{
+  guint i;
+
+  if (isa == GST_PLUGIN_TEMPLATE_ISA_AUTO)
+    isa = gst_plugin_template_isa_best ();
+  else if (!gst_plugin_template_isa_supported (isa))
+    return NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (kernels); i++) {
+    if (kernels[i].isa == isa)
+      return &kernels[i];
+  }
+  return NULL;
+}
@@ -0,0 +1,59 @@
+/*
+ * GStreamer
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_TRANSFORM_KERNELS_H__
+#define __GST_TRANSFORM_KERNELS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* instruction set levels, each one implies the ones before it */
+typedef enum
+{
+  GST_PLUGIN_TEMPLATE_ISA_AUTO,
+  GST_PLUGIN_TEMPLATE_ISA_SCALAR,
+  GST_PLUGIN_TEMPLATE_ISA_SSE2,
+  GST_PLUGIN_TEMPLATE_ISA_AVX2,
+  GST_PLUGIN_TEMPLATE_ISA_AVX512
+} GstPluginTemplateIsa;
+
+/* multiply interleaved frames by gain + step * frame_index */
+typedef void (*GstPluginTemplateGainRampFunc) (gfloat * data, guint channels,
+    guint frames, gdouble gain, gdouble step);
+
+/* one table per ISA level; elements derived from the template add their
+ * kernels here so they are dispatched together */
+typedef struct
+{
+  GstPluginTemplateIsa isa;
+  const gchar *name;
+
+  GstPluginTemplateGainRampFunc gain_ramp;
+} GstPluginTemplateKernels;
+
+GstPluginTemplateIsa gst_plugin_template_isa_best (void);
+gboolean gst_plugin_template_isa_supported (GstPluginTemplateIsa isa);
+const GstPluginTemplateKernels *gst_plugin_template_kernels_get (
+    GstPluginTemplateIsa isa);
+
+G_END_DECLS
+
+#endif /* __GST_TRANSFORM_KERNELS_H__ */
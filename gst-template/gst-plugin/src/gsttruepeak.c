@@ -0,0 +1,211 @@
+/* GStreamer 4x oversampled true peak detection
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* ITU-R BS.1770 true peak: a 4x polyphase interpolator with 12 taps per
+ * phase. All four phases of a sample are computed together in one vector,
+ * one broadcast multiply-add per tap. The history of each channel is
+ * mirrored so the window of the newest sample is always contiguous.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "gsttruepeak.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TP_PHASES 4
+#define TP_TAPS 12
+
+struct _GstTruePeak
+{
+  guint channels;
+
+  /* coeffs[j * TP_PHASES + p] weights window sample j, oldest first, for
+   * phase p */
+  gfloat coeffs[TP_TAPS * TP_PHASES];
+  gfloat *history;              /* per channel 2 * TP_TAPS, mirrored */
+  guint pos;
+};
+
+/* Hann windowed sinc, each phase normalized to unity gain at DC */
+static void
+gst_true_peak_init_coeffs (GstTruePeak * tp)
+{
+  gdouble h[TP_TAPS * TP_PHASES], sum[TP_PHASES] = { 0, };
+  guint n = TP_TAPS * TP_PHASES, i, j, p;
+
+  for (i = 0; i < n; i++) {
+    gdouble t = (i - (n - 1) / 2.0) / TP_PHASES;
+    gdouble sinc = t == 0.0 ? 1.0 : sin (G_PI * t) / (G_PI * t);
+    gdouble w = 0.5 * (1.0 - cos (2.0 * G_PI * (i + 1) / (n + 1)));
+
+    h[i] = sinc * w;
+    sum[i % TP_PHASES] += h[i];
+  }
+
+  for (j = 0; j < TP_TAPS; j++)
+    for (p = 0; p < TP_PHASES; p++)
+      tp->coeffs[j * TP_PHASES + p] =
+          h[p + TP_PHASES * (TP_TAPS - 1 - j)] / sum[p];
+}
+
+GstTruePeak *
+gst_true_peak_new (guint channels)
+{
+  GstTruePeak *tp;
+
+  g_return_val_if_fail (channels > 0, NULL);
+
+  tp = g_new0 (GstTruePeak, 1);
+  tp->channels = channels;
+  tp->history = g_new0 (gfloat, channels * 2 * TP_TAPS);
+  gst_true_peak_init_coeffs (tp);
+
+  return tp;
+}
+
+void
+gst_true_peak_free (GstTruePeak * tp)
+{
+  if (tp == NULL)
+    return;
+
+  g_free (tp->history);
+  g_free (tp);
+}
+
+void
+gst_true_peak_reset (GstTruePeak * tp)
+{
+  memset (tp->history, 0, tp->channels * 2 * TP_TAPS * sizeof (gfloat));
+  tp->pos = 0;
+}
+
+/* the windowed sinc is centered TP_TAPS / 2 - 1 / (2 * TP_PHASES) input
+ * samples behind the newest one */
+guint
+gst_true_peak_get_delay (const GstTruePeak * tp)
+{
+  return TP_TAPS / 2;
+}
+
+static void
+gst_true_peak_channel (GstTruePeak * tp, guint c, const gfloat * data,
+    guint frames, gfloat * true_peak, gfloat * sample_peak)
+{
+  gfloat *hist = tp->history + c * 2 * TP_TAPS;
+  gfloat speak = sample_peak ? sample_peak[c] : 0.0f;
+  guint pos = tp->pos, f;
+#ifdef __SSE2__
+  __m128 peak = _mm_set1_ps (true_peak[c]);
+  __m128 abs_mask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+#else
+  gfloat peak = true_peak[c];
+#endif
+
+  for (f = 0; f < frames; f++) {
+    gfloat x = data[f * tp->channels + c];
+    const gfloat *w;
+    guint j;
+
+    speak = MAX (speak, fabsf (x));
+
+    hist[pos] = hist[pos + TP_TAPS] = x;
+    w = hist + pos + 1;
+    pos = pos + 1 == TP_TAPS ? 0 : pos + 1;
+
+#ifdef __SSE2__
+    {
+      __m128 acc = _mm_setzero_ps ();
+
+      for (j = 0; j < TP_TAPS; j++)
+        acc = _mm_add_ps (acc, _mm_mul_ps (_mm_set1_ps (w[j]),
+                _mm_loadu_ps (tp->coeffs + j * TP_PHASES)));
+      peak = _mm_max_ps (peak, _mm_and_ps (acc, abs_mask));
+    }
+#else
+    {
+      guint p;
+
+      for (p = 0; p < TP_PHASES; p++) {
+        gfloat acc = 0.0f;
+
+        for (j = 0; j < TP_TAPS; j++)
+          acc += w[j] * tp->coeffs[j * TP_PHASES + p];
+        peak = MAX (peak, fabsf (acc));
+      }
+    }
+#endif
+  }
+
+#ifdef __SSE2__
+  {
+    gfloat lanes[4];
+
+    _mm_storeu_ps (lanes, peak);
+    true_peak[c] = MAX (MAX (lanes[0], lanes[1]), MAX (lanes[2], lanes[3]));
+  }
+#else
+  true_peak[c] = peak;
+#endif
+  if (sample_peak)
+    sample_peak[c] = speak;
+}
+
+void
+gst_true_peak_process (GstTruePeak * tp, const gfloat * data, guint frames,
+    gfloat * true_peak, gfloat * sample_peak)
+{
+  guint c;
+
+  for (c = 0; c < tp->channels; c++)
+    gst_true_peak_channel (tp, c, data, frames, true_peak, sample_peak);
+  tp->pos = (tp->pos + frames) % TP_TAPS;
+}
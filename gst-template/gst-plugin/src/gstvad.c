@@ -0,0 +1,284 @@
+/* GStreamer voice activity detection
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/* Energy based voice activity detection. The audio is cut into windows
+ * of 10 ms, a window whose RMS level over all channels reaches the
+ * threshold is speech. Speech starts with the first speech window and
+ * stops once the silence after the last one has lasted the hangover, so
+ * short pauses between words do not count as silence.
+ *
+ * The per-sample work is the sum of squares. The SSE2 kernels square
+ * S16 pairs with pmaddwd into exact 64 bit sums and F32 into double
+ * accumulators, so both agree with the scalar loops.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include "gstvad.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define S16_SCALE (1.0 / (32768.0 * 32768.0))
+
+struct _GstVad
+{
+  GstVadEnergyFunc energy;
+  guint channels;
+  guint bpf;
+  guint window;                 /* frames */
+
+  gdouble threshold;            /* mean square */
+  guint64 hangover;             /* frames */
+
+  gboolean speech;
+  guint64 silence;              /* frames since the last speech window */
+};
+
+static gdouble
+energy_s16_scalar (gconstpointer data, guint n_samples)
+{
+  const gint16 *s = data;
+  guint64 sum = 0;
+  guint i;
+
+  for (i = 0; i < n_samples; i++)
+    sum += (guint64) ((gint32) s[i] * s[i]);
+  return sum * S16_SCALE;
+}
+
+static gdouble
+energy_f32_scalar (gconstpointer data, guint n_samples)
+{
+  const gfloat *s = data;
+  gdouble sum = 0.0;
+  guint i;
+
+  for (i = 0; i < n_samples; i++)
+    sum += (gdouble) s[i] * s[i];
+  return sum;
+}
+
+#ifdef __SSE2__
+
+/* 8 samples: pmaddwd gives 4 sums of two squares, each at most 2^31 so
+ * they fit unsigned 32 bit, widened into two 64 bit lanes */
+static gdouble
+energy_s16_sse2 (gconstpointer data, guint n_samples)
+{
+  const gint16 *s = data;
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i acc = _mm_setzero_si128 ();
+  guint64 lanes[2];
+  guint i = 0;
+
+  for (; i + 8 <= n_samples; i += 8) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (s + i));
+    __m128i sq = _mm_madd_epi16 (v, v);
+
+    acc = _mm_add_epi64 (acc, _mm_unpacklo_epi32 (sq, zero));
+    acc = _mm_add_epi64 (acc, _mm_unpackhi_epi32 (sq, zero));
+  }
+  _mm_storeu_si128 ((__m128i *) lanes, acc);
+
+  return (lanes[0] + lanes[1]) * S16_SCALE + energy_s16_scalar (s + i,
+      n_samples - i);
+}
+
+/* 8 samples into four double accumulators */
+static gdouble
+energy_f32_sse2 (gconstpointer data, guint n_samples)
+{
+  const gfloat *s = data;
+  __m128d acc0 = _mm_setzero_pd (), acc1 = _mm_setzero_pd ();
+  __m128d acc2 = _mm_setzero_pd (), acc3 = _mm_setzero_pd ();
+  gdouble lanes[2];
+  guint i = 0;
+
+  for (; i + 8 <= n_samples; i += 8) {
+    __m128 a = _mm_loadu_ps (s + i);
+    __m128 b = _mm_loadu_ps (s + i + 4);
+    __m128d a0 = _mm_cvtps_pd (a), a1 = _mm_cvtps_pd (_mm_movehl_ps (a, a));
+    __m128d b0 = _mm_cvtps_pd (b), b1 = _mm_cvtps_pd (_mm_movehl_ps (b, b));
+
+    acc0 = _mm_add_pd (acc0, _mm_mul_pd (a0, a0));
+    acc1 = _mm_add_pd (acc1, _mm_mul_pd (a1, a1));
+    acc2 = _mm_add_pd (acc2, _mm_mul_pd (b0, b0));
+    acc3 = _mm_add_pd (acc3, _mm_mul_pd (b1, b1));
+  }
+  acc0 = _mm_add_pd (_mm_add_pd (acc0, acc1), _mm_add_pd (acc2, acc3));
+  _mm_storeu_pd (lanes, acc0);
+
+  return lanes[0] + lanes[1] + energy_f32_scalar (s + i, n_samples - i);
+}
+
+#endif /* __SSE2__ */
+
+GstVadEnergyFunc
+gst_vad_energy_func_scalar (GstAudioFormat format)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return energy_s16_scalar;
+    case GST_AUDIO_FORMAT_F32:
+      return energy_f32_scalar;
+    default:
+      return NULL;
+  }
+}
+
+/* the fastest kernel for a native endian format, NULL if unsupported */
+GstVadEnergyFunc
+gst_vad_energy_func (GstAudioFormat format)
+{
+#ifdef __SSE2__
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return energy_s16_sse2;
+    case GST_AUDIO_FORMAT_F32:
+      return energy_f32_sse2;
+    default:
+      return NULL;
+  }
+#else
+  return gst_vad_energy_func_scalar (format);
+#endif
+}
+
+GstVad *
+gst_vad_new (GstAudioFormat format, guint rate, guint channels)
+{
+  GstVadEnergyFunc energy = gst_vad_energy_func (format);
+  GstVad *vad;
+
+  g_return_val_if_fail (rate > 0 && channels > 0, NULL);
+
+  if (energy == NULL)
+    return NULL;
+
+  vad = g_new0 (GstVad, 1);
+  vad->energy = energy;
+  vad->channels = channels;
+  vad->bpf = channels * (format == GST_AUDIO_FORMAT_S16 ? 2 : 4);
+  vad->window = MAX (rate / 100, 1);
+
+  gst_vad_set_threshold (vad, -50.0);
+  gst_vad_set_hangover (vad, rate / 2);
+  gst_vad_reset (vad);
+
+  return vad;
+}
+
+void
+gst_vad_free (GstVad * vad)
+{
+  g_free (vad);
+}
+
+void
+gst_vad_reset (GstVad * vad)
+{
+  vad->speech = FALSE;
+  vad->silence = 0;
+}
+
+void
+gst_vad_set_threshold (GstVad * vad, gdouble threshold_db)
+{
+  vad->threshold = pow (10.0, threshold_db / 10.0);
+}
+
+void
+gst_vad_set_hangover (GstVad * vad, guint64 frames)
+{
+  vad->hangover = frames;
+}
+
+gboolean
+gst_vad_is_speech (const GstVad * vad)
+{
+  return vad->speech;
+}
+
+guint
+gst_vad_process (GstVad * vad, gconstpointer data, guint frames,
+    GstVadEvent * event, gint64 * event_frame)
+{
+  const guint8 *d = data;
+  guint done = 0;
+
+  *event = GST_VAD_EVENT_NONE;
+
+  while (done < frames) {
+    guint n = MIN (vad->window, frames - done);
+    gdouble e = vad->energy (d + done * vad->bpf, n * vad->channels);
+
+    /* compare sums, mean square >= threshold */
+    if (e >= vad->threshold * n * vad->channels) {
+      vad->silence = 0;
+      if (!vad->speech) {
+        vad->speech = TRUE;
+        *event = GST_VAD_EVENT_SPEECH_START;
+        *event_frame = done;
+        return done + n;
+      }
+    } else {
+      vad->silence += n;
+      if (vad->speech && vad->silence >= vad->hangover) {
+        vad->speech = FALSE;
+        *event = GST_VAD_EVENT_SPEECH_STOP;
+        *event_frame = (gint64) (done + n) - (gint64) vad->silence;
+        return done + n;
+      }
+    }
+    done += n;
+  }
+
+  return done;
+}
@@ -0,0 +1,91 @@
+/* GStreamer voice activity detection
+ * Copyright (C) YEAR AUTHOR_NAME AUTHOR_EMAIL
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_VAD_H__
+#define __GST_VAD_H__
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVad GstVad;
+
+typedef enum
+{
+  GST_VAD_EVENT_NONE,
+  GST_VAD_EVENT_SPEECH_START,
+  GST_VAD_EVENT_SPEECH_STOP
+} GstVadEvent;
+
+/* sum of the squares of n_samples native endian samples, full scale
+ * being 1.0 */
+typedef gdouble (*GstVadEnergyFunc) (gconstpointer data, guint n_samples);
+
+GstVadEnergyFunc gst_vad_energy_func (GstAudioFormat format);
+GstVadEnergyFunc gst_vad_energy_func_scalar (GstAudioFormat format);
+
+/* interleaved S16 or F32, NULL for other formats. Starts out in silence */
+GstVad *gst_vad_new (GstAudioFormat format, guint rate, guint channels);
+void gst_vad_free (GstVad * vad);
+void gst_vad_reset (GstVad * vad);
+
+/* RMS level over all channels in dBFS above which a window is speech */
+void gst_vad_set_threshold (GstVad * vad, gdouble threshold_db);
+/* frames of silence after the last speech window before speech stops */
+void gst_vad_set_hangover (GstVad * vad, guint64 frames);
+
+gboolean gst_vad_is_speech (const GstVad * vad);
+
+/* Analyses frames in windows of 10 ms and returns after the first state
+ * change or at the end of the data, with the number of frames consumed.
+ * On a change event and event_frame are set: a start points at the
+ * beginning of the first speech window, a stop at the end of the last
+ * one, which can lie before data. */
+guint gst_vad_process (GstVad * vad, gconstpointer data, guint frames,
+    GstVadEvent * event, gint64 * event_frame);
+
+G_END_DECLS
+
+#endif /* __GST_VAD_H__ */
@@ -0,0 +1,75 @@
+#include <gst/gst.h>
+#include <cstdio>
+
+// 对比 audioresample 与 polyresample 的重采样速度
+// audiotestsrc 产生立体声 F32 正弦，fakesink 不同步，两者的源开销相同
+static gdouble run(const gchar *resampler, gint in_rate, gint out_rate, guint n)
+{
+    gchar *description = g_strdup_printf(
+        "audiotestsrc num-buffers=%u samplesperbuffer=1024 ! "
+        "audio/x-raw,format=F32LE,channels=2,rate=%d ! %s ! "
+        "audio/x-raw,rate=%d ! fakesink sync=false",
+        n, in_rate, resampler, out_rate);
+    GError *error = nullptr;
+    GstElement *pipeline = gst_parse_launch(description, &error);
+    GstBus *bus;
+    GstMessage *msg;
+    gint64 start, elapsed;
+
+    g_free(description);
+    if (pipeline == nullptr)
+    {
+        g_printerr("%s\n", error ? error->message : "failed to create pipeline");
+        g_clear_error(&error);
+        return -1;
+    }
+
+    bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+    start = g_get_monotonic_time();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                     (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    elapsed = g_get_monotonic_time() - start;
+
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR)
+        elapsed = -1;
+    gst_message_unref(msg);
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+
+    // 微秒转换为每个输入帧的纳秒
+    return elapsed < 0 ? -1 : elapsed * 1000.0 / (n * 1024.0);
+}
+
+int main(int argc, char **argv)
+{
+    guint n = argc > 1 ? (guint)g_ascii_strtoull(argv[1], nullptr, 10) : 5000;
+    const gint rates[][2] = {
+        {44100, 48000},
+        {48000, 44100},
+        {48000, 96000},
+        {96000, 48000},
+    };
+    const gchar *resamplers[] = {
+        "audioresample quality=4",
+        "audioresample quality=10",
+        "polyresample quality=medium",
+        "polyresample quality=best",
+    };
+
+    gst_init(&argc, &argv);
+
+    for (const auto &rate : rates)
+    {
+        for (const gchar *resampler : resamplers)
+        {
+            gdouble ns = run(resampler, rate[0], rate[1], n);
+
+            if (ns < 0)
+                return 1;
+            printf("%6d -> %6d  %-28s %8.2f ns/frame\n", rate[0], rate[1], resampler, ns);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <gst/gst.h>
+#include <cstdio>
+
+// 对比 queue 与 ring_queue 的单缓冲区交接开销
+// fakesrc 产生小缓冲区，fakesink 不同步，耗时基本都在线程交接上
+static gdouble run(const gchar *queue, guint n)
+{
+    gchar *description = g_strdup_printf(
+        "fakesrc num-buffers=%u sizetype=fixed sizemax=16 ! %s ! fakesink sync=false", n, queue);
+    GError *error = nullptr;
+    GstElement *pipeline = gst_parse_launch(description, &error);
+    GstBus *bus;
+    GstMessage *msg;
+    gint64 start, elapsed;
+
+    g_free(description);
+    if (pipeline == nullptr)
+    {
+        g_printerr("%s\n", error ? error->message : "failed to create pipeline");
+        g_clear_error(&error);
+        return -1;
+    }
+
+    bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+    start = g_get_monotonic_time();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                     (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    elapsed = g_get_monotonic_time() - start;
+
+    gst_message_unref(msg);
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+
+    // 微秒转换为每个缓冲区的纳秒
+    return elapsed * 1000.0 / n;
+}
+
+int main(int argc, char **argv)
+{
+    guint n = argc > 1 ? (guint)g_ascii_strtoull(argv[1], nullptr, 10) : 1000000;
+    const gchar *queues[] = {
+        "queue max-size-buffers=64 max-size-bytes=0 max-size-time=0",
+        "ring_queue max-size-buffers=64",
+    };
+
+    gst_init(&argc, &argv);
+
+    for (const gchar *queue : queues)
+    {
+        gdouble ns = run(queue, n);
+
+        if (ns < 0)
+            return 1;
+        printf("%-64s %8.1f ns/buffer\n", queue, ns);
+    }
+    return 0;
+}
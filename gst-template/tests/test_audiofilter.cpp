@@ -0,0 +1,863 @@
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/base/gstbasetransform.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "gstfirengine.h"
+
+// audiofiltertemplate 的元素测试：在元素的 sink pad 上记录输入，fakesink 记录输出，
+// 样本按声道展开成 double，交错和非交错布局用同一种方式比较
+typedef std::vector<std::vector<gdouble>> Channels;
+
+// 把缓冲区中的样本按声道追加到 dst，布局和格式取自 pad 上协商好的 caps
+static void append_channels(GstPad *pad, GstBuffer *buf, Channels &dst)
+{
+    GstCaps *caps = gst_pad_get_current_caps(pad);
+    GstAudioInfo info;
+    GstAudioBuffer abuf;
+
+    ASSERT_NE(caps, nullptr);
+    ASSERT_TRUE(gst_audio_info_from_caps(&info, caps));
+    gst_caps_unref(caps);
+    ASSERT_TRUE(gst_audio_buffer_map(&abuf, &info, buf, GST_MAP_READ));
+
+    gint channels = GST_AUDIO_INFO_CHANNELS(&info);
+    gboolean planar = GST_AUDIO_INFO_LAYOUT(&info) == GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+    gsize samples = GST_AUDIO_BUFFER_N_SAMPLES(&abuf);
+
+    dst.resize(channels);
+    for (gint c = 0; c < channels; c++)
+    {
+        for (gsize i = 0; i < samples; i++)
+        {
+            gconstpointer plane = GST_AUDIO_BUFFER_PLANE_DATA(&abuf, planar ? c : 0);
+            gsize index = planar ? i : i * channels + c;
+
+            switch (GST_AUDIO_INFO_FORMAT(&info))
+            {
+            case GST_AUDIO_FORMAT_S16:
+                dst[c].push_back(((const gint16 *)plane)[index]);
+                break;
+            case GST_AUDIO_FORMAT_F32:
+                dst[c].push_back(((const gfloat *)plane)[index]);
+                break;
+            default:
+                FAIL() << "unexpected format";
+            }
+        }
+    }
+    gst_audio_buffer_unmap(&abuf);
+}
+
+class AudioFilterTest : public ::testing::Test
+{
+protected:
+    GstElement *pipeline;
+    Channels input, output;
+    std::vector<GstBuffer *> held; // 持有输入缓冲区的引用时，元素只能走复制路径
+    std::vector<GstBuffer *> rendered; // fakesink 收到的缓冲区，持有引用
+    gboolean hold_input;
+
+    void SetUp() override
+    {
+        gst_init(nullptr, nullptr);
+        pipeline = nullptr;
+        input.clear();
+        output.clear();
+        held.clear();
+        rendered.clear();
+        hold_input = FALSE;
+    }
+
+    void TearDown() override
+    {
+        for (GstBuffer *buf : held)
+            gst_buffer_unref(buf);
+        held.clear();
+        for (GstBuffer *buf : rendered)
+            gst_buffer_unref(buf);
+        rendered.clear();
+        if (pipeline)
+        {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+        }
+    }
+
+    // 管道中需要名为 filter 的 audiofiltertemplate 和名为 sink 的 fakesink
+    void launch(const gchar *description)
+    {
+        GError *error = nullptr;
+
+        pipeline = gst_parse_launch(description, &error);
+        ASSERT_EQ(error, nullptr) << error->message;
+        ASSERT_NE(pipeline, nullptr);
+
+        GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+        GstPad *pad = gst_element_get_static_pad(filter, "sink");
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_input, this, NULL);
+        gst_object_unref(pad);
+        gst_object_unref(filter);
+
+        GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+        g_object_set(sink, "signal-handoffs", TRUE, NULL);
+        g_signal_connect(sink, "handoff", G_CALLBACK(on_handoff), this);
+        gst_object_unref(sink);
+    }
+
+    gboolean run_to_eos()
+    {
+        GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+        GstMessage *msg;
+        gboolean eos;
+
+        if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+        {
+            gst_object_unref(bus);
+            return FALSE;
+        }
+
+        msg = gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND,
+                                         (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        eos = msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+        if (msg)
+            gst_message_unref(msg);
+        gst_object_unref(bus);
+        return eos;
+    }
+
+    static GstPadProbeReturn on_input(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+    {
+        AudioFilterTest *test = (AudioFilterTest *)data;
+        GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+
+        append_channels(pad, buf, test->input);
+        if (test->hold_input)
+            test->held.push_back(gst_buffer_ref(buf));
+        return GST_PAD_PROBE_OK;
+    }
+
+    static void on_handoff(GstElement *sink, GstBuffer *buf, GstPad *pad, gpointer data)
+    {
+        AudioFilterTest *test = (AudioFilterTest *)data;
+
+        append_channels(pad, buf, test->output);
+        test->rendered.push_back(gst_buffer_ref(buf));
+    }
+
+    // 每个声道的输出都应等于输入乘以 gain
+    void expect_gain(gdouble gain, gdouble tolerance)
+    {
+        ASSERT_EQ(output.size(), input.size());
+        for (gsize c = 0; c < input.size(); c++)
+        {
+            ASSERT_EQ(output[c].size(), input[c].size()) << "channel " << c;
+            for (gsize i = 0; i < input[c].size(); i++)
+                ASSERT_NEAR(output[c][i], input[c][i] * gain, tolerance) << "channel " << c << " sample " << i;
+        }
+    }
+};
+
+// 非交错 F32：输入缓冲区可写时逐个平面原位处理
+TEST_F(AudioFilterTest, PlanarInPlace)
+{
+    launch("audiotestsrc num-buffers=20 wave=sine ! "
+           "audio/x-raw,format=F32LE,layout=non-interleaved,channels=3,rate=48000 ! "
+           "audiofiltertemplate name=filter gain=0.5 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    ASSERT_EQ(input.size(), 3u);
+    EXPECT_GT(input[0].size(), 0u);
+    expect_gain(0.5, 1e-6);
+}
+
+// 非交错 F32：输入缓冲区被共享时从输入平面读、写入新缓冲区的平面
+TEST_F(AudioFilterTest, PlanarCopy)
+{
+    hold_input = TRUE;
+    launch("audiotestsrc num-buffers=20 wave=sine ! "
+           "audio/x-raw,format=F32LE,layout=non-interleaved,channels=3,rate=48000 ! "
+           "audiofiltertemplate name=filter gain=0.5 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    ASSERT_EQ(input.size(), 3u);
+    expect_gain(0.5, 1e-6);
+}
+
+// 非交错 S16：定点内核逐平面处理，舍入误差不超过 1
+TEST_F(AudioFilterTest, PlanarS16)
+{
+    launch("audiotestsrc num-buffers=20 wave=sine ! "
+           "audio/x-raw,format=S16LE,layout=non-interleaved,channels=2,rate=44100 ! "
+           "audiofiltertemplate name=filter gain=0.75 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    ASSERT_EQ(input.size(), 2u);
+    expect_gain(0.75, 1.0);
+}
+
+// firconvolver：输出应等于分块卷积引擎对同一输入（末尾补 latency 个零，对应 EOS 时
+// 推出的尾部）的输出，LATENCY 查询报告引擎的延迟
+#define FIR_TAPS 300
+#define FIR_BLOCK_SIZE 64
+
+static std::vector<gfloat> fir_taps()
+{
+    std::vector<gfloat> taps(FIR_TAPS);
+
+    for (guint i = 0; i < FIR_TAPS; i++)
+        taps[i] = 0.1 * std::pow(0.98, i) * std::cos(0.3 * i);
+    return taps;
+}
+
+TEST_F(AudioFilterTest, FirConvolverMatchesEngine)
+{
+    std::vector<gfloat> taps = fir_taps();
+    GValue array = G_VALUE_INIT;
+    GValue tap = G_VALUE_INIT;
+
+    launch("audiotestsrc num-buffers=20 wave=white-noise samplesperbuffer=1000 ! "
+           "audio/x-raw,format=F32LE,channels=2,rate=48000 ! "
+           "firconvolver name=filter block-size=64 partitioning=uniform threads=2 ! "
+           "fakesink name=sink");
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    g_value_init(&array, GST_TYPE_ARRAY);
+    g_value_init(&tap, G_TYPE_FLOAT);
+    for (gfloat t : taps)
+    {
+        g_value_set_float(&tap, t);
+        gst_value_array_append_value(&array, &tap);
+    }
+    g_object_set_property(G_OBJECT(filter), "taps", &array);
+    g_value_unset(&tap);
+    g_value_unset(&array);
+
+    GstFirEngine *engine = gst_fir_engine_new(taps.data(), FIR_TAPS, FIR_BLOCK_SIZE, FALSE, 8192);
+    guint latency = gst_fir_engine_get_latency(engine);
+    EXPECT_GT(latency, 0u);
+
+    // 预滚之后引擎已经建好，查询结果包含引擎延迟
+    ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PAUSED), GST_STATE_CHANGE_FAILURE);
+    ASSERT_EQ(gst_element_get_state(pipeline, NULL, NULL, 10 * GST_SECOND), GST_STATE_CHANGE_SUCCESS);
+
+    GstPad *srcpad = gst_element_get_static_pad(filter, "src");
+    GstQuery *query = gst_query_new_latency();
+    GstClockTime min, max;
+    gboolean live;
+
+    ASSERT_TRUE(gst_pad_query(srcpad, query));
+    gst_query_parse_latency(query, &live, &min, &max);
+    EXPECT_EQ(min, gst_util_uint64_scale_int(latency, GST_SECOND, 48000));
+    gst_query_unref(query);
+    gst_object_unref(srcpad);
+    gst_object_unref(filter);
+
+    ASSERT_TRUE(run_to_eos());
+    ASSERT_EQ(input.size(), 2u);
+    ASSERT_EQ(output.size(), 2u);
+
+    for (guint c = 0; c < 2; c++)
+    {
+        std::vector<gfloat> in(input[c].begin(), input[c].end());
+        std::vector<gfloat> expected(in.size() + latency);
+        GstFirEngineChannel *channel = gst_fir_engine_channel_new(engine);
+
+        in.resize(in.size() + latency, 0.0f);
+        gst_fir_engine_channel_process(channel, in.data(), expected.data(), in.size(), 1);
+        gst_fir_engine_channel_free(channel);
+
+        ASSERT_EQ(output[c].size(), expected.size()) << "channel " << c;
+        for (gsize i = 0; i < expected.size(); i++)
+            ASSERT_NEAR(output[c][i], expected[i], 1e-4) << "channel " << c << " sample " << i;
+    }
+    gst_fir_engine_free(engine);
+}
+
+// loudnessmeter 消息中的 timestamp，按到达顺序
+static void on_loudness_message(GstBus *bus, GstMessage *msg, gpointer data)
+{
+    std::vector<GstClockTime> *timestamps = (std::vector<GstClockTime> *)data;
+    const GstStructure *s = gst_message_get_structure(msg);
+    GstClockTime ts;
+
+    if (s == nullptr || !gst_structure_has_name(s, "loudness"))
+        return;
+    ASSERT_TRUE(gst_structure_get_uint64(s, "timestamp", &ts));
+    timestamps->push_back(ts);
+}
+
+// loudnessmeter 只读不写：持有输入缓冲区的引用时，fakesink 收到的仍是同一个
+// GstBuffer，样本不变；每 100ms 音频发一条 loudness 消息，时间戳在区间末尾
+TEST_F(AudioFilterTest, LoudnessMeterPassesBuffersThrough)
+{
+    std::vector<GstClockTime> timestamps;
+
+    hold_input = TRUE;
+    launch("audiotestsrc num-buffers=50 samplesperbuffer=1000 wave=sine ! "
+           "audio/x-raw,format=F32LE,channels=2,rate=48000 ! "
+           "loudnessmeter name=filter interval=100000000 ! fakesink name=sink");
+
+    GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+    gst_bus_enable_sync_message_emission(bus);
+    g_signal_connect(bus, "sync-message::element", G_CALLBACK(on_loudness_message), &timestamps);
+
+    ASSERT_TRUE(run_to_eos());
+    gst_bus_disable_sync_message_emission(bus);
+    gst_object_unref(bus);
+
+    ASSERT_EQ(held.size(), 50u);
+    ASSERT_EQ(rendered.size(), held.size());
+    for (gsize i = 0; i < held.size(); i++)
+        EXPECT_EQ(rendered[i], held[i]) << "buffer " << i;
+    expect_gain(1.0, 0.0);
+
+    // 50000 帧，每 4800 帧一条消息
+    ASSERT_EQ(timestamps.size(), 10u);
+    for (guint k = 0; k < timestamps.size(); k++)
+        EXPECT_LE(std::llabs((gint64)timestamps[k] - (gint64)((k + 1) * 100 * GST_MSECOND)), (gint64)GST_USECOND)
+            << "message " << k;
+}
+
+// channelmatrix：5.1 向下游的立体声 caps 协商，用标准矩阵混音：
+// 前置声道不变，中置和后置衰减 3dB 混入同侧，LFE 丢弃
+TEST_F(AudioFilterTest, ChannelMatrixDownmixesToStereo)
+{
+    const gdouble minus_3db = 0.70710678;
+
+    launch("audiotestsrc num-buffers=20 wave=white-noise ! "
+           "audio/x-raw,format=F32LE,channels=6,channel-mask=(bitmask)0x3f,rate=48000 ! "
+           "channelmatrix name=filter ! audio/x-raw,channels=2 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    GstPad *srcpad = gst_element_get_static_pad(filter, "src");
+    GstCaps *caps = gst_pad_get_current_caps(srcpad);
+    GstAudioInfo info;
+
+    ASSERT_NE(caps, nullptr);
+    ASSERT_TRUE(gst_audio_info_from_caps(&info, caps));
+    EXPECT_EQ(GST_AUDIO_INFO_CHANNELS(&info), 2);
+    EXPECT_EQ(GST_AUDIO_INFO_POSITION(&info, 0), GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT);
+    EXPECT_EQ(GST_AUDIO_INFO_POSITION(&info, 1), GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT);
+    EXPECT_FALSE(gst_base_transform_is_passthrough(GST_BASE_TRANSFORM(filter)));
+    gst_caps_unref(caps);
+    gst_object_unref(srcpad);
+    gst_object_unref(filter);
+
+    // 输入顺序 FL FR FC LFE RL RR
+    ASSERT_EQ(input.size(), 6u);
+    ASSERT_EQ(output.size(), 2u);
+    ASSERT_EQ(output[0].size(), input[0].size());
+    for (gsize i = 0; i < input[0].size(); i++)
+    {
+        ASSERT_NEAR(output[0][i], input[0][i] + minus_3db * (input[2][i] + input[4][i]), 1e-5) << "sample " << i;
+        ASSERT_NEAR(output[1][i], input[1][i] + minus_3db * (input[2][i] + input[5][i]), 1e-5) << "sample " << i;
+    }
+}
+
+// channelmatrix：单位矩阵直通，下游收到的就是输入缓冲区
+TEST_F(AudioFilterTest, ChannelMatrixIdentityIsPassthrough)
+{
+    hold_input = TRUE;
+    launch("audiotestsrc num-buffers=20 wave=white-noise ! "
+           "audio/x-raw,format=F32LE,channels=2,rate=48000 ! "
+           "channelmatrix name=filter matrix=\"<<(float)1,(float)0>,<(float)0,(float)1>>\" ! "
+           "fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    EXPECT_TRUE(gst_base_transform_is_passthrough(GST_BASE_TRANSFORM(filter)));
+    gst_object_unref(filter);
+
+    ASSERT_EQ(held.size(), 20u);
+    ASSERT_EQ(rendered.size(), held.size());
+    for (gsize i = 0; i < held.size(); i++)
+        EXPECT_EQ(rendered[i], held[i]) << "buffer " << i;
+    expect_gain(1.0, 0.0);
+}
+
+// audiofiltertemplate 的重新分块：测试线程直接向 filter 的 sink pad 推送事件和缓冲区，
+// 输出同步到达 fakesink
+#define CHUNK_FRAMES 256
+#define CHUNK_RATE 48000
+
+static const gchar *chunk_pipeline =
+    "audiofiltertemplate name=filter gain=0.5 chunk-frames=256 ! fakesink name=sink sync=false async=false";
+
+// 立体声 F32 的 caps 和 TIME segment
+static void start_stream(GstPad *pad)
+{
+    GstCaps *caps = gst_caps_from_string("audio/x-raw,format=F32LE,layout=interleaved,channels=2,rate=48000");
+    GstSegment segment;
+
+    gst_pad_send_event(pad, gst_event_new_stream_start("chunk"));
+    gst_pad_send_event(pad, gst_event_new_caps(caps));
+    gst_caps_unref(caps);
+    gst_segment_init(&segment, GST_FORMAT_TIME);
+    gst_pad_send_event(pad, gst_event_new_segment(&segment));
+}
+
+static GstBuffer *constant_buffer(guint frames, gfloat value, GstClockTime pts)
+{
+    GstBuffer *buf = gst_buffer_new_allocate(NULL, frames * 2 * sizeof(gfloat), NULL);
+    GstMapInfo map;
+
+    gst_buffer_map(buf, &map, GST_MAP_WRITE);
+    for (guint i = 0; i < frames * 2; i++)
+        ((gfloat *)map.data)[i] = value;
+    gst_buffer_unmap(buf, &map);
+
+    GST_BUFFER_PTS(buf) = pts;
+    GST_BUFFER_DURATION(buf) = gst_util_uint64_scale_int(frames, GST_SECOND, CHUNK_RATE);
+    return buf;
+}
+
+static gint64 time_diff(GstClockTime a, GstClockTime b)
+{
+    return (gint64)a - (gint64)b;
+}
+
+// 奇数大小的输入：每个输出都是整块且 64 字节对齐，时间戳连续，EOS 时推出不足一块的尾部
+TEST_F(AudioFilterTest, RechunksOddBuffers)
+{
+    launch(chunk_pipeline);
+    ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    GstPad *sinkpad = gst_element_get_static_pad(filter, "sink");
+    guint64 offset = 0;
+
+    start_stream(sinkpad);
+    // 4410 帧 = 17 块 + 58 帧
+    for (guint i = 0; i < 10; i++)
+    {
+        GstClockTime pts = gst_util_uint64_scale_int(offset, GST_SECOND, CHUNK_RATE);
+
+        ASSERT_EQ(gst_pad_chain(sinkpad, constant_buffer(441, 0.1f * (i + 1), pts)), GST_FLOW_OK);
+        offset += 441;
+    }
+    EXPECT_EQ(rendered.size(), 17u);
+    gst_pad_send_event(sinkpad, gst_event_new_eos());
+    gst_object_unref(sinkpad);
+    gst_object_unref(filter);
+
+    ASSERT_EQ(rendered.size(), 18u);
+    for (gsize k = 0; k < rendered.size(); k++)
+    {
+        GstBuffer *buf = rendered[k];
+        guint frames = k < 17 ? CHUNK_FRAMES : 58;
+        GstMapInfo map;
+
+        ASSERT_EQ(gst_buffer_get_size(buf), frames * 2 * sizeof(gfloat)) << "chunk " << k;
+        ASSERT_TRUE(gst_buffer_map(buf, &map, GST_MAP_READ));
+        EXPECT_EQ((guintptr)map.data % 64, 0u) << "chunk " << k;
+        gst_buffer_unmap(buf, &map);
+
+        EXPECT_LE(std::llabs(time_diff(GST_BUFFER_PTS(buf),
+                                       gst_util_uint64_scale_int(k * CHUNK_FRAMES, GST_SECOND, CHUNK_RATE))),
+                  1)
+            << "chunk " << k;
+        if (k > 0)
+            EXPECT_LE(std::llabs(time_diff(GST_BUFFER_PTS(buf),
+                                           GST_BUFFER_PTS(rendered[k - 1]) + GST_BUFFER_DURATION(rendered[k - 1]))),
+                      1)
+                << "chunk " << k;
+    }
+    expect_gain(0.5, 1e-6);
+}
+
+// FLUSH_STOP 丢弃还没凑满一块的输入，之后的第一块带 DISCONT
+TEST_F(AudioFilterTest, FlushDiscardsPartialChunk)
+{
+    launch(chunk_pipeline);
+    ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    GstPad *sinkpad = gst_element_get_static_pad(filter, "sink");
+    GstSegment segment;
+
+    start_stream(sinkpad);
+    ASSERT_EQ(gst_pad_chain(sinkpad, constant_buffer(100, 0.25f, 0)), GST_FLOW_OK);
+    EXPECT_EQ(rendered.size(), 0u);
+
+    gst_pad_send_event(sinkpad, gst_event_new_flush_start());
+    gst_pad_send_event(sinkpad, gst_event_new_flush_stop(TRUE));
+    gst_segment_init(&segment, GST_FORMAT_TIME);
+    gst_pad_send_event(sinkpad, gst_event_new_segment(&segment));
+
+    ASSERT_EQ(gst_pad_chain(sinkpad, constant_buffer(300, 0.75f, GST_SECOND)), GST_FLOW_OK);
+    gst_pad_send_event(sinkpad, gst_event_new_eos());
+    gst_object_unref(sinkpad);
+    gst_object_unref(filter);
+
+    ASSERT_EQ(rendered.size(), 2u);
+    EXPECT_EQ(gst_buffer_get_size(rendered[0]), CHUNK_FRAMES * 2 * sizeof(gfloat));
+    EXPECT_EQ(gst_buffer_get_size(rendered[1]), (300 - CHUNK_FRAMES) * 2 * sizeof(gfloat));
+    EXPECT_EQ(GST_BUFFER_PTS(rendered[0]), GST_SECOND);
+    EXPECT_TRUE(GST_BUFFER_IS_DISCONT(rendered[0]));
+
+    ASSERT_EQ(output.size(), 2u);
+    for (gsize c = 0; c < 2; c++)
+    {
+        ASSERT_EQ(output[c].size(), 300u);
+        for (gdouble x : output[c])
+            ASSERT_FLOAT_EQ(x, 0.375f);
+    }
+}
+
+// 一块的时长计入 LATENCY 查询
+TEST_F(AudioFilterTest, ChunkAddsLatency)
+{
+    launch("audiotestsrc ! audio/x-raw,format=F32LE,channels=2,rate=48000 ! "
+           "audiofiltertemplate name=filter chunk-frames=256 ! fakesink name=sink");
+    ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PAUSED), GST_STATE_CHANGE_FAILURE);
+    ASSERT_EQ(gst_element_get_state(pipeline, NULL, NULL, 10 * GST_SECOND), GST_STATE_CHANGE_SUCCESS);
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    GstPad *srcpad = gst_element_get_static_pad(filter, "src");
+    GstQuery *query = gst_query_new_latency();
+    GstClockTime min, max;
+    gboolean live;
+
+    ASSERT_TRUE(gst_pad_query(srcpad, query));
+    gst_query_parse_latency(query, &live, &min, &max);
+    EXPECT_EQ(min, gst_util_uint64_scale_int(CHUNK_FRAMES, GST_SECOND, CHUNK_RATE));
+    gst_query_unref(query);
+    gst_object_unref(srcpad);
+    gst_object_unref(filter);
+}
+
+// silencegap：100 个 10ms 的立体声缓冲区，20 到 39 是语音（直流 0.5），其余为静音。
+// hangover 100ms：语音停止后的 10 个缓冲区仍保留，第 49 个缓冲区内发出 speech-stop，
+// 从第 50 个开始又替换为 gap
+#define GAP_FRAMES 480
+
+struct GapOutput
+{
+    GstClockTime pts;
+    GstClockTime duration;
+    gchar kind; // 'b' 普通缓冲区，'g' 带 GAP 标志的缓冲区，'e' GAP 事件
+};
+
+struct SpeechMessage
+{
+    std::string name;
+    GstClockTime timestamp;
+};
+
+class SilenceGapTest : public AudioFilterTest
+{
+protected:
+    std::vector<GapOutput> out;
+    std::vector<SpeechMessage> messages;
+
+    static GstPadProbeReturn on_output(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+    {
+        SilenceGapTest *test = (SilenceGapTest *)data;
+        GapOutput item;
+
+        if (info->type & GST_PAD_PROBE_TYPE_BUFFER)
+        {
+            GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+
+            item.pts = GST_BUFFER_PTS(buf);
+            item.duration = GST_BUFFER_DURATION(buf);
+            item.kind = GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_GAP) ? 'g' : 'b';
+            test->out.push_back(item);
+        }
+        else if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_GAP)
+        {
+            gst_event_parse_gap(GST_PAD_PROBE_INFO_EVENT(info), &item.pts, &item.duration);
+            item.kind = 'e';
+            test->out.push_back(item);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    static void on_message(GstBus *bus, GstMessage *msg, gpointer data)
+    {
+        SilenceGapTest *test = (SilenceGapTest *)data;
+        const GstStructure *s = gst_message_get_structure(msg);
+        SpeechMessage m;
+
+        if (s == nullptr || !g_str_has_prefix(gst_structure_get_name(s), "speech-"))
+            return;
+        m.name = gst_structure_get_name(s);
+        ASSERT_TRUE(gst_structure_get_uint64(s, "timestamp", &m.timestamp));
+        test->messages.push_back(m);
+    }
+
+    void run(const gchar *mode)
+    {
+        gchar *description = g_strdup_printf("silencegap name=filter hangover=100000000 mode=%s ! "
+                                             "fakesink name=sink sync=false async=false",
+                                             mode);
+
+        launch(description);
+        g_free(description);
+        ASSERT_NE(gst_element_set_state(pipeline, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+
+        GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+        GstPad *sinkpad = gst_element_get_static_pad(filter, "sink");
+        GstPad *srcpad = gst_element_get_static_pad(filter, "src");
+        GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+
+        gst_pad_add_probe(srcpad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                          on_output, this, NULL);
+        gst_bus_enable_sync_message_emission(bus);
+        g_signal_connect(bus, "sync-message::element", G_CALLBACK(on_message), this);
+
+        start_stream(sinkpad);
+        for (guint k = 0; k < 100; k++)
+        {
+            gfloat value = k >= 20 && k < 40 ? 0.5f : 0.0f;
+            GstClockTime pts = gst_util_uint64_scale_int(k * GAP_FRAMES, GST_SECOND, CHUNK_RATE);
+
+            ASSERT_EQ(gst_pad_chain(sinkpad, constant_buffer(GAP_FRAMES, value, pts)), GST_FLOW_OK) << "buffer " << k;
+        }
+        gst_pad_send_event(sinkpad, gst_event_new_eos());
+
+        gst_bus_disable_sync_message_emission(bus);
+        gst_object_unref(bus);
+        gst_object_unref(srcpad);
+        gst_object_unref(sinkpad);
+        gst_object_unref(filter);
+    }
+
+    static gboolean speech(guint k)
+    {
+        return k >= 20 && k < 50;
+    }
+
+    void expect_messages()
+    {
+        ASSERT_EQ(messages.size(), 2u);
+        EXPECT_EQ(messages[0].name, "speech-start");
+        EXPECT_EQ(messages[0].timestamp, 200 * GST_MSECOND);
+        // 停止点是最后一个语音窗口的末尾，比发出它的音频早一个 hangover
+        EXPECT_EQ(messages[1].name, "speech-stop");
+        EXPECT_EQ(messages[1].timestamp, 400 * GST_MSECOND);
+    }
+};
+
+// mode=event：静音缓冲区换成时间戳和时长相同的 GAP 事件，下游只收到语音和 hangover
+TEST_F(SilenceGapTest, ReplacesSilenceWithGapEvents)
+{
+    run("event");
+    ASSERT_EQ(out.size(), 100u);
+    for (guint k = 0; k < 100; k++)
+    {
+        EXPECT_EQ(out[k].kind, speech(k) ? 'b' : 'e') << "buffer " << k;
+        EXPECT_EQ(out[k].pts, k * 10 * GST_MSECOND) << "buffer " << k;
+        EXPECT_EQ(out[k].duration, 10 * GST_MSECOND) << "buffer " << k;
+    }
+    EXPECT_EQ(rendered.size(), 30u);
+    expect_messages();
+}
+
+// mode=buffer：静音缓冲区换成同样大小、带 GAP 标志的全零缓冲区，下游收到全部 100 个
+TEST_F(SilenceGapTest, ReplacesSilenceWithGapBuffers)
+{
+    run("buffer");
+    ASSERT_EQ(out.size(), 100u);
+    for (guint k = 0; k < 100; k++)
+    {
+        EXPECT_EQ(out[k].kind, speech(k) ? 'b' : 'g') << "buffer " << k;
+        EXPECT_EQ(out[k].pts, k * 10 * GST_MSECOND) << "buffer " << k;
+    }
+
+    ASSERT_EQ(rendered.size(), 100u);
+    for (guint k = 0; k < 100; k++)
+        EXPECT_EQ(gst_buffer_get_size(rendered[k]), GAP_FRAMES * 2 * sizeof(gfloat)) << "buffer " << k;
+    // 输入的语音段原样保留，其余都是零
+    ASSERT_EQ(output.size(), 2u);
+    for (gsize c = 0; c < 2; c++)
+    {
+        ASSERT_EQ(output[c].size(), 100u * GAP_FRAMES);
+        for (gsize i = 0; i < output[c].size(); i++)
+            ASSERT_EQ(output[c][i], i >= 20 * GAP_FRAMES && i < 40 * GAP_FRAMES ? 0.5 : 0.0) << "frame " << i;
+    }
+    expect_messages();
+}
+
+// polyresample：44.1 kHz 单声道输入，20 个 441 帧的缓冲区共 0.2 秒
+#define RESAMPLE_SOURCE "audiotestsrc num-buffers=20 samplesperbuffer=441 wave=sine timestamp-offset=1000000000 ! " \
+                        "audio/x-raw,format=F32LE,channels=1,rate=44100 ! "
+
+// fakesink 上协商好的采样率
+static gint sink_rate(GstElement *pipeline)
+{
+    GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    GstPad *pad = gst_element_get_static_pad(sink, "sink");
+    GstCaps *caps = gst_pad_get_current_caps(pad);
+    gint rate = 0;
+
+    if (caps)
+    {
+        gst_structure_get_int(gst_caps_get_structure(caps, 0), "rate", &rate);
+        gst_caps_unref(caps);
+    }
+    gst_object_unref(pad);
+    gst_object_unref(sink);
+    return rate;
+}
+
+// 下游接受任意采样率时保持输入采样率，元素直通，输出缓冲区就是输入缓冲区
+TEST_F(AudioFilterTest, PolyResampleKeepsRateWhenAllowed)
+{
+    hold_input = TRUE;
+    launch(RESAMPLE_SOURCE "polyresample name=filter ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+
+    EXPECT_EQ(sink_rate(pipeline), 44100);
+    ASSERT_EQ(rendered.size(), held.size());
+    for (gsize i = 0; i < held.size(); i++)
+        EXPECT_EQ(rendered[i], held[i]) << "buffer " << i;
+}
+
+// 下游给出候选列表时选择最接近输入的采样率，而不是列表中的第一个
+TEST_F(AudioFilterTest, PolyResampleFixatesNearestRate)
+{
+    launch(RESAMPLE_SOURCE "polyresample name=filter ! audio/x-raw,rate={32000,48000} ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(sink_rate(pipeline), 48000);
+}
+
+// 约简后相位数超过 4096 的比例在协商时被拒绝
+TEST_F(AudioFilterTest, PolyResampleRefusesHugeRatio)
+{
+    launch(RESAMPLE_SOURCE "polyresample name=filter ! audio/x-raw,rate=48017 ! fakesink name=sink");
+    EXPECT_FALSE(run_to_eos());
+    EXPECT_TRUE(rendered.empty());
+}
+
+// 44.1 kHz 到 48 kHz：输出时间戳从第一个输入时间戳起按输出帧数计算，缓冲区首尾相接，
+// offset 连续；EOS 时推出滤波器延迟中剩余的帧，总帧数等于 0.2 秒的 48 kHz 帧数，
+// 最后一个缓冲区的结束时间等于输入的结束时间
+TEST_F(AudioFilterTest, PolyResampleStampsAndDrains)
+{
+    launch(RESAMPLE_SOURCE "polyresample name=filter ! audio/x-raw,rate=48000 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    ASSERT_EQ(sink_rate(pipeline), 48000);
+    ASSERT_FALSE(rendered.empty());
+
+    guint64 frames = 0;
+
+    EXPECT_TRUE(GST_BUFFER_IS_DISCONT(rendered[0]));
+    for (gsize k = 0; k < rendered.size(); k++)
+    {
+        GstBuffer *buf = rendered[k];
+        guint n = gst_buffer_get_size(buf) / sizeof(gfloat);
+
+        EXPECT_EQ(GST_BUFFER_OFFSET(buf), frames) << "buffer " << k;
+        EXPECT_EQ(GST_BUFFER_OFFSET_END(buf), frames + n) << "buffer " << k;
+        EXPECT_EQ(GST_BUFFER_PTS(buf), GST_SECOND + gst_util_uint64_scale_int(frames, GST_SECOND, 48000))
+            << "buffer " << k;
+        EXPECT_EQ(GST_BUFFER_PTS(buf) + GST_BUFFER_DURATION(buf),
+                  GST_SECOND + gst_util_uint64_scale_int(frames + n, GST_SECOND, 48000))
+            << "buffer " << k;
+        frames += n;
+    }
+
+    EXPECT_EQ(frames, 9600u);
+    ASSERT_EQ(output.size(), 1u);
+    EXPECT_EQ(output[0].size(), 9600u);
+    GstBuffer *last = rendered.back();
+    EXPECT_EQ(GST_BUFFER_PTS(last) + GST_BUFFER_DURATION(last), GST_SECOND + 200 * GST_MSECOND);
+}
+
+// simdmixer 的元素测试：每路输入经过名为 a、b、c 的 capsfilter 接到混音器，
+// 混音器没有 GstChildProxy，pad 属性在解析之后直接设置到各路对应的请求 pad 上
+#define MIXER_CAPS "audio/x-raw,format=F32LE,layout=interleaved,rate=48000,channels=1"
+
+class MixerTest : public AudioFilterTest
+{
+protected:
+    // 混音器没有静态 sink pad，只记录输出
+    void launch_mixer(const gchar *description)
+    {
+        GError *error = nullptr;
+
+        pipeline = gst_parse_launch(description, &error);
+        ASSERT_EQ(error, nullptr) << error->message;
+        ASSERT_NE(pipeline, nullptr);
+
+        GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+        g_object_set(sink, "signal-handoffs", TRUE, NULL);
+        g_signal_connect(sink, "handoff", G_CALLBACK(on_handoff), this);
+        gst_object_unref(sink);
+    }
+
+    // 名为 name 的元素所连接的混音器 pad
+    GstPad *mixer_pad(const gchar *name)
+    {
+        GstElement *upstream = gst_bin_get_by_name(GST_BIN(pipeline), name);
+        GstPad *srcpad = gst_element_get_static_pad(upstream, "src");
+        GstPad *pad = gst_pad_get_peer(srcpad);
+
+        gst_object_unref(srcpad);
+        gst_object_unref(upstream);
+        return pad;
+    }
+};
+
+// 三路常数输入 0.25、0.125、0.5，音量分别为 1、2 和静音：输出是前两路之和 0.5，
+// 静音的一路不参与累加，输出缓冲区都不带 GAP 标志
+TEST_F(MixerTest, AppliesPadVolumeAndMute)
+{
+    launch_mixer("simdmixer name=mix ! " MIXER_CAPS " ! fakesink name=sink "
+                 "audiotestsrc num-buffers=20 samplesperbuffer=480 wave=square freq=1 volume=0.25 ! "
+                 "capsfilter name=a caps=" MIXER_CAPS " ! mix. "
+                 "audiotestsrc num-buffers=20 samplesperbuffer=480 wave=square freq=1 volume=0.125 ! "
+                 "capsfilter name=b caps=" MIXER_CAPS " ! mix. "
+                 "audiotestsrc num-buffers=20 samplesperbuffer=480 wave=square freq=1 volume=0.5 ! "
+                 "capsfilter name=c caps=" MIXER_CAPS " ! mix.");
+    GstPad *a = mixer_pad("a"), *b = mixer_pad("b"), *c = mixer_pad("c");
+
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    ASSERT_NE(c, nullptr);
+    g_object_set(a, "volume", 1.0, NULL);
+    g_object_set(b, "volume", 2.0, NULL);
+    g_object_set(c, "mute", TRUE, NULL);
+    gst_object_unref(a);
+    gst_object_unref(b);
+    gst_object_unref(c);
+
+    ASSERT_TRUE(run_to_eos());
+    // 1 Hz 方波的前半秒是 +volume，20 个缓冲区只有 0.2 秒
+    ASSERT_EQ(output.size(), 1u);
+    ASSERT_EQ(output[0].size(), 20u * 480);
+    for (gsize i = 0; i < output[0].size(); i++)
+        ASSERT_NEAR(output[0][i], 0.5, 1e-6) << "frame " << i;
+    for (gsize k = 0; k < rendered.size(); k++)
+        EXPECT_FALSE(GST_BUFFER_FLAG_IS_SET(rendered[k], GST_BUFFER_FLAG_GAP)) << "buffer " << k;
+}
+
+// 两路静音输入经过 silencegap，一路变成 GAP 缓冲区，一路变成 GAP 事件：
+// 没有任何输入被累加，每个输出缓冲区都带 GAP 标志且全为零
+TEST_F(MixerTest, AllGapInputsGiveGapOutput)
+{
+    launch_mixer("simdmixer name=mix ! " MIXER_CAPS " ! fakesink name=sink "
+                 "audiotestsrc num-buffers=20 samplesperbuffer=480 wave=silence ! "
+                 "capsfilter caps=" MIXER_CAPS " ! silencegap mode=buffer post-messages=false ! mix. "
+                 "audiotestsrc num-buffers=20 samplesperbuffer=480 wave=silence ! "
+                 "capsfilter caps=" MIXER_CAPS " ! silencegap mode=event post-messages=false ! mix.");
+    ASSERT_TRUE(run_to_eos());
+
+    ASSERT_FALSE(rendered.empty());
+    for (gsize k = 0; k < rendered.size(); k++)
+        EXPECT_TRUE(GST_BUFFER_FLAG_IS_SET(rendered[k], GST_BUFFER_FLAG_GAP)) << "buffer " << k;
+    ASSERT_EQ(output.size(), 1u);
+    ASSERT_EQ(output[0].size(), 20u * 480);
+    for (gsize i = 0; i < output[0].size(); i++)
+        ASSERT_EQ(output[0][i], 0.0) << "frame " << i;
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
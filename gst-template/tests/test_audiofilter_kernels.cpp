@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gstaudiofilterkernels.h"
+
+// 每种格式的优化内核与标量参考实现比较。整数格式的 tolerance 是绝对误差，
+// 只允许 1 LSB 的舍入差（SSE2 的转换按偶数舍入，标量实现远离零舍入），
+// 并且参考实现本身也要在 1 LSB 内等于按 double 计算并饱和的结果；
+// 浮点格式的 tolerance 是相对误差
+template <typename T>
+static void compare(GstAudioFormat format, gdouble gain, double tolerance)
+{
+    GstAudioFilterTemplateGainFunc ref_func = gst_audio_filter_template_gain_func_scalar(format);
+    GstAudioFilterTemplateGainFunc func = gst_audio_filter_template_gain_func(format);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    bool integral = std::is_integral<T>::value;
+    double scale = integral ? (double)std::numeric_limits<T>::max() : 1.0;
+
+    ASSERT_NE(ref_func, nullptr);
+    ASSERT_NE(func, nullptr);
+
+    // 不同长度覆盖向量主体和尾部；分别检查原地处理和读入写出分离的情况
+    for (guint n : {0u, 1u, 3u, 17u, 1024u, 1031u})
+    {
+        std::vector<T> src(n), ref(n), out(n), inplace;
+
+        for (auto &v : src)
+            v = (T)(dist(rng) * scale);
+        inplace = src;
+
+        ref_func(ref.data(), src.data(), n, gain);
+        func(out.data(), src.data(), n, gain);
+        func(inplace.data(), inplace.data(), n, gain);
+
+        for (guint i = 0; i < n; i++)
+        {
+            if (integral)
+            {
+                double expected = std::round((double)src[i] * gain);
+
+                expected = std::min(std::max(expected, (double)std::numeric_limits<T>::min()),
+                                    (double)std::numeric_limits<T>::max());
+                ASSERT_NEAR((double)ref[i], expected, tolerance) << "reference, n " << n << " sample " << i;
+                ASSERT_NEAR((double)out[i], (double)ref[i], tolerance) << "n " << n << " sample " << i;
+            }
+            else
+            {
+                ASSERT_NEAR((double)out[i], (double)ref[i], tolerance * (1.0 + std::fabs((double)ref[i])))
+                    << "n " << n << " sample " << i;
+            }
+            ASSERT_EQ(inplace[i], out[i]) << "in place, n " << n << " sample " << i;
+        }
+    }
+}
+
+TEST(AudioFilterKernels, S16) { compare<gint16>(GST_AUDIO_FORMAT_S16, 0.7, 1.0); }
+
+// 增益大于 1 时应饱和而不是回绕
+TEST(AudioFilterKernels, S16Saturates) { compare<gint16>(GST_AUDIO_FORMAT_S16, 4.0, 1.0); }
+
+TEST(AudioFilterKernels, S32) { compare<gint32>(GST_AUDIO_FORMAT_S32, 0.7, 1.0); }
+
+TEST(AudioFilterKernels, S32Saturates) { compare<gint32>(GST_AUDIO_FORMAT_S32, 4.0, 1.0); }
+
+TEST(AudioFilterKernels, F32) { compare<gfloat>(GST_AUDIO_FORMAT_F32, 0.7, 1e-6); }
+
+TEST(AudioFilterKernels, F64) { compare<gdouble>(GST_AUDIO_FORMAT_F64, 0.7, 1e-12); }
+
+TEST(AudioFilterKernels, UnsupportedFormat)
+{
+    EXPECT_EQ(gst_audio_filter_template_gain_func(GST_AUDIO_FORMAT_U8), nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
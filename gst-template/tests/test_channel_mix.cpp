@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "gstchannelmix.h"
+
+typedef std::tuple<guint, guint> Channels;
+
+// 每种声道数组合的内核与逐帧矩阵乘法比较，帧数不是 4 的倍数以覆盖尾部
+class ChannelMixTest : public ::testing::TestWithParam<Channels>
+{
+};
+
+TEST_P(ChannelMixTest, MatchesReference)
+{
+    guint in_ch = std::get<0>(GetParam()), out_ch = std::get<1>(GetParam()), frames = 1023;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<gfloat> matrix(in_ch * out_ch), in(frames * in_ch), out(frames * out_ch);
+
+    for (auto &g : matrix)
+        g = dist(rng);
+    for (auto &x : in)
+        x = dist(rng);
+
+    GstChannelMix *mix = gst_channel_mix_new(in_ch, out_ch, matrix.data());
+    EXPECT_FALSE(gst_channel_mix_is_reorder(mix));
+    gst_channel_mix_process(mix, in.data(), out.data(), frames);
+
+    for (guint f = 0; f < frames; f++)
+    {
+        for (guint o = 0; o < out_ch; o++)
+        {
+            double sum = 0.0;
+
+            for (guint i = 0; i < in_ch; i++)
+                sum += matrix[o * in_ch + i] * in[f * in_ch + i];
+            ASSERT_NEAR(out[f * out_ch + o], sum, 1e-5) << gst_channel_mix_get_kernel_name(mix) << " frame " << f;
+        }
+    }
+    gst_channel_mix_free(mix);
+}
+
+// 参数：专用内核的组合与一个走通用路径的组合
+INSTANTIATE_TEST_SUITE_P(Layouts, ChannelMixTest,
+                         ::testing::Values(Channels{1, 2}, Channels{2, 1}, Channels{6, 2}, Channels{8, 2},
+                                           Channels{8, 6}, Channels{3, 5}));
+
+// 单位矩阵与纯重排不做乘法
+TEST(ChannelMixMatrixTest, DetectsIdentityAndReorder)
+{
+    const gfloat identity[4] = {1, 0, 0, 1};
+    const gfloat swap[4] = {0, 1, 1, 0};
+    const gfloat gain[4] = {0.5f, 0, 0, 1};
+    const gfloat in[4] = {1, 2, 3, 4};
+    gfloat out[4];
+
+    GstChannelMix *mix = gst_channel_mix_new(2, 2, identity);
+    EXPECT_TRUE(gst_channel_mix_is_identity(mix));
+    gst_channel_mix_free(mix);
+
+    mix = gst_channel_mix_new(2, 2, swap);
+    EXPECT_FALSE(gst_channel_mix_is_identity(mix));
+    EXPECT_TRUE(gst_channel_mix_is_reorder(mix));
+    gst_channel_mix_process(mix, in, out, 2);
+    EXPECT_EQ(out[0], 2);
+    EXPECT_EQ(out[1], 1);
+    EXPECT_EQ(out[2], 4);
+    EXPECT_EQ(out[3], 3);
+    gst_channel_mix_free(mix);
+
+    mix = gst_channel_mix_new(2, 2, gain);
+    EXPECT_FALSE(gst_channel_mix_is_reorder(mix));
+    gst_channel_mix_free(mix);
+}
+
+// 5.1 下混为立体声：L = FL + 0.707 C + 0.707 RL，LFE 丢弃
+TEST(ChannelMixMatrixTest, StandardDownmix51)
+{
+    const GstAudioChannelPosition in[6] = {
+        GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT, GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT,
+        GST_AUDIO_CHANNEL_POSITION_FRONT_CENTER, GST_AUDIO_CHANNEL_POSITION_LFE1,
+        GST_AUDIO_CHANNEL_POSITION_REAR_LEFT, GST_AUDIO_CHANNEL_POSITION_REAR_RIGHT};
+    const GstAudioChannelPosition out[2] = {
+        GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT, GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT};
+    const gfloat expected[12] = {
+        1, 0, M_SQRT1_2, 0, M_SQRT1_2, 0,
+        0, 1, M_SQRT1_2, 0, 0, M_SQRT1_2};
+    gfloat matrix[12];
+
+    gst_channel_mix_standard_matrix(in, 6, out, 2, matrix);
+    for (guint i = 0; i < 12; i++)
+        EXPECT_NEAR(matrix[i], expected[i], 1e-6) << "gain " << i;
+}
+
+// 声道相同只是顺序不同：得到重排
+TEST(ChannelMixMatrixTest, StandardReorder)
+{
+    const GstAudioChannelPosition in[3] = {
+        GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT, GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT,
+        GST_AUDIO_CHANNEL_POSITION_FRONT_CENTER};
+    const GstAudioChannelPosition out[3] = {
+        GST_AUDIO_CHANNEL_POSITION_FRONT_CENTER, GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT,
+        GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT};
+    gfloat matrix[9];
+
+    gst_channel_mix_standard_matrix(in, 3, out, 3, matrix);
+    GstChannelMix *mix = gst_channel_mix_new(3, 3, matrix);
+    EXPECT_TRUE(gst_channel_mix_is_reorder(mix));
+    EXPECT_FALSE(gst_channel_mix_is_identity(mix));
+    gst_channel_mix_free(mix);
+}
+
+// 立体声到单声道取平均，单声道到立体声各 -3 dB
+TEST(ChannelMixMatrixTest, StandardMono)
+{
+    const GstAudioChannelPosition stereo[2] = {
+        GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT, GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT};
+    const GstAudioChannelPosition mono[1] = {GST_AUDIO_CHANNEL_POSITION_MONO};
+    gfloat matrix[2];
+
+    gst_channel_mix_standard_matrix(stereo, 2, mono, 1, matrix);
+    EXPECT_FLOAT_EQ(matrix[0], 0.5f);
+    EXPECT_FLOAT_EQ(matrix[1], 0.5f);
+
+    gst_channel_mix_standard_matrix(mono, 1, stereo, 2, matrix);
+    EXPECT_NEAR(matrix[0], M_SQRT1_2, 1e-6);
+    EXPECT_NEAR(matrix[1], M_SQRT1_2, 1e-6);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
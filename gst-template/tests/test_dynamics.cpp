@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gstdynamics.h"
+#include "gsttruepeak.h"
+
+static const guint RATE = 48000;
+
+static GstDynamicsParams limiter(double threshold)
+{
+    GstDynamicsParams params = {threshold, 0.0, 0.0, 0.0, 5.0, 50.0, TRUE, FALSE};
+    return params;
+}
+
+// 交织的多声道正弦，每个声道单独给出幅度
+static std::vector<gfloat> sine(double freq, double phase, const std::vector<double> &amplitude, guint frames)
+{
+    guint ch = amplitude.size();
+    std::vector<gfloat> data(frames * ch);
+
+    for (guint i = 0; i < frames; i++)
+        for (guint c = 0; c < ch; c++)
+            data[i * ch + c] = (gfloat)(amplitude[c] * std::sin(2.0 * M_PI * freq * i / RATE + phase));
+    return data;
+}
+
+static gfloat peak(const std::vector<gfloat> &data, guint start, guint ch = 1, guint c = 0)
+{
+    gfloat m = 0.0f;
+
+    for (size_t i = start * ch + c; i < data.size(); i += ch)
+        m = std::max(m, std::fabs(data[i]));
+    return m;
+}
+
+// 低于阈值时输出是输入精确延迟 latency 帧
+TEST(DynamicsTest, DelaysByLatency)
+{
+    GstDynamics *dyn = gst_dynamics_new(RATE, 2, 240);
+    GstDynamicsParams params = limiter(0.0);
+    std::vector<gfloat> in = sine(997.0, 0.0, {0.5, 0.25}, 4000), out = in;
+    guint latency = gst_dynamics_get_latency(dyn);
+
+    gst_dynamics_set_params(dyn, &params);
+    gst_dynamics_process(dyn, out.data(), 4000);
+
+    EXPECT_GE(latency, 240u);
+    for (guint i = 0; i < latency * 2; i++)
+        ASSERT_EQ(out[i], 0.0f);
+    for (guint i = latency * 2; i < out.size(); i++)
+        ASSERT_EQ(out[i], in[i - latency * 2]) << "sample " << i;
+    gst_dynamics_free(dyn);
+}
+
+// 限幅器：从第一个样本起输出都不超过阈值，分块处理结果与整块一致
+TEST(DynamicsTest, LimiterNeverOvershoots)
+{
+    GstDynamics *a = gst_dynamics_new(RATE, 1, 96);
+    GstDynamics *b = gst_dynamics_new(RATE, 1, 96);
+    GstDynamicsParams params = limiter(-6.0);
+    std::vector<gfloat> in = sine(1000.0, 0.0, {1.0}, RATE);
+    std::vector<gfloat> out_a = in, out_b = in;
+
+    gst_dynamics_set_params(a, &params);
+    gst_dynamics_set_params(b, &params);
+    gst_dynamics_process(a, out_a.data(), RATE);
+    for (guint done = 0, chunk = 1; done < RATE; chunk = chunk * 7 % 501 + 1)
+    {
+        guint n = std::min(chunk, RATE - done);
+
+        gst_dynamics_process(b, &out_b[done], n);
+        done += n;
+    }
+
+    EXPECT_LE(peak(out_a, 0), std::pow(10.0, -6.0 / 20.0) + 1e-6);
+    EXPECT_GT(peak(out_a, RATE / 2), std::pow(10.0, -6.5 / 20.0));
+    EXPECT_EQ(out_a, out_b);
+    gst_dynamics_free(a);
+    gst_dynamics_free(b);
+}
+
+// 压缩器 2:1，阈值 -20 dB：-10 dBFS 的输入稳定在 -15 dBFS
+TEST(DynamicsTest, CompressorRatio)
+{
+    GstDynamics *dyn = gst_dynamics_new(RATE, 1, 0);
+    GstDynamicsParams params = {-20.0, 2.0, 0.0, 0.0, 0.0, 20.0, TRUE, FALSE};
+    // 3 kHz 每 16 个样本一个周期，每块都含有正峰值
+    std::vector<gfloat> data = sine(3000.0, 0.0, {std::pow(10.0, -10.0 / 20.0)}, RATE);
+
+    gst_dynamics_set_params(dyn, &params);
+    gst_dynamics_process(dyn, data.data(), RATE);
+
+    EXPECT_NEAR(20.0 * std::log10(peak(data, RATE / 2)), -15.0, 0.05);
+    gst_dynamics_free(dyn);
+}
+
+// 响亮段之后增益按释放时间恢复
+TEST(DynamicsTest, Release)
+{
+    GstDynamics *dyn = gst_dynamics_new(RATE, 1, 0);
+    GstDynamicsParams params = limiter(-20.0);
+    std::vector<gfloat> loud = sine(3000.0, 0.0, {1.0}, RATE / 2);
+    std::vector<gfloat> quiet = sine(3000.0, 0.0, {0.01}, RATE);
+
+    gst_dynamics_set_params(dyn, &params);
+    gst_dynamics_process(dyn, loud.data(), RATE / 2);
+    gst_dynamics_process(dyn, quiet.data(), RATE);
+
+    // 释放 50 ms，半秒后增益已恢复到 1
+    EXPECT_NEAR(peak(quiet, RATE / 2), 0.01, 1e-4);
+    gst_dynamics_free(dyn);
+}
+
+// 联动检测时响亮声道也压低安静声道，独立检测时不影响
+TEST(DynamicsTest, LinkedAndIndependent)
+{
+    for (gboolean linked : {TRUE, FALSE})
+    {
+        GstDynamics *dyn = gst_dynamics_new(RATE, 2, 64);
+        GstDynamicsParams params = limiter(-12.0);
+        std::vector<gfloat> data = sine(3000.0, 0.0, {1.0, 0.1}, RATE / 2);
+
+        params.linked = linked;
+        gst_dynamics_set_params(dyn, &params);
+        gst_dynamics_process(dyn, data.data(), RATE / 2);
+
+        EXPECT_NEAR(peak(data, RATE / 4, 2, 0), std::pow(10.0, -12.0 / 20.0), 1e-3);
+        if (linked)
+            EXPECT_NEAR(peak(data, RATE / 4, 2, 1), 0.1 * std::pow(10.0, -12.0 / 20.0), 1e-3);
+        else
+            EXPECT_NEAR(peak(data, RATE / 4, 2, 1), 0.1, 1e-6);
+        gst_dynamics_free(dyn);
+    }
+}
+
+// fs/4、相位 45 度的正弦：采样峰值 0.707，真峰值 1，只有真峰值检测会压低
+TEST(DynamicsTest, TruePeakDetection)
+{
+    for (gboolean true_peak : {FALSE, TRUE})
+    {
+        GstDynamics *dyn = gst_dynamics_new(RATE, 1, 64);
+        GstDynamicsParams params = limiter(-1.0);
+        std::vector<gfloat> data = sine(RATE / 4.0, M_PI / 4.0, {1.0}, RATE / 2);
+
+        params.true_peak = true_peak;
+        gst_dynamics_set_params(dyn, &params);
+        gst_dynamics_process(dyn, data.data(), RATE / 2);
+
+        if (true_peak)
+            EXPECT_NEAR(peak(data, RATE / 4), M_SQRT1_2 * std::pow(10.0, -1.0 / 20.0), 0.02);
+        else
+            EXPECT_NEAR(peak(data, RATE / 4), M_SQRT1_2, 1e-6);
+        gst_dynamics_free(dyn);
+    }
+}
+
+// 单声道信号的真峰值，用与限幅器相同的插值器测量
+static gfloat true_peak(const std::vector<gfloat> &data)
+{
+    GstTruePeak *tp = gst_true_peak_new(1);
+    gfloat peak = 0.0f, sample = 0.0f;
+
+    gst_true_peak_process(tp, data.data(), data.size(), &peak, &sample);
+    gst_true_peak_free(tp);
+    return std::max(peak, sample);
+}
+
+// 块边界附近的脉冲和样本间峰值：插值器滞后几帧，块末尾的峰值在下一块才被看到，
+// 但仍要压低它所在的块。每个位置的输出采样峰值和真峰值都不超过阈值
+TEST(DynamicsTest, TruePeakCeilingAtBlockBoundary)
+{
+    const double ceiling = std::pow(10.0, -6.0 / 20.0);
+
+    for (guint pos = 280; pos < 360; pos++)
+    {
+        for (guint width : {1u, 2u})
+        {
+            GstDynamics *dyn = gst_dynamics_new(RATE, 1, 64);
+            GstDynamicsParams params = limiter(-6.0);
+            std::vector<gfloat> data(2000, 0.0f);
+
+            // 两个相邻的 0.8 之间的真峰值约为 0.97
+            for (guint i = 0; i < width; i++)
+                data[pos + i] = width == 1 ? 1.0f : 0.8f;
+
+            params.true_peak = TRUE;
+            gst_dynamics_set_params(dyn, &params);
+            gst_dynamics_process(dyn, data.data(), data.size());
+
+            EXPECT_LE(peak(data, 0), ceiling + 1e-6) << "width " << width << " at " << pos;
+            EXPECT_LE(true_peak(data), ceiling + 1e-3) << "width " << width << " at " << pos;
+            gst_dynamics_free(dyn);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gstfirengine.h"
+
+// 分段重叠保留卷积与直接卷积比较，输出整体延迟 latency 个样本
+class FirEngineTest : public ::testing::TestWithParam<bool>
+{
+protected:
+    std::vector<gfloat> taps, input;
+
+    void SetUp() override
+    {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+        taps.resize(300);
+        for (auto &t : taps)
+            t = dist(rng) * 0.1f;
+        input.resize(1500);
+        for (auto &x : input)
+            x = dist(rng);
+    }
+
+    gfloat direct(guint n)
+    {
+        double sum = 0.0;
+
+        for (guint k = 0; k < taps.size() && k <= n; k++)
+            sum += taps[k] * input[n - k];
+        return (gfloat)sum;
+    }
+
+    // stride 大于 1 时模拟交织的多声道数据，并原地处理
+    void run(guint stride)
+    {
+        GstFirEngine *engine = gst_fir_engine_new(taps.data(), taps.size(), 8, GetParam(), 64);
+        GstFirEngineChannel *channel = gst_fir_engine_channel_new(engine);
+        guint latency = gst_fir_engine_get_latency(engine);
+        std::vector<gfloat> data(input.size() * stride);
+        guint done = 0, chunk = 1;
+
+        for (guint i = 0; i < input.size(); i++)
+            data[i * stride] = input[i];
+
+        // 不规则的块长度，覆盖跨块边界的情况
+        while (done < input.size())
+        {
+            guint n = std::min<guint>(chunk, input.size() - done);
+
+            gst_fir_engine_channel_process(channel, &data[done * stride], &data[done * stride], n, stride);
+            done += n;
+            chunk = chunk * 3 % 37 + 1;
+        }
+
+        EXPECT_EQ(latency, 8u);
+        for (guint i = 0; i < latency; i++)
+            ASSERT_EQ(data[i * stride], 0.0f);
+        for (guint i = latency; i < input.size(); i++)
+            ASSERT_NEAR(data[i * stride], direct(i - latency), 1e-4) << "sample " << i;
+
+        gst_fir_engine_channel_free(channel);
+        gst_fir_engine_free(engine);
+    }
+};
+
+TEST_P(FirEngineTest, MatchesDirectConvolution)
+{
+    run(1);
+}
+
+TEST_P(FirEngineTest, MatchesDirectConvolutionStrided)
+{
+    run(3);
+}
+
+// 参数：是否使用非均匀分段
+INSTANTIATE_TEST_SUITE_P(Partitioning, FirEngineTest, ::testing::Values(false, true));
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+#include "gstloudness.h"
+
+static const guint RATE = 48000;
+
+// 生成交织的立体声正弦，两个声道相同
+static std::vector<gfloat> sine(double freq, double amplitude, double phase, guint frames)
+{
+    std::vector<gfloat> data(frames * 2);
+
+    for (guint i = 0; i < frames; i++)
+        data[2 * i] = data[2 * i + 1] = (gfloat)(amplitude * std::sin(2.0 * M_PI * freq * i / RATE + phase));
+    return data;
+}
+
+// EBU Tech 3341：-20 dBFS、997 Hz 的立体声正弦应读作 -20 LUFS
+TEST(LoudnessTest, SineReadsMinus20Lufs)
+{
+    GstLoudness *l = gst_loudness_new(RATE, 2, NULL);
+    std::vector<gfloat> data = sine(997.0, std::pow(10.0, -20.0 / 20.0), 0.0, RATE * 5);
+
+    // 不规则的块长度，覆盖跨子块边界的情况
+    for (guint done = 0, chunk = 1; done < RATE * 5; chunk = chunk * 7 % 1999 + 1)
+    {
+        guint n = std::min(chunk, RATE * 5 - done);
+
+        gst_loudness_process_f32(l, &data[done * 2], n);
+        done += n;
+    }
+
+    EXPECT_NEAR(gst_loudness_momentary(l), -20.0, 0.1);
+    EXPECT_NEAR(gst_loudness_short_term(l), -20.0, 0.1);
+    EXPECT_NEAR(gst_loudness_integrated(l), -20.0, 0.1);
+    EXPECT_NEAR(gst_loudness_range(l), 0.0, 0.2);
+    gst_loudness_free(l);
+}
+
+// S16 输入与 F32 输入结果一致
+TEST(LoudnessTest, S16MatchesF32)
+{
+    GstLoudness *a = gst_loudness_new(RATE, 2, NULL);
+    GstLoudness *b = gst_loudness_new(RATE, 2, NULL);
+    std::vector<gfloat> data = sine(440.0, 0.25, 0.0, RATE * 2);
+    std::vector<gint16> s16(data.size());
+
+    for (size_t i = 0; i < data.size(); i++)
+        s16[i] = (gint16)std::lrint(data[i] * 32768.0f);
+    gst_loudness_process_f32(a, data.data(), RATE * 2);
+    gst_loudness_process_s16(b, s16.data(), RATE * 2);
+
+    EXPECT_NEAR(gst_loudness_integrated(a), gst_loudness_integrated(b), 0.01);
+    EXPECT_NEAR(gst_loudness_sample_peak(a, 0), gst_loudness_sample_peak(b, 0), 1e-4);
+    gst_loudness_free(a);
+    gst_loudness_free(b);
+}
+
+// 相对门限：一段 -20 LUFS 后接 -40 LUFS，后者被门限排除
+TEST(LoudnessTest, RelativeGateDropsQuietPart)
+{
+    GstLoudness *l = gst_loudness_new(RATE, 2, NULL);
+    std::vector<gfloat> loud = sine(997.0, 0.1, 0.0, RATE * 10);
+    std::vector<gfloat> quiet = sine(997.0, 0.01, 0.0, RATE * 10);
+
+    gst_loudness_process_f32(l, loud.data(), RATE * 10);
+    gst_loudness_process_f32(l, quiet.data(), RATE * 10);
+
+    EXPECT_NEAR(gst_loudness_integrated(l), -20.0, 0.2);
+    // 两段的短期响度相差 20 LU，都在 LRA 门限之内
+    EXPECT_NEAR(gst_loudness_range(l), 20.0, 0.5);
+    gst_loudness_free(l);
+}
+
+// fs/4 正弦相位 45 度：采样点都在 0.707，真峰值接近 1
+TEST(LoudnessTest, TruePeakBetweenSamples)
+{
+    GstLoudness *l = gst_loudness_new(RATE, 2, NULL);
+    std::vector<gfloat> data = sine(RATE / 4.0, 1.0, M_PI / 4.0, RATE);
+
+    gst_loudness_process_f32(l, data.data(), RATE);
+
+    EXPECT_NEAR(gst_loudness_sample_peak(l, 0), M_SQRT1_2, 1e-4);
+    EXPECT_NEAR(gst_loudness_true_peak(l, 0), 1.0, 0.05);
+    EXPECT_NEAR(gst_loudness_true_peak(l, 1), 1.0, 0.05);
+
+    gst_loudness_reset(l);
+    EXPECT_EQ(gst_loudness_true_peak(l, 0), 0.0);
+    EXPECT_TRUE(std::isinf(gst_loudness_integrated(l)));
+    gst_loudness_free(l);
+}
+
+// LFE 权重为 0，不计入响度
+TEST(LoudnessTest, ChannelWeights)
+{
+    const gdouble weights[3] = {1.0, 1.0, 0.0};
+    GstLoudness *l = gst_loudness_new(RATE, 3, weights);
+    std::vector<gfloat> data(RATE * 3 * 3);
+
+    for (guint i = 0; i < RATE * 3; i++)
+        data[3 * i + 2] = (gfloat)std::sin(2.0 * M_PI * 50.0 * i / RATE);
+    gst_loudness_process_f32(l, data.data(), RATE * 3);
+
+    EXPECT_TRUE(std::isinf(gst_loudness_integrated(l)));
+    EXPECT_NEAR(gst_loudness_sample_peak(l, 2), 1.0, 1e-3);
+    gst_loudness_free(l);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gstmixkernels.h"
+
+// 每个 ISA 变体的累加结果都与标量参考实现比较
+class MixKernelTest : public ::testing::TestWithParam<GstMixIsa>
+{
+protected:
+    const GstMixKernels *scalar, *kernels;
+
+    void SetUp() override
+    {
+        scalar = gst_mix_kernels_get(GST_MIX_ISA_SCALAR);
+        ASSERT_NE(scalar, nullptr);
+
+        if (!gst_mix_isa_supported(GetParam()))
+            GTEST_SKIP() << "ISA level not supported on this CPU";
+        kernels = gst_mix_kernels_get(GetParam());
+        ASSERT_NE(kernels, nullptr);
+        ASSERT_EQ(kernels->isa, GetParam());
+    }
+};
+
+// S16：包括接近满幅的输入，饱和后必须逐样本相同
+TEST_P(MixKernelTest, S16MatchesScalar)
+{
+    for (gfloat volume : {1.0f, 0.5f, 0.3333f, 2.5f})
+        for (guint n : {0u, 1u, 7u, 8u, 15u, 16u, 33u, 1000u})
+        {
+            std::mt19937 rng(n + (guint)(volume * 100));
+            std::uniform_int_distribution<int> dist(-32768, 32767);
+            std::vector<gint16> src(n + 1), ref(n + 1), out;
+
+            for (guint i = 0; i <= n; i++)
+            {
+                src[i] = (gint16)dist(rng);
+                ref[i] = (gint16)dist(rng);
+            }
+            out = ref;
+
+            scalar->accumulate_s16(ref.data(), src.data(), n, volume);
+            kernels->accumulate_s16(out.data(), src.data(), n, volume);
+            for (guint i = 0; i <= n; i++)
+                ASSERT_EQ(out[i], ref[i]) << kernels->name << " volume " << volume << " n " << n << " sample " << i;
+        }
+}
+
+TEST_P(MixKernelTest, F32MatchesScalar)
+{
+    for (gfloat volume : {1.0f, 0.5f, 0.3333f, 2.5f})
+        for (guint n : {0u, 1u, 7u, 8u, 15u, 16u, 33u, 1000u})
+        {
+            std::mt19937 rng(n);
+            std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+            std::vector<gfloat> src(n + 1), ref(n + 1), out;
+
+            for (guint i = 0; i <= n; i++)
+            {
+                src[i] = dist(rng);
+                ref[i] = dist(rng);
+            }
+            out = ref;
+
+            scalar->accumulate_f32(ref.data(), src.data(), n, volume);
+            kernels->accumulate_f32(out.data(), src.data(), n, volume);
+            for (guint i = 0; i <= n; i++)
+                ASSERT_NEAR(out[i], ref[i], 1e-6f) << kernels->name << " n " << n << " sample " << i;
+        }
+}
+
+// 饱和：同号大信号相加截到满幅，而不是回绕
+TEST_P(MixKernelTest, S16Saturates)
+{
+    std::vector<gint16> dest(32, 30000), src(32, 10000);
+
+    kernels->accumulate_s16(dest.data(), src.data(), 32, 1.0f);
+    for (gint16 v : dest)
+        ASSERT_EQ(v, 32767);
+
+    std::fill(dest.begin(), dest.end(), -30000);
+    kernels->accumulate_s16(dest.data(), src.data(), 32, -1.5f);
+    for (gint16 v : dest)
+        ASSERT_EQ(v, -32768);
+
+    // 音量放大后单个输入本身也先饱和
+    std::fill(dest.begin(), dest.end(), 0);
+    std::fill(src.begin(), src.end(), 20000);
+    kernels->accumulate_s16(dest.data(), src.data(), 32, 4.0f);
+    for (gint16 v : dest)
+        ASSERT_EQ(v, 32767);
+}
+
+// 多路累加与按定义计算的和一致
+TEST_P(MixKernelTest, MixesManyInputs)
+{
+    const guint n = 1024, inputs = 32;
+    std::vector<std::vector<gfloat>> src(inputs, std::vector<gfloat>(n));
+    std::vector<gfloat> out(n, 0.0f);
+    std::vector<double> expected(n, 0.0);
+
+    for (guint k = 0; k < inputs; k++)
+        for (guint i = 0; i < n; i++)
+        {
+            src[k][i] = (gfloat)std::sin(0.01 * (i + 1) * (k + 1));
+            expected[i] += src[k][i] * 0.25;
+        }
+    for (guint k = 0; k < inputs; k++)
+        kernels->accumulate_f32(out.data(), src[k].data(), n, 0.25f);
+    for (guint i = 0; i < n; i++)
+        ASSERT_NEAR(out[i], expected[i], 1e-5);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllIsa, MixKernelTest,
+                         ::testing::Values(GST_MIX_ISA_SCALAR, GST_MIX_ISA_SSE2, GST_MIX_ISA_AVX2));
+
+// AUTO 总是得到本机支持的最高级别，不支持的格式没有内核
+TEST(MixKernelDispatch, AutoPicksBest)
+{
+    const GstMixKernels *k = gst_mix_kernels_get(GST_MIX_ISA_AUTO);
+
+    ASSERT_NE(k, nullptr);
+    EXPECT_EQ(k->isa, gst_mix_isa_best());
+    EXPECT_EQ(gst_mix_kernels_accumulate(k, GST_AUDIO_FORMAT_S16), k->accumulate_s16);
+    EXPECT_EQ(gst_mix_kernels_accumulate(k, GST_AUDIO_FORMAT_F64), nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
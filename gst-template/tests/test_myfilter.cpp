@@ -0,0 +1,725 @@
+#include <gst/gst.h>
+#include <gst/video/gstvideopool.h>
+#include <gst/video/video.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <set>
+#include <vector>
+
+// my_filter 的无界面测试：使用 videotestsrc 和 fakesink，不依赖视频文件和显示设备
+class MyFilterTest : public ::testing::Test
+{
+protected:
+    GstElement *pipeline;
+    guint handoff_count;
+    GstClockTime last_pts;
+    gboolean pts_in_order;
+    guint8 first_byte, last_byte;
+    gsize last_size;
+    std::vector<guint> list_sizes;
+
+    void SetUp() override
+    {
+        gst_init(nullptr, nullptr);
+        pipeline = nullptr;
+        handoff_count = 0;
+        last_pts = GST_CLOCK_TIME_NONE;
+        pts_in_order = TRUE;
+        last_size = 0;
+        list_sizes.clear();
+    }
+
+    void TearDown() override
+    {
+        if (pipeline)
+        {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+        }
+    }
+
+    // 根据描述创建管道，并统计 fakesink 收到的缓冲区数量
+    void launch(const gchar *description)
+    {
+        GError *error = nullptr;
+
+        pipeline = gst_parse_launch(description, &error);
+        ASSERT_EQ(error, nullptr) << error->message;
+        ASSERT_NE(pipeline, nullptr);
+
+        GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+        ASSERT_NE(sink, nullptr);
+        g_object_set(sink, "signal-handoffs", TRUE, NULL);
+        g_signal_connect(sink, "handoff", G_CALLBACK(on_handoff), this);
+        gst_object_unref(sink);
+    }
+
+    // 记录 fakesink 收到的每个缓冲区列表的长度
+    void watch_lists()
+    {
+        GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+        GstPad *pad = gst_element_get_static_pad(sink, "sink");
+
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER_LIST, on_list, this, NULL);
+        gst_object_unref(pad);
+        gst_object_unref(sink);
+    }
+
+    static GstPadProbeReturn on_list(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+    {
+        MyFilterTest *test = (MyFilterTest *)data;
+
+        test->list_sizes.push_back(gst_buffer_list_length(GST_PAD_PROBE_INFO_BUFFER_LIST(info)));
+        return GST_PAD_PROBE_OK;
+    }
+
+    // 运行管道直到 EOS 或错误，返回是否正常结束
+    gboolean run_to_eos()
+    {
+        GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+        GstMessage *msg;
+        gboolean eos;
+
+        if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+        {
+            gst_object_unref(bus);
+            return FALSE;
+        }
+
+        msg = gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND,
+                                         (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        eos = msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+        if (msg)
+            gst_message_unref(msg);
+        gst_object_unref(bus);
+        return eos;
+    }
+
+    // 统计缓冲区数量并检查 PTS 是否保持输入顺序
+    static void on_handoff(GstElement *sink, GstBuffer *buf, GstPad *pad, gpointer data)
+    {
+        MyFilterTest *test = (MyFilterTest *)data;
+        GstClockTime pts = GST_BUFFER_PTS(buf);
+
+        test->handoff_count++;
+        if (GST_CLOCK_TIME_IS_VALID(test->last_pts) && pts <= test->last_pts)
+            test->pts_in_order = FALSE;
+        test->last_pts = pts;
+        test->last_size = gst_buffer_get_size(buf);
+
+        gst_buffer_extract(buf, 0, &test->first_byte, 1);
+        gst_buffer_extract(buf, gst_buffer_get_size(buf) - 1, &test->last_byte, 1);
+    }
+};
+
+// 批处理模式下所有缓冲区都应到达下游，EOS 时剩余的不完整批次也要推送
+TEST_F(MyFilterTest, BatchingForwardsAllBuffers)
+{
+    launch("videotestsrc num-buffers=30 ! my_filter silent=true batch-size=4 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 30u);
+}
+
+// 按时间窗口分批：30fps 下 100ms 窗口，时间戳跨度达到 100ms 的第 4 帧触发推送，
+// 批大小设得很大，所以每个列表都是由时间窗口截断的；剩余 2 帧在 EOS 时推送
+TEST_F(MyFilterTest, BatchingByTimeWindow)
+{
+    launch("videotestsrc num-buffers=30 ! video/x-raw,framerate=30/1 ! "
+           "my_filter silent=true batch-size=1000 batch-time=100000000 ! fakesink name=sink");
+    watch_lists();
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 30u);
+    EXPECT_EQ(list_sizes, std::vector<guint>({4, 4, 4, 4, 4, 4, 4, 2}));
+}
+
+// 统计属性在 EOS 后应与实际通过的数据一致
+TEST_F(MyFilterTest, StatisticsCountBuffersAndBytes)
+{
+    guint64 buffers = 0, bytes = 0, drops = 0;
+
+    launch("videotestsrc num-buffers=20 ! video/x-raw,format=GRAY8,width=64,height=48 ! "
+           "my_filter name=filter silent=true ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    g_object_get(filter, "buffers", &buffers, "bytes", &bytes, "drops", &drops, NULL);
+    gst_object_unref(filter);
+
+    EXPECT_EQ(buffers, 20u);
+    EXPECT_EQ(bytes, 20u * 64 * 48);
+    EXPECT_EQ(drops, 0u);
+}
+
+// 第一个实例打戳，第二个实例测量，延迟百分位应单调不减
+TEST_F(MyFilterTest, LatencyHistogramFromTimingMeta)
+{
+    guint64 count = 0, p50 = 0, p99 = 0, p999 = 0;
+
+    launch("videotestsrc num-buffers=30 ! my_filter silent=true timing-mode=stamp ! "
+           "videoconvert ! queue ! my_filter name=filter silent=true timing-mode=measure ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    g_object_get(filter, "latency-count", &count, "latency-p50", &p50,
+                 "latency-p99", &p99, "latency-p999", &p999, NULL);
+    gst_object_unref(filter);
+
+    EXPECT_EQ(count, 30u);
+    EXPECT_NE(p50, GST_CLOCK_TIME_NONE);
+    EXPECT_LE(p50, p99);
+    EXPECT_LE(p99, p999);
+}
+
+// 第一帧到达 my_filter 之前，从 src pad 发出一个 QOS 事件，声明 1.5s 之前的帧都已迟到
+static GstPadProbeReturn on_first_buffer_send_qos(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstPad *srcpad = (GstPad *)data;
+
+    gst_pad_send_event(srcpad, gst_event_new_qos(GST_QOS_TYPE_UNDERFLOW, 2.0,
+                                                 GST_SECOND / 2, GST_SECOND / 2));
+    return GST_PAD_PROBE_REMOVE;
+}
+
+struct QosMessages
+{
+    guint count;
+    guint64 processed, dropped;
+};
+
+static void on_qos_message(GstBus *bus, GstMessage *msg, gpointer data)
+{
+    QosMessages *qos = (QosMessages *)data;
+    GstFormat format;
+
+    qos->count++;
+    gst_message_parse_qos_stats(msg, &format, &qos->processed, &qos->dropped);
+}
+
+// 收到迟到的 QOS 事件后丢弃早于 earliest time 的帧，发送 QoS 消息，并计入 drops
+TEST_F(MyFilterTest, QosDropsLateFrames)
+{
+    QosMessages qos = {0, 0, 0};
+    guint64 drops = 0;
+
+    launch("videotestsrc num-buffers=90 ! video/x-raw,framerate=30/1 ! "
+           "my_filter name=filter silent=true ! fakesink name=sink");
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    GstPad *sinkpad = gst_element_get_static_pad(filter, "sink");
+    GstPad *srcpad = gst_element_get_static_pad(filter, "src");
+    gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, on_first_buffer_send_qos, srcpad, NULL);
+
+    GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+    gst_bus_enable_sync_message_emission(bus);
+    g_signal_connect(bus, "sync-message::qos", G_CALLBACK(on_qos_message), &qos);
+
+    ASSERT_TRUE(run_to_eos());
+    gst_bus_disable_sync_message_emission(bus);
+    gst_object_unref(bus);
+
+    g_object_get(filter, "drops", &drops, NULL);
+    gst_object_unref(srcpad);
+    gst_object_unref(sinkpad);
+    gst_object_unref(filter);
+
+    // earliest = 0.5s + 2 * 0.5s + 1/30s：PTS 0 到 1.5s 的 46 帧结束时间不晚于它
+    EXPECT_EQ(drops, 46u);
+    EXPECT_EQ(handoff_count, 90u - 46u);
+    EXPECT_EQ(qos.count, 46u);
+    EXPECT_EQ(qos.dropped, 46u);
+    EXPECT_EQ(qos.processed, 0u);
+    EXPECT_TRUE(pts_in_order);
+}
+
+// 记录上游收到的 ALLOCATION 查询结果
+static GstPadProbeReturn on_allocation(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstQuery *query = GST_PAD_PROBE_INFO_QUERY(info);
+    GstBufferPool **pool = (GstBufferPool **)data;
+
+    if (GST_QUERY_TYPE(query) == GST_QUERY_ALLOCATION && *pool == NULL &&
+        gst_query_get_n_allocation_pools(query) > 0)
+        gst_query_parse_nth_allocation_pool(query, 0, pool, NULL, NULL, NULL);
+    return GST_PAD_PROBE_OK;
+}
+
+// 记录进入 my_filter 的缓冲区来自哪个缓冲池，以及不同的缓冲区对象
+struct PoolUsage
+{
+    std::set<GstBufferPool *> pools;
+    std::set<GstBuffer *> buffers;
+};
+
+static GstPadProbeReturn on_pool_buffer(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    PoolUsage *usage = (PoolUsage *)data;
+
+    usage->pools.insert(buf->pool);
+    usage->buffers.insert(buf);
+    return GST_PAD_PROBE_OK;
+}
+
+// fakesink 不提供缓冲池时，my_filter 提议 64 字节对齐的视频缓冲池，
+// 上游从池中取缓冲区，稳态下反复使用少数几个缓冲区
+TEST_F(MyFilterTest, ProposesAlignedVideoPool)
+{
+    GstBufferPool *pool = nullptr;
+    GstAllocationParams params;
+    GstStructure *config;
+    PoolUsage usage;
+
+    launch("videotestsrc name=src num-buffers=50 ! video/x-raw,format=I420,width=320,height=240 ! "
+           "my_filter name=filter silent=true ! fakesink name=sink enable-last-sample=false");
+
+    GstElement *src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    GstPad *srcpad = gst_element_get_static_pad(src, "src");
+    gst_pad_add_probe(srcpad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PULL),
+                      on_allocation, &pool, NULL);
+    gst_object_unref(srcpad);
+    gst_object_unref(src);
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    GstPad *sinkpad = gst_element_get_static_pad(filter, "sink");
+    gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, on_pool_buffer, &usage, NULL);
+    gst_object_unref(sinkpad);
+    gst_object_unref(filter);
+
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 50u);
+
+    ASSERT_NE(pool, nullptr);
+    EXPECT_TRUE(GST_IS_VIDEO_BUFFER_POOL(pool));
+    config = gst_buffer_pool_get_config(pool);
+    ASSERT_TRUE(gst_buffer_pool_config_get_allocator(config, NULL, &params));
+    EXPECT_EQ(params.align, 63u);
+    gst_structure_free(config);
+
+    // 所有缓冲区都来自提议的缓冲池，并且被循环使用
+    EXPECT_EQ(usage.pools, std::set<GstBufferPool *>({pool}));
+    EXPECT_LE(usage.buffers.size(), 8u);
+    gst_object_unref(pool);
+}
+
+// 工作线程中按帧序号延长处理时间：每 4 帧中第一帧最慢，后面的帧先处理完。
+// 元素在工作线程中通过 gst_video_frame_map 访问帧，测试在输入缓冲区的 GstVideoMeta
+// 上挂自己的 map/unmap：map 时休眠，unmap 时记录完成顺序
+static std::atomic<guint> completed_out_of_order{0};
+static std::atomic<guint64> last_done{0};
+
+static gboolean slow_map(GstVideoMeta *meta, guint plane, GstMapInfo *info, gpointer *data, gint *stride,
+                         GstMapFlags flags)
+{
+    if (plane == 0)
+        g_usleep((3 - GST_BUFFER_OFFSET(meta->buffer) % 4) * 5000);
+    if (!gst_buffer_map(meta->buffer, info, flags))
+        return FALSE;
+    *data = info->data + meta->offset[plane];
+    *stride = meta->stride[plane];
+    return TRUE;
+}
+
+static gboolean slow_unmap(GstVideoMeta *meta, guint plane, GstMapInfo *info)
+{
+    guint64 index = GST_BUFFER_OFFSET(meta->buffer);
+
+    if (plane == 0 && index < last_done.exchange(index))
+        completed_out_of_order++;
+    gst_buffer_unmap(meta->buffer, info);
+    return TRUE;
+}
+
+static GstPadProbeReturn on_slow_frame(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    const GstVideoInfo *vinfo = (const GstVideoInfo *)data;
+    GstBuffer *buf = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+    GstVideoMeta *meta = gst_buffer_get_video_meta(buf);
+
+    GST_PAD_PROBE_INFO_DATA(info) = buf;
+    if (meta == NULL)
+        meta = gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE, GST_VIDEO_INFO_FORMAT(vinfo),
+                                              GST_VIDEO_INFO_WIDTH(vinfo), GST_VIDEO_INFO_HEIGHT(vinfo),
+                                              GST_VIDEO_INFO_N_PLANES(vinfo), vinfo->offset,
+                                              vinfo->stride);
+    meta->map = slow_map;
+    meta->unmap = slow_unmap;
+    return GST_PAD_PROBE_OK;
+}
+
+// 多个工作线程并行处理且完成顺序被打乱时，输出仍须保持输入顺序
+TEST_F(MyFilterTest, WorkerPoolKeepsOrder)
+{
+    GstVideoInfo vinfo;
+
+    completed_out_of_order = 0;
+    last_done = 0;
+    gst_video_info_set_format(&vinfo, GST_VIDEO_FORMAT_GRAY8, 64, 48);
+
+    launch("videotestsrc num-buffers=100 ! video/x-raw,format=GRAY8,width=64,height=48 ! "
+           "my_filter name=filter silent=true invert=true workers=4 max-in-flight=8 ! fakesink name=sink");
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    GstPad *pad = gst_element_get_static_pad(filter, "sink");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_slow_frame, &vinfo, NULL);
+    gst_object_unref(pad);
+    gst_object_unref(filter);
+
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_GT(completed_out_of_order.load(), 0u);
+    EXPECT_EQ(handoff_count, 100u);
+    EXPECT_TRUE(pts_in_order);
+}
+
+// 按条带并行反色：黑色 GRAY8 帧的每个字节都应变为 255
+TEST_F(MyFilterTest, SliceThreadedInvert)
+{
+    launch("videotestsrc num-buffers=10 pattern=black ! video/x-raw,format=GRAY8,width=320,height=240 ! "
+           "my_filter silent=true invert=true slices=4 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 10u);
+    EXPECT_EQ(first_byte, 255);
+    EXPECT_EQ(last_byte, 255);
+}
+
+// fakesink 不支持 GstVideoCropMeta，ROI 区域被复制到更小的帧中
+TEST_F(MyFilterTest, RoiCopiedWithoutCropMeta)
+{
+    launch("videotestsrc num-buffers=10 ! video/x-raw,format=GRAY8,width=320,height=240 ! "
+           "my_filter silent=true roi-x=10 roi-y=20 roi-width=100 roi-height=50 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 10u);
+    EXPECT_EQ(last_size, 100u * 50u);
+}
+
+// 模拟提供缓冲池的下游：在 fakesink 的 sink pad 上直接应答 ALLOCATION 查询，
+// 可选地声明支持 GstVideoCropMeta，并记录收到的缓冲区是否带裁剪元数据
+struct Downstream
+{
+    GstBufferPool *pool;
+    gboolean crop_meta;
+    guint cropped;
+};
+
+static GstPadProbeReturn on_downstream_allocation(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstQuery *query = GST_PAD_PROBE_INFO_QUERY(info);
+    Downstream *downstream = (Downstream *)data;
+    GstCaps *caps;
+    GstVideoInfo vinfo;
+
+    if (GST_QUERY_TYPE(query) != GST_QUERY_ALLOCATION)
+        return GST_PAD_PROBE_OK;
+    gst_query_parse_allocation(query, &caps, NULL);
+    if (caps == NULL || !gst_video_info_from_caps(&vinfo, caps))
+        return GST_PAD_PROBE_OK;
+
+    gst_query_add_allocation_pool(query, downstream->pool, GST_VIDEO_INFO_SIZE(&vinfo), 2, 0);
+    if (downstream->crop_meta)
+        gst_query_add_allocation_meta(query, GST_VIDEO_CROP_META_API_TYPE, NULL);
+    return GST_PAD_PROBE_HANDLED;
+}
+
+static GstPadProbeReturn on_downstream_buffer(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstVideoCropMeta *meta = gst_buffer_get_video_crop_meta(GST_PAD_PROBE_INFO_BUFFER(info));
+    Downstream *downstream = (Downstream *)data;
+
+    if (meta && meta->x == 10 && meta->y == 20 && meta->width == 100 && meta->height == 50)
+        downstream->cropped++;
+    return GST_PAD_PROBE_OK;
+}
+
+class AllocationTest : public MyFilterTest
+{
+protected:
+    GstBufferPool *upstream_pool;
+    Downstream downstream;
+    PoolUsage usage;
+
+    void SetUp() override
+    {
+        MyFilterTest::SetUp();
+        upstream_pool = nullptr;
+        downstream.pool = gst_video_buffer_pool_new();
+        downstream.crop_meta = FALSE;
+        downstream.cropped = 0;
+    }
+
+    void TearDown() override
+    {
+        MyFilterTest::TearDown();
+        if (upstream_pool)
+            gst_object_unref(upstream_pool);
+        gst_object_unref(downstream.pool);
+    }
+
+    // 320x240 GRAY8 输入，ROI 为 100x50+10+20
+    void run_roi()
+    {
+        launch("videotestsrc name=src num-buffers=10 ! video/x-raw,format=GRAY8,width=320,height=240 ! "
+               "my_filter name=filter silent=true roi-x=10 roi-y=20 roi-width=100 roi-height=50 ! "
+               "fakesink name=sink enable-last-sample=false");
+        probe("src", "src", (GstPadProbeType)(GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PULL),
+              on_allocation, &upstream_pool);
+        probe("filter", "sink", GST_PAD_PROBE_TYPE_BUFFER, on_pool_buffer, &usage);
+        probe("sink", "sink", GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM, on_downstream_allocation, &downstream);
+        probe("sink", "sink", GST_PAD_PROBE_TYPE_BUFFER, on_downstream_buffer, &downstream);
+        ASSERT_TRUE(run_to_eos());
+        EXPECT_EQ(handoff_count, 10u);
+    }
+
+    void probe(const gchar *element, const gchar *pad_name, GstPadProbeType type,
+               GstPadProbeCallback callback, gpointer data)
+    {
+        GstElement *e = gst_bin_get_by_name(GST_BIN(pipeline), element);
+        GstPad *pad = gst_element_get_static_pad(e, pad_name);
+
+        gst_pad_add_probe(pad, type, callback, data, NULL);
+        gst_object_unref(pad);
+        gst_object_unref(e);
+    }
+};
+
+// 下游支持裁剪元数据：输入输出 caps 相同，下游的缓冲池透传给上游，
+// 整帧带着裁剪元数据到达下游
+TEST_F(AllocationTest, CropMetaUsesDownstreamPool)
+{
+    downstream.crop_meta = TRUE;
+    run_roi();
+
+    EXPECT_EQ(upstream_pool, downstream.pool);
+    EXPECT_EQ(usage.pools, std::set<GstBufferPool *>({downstream.pool}));
+    EXPECT_EQ(last_size, 320u * 240u);
+    EXPECT_EQ(downstream.cropped, 10u);
+}
+
+// 下游不支持裁剪元数据：ROI 被复制到 crop_pool 的小帧中，下游的缓冲池对应的是
+// 输出 caps，不能交给上游；上游得到本元素按输入尺寸提议的缓冲池
+TEST_F(AllocationTest, RoiCopyProposesOwnPool)
+{
+    GstStructure *config;
+    GstCaps *caps;
+    guint size;
+
+    run_roi();
+
+    ASSERT_NE(upstream_pool, nullptr);
+    EXPECT_NE(upstream_pool, downstream.pool);
+    EXPECT_TRUE(GST_IS_VIDEO_BUFFER_POOL(upstream_pool));
+    config = gst_buffer_pool_get_config(upstream_pool);
+    ASSERT_TRUE(gst_buffer_pool_config_get_params(config, &caps, &size, NULL, NULL));
+    EXPECT_GE(size, 320u * 240u);
+    gst_structure_free(config);
+
+    EXPECT_EQ(usage.pools, std::set<GstBufferPool *>({upstream_pool}));
+    EXPECT_EQ(last_size, 100u * 50u);
+    EXPECT_EQ(downstream.cropped, 0u);
+}
+
+// 每帧在第 16..63 列（行内未抽样的区域）写入不同的值
+static GstPadProbeReturn on_paint_unsampled(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    guint8 value = (guint8)(GST_BUFFER_OFFSET(buf) * 40);
+    GstMapInfo map;
+
+    buf = gst_buffer_make_writable(buf);
+    GST_PAD_PROBE_INFO_DATA(info) = buf;
+    if (gst_buffer_map(buf, &map, GST_MAP_WRITE))
+    {
+        for (gsize row = 0; row < 64; row++)
+            memset(map.data + row * 128 + 16, value, 48);
+        gst_buffer_unmap(buf, &map);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// 运动门限：静止画面只保留第一帧，随机噪声画面全部保留
+TEST_F(MyFilterTest, MotionGateDropsStaticFrames)
+{
+    guint64 drops = 0;
+
+    launch("videotestsrc num-buffers=30 pattern=black ! my_filter name=filter silent=true motion-threshold=1 ! "
+           "fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 1u);
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    g_object_get(filter, "drops", &drops, NULL);
+    gst_object_unref(filter);
+    EXPECT_EQ(drops, 29u);
+}
+
+// 只有行内未被抽样的区域变化时，画面仍判为静止
+TEST_F(MyFilterTest, MotionGateSamplesColumns)
+{
+    launch("videotestsrc name=src num-buffers=10 pattern=black ! video/x-raw,format=GRAY8,width=128,height=64 ! "
+           "my_filter silent=true motion-threshold=1 ! fakesink name=sink");
+    GstElement *src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    GstPad *pad = gst_element_get_static_pad(src, "src");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_paint_unsampled, NULL, NULL);
+    gst_object_unref(pad);
+    gst_object_unref(src);
+
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 1u);
+}
+
+TEST_F(MyFilterTest, MotionGateKeepsMovingFrames)
+{
+    launch("videotestsrc num-buffers=30 pattern=snow ! my_filter silent=true motion-threshold=1 ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(handoff_count, 30u);
+}
+
+// POSITION 查询在元素内部应答：结果应等于最后推送到下游的缓冲区时间戳
+TEST_F(MyFilterTest, PositionAnsweredLocally)
+{
+    launch("videotestsrc num-buffers=30 ! my_filter name=filter silent=true ! fakesink name=sink");
+    ASSERT_TRUE(run_to_eos());
+
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+    ASSERT_NE(filter, nullptr);
+    GstPad *srcpad = gst_element_get_static_pad(filter, "src");
+    gint64 position = -1;
+
+    EXPECT_TRUE(gst_pad_query_position(srcpad, GST_FORMAT_TIME, &position));
+    EXPECT_EQ((GstClockTime)position, last_pts);
+
+    gst_object_unref(srcpad);
+    gst_object_unref(filter);
+}
+
+// DURATION 查询的缓存：测试用自己的 src pad 充当上游并统计收到的 DURATION 查询，
+// 自己的 sink pad 接收输出
+class DurationCacheTest : public ::testing::Test
+{
+protected:
+    GstElement *filter;
+    GstPad *src, *sink, *filter_src;
+    guint upstream_queries;
+    GstClockTime upstream_duration;
+
+    void SetUp() override
+    {
+        gst_init(nullptr, nullptr);
+        upstream_queries = 0;
+        upstream_duration = 10 * GST_SECOND;
+
+        filter = gst_element_factory_make("my_filter", nullptr);
+        ASSERT_NE(filter, nullptr);
+        g_object_set(filter, "silent", TRUE, NULL);
+        src = gst_pad_new("src", GST_PAD_SRC);
+        sink = gst_pad_new("sink", GST_PAD_SINK);
+        g_object_set_data(G_OBJECT(src), "test", this);
+        gst_pad_set_query_function(src, on_upstream_query);
+        gst_pad_set_event_function(sink, on_event);
+
+        GstPad *filter_sink = gst_element_get_static_pad(filter, "sink");
+        filter_src = gst_element_get_static_pad(filter, "src");
+        ASSERT_EQ(gst_pad_link(src, filter_sink), GST_PAD_LINK_OK);
+        ASSERT_EQ(gst_pad_link(filter_src, sink), GST_PAD_LINK_OK);
+        gst_object_unref(filter_sink);
+
+        gst_pad_set_active(src, TRUE);
+        gst_pad_set_active(sink, TRUE);
+        ASSERT_NE(gst_element_set_state(filter, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+
+        ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_stream_start("first")));
+        ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_caps(gst_caps_from_string(
+                                                "video/x-raw,format=GRAY8,width=16,height=16,framerate=30/1"))));
+        push_segment(GST_CLOCK_TIME_NONE);
+    }
+
+    void TearDown() override
+    {
+        gst_element_set_state(filter, GST_STATE_NULL);
+        gst_pad_set_active(src, FALSE);
+        gst_pad_set_active(sink, FALSE);
+        gst_object_unref(filter_src);
+        gst_object_unref(filter);
+        gst_object_unref(src);
+        gst_object_unref(sink);
+    }
+
+    static gboolean on_upstream_query(GstPad *pad, GstObject *parent, GstQuery *query)
+    {
+        DurationCacheTest *test = (DurationCacheTest *)g_object_get_data(G_OBJECT(pad), "test");
+
+        if (GST_QUERY_TYPE(query) != GST_QUERY_DURATION)
+            return gst_pad_query_default(pad, parent, query);
+        test->upstream_queries++;
+        gst_query_set_duration(query, GST_FORMAT_TIME, test->upstream_duration);
+        return TRUE;
+    }
+
+    static gboolean on_event(GstPad *pad, GstObject *parent, GstEvent *event)
+    {
+        gst_event_unref(event);
+        return TRUE;
+    }
+
+    void push_segment(GstClockTime duration)
+    {
+        GstSegment segment;
+
+        gst_segment_init(&segment, GST_FORMAT_TIME);
+        segment.duration = duration;
+        ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_segment(&segment)));
+    }
+
+    GstClockTime duration()
+    {
+        gint64 value = -1;
+
+        if (!gst_pad_query_duration(filter_src, GST_FORMAT_TIME, &value))
+            return GST_CLOCK_TIME_NONE;
+        return value;
+    }
+};
+
+// 第一次查询向上游获取时长，之后直接使用缓存，上游的变化在失效之前不可见
+TEST_F(DurationCacheTest, CachedAfterFirstQuery)
+{
+    EXPECT_EQ(duration(), 10 * GST_SECOND);
+    EXPECT_EQ(upstream_queries, 1u);
+
+    upstream_duration = 20 * GST_SECOND;
+    EXPECT_EQ(duration(), 10 * GST_SECOND);
+    EXPECT_EQ(duration(), 10 * GST_SECOND);
+    EXPECT_EQ(upstream_queries, 1u);
+}
+
+// 新的 segment 使缓存失效：不带时长时重新询问上游，带时长时直接使用 segment 中的值
+TEST_F(DurationCacheTest, SegmentInvalidatesCache)
+{
+    EXPECT_EQ(duration(), 10 * GST_SECOND);
+    upstream_duration = 20 * GST_SECOND;
+
+    push_segment(GST_CLOCK_TIME_NONE);
+    EXPECT_EQ(duration(), 20 * GST_SECOND);
+    EXPECT_EQ(upstream_queries, 2u);
+
+    push_segment(5 * GST_SECOND);
+    EXPECT_EQ(duration(), 5 * GST_SECOND);
+    EXPECT_EQ(upstream_queries, 2u);
+}
+
+// 新的流使缓存失效
+TEST_F(DurationCacheTest, StreamStartInvalidatesCache)
+{
+    EXPECT_EQ(duration(), 10 * GST_SECOND);
+    upstream_duration = 30 * GST_SECOND;
+
+    ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_stream_start("second")));
+    EXPECT_EQ(duration(), 30 * GST_SECOND);
+    EXPECT_EQ(upstream_queries, 2u);
+    EXPECT_EQ(duration(), 30 * GST_SECOND);
+    EXPECT_EQ(upstream_queries, 2u);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,504 @@
+#include <gst/gst.h>
+#include <gtest/gtest.h>
+
+// plugin_template 扇出测试：每个分支用一个 fakesink 统计收到的缓冲区
+class FanOutTest : public ::testing::Test
+{
+protected:
+    GstElement *pipeline;
+    guint fast_count, slow_count;
+
+    void SetUp() override
+    {
+        gst_init(nullptr, nullptr);
+        pipeline = nullptr;
+        fast_count = 0;
+        slow_count = 0;
+    }
+
+    void TearDown() override
+    {
+        if (pipeline)
+        {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+        }
+    }
+
+    void launch(const gchar *description)
+    {
+        GError *error = nullptr;
+
+        pipeline = gst_parse_launch(description, &error);
+        ASSERT_EQ(error, nullptr) << error->message;
+        ASSERT_NE(pipeline, nullptr);
+
+        connect("fast", &fast_count);
+        connect("slow", &slow_count);
+    }
+
+    void connect(const gchar *name, guint *counter)
+    {
+        GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), name);
+
+        if (sink == nullptr)
+            return;
+        g_object_set(sink, "signal-handoffs", TRUE, NULL);
+        g_signal_connect(sink, "handoff", G_CALLBACK(on_handoff), counter);
+        gst_object_unref(sink);
+    }
+
+    gboolean run_to_eos()
+    {
+        GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+        GstMessage *msg;
+        gboolean eos;
+
+        if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+        {
+            gst_object_unref(bus);
+            return FALSE;
+        }
+
+        msg = gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND,
+                                         (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        eos = msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+        if (msg)
+            gst_message_unref(msg);
+        gst_object_unref(bus);
+        return eos;
+    }
+
+    static void on_handoff(GstElement *sink, GstBuffer *buf, GstPad *pad, gpointer data)
+    {
+        g_atomic_int_inc((gint *)data);
+    }
+};
+
+// 不丢帧时每个分支都收到全部缓冲区
+TEST_F(FanOutTest, EveryBranchGetsEveryBuffer)
+{
+    launch("videotestsrc num-buffers=50 ! plugin_template name=t silent=true leaky=no "
+           "t. ! fakesink name=fast  t. ! fakesink name=slow");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(fast_count, 50u);
+    EXPECT_EQ(slow_count, 50u);
+}
+
+// 慢分支阻塞时快分支不受影响：慢分支的 sink pad 一直阻塞到快分支收到 EOS，
+// 期间上游继续推送，快分支收到全部缓冲区，慢分支的队列只保留最新的几个。
+// 断言只依赖事件顺序和计数，不依赖调度速度
+struct Gate
+{
+    GMutex lock;
+    GCond cond;
+    gboolean open;
+};
+
+static GstPadProbeReturn on_fast_eos(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    Gate *gate = (Gate *)data;
+
+    if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_EOS)
+    {
+        g_mutex_lock(&gate->lock);
+        gate->open = TRUE;
+        g_cond_broadcast(&gate->cond);
+        g_mutex_unlock(&gate->lock);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn on_slow_buffer(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    Gate *gate = (Gate *)data;
+    gint64 end = g_get_monotonic_time() + 10 * G_TIME_SPAN_SECOND;
+
+    g_mutex_lock(&gate->lock);
+    while (!gate->open && g_cond_wait_until(&gate->cond, &gate->lock, end))
+        ;
+    g_mutex_unlock(&gate->lock);
+    return GST_PAD_PROBE_OK;
+}
+
+TEST_F(FanOutTest, SlowBranchDoesNotStallOthers)
+{
+    Gate gate;
+
+    g_mutex_init(&gate.lock);
+    g_cond_init(&gate.cond);
+    gate.open = FALSE;
+
+    // 实时源不预滚，快分支不会因为等待 PLAYING 而丢缓冲区
+    launch("videotestsrc is-live=true num-buffers=50 ! video/x-raw,width=64,height=48,framerate=50/1 ! "
+           "plugin_template name=t silent=true leaky=downstream max-size-buffers=2 "
+           "t. ! fakesink name=fast  t. ! fakesink name=slow");
+
+    GstElement *fast = gst_bin_get_by_name(GST_BIN(pipeline), "fast");
+    GstElement *slow = gst_bin_get_by_name(GST_BIN(pipeline), "slow");
+    GstPad *fast_pad = gst_element_get_static_pad(fast, "sink");
+    GstPad *slow_pad = gst_element_get_static_pad(slow, "sink");
+    gst_pad_add_probe(fast_pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, on_fast_eos, &gate, NULL);
+    gst_pad_add_probe(slow_pad, GST_PAD_PROBE_TYPE_BUFFER, on_slow_buffer, &gate, NULL);
+
+    EXPECT_TRUE(run_to_eos());
+    // 结束前先把管道停下，探针回调不再访问 gate
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(fast_pad);
+    gst_object_unref(slow_pad);
+    gst_object_unref(fast);
+    gst_object_unref(slow);
+
+    GstElement *tee = gst_bin_get_by_name(GST_BIN(pipeline), "t");
+    guint64 dropped = 0;
+
+    g_object_get(tee, "dropped", &dropped, NULL);
+    gst_object_unref(tee);
+
+    // 快分支一个不丢；慢分支最多收到阻塞中的那一个加上队列里的 2 个
+    EXPECT_EQ(fast_count, 50u);
+    EXPECT_LE(slow_count, 3u);
+    EXPECT_EQ(dropped, 50u - slow_count);
+
+    g_cond_clear(&gate.cond);
+    g_mutex_clear(&gate.lock);
+}
+
+// 分支的 ALLOCATION 应答：在 fakesink 的 sink pad 上直接回答，pool 为空时只给出对齐要求
+struct BranchAllocation
+{
+    GstBufferPool *pool;
+    gsize align;
+};
+
+static GstPadProbeReturn on_branch_allocation(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstQuery *query = GST_PAD_PROBE_INFO_QUERY(info);
+    BranchAllocation *branch = (BranchAllocation *)data;
+    GstAllocationParams params;
+
+    if (GST_QUERY_TYPE(query) != GST_QUERY_ALLOCATION)
+        return GST_PAD_PROBE_OK;
+    if (branch->pool)
+        gst_query_add_allocation_pool(query, branch->pool, 4096, 2, 0);
+    gst_allocation_params_init(&params);
+    params.align = branch->align;
+    gst_query_add_allocation_param(query, NULL, &params);
+    return GST_PAD_PROBE_HANDLED;
+}
+
+// 上游收到的合并结果
+struct UpstreamAllocation
+{
+    gboolean answered;
+    guint n_pools;
+    GstBufferPool *pool;
+    gsize align;
+};
+
+static GstPadProbeReturn on_upstream_allocation(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstQuery *query = GST_PAD_PROBE_INFO_QUERY(info);
+    UpstreamAllocation *up = (UpstreamAllocation *)data;
+    GstAllocationParams params;
+
+    if (GST_QUERY_TYPE(query) != GST_QUERY_ALLOCATION || up->answered)
+        return GST_PAD_PROBE_OK;
+    up->answered = TRUE;
+    up->n_pools = gst_query_get_n_allocation_pools(query);
+    if (up->n_pools > 0)
+        gst_query_parse_nth_allocation_pool(query, 0, &up->pool, NULL, NULL, NULL);
+    if (gst_query_get_n_allocation_params(query) > 0)
+    {
+        gst_query_parse_nth_allocation_param(query, 0, NULL, &params);
+        up->align = params.align;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+class AllocationTest : public FanOutTest
+{
+protected:
+    GstBufferPool *pools[2];
+    UpstreamAllocation up;
+
+    void SetUp() override
+    {
+        FanOutTest::SetUp();
+        pools[0] = gst_buffer_pool_new();
+        pools[1] = gst_buffer_pool_new();
+        up = {FALSE, 0, nullptr, 0};
+    }
+
+    void TearDown() override
+    {
+        FanOutTest::TearDown();
+        if (up.pool)
+            gst_object_unref(up.pool);
+        gst_object_unref(pools[0]);
+        gst_object_unref(pools[1]);
+    }
+
+    void answer(const gchar *name, BranchAllocation *branch)
+    {
+        GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), name);
+        GstPad *pad = gst_element_get_static_pad(sink, "sink");
+
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM, on_branch_allocation, branch, NULL);
+        gst_object_unref(pad);
+        gst_object_unref(sink);
+    }
+
+    // 两个分支分别按 fast、slow 应答，运行到 EOS，记录上游收到的结果
+    void run(BranchAllocation *fast, BranchAllocation *slow)
+    {
+        launch("videotestsrc name=src num-buffers=5 ! plugin_template name=t silent=true "
+               "t. ! fakesink name=fast  t. ! fakesink name=slow");
+        answer("fast", fast);
+        answer("slow", slow);
+
+        GstElement *src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+        GstPad *pad = gst_element_get_static_pad(src, "src");
+        gst_pad_add_probe(pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PULL),
+                          on_upstream_allocation, &up, NULL);
+        gst_object_unref(pad);
+        gst_object_unref(src);
+
+        ASSERT_TRUE(run_to_eos());
+        ASSERT_TRUE(up.answered);
+    }
+};
+
+// 两个分支都应答时，任何一个分支的缓冲池都不能交给上游，无论缓冲池出现在哪个分支；
+// 对齐取最严格的要求
+TEST_F(AllocationTest, PoolNotPassedWhenTwoBranchesAnswer)
+{
+    BranchAllocation with_pool = {pools[0], 15}, without_pool = {nullptr, 63};
+
+    run(&with_pool, &without_pool);
+    EXPECT_EQ(up.pool, nullptr);
+    EXPECT_EQ(up.align, 63u);
+}
+
+TEST_F(AllocationTest, PoolNotPassedWhenOnlyLaterBranchHasOne)
+{
+    BranchAllocation without_pool = {nullptr, 15}, with_pool = {pools[0], 63};
+
+    run(&without_pool, &with_pool);
+    EXPECT_EQ(up.pool, nullptr);
+    EXPECT_EQ(up.align, 63u);
+}
+
+TEST_F(AllocationTest, PoolNotPassedWhenBothBranchesHaveOne)
+{
+    BranchAllocation fast = {pools[0], 15}, slow = {pools[1], 31};
+
+    run(&fast, &slow);
+    ASSERT_EQ(up.n_pools, 1u);
+    EXPECT_EQ(up.pool, nullptr);
+    EXPECT_EQ(up.align, 31u);
+}
+
+// 只有一个分支时它的缓冲池原样透传
+TEST_F(AllocationTest, SingleBranchPoolPassedThrough)
+{
+    BranchAllocation fast = {pools[0], 15};
+
+    launch("videotestsrc name=src num-buffers=5 ! plugin_template name=t silent=true "
+           "t. ! fakesink name=fast");
+    answer("fast", &fast);
+
+    GstElement *src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    GstPad *pad = gst_element_get_static_pad(src, "src");
+    gst_pad_add_probe(pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PULL),
+                      on_upstream_allocation, &up, NULL);
+    gst_object_unref(pad);
+    gst_object_unref(src);
+
+    ASSERT_TRUE(run_to_eos());
+    ASSERT_TRUE(up.answered);
+    EXPECT_EQ(up.pool, pools[0]);
+}
+
+// ring_queue 容量很小时阻塞上游，缓冲区和 EOS 都不丢
+TEST_F(FanOutTest, RingQueueDeliversEverything)
+{
+    launch("fakesrc num-buffers=200 sizetype=fixed sizemax=64 ! ring_queue max-size-buffers=2 "
+           "! identity sleep-time=100 ! fakesink name=fast");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_EQ(fast_count, 200u);
+}
+
+// ring_queue 满时丢弃新缓冲区，统计与下游收到的数量一致
+TEST_F(FanOutTest, RingQueueLeaksUpstream)
+{
+    launch("videotestsrc num-buffers=50 ! ring_queue name=q leaky=upstream max-size-buffers=2 "
+           "! identity sleep-time=20000 ! fakesink name=slow");
+    ASSERT_TRUE(run_to_eos());
+    EXPECT_LT(slow_count, 50u);
+
+    GstElement *q = gst_bin_get_by_name(GST_BIN(pipeline), "q");
+    guint dropped = 0;
+
+    g_object_get(q, "dropped", &dropped, NULL);
+    EXPECT_EQ(dropped, 50u - slow_count);
+    gst_object_unref(q);
+}
+
+// ring_queue 的串行查询：测试用自己的 src pad 和 sink pad 夹住队列，
+// sink pad 统计收到的缓冲区、EOS 和查询
+class RingQueueQueryTest : public ::testing::Test
+{
+protected:
+    GstElement *queue;
+    GstPad *src, *sink;
+    GMutex lock;
+    GCond cond;
+    guint buffers, eos, queries;
+
+    void SetUp() override
+    {
+        gst_init(nullptr, nullptr);
+        g_mutex_init(&lock);
+        g_cond_init(&cond);
+        buffers = eos = queries = 0;
+
+        queue = gst_element_factory_make("ring_queue", nullptr);
+        ASSERT_NE(queue, nullptr);
+        src = gst_pad_new("src", GST_PAD_SRC);
+        sink = gst_pad_new("sink", GST_PAD_SINK);
+        g_object_set_data(G_OBJECT(sink), "test", this);
+        gst_pad_set_chain_function(sink, on_chain);
+        gst_pad_set_event_function(sink, on_event);
+        gst_pad_set_query_function(sink, on_query);
+
+        GstPad *qsink = gst_element_get_static_pad(queue, "sink");
+        GstPad *qsrc = gst_element_get_static_pad(queue, "src");
+        ASSERT_EQ(gst_pad_link(src, qsink), GST_PAD_LINK_OK);
+        ASSERT_EQ(gst_pad_link(qsrc, sink), GST_PAD_LINK_OK);
+        gst_object_unref(qsink);
+        gst_object_unref(qsrc);
+
+        gst_pad_set_active(src, TRUE);
+        gst_pad_set_active(sink, TRUE);
+        ASSERT_NE(gst_element_set_state(queue, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+    }
+
+    void TearDown() override
+    {
+        gst_element_set_state(queue, GST_STATE_NULL);
+        gst_pad_set_active(src, FALSE);
+        gst_pad_set_active(sink, FALSE);
+        gst_object_unref(queue);
+        gst_object_unref(src);
+        gst_object_unref(sink);
+        g_cond_clear(&cond);
+        g_mutex_clear(&lock);
+    }
+
+    static RingQueueQueryTest *from(GstPad *pad)
+    {
+        return (RingQueueQueryTest *)g_object_get_data(G_OBJECT(pad), "test");
+    }
+
+    static GstFlowReturn on_chain(GstPad *pad, GstObject *parent, GstBuffer *buf)
+    {
+        RingQueueQueryTest *test = from(pad);
+
+        gst_buffer_unref(buf);
+        g_mutex_lock(&test->lock);
+        test->buffers++;
+        g_mutex_unlock(&test->lock);
+        return GST_FLOW_OK;
+    }
+
+    static gboolean on_event(GstPad *pad, GstObject *parent, GstEvent *event)
+    {
+        RingQueueQueryTest *test = from(pad);
+
+        if (GST_EVENT_TYPE(event) == GST_EVENT_EOS)
+        {
+            g_mutex_lock(&test->lock);
+            test->eos++;
+            g_cond_broadcast(&test->cond);
+            g_mutex_unlock(&test->lock);
+        }
+        gst_event_unref(event);
+        return TRUE;
+    }
+
+    static gboolean on_query(GstPad *pad, GstObject *parent, GstQuery *query)
+    {
+        RingQueueQueryTest *test = from(pad);
+
+        if (!GST_QUERY_IS_SERIALIZED(query))
+            return gst_pad_query_default(pad, parent, query);
+        g_mutex_lock(&test->lock);
+        test->queries++;
+        g_mutex_unlock(&test->lock);
+        return TRUE;
+    }
+
+    // 推送一段流：stream-start、caps、segment、n 个缓冲区和 EOS
+    void push_stream(const gchar *id, guint n)
+    {
+        GstSegment segment;
+
+        gst_segment_init(&segment, GST_FORMAT_TIME);
+        ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_stream_start(id)));
+        ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_caps(gst_caps_new_empty_simple("test/x-data"))));
+        ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_segment(&segment)));
+        for (guint i = 0; i < n; i++)
+            ASSERT_EQ(gst_pad_push(src, gst_buffer_new_allocate(NULL, 64, NULL)), GST_FLOW_OK);
+    }
+
+    // 等待下游收到第 count 个 EOS
+    gboolean wait_eos(guint count)
+    {
+        gint64 end = g_get_monotonic_time() + 5 * G_TIME_SPAN_SECOND;
+        gboolean ok = TRUE;
+
+        g_mutex_lock(&lock);
+        while (eos < count && ok)
+            ok = g_cond_wait_until(&cond, &lock, end);
+        g_mutex_unlock(&lock);
+        return ok;
+    }
+
+    gboolean drain()
+    {
+        GstQuery *query = gst_query_new_drain();
+        gboolean res = gst_pad_peer_query(src, query);
+
+        gst_query_unref(query);
+        return res;
+    }
+};
+
+// EOS 之后任务已经停下，串行查询不进入队列，直接失败；调用者随后释放查询。
+// 新的 stream-start 重启任务后，只有新流中的查询被回答，旧查询不会被再次访问
+TEST_F(RingQueueQueryTest, QueryAfterEosIsNotAnsweredLater)
+{
+    push_stream("first", 5);
+    EXPECT_TRUE(drain());
+    ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_eos()));
+    ASSERT_TRUE(wait_eos(1));
+
+    EXPECT_FALSE(drain());
+
+    push_stream("second", 5);
+    EXPECT_TRUE(drain());
+    ASSERT_TRUE(gst_pad_push_event(src, gst_event_new_eos()));
+    ASSERT_TRUE(wait_eos(2));
+
+    g_mutex_lock(&lock);
+    EXPECT_EQ(buffers, 10u);
+    EXPECT_EQ(queries, 2u);
+    g_mutex_unlock(&lock);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
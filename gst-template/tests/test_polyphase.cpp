@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gstpolyphase.h"
+
+struct Ratio
+{
+    guint in_rate, out_rate;
+};
+
+// 输入立体声正弦，输出应与新采样率下的同一正弦一致（延迟已补偿）
+class PolyphaseTest : public ::testing::TestWithParam<Ratio>
+{
+protected:
+    static constexpr double FREQ = 1000.0, AMPLITUDE = 0.5;
+
+    std::vector<gfloat> resample(guint in_frames)
+    {
+        Ratio ratio = GetParam();
+        GstPolyphaseBank *bank = gst_polyphase_bank_get(ratio.in_rate, ratio.out_rate, GST_POLYPHASE_QUALITY_HIGH);
+        GstPolyphase *r = gst_polyphase_new(bank, 2);
+        std::vector<gfloat> in(in_frames * 2), out;
+        guint done = 0, chunk = 1;
+
+        gst_polyphase_bank_unref(bank);
+        for (guint i = 0; i < in_frames; i++)
+            in[2 * i] = in[2 * i + 1] = (gfloat)(AMPLITUDE * std::sin(2.0 * M_PI * FREQ * i / ratio.in_rate));
+
+        // 不规则的块长度，覆盖跨块边界的情况
+        while (done < in_frames)
+        {
+            guint n = std::min(chunk, in_frames - done);
+            size_t size = out.size();
+
+            out.resize(size + gst_polyphase_get_max_output(r, n) * 2);
+            size += gst_polyphase_process(r, &in[done * 2], n, out.data() + size) * 2;
+            out.resize(size);
+            done += n;
+            chunk = chunk * 5 % 3001 + 1;
+        }
+
+        size_t size = out.size();
+        out.resize(size + gst_polyphase_get_max_output(r, gst_polyphase_get_delay(r)) * 2);
+        size += gst_polyphase_drain(r, out.data() + size) * 2;
+        out.resize(size);
+
+        gst_polyphase_free(r);
+        return out;
+    }
+};
+
+TEST_P(PolyphaseTest, OutputLength)
+{
+    Ratio ratio = GetParam();
+    guint in_frames = 12345;
+    std::vector<gfloat> out = resample(in_frames);
+    guint64 expected = ((guint64)in_frames * ratio.out_rate + ratio.in_rate - 1) / ratio.in_rate;
+
+    EXPECT_EQ(out.size() / 2, expected);
+}
+
+TEST_P(PolyphaseTest, MatchesSine)
+{
+    Ratio ratio = GetParam();
+    std::vector<gfloat> out = resample(ratio.in_rate / 2);
+    guint frames = out.size() / 2;
+
+    // 两端受滤波器过渡影响，只比较中间部分
+    for (guint n = 200; n + 200 < frames; n++)
+    {
+        double expected = AMPLITUDE * std::sin(2.0 * M_PI * FREQ * n / ratio.out_rate);
+
+        ASSERT_NEAR(out[2 * n], expected, 2e-3) << "frame " << n;
+        ASSERT_EQ(out[2 * n], out[2 * n + 1]);
+    }
+}
+
+// 参数：一般有理比例与整数比例（插值、抽取）
+INSTANTIATE_TEST_SUITE_P(Ratios, PolyphaseTest,
+                         ::testing::Values(Ratio{44100, 48000}, Ratio{48000, 44100}, Ratio{48000, 96000},
+                                           Ratio{96000, 48000}, Ratio{96000, 44100}));
+
+// 相同化简比例、相同质量共用滤波器组
+TEST(PolyphaseBankTest, Cached)
+{
+    GstPolyphaseBank *a = gst_polyphase_bank_get(44100, 48000, GST_POLYPHASE_QUALITY_MEDIUM);
+    GstPolyphaseBank *b = gst_polyphase_bank_get(88200, 96000, GST_POLYPHASE_QUALITY_MEDIUM);
+    GstPolyphaseBank *c = gst_polyphase_bank_get(44100, 48000, GST_POLYPHASE_QUALITY_LOW);
+
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ(gst_polyphase_bank_get_taps(a) % 8, 0u);
+
+    gst_polyphase_bank_unref(a);
+    gst_polyphase_bank_unref(b);
+    gst_polyphase_bank_unref(c);
+}
+
+// 化简后相位数过多的比例不支持
+TEST(PolyphaseBankTest, RejectsHugeRatio)
+{
+    EXPECT_EQ(gst_polyphase_bank_get(44100, 48017, GST_POLYPHASE_QUALITY_HIGH), nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,271 @@
+#include <gst/gst.h>
+#include <gst/controller/controller.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+// transform_template 的元素测试：appsrc 推送常数样本，fakesink 收集输出，
+// 输出除以输入值就是每个样本实际使用的增益
+#define RATE 48000
+#define FRAMES 480 // 每个缓冲区 10ms
+#define INPUT 0.5f
+
+class TransformTest : public ::testing::Test
+{
+protected:
+    GstElement *pipeline;
+    GstElement *filter;
+    std::vector<gfloat> output;
+    std::vector<GstBuffer *> pushed;     // 测试持有输入缓冲区的引用，原位处理时必须复制
+    std::vector<gboolean> passed_through; // 输出缓冲区是否就是输入缓冲区
+    std::vector<GstClockTime> pts;
+    guint discont;
+
+    void SetUp() override
+    {
+        gst_init(nullptr, nullptr);
+        pipeline = nullptr;
+        filter = nullptr;
+        output.clear();
+        pushed.clear();
+        passed_through.clear();
+        pts.clear();
+        discont = 0;
+    }
+
+    void TearDown() override
+    {
+        for (GstBuffer *buf : pushed)
+            gst_buffer_unref(buf);
+        pushed.clear();
+        if (filter)
+            gst_object_unref(filter);
+        if (pipeline)
+        {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+        }
+    }
+
+    void launch(const gchar *properties)
+    {
+        GError *error = nullptr;
+        gchar *description = g_strdup_printf(
+            "appsrc name=src format=time max-bytes=0 "
+            "caps=audio/x-raw,format=F32LE,layout=interleaved,rate=%d,channels=1 ! "
+            "transform_template name=filter silent=true %s ! fakesink name=sink",
+            RATE, properties);
+
+        pipeline = gst_parse_launch(description, &error);
+        g_free(description);
+        ASSERT_EQ(error, nullptr) << error->message;
+        ASSERT_NE(pipeline, nullptr);
+
+        filter = gst_bin_get_by_name(GST_BIN(pipeline), "filter");
+        ASSERT_NE(filter, nullptr);
+
+        GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+        g_object_set(sink, "signal-handoffs", TRUE, NULL);
+        g_signal_connect(sink, "handoff", G_CALLBACK(on_handoff), this);
+        gst_object_unref(sink);
+    }
+
+    // 第 i 个缓冲区的 offset 为 i，时间戳连续
+    static GstBuffer *make_buffer(guint i)
+    {
+        GstBuffer *buf = gst_buffer_new_allocate(NULL, FRAMES * sizeof(gfloat), NULL);
+        GstMapInfo map;
+
+        gst_buffer_map(buf, &map, GST_MAP_WRITE);
+        for (guint j = 0; j < FRAMES; j++)
+            ((gfloat *)map.data)[j] = INPUT;
+        gst_buffer_unmap(buf, &map);
+
+        GST_BUFFER_OFFSET(buf) = i;
+        GST_BUFFER_PTS(buf) = gst_util_uint64_scale_int(i * FRAMES, GST_SECOND, RATE);
+        GST_BUFFER_DURATION(buf) = gst_util_uint64_scale_int((i + 1) * FRAMES, GST_SECOND, RATE) -
+                                   GST_BUFFER_PTS(buf);
+        return buf;
+    }
+
+    // 推送 n 个缓冲区和 EOS，运行到 EOS 或错误
+    gboolean run(guint n)
+    {
+        GstElement *src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+        GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+        GstFlowReturn ret;
+        GstMessage *msg;
+        gboolean eos;
+
+        // appsrc 只在启动之后接受数据
+        gst_element_set_state(pipeline, GST_STATE_PAUSED);
+        for (guint i = 0; i < n; i++)
+        {
+            GstBuffer *buf = make_buffer(i);
+
+            g_signal_emit_by_name(src, "push-buffer", buf, &ret);
+            pushed.push_back(buf);
+        }
+        g_signal_emit_by_name(src, "end-of-stream", &ret);
+        gst_object_unref(src);
+
+        if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+        {
+            gst_object_unref(bus);
+            return FALSE;
+        }
+
+        msg = gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND,
+                                         (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        eos = msg != nullptr && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+        if (msg)
+            gst_message_unref(msg);
+        gst_object_unref(bus);
+        return eos;
+    }
+
+    static void on_handoff(GstElement *sink, GstBuffer *buf, GstPad *pad, gpointer data)
+    {
+        TransformTest *test = (TransformTest *)data;
+        GstMapInfo map;
+
+        gst_buffer_map(buf, &map, GST_MAP_READ);
+        test->output.insert(test->output.end(), (gfloat *)map.data,
+                            (gfloat *)(map.data + map.size));
+        gst_buffer_unmap(buf, &map);
+
+        test->passed_through.push_back(buf == test->pushed[GST_BUFFER_OFFSET(buf)]);
+        test->pts.push_back(GST_BUFFER_PTS(buf));
+        if (GST_BUFFER_IS_DISCONT(buf))
+            test->discont++;
+    }
+
+    // gain 的控制曲线：0 秒时为 1.0，1 秒时为 3.0，线性插值
+    // direct binding 把 [0, 1] 映射到属性范围 [0, 10]
+    void control_gain()
+    {
+        GstControlSource *cs = gst_interpolation_control_source_new();
+
+        g_object_set(cs, "mode", GST_INTERPOLATION_MODE_LINEAR, NULL);
+        gst_timed_value_control_source_set(GST_TIMED_VALUE_CONTROL_SOURCE(cs), 0, 0.1);
+        gst_timed_value_control_source_set(GST_TIMED_VALUE_CONTROL_SOURCE(cs), GST_SECOND, 0.3);
+        gst_object_add_control_binding(GST_OBJECT(filter),
+                                       gst_direct_control_binding_new(GST_OBJECT(filter), "gain", cs));
+        gst_object_unref(cs);
+    }
+
+    static gdouble controlled_gain(guint frame)
+    {
+        return 1.0 + 2.0 * frame / RATE;
+    }
+};
+
+// control-interval=0：每个缓冲区同步一次控制器，缓冲区内从上一个缓冲区的增益
+// 线性过渡到本缓冲区时间戳处的增益，所以每个缓冲区的第一个样本使用上一个时间戳的值
+TEST_F(TransformTest, ControllerSyncedPerBuffer)
+{
+    launch("control-interval=0");
+    control_gain();
+    ASSERT_TRUE(run(50));
+    ASSERT_EQ(output.size(), 50u * FRAMES);
+
+    EXPECT_NEAR(output[0], INPUT * controlled_gain(0), 1e-5);
+    for (guint k = 1; k < 50; k++)
+        EXPECT_NEAR(output[k * FRAMES], INPUT * controlled_gain((k - 1) * FRAMES), 1e-5) << "buffer " << k;
+
+    // 缓冲区内的误差不超过一个缓冲区时长内的增益变化
+    for (gsize i = 0; i < output.size(); i++)
+        ASSERT_NEAR(output[i], INPUT * controlled_gain(i), INPUT * 2.0 * FRAMES / RATE + 1e-5) << "frame " << i;
+}
+
+// control-interval 非零：按固定间隔采样控制曲线，控制点之间逐样本插值，
+// 线性曲线应逐样本还原
+TEST_F(TransformTest, ControllerSampledAtInterval)
+{
+    launch("control-interval=1000000");
+    control_gain();
+    ASSERT_TRUE(run(50));
+    ASSERT_EQ(output.size(), 50u * FRAMES);
+
+    for (gsize i = 0; i < output.size(); i++)
+        ASSERT_NEAR(output[i], INPUT * controlled_gain(i), 1e-4) << "frame " << i;
+}
+
+// isa 属性在启动时选择内核：每个级别（CPU 不支持的会回退到最高支持级别）
+// 的输出都应与标量内核一致
+TEST_F(TransformTest, EveryIsaMatchesScalar)
+{
+    static const gchar *levels[] = {"sse2", "avx2", "avx512", "auto"};
+    std::vector<gfloat> scalar;
+
+    launch("control-interval=1000000 isa=scalar");
+    control_gain();
+    ASSERT_TRUE(run(20));
+    scalar = output;
+    ASSERT_EQ(scalar.size(), 20u * FRAMES);
+
+    for (const gchar *level : levels)
+    {
+        gchar *properties = g_strdup_printf("control-interval=1000000 isa=%s", level);
+
+        TearDown();
+        SetUp();
+        launch(properties);
+        g_free(properties);
+        control_gain();
+        ASSERT_TRUE(run(20)) << level;
+        ASSERT_EQ(output.size(), scalar.size()) << level;
+        for (gsize i = 0; i < output.size(); i++)
+            ASSERT_NEAR(output[i], scalar[i], 1e-6) << level << " frame " << i;
+    }
+}
+
+// 第 10 个缓冲区之前把 gain 改为 2.0，第 20 个缓冲区之前改回 1.0
+static GstPadProbeReturn on_switch_gain(GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstElement *filter = GST_ELEMENT(data);
+
+    if (GST_BUFFER_OFFSET(buf) == 10)
+        g_object_set(filter, "gain", 2.0, NULL);
+    else if (GST_BUFFER_OFFSET(buf) == 20)
+        g_object_set(filter, "gain", 1.0, NULL);
+    return GST_PAD_PROBE_OK;
+}
+
+// 运行中切换 gain 1.0 -> 2.0 -> 1.0：gain 为 1.0 时直通，原样推送输入缓冲区；
+// 改变 gain 的缓冲区内从旧值过渡到新值，回到 1.0 的那个缓冲区仍要处理完过渡，
+// 下一个缓冲区才重新直通。输出样本和时间戳在切换处都不跳变
+TEST_F(TransformTest, PassthroughFollowsGain)
+{
+    launch("");
+    GstPad *sinkpad = gst_element_get_static_pad(filter, "sink");
+    gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, on_switch_gain, filter, NULL);
+    gst_object_unref(sinkpad);
+
+    ASSERT_TRUE(run(30));
+    ASSERT_EQ(output.size(), 30u * FRAMES);
+    ASSERT_EQ(passed_through.size(), 30u);
+
+    for (guint k = 0; k < 30; k++)
+        EXPECT_EQ(passed_through[k], k < 10 || k > 20) << "buffer " << k;
+
+    EXPECT_FLOAT_EQ(output[10 * FRAMES - 1], INPUT);
+    EXPECT_FLOAT_EQ(output[15 * FRAMES], 2.0f * INPUT);
+    EXPECT_FLOAT_EQ(output[21 * FRAMES], INPUT);
+
+    // 过渡中相邻样本的差不超过一个斜坡步长
+    for (gsize i = 1; i < output.size(); i++)
+        ASSERT_LE(std::fabs(output[i] - output[i - 1]), INPUT / FRAMES + 1e-6) << "frame " << i;
+
+    // 只有第一个缓冲区带 DISCONT，时间戳连续
+    EXPECT_LE(discont, 1u);
+    for (guint k = 0; k < 30; k++)
+        EXPECT_EQ(pts[k], gst_util_uint64_scale_int(k * FRAMES, GST_SECOND, RATE));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "gstvad.h"
+
+static const guint RATE = 16000;
+static const guint WINDOW = RATE / 100;
+
+// 交织的正弦，frames 帧，每个声道相同
+static std::vector<gfloat> sine(double amplitude, guint frames, guint ch = 1)
+{
+    std::vector<gfloat> data(frames * ch);
+
+    for (guint i = 0; i < frames; i++)
+        for (guint c = 0; c < ch; c++)
+            data[i * ch + c] = (gfloat)(amplitude * std::sin(2.0 * M_PI * 440.0 * i / RATE));
+    return data;
+}
+
+// 处理整段数据，记录每个状态变化及其帧位置
+struct Change
+{
+    GstVadEvent event;
+    gint64 frame;
+};
+
+static std::vector<Change> run(GstVad *vad, const std::vector<gfloat> &data, guint ch = 1)
+{
+    std::vector<Change> changes;
+    guint frames = data.size() / ch, done = 0;
+
+    while (done < frames) {
+        GstVadEvent event;
+        gint64 frame;
+        guint n = gst_vad_process(vad, data.data() + done * ch, frames - done, &event, &frame);
+
+        if (event != GST_VAD_EVENT_NONE)
+            changes.push_back({event, done + frame});
+        done += n;
+    }
+    return changes;
+}
+
+// SIMD 能量与标量结果一致，S16 的 -32768 也不溢出
+TEST(VadTest, EnergyMatchesScalar)
+{
+    std::vector<gint16> s16(1003);
+    std::vector<gfloat> f32(1003);
+
+    srand(7);
+    for (size_t i = 0; i < s16.size(); i++) {
+        s16[i] = (gint16)(rand() % 65536 - 32768);
+        f32[i] = s16[i] / 32768.0f;
+    }
+    s16[0] = s16[1] = -32768;
+    f32[0] = f32[1] = -1.0f;
+
+    for (guint n : {0u, 7u, 8u, 64u, 1003u}) {
+        EXPECT_DOUBLE_EQ(gst_vad_energy_func(GST_AUDIO_FORMAT_S16)(s16.data(), n),
+                         gst_vad_energy_func_scalar(GST_AUDIO_FORMAT_S16)(s16.data(), n));
+        EXPECT_NEAR(gst_vad_energy_func(GST_AUDIO_FORMAT_F32)(f32.data(), n),
+                    gst_vad_energy_func_scalar(GST_AUDIO_FORMAT_F32)(f32.data(), n), 1e-9);
+        EXPECT_NEAR(gst_vad_energy_func(GST_AUDIO_FORMAT_F32)(f32.data(), n),
+                    gst_vad_energy_func(GST_AUDIO_FORMAT_S16)(s16.data(), n), 1e-9);
+    }
+    EXPECT_EQ(gst_vad_energy_func(GST_AUDIO_FORMAT_U8), nullptr);
+    EXPECT_EQ(gst_vad_new(GST_AUDIO_FORMAT_F64, RATE, 1), nullptr);
+}
+
+// 静音 -> 语音 -> 静音，开始点在语音窗口起点，停止点在最后一个语音窗口末尾
+TEST(VadTest, StartAndStop)
+{
+    GstVad *vad = gst_vad_new(GST_AUDIO_FORMAT_F32, RATE, 1);
+    std::vector<gfloat> data(RATE * 2, 0.0f);
+    std::vector<gfloat> speech = sine(0.1, RATE / 2);
+
+    gst_vad_set_hangover(vad, RATE / 4);
+    std::copy(speech.begin(), speech.end(), data.begin() + RATE / 2);
+
+    EXPECT_FALSE(gst_vad_is_speech(vad));
+    std::vector<Change> changes = run(vad, data);
+    ASSERT_EQ(changes.size(), 2u);
+    EXPECT_EQ(changes[0].event, GST_VAD_EVENT_SPEECH_START);
+    EXPECT_EQ(changes[0].frame, RATE / 2);
+    EXPECT_EQ(changes[1].event, GST_VAD_EVENT_SPEECH_STOP);
+    EXPECT_EQ(changes[1].frame, RATE);
+    EXPECT_FALSE(gst_vad_is_speech(vad));
+    gst_vad_free(vad);
+}
+
+// 短于挂起时间的停顿不算静音
+TEST(VadTest, HangoverBridgesPauses)
+{
+    GstVad *vad = gst_vad_new(GST_AUDIO_FORMAT_F32, RATE, 2);
+    std::vector<gfloat> data = sine(0.1, RATE, 2);
+
+    gst_vad_set_hangover(vad, RATE / 5);
+    // 中间 100 ms 静音
+    std::fill(data.begin() + RATE / 2 * 2, data.begin() + (RATE / 2 + RATE / 10) * 2, 0.0f);
+
+    std::vector<Change> changes = run(vad, data, 2);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].event, GST_VAD_EVENT_SPEECH_START);
+    EXPECT_TRUE(gst_vad_is_speech(vad));
+    gst_vad_free(vad);
+}
+
+// 阈值按所有声道的 RMS 比较
+TEST(VadTest, Threshold)
+{
+    GstVad *vad = gst_vad_new(GST_AUDIO_FORMAT_F32, RATE, 1);
+    // 正弦 RMS = A / sqrt(2)，0.01 约为 -43 dBFS
+    std::vector<gfloat> quiet = sine(0.01, WINDOW * 10);
+
+    gst_vad_set_threshold(vad, -40.0);
+    EXPECT_TRUE(run(vad, quiet).empty());
+    gst_vad_set_threshold(vad, -46.0);
+    EXPECT_EQ(run(vad, quiet).size(), 1u);
+    gst_vad_free(vad);
+}
+
+// 停止点可以落在本次数据之前（挂起时间跨过了多次调用）
+TEST(VadTest, StopBeforeData)
+{
+    GstVad *vad = gst_vad_new(GST_AUDIO_FORMAT_S16, RATE, 1);
+    std::vector<gint16> loud(WINDOW * 2, 8000), silence(WINDOW * 3, 0);
+    GstVadEvent event;
+    gint64 frame;
+
+    gst_vad_set_hangover(vad, WINDOW * 4);
+    gst_vad_process(vad, loud.data(), loud.size(), &event, &frame);
+    EXPECT_EQ(event, GST_VAD_EVENT_SPEECH_START);
+    EXPECT_EQ(frame, 0);
+    EXPECT_EQ(gst_vad_process(vad, loud.data() + WINDOW, WINDOW, &event, &frame), WINDOW);
+    EXPECT_EQ(event, GST_VAD_EVENT_NONE);
+    EXPECT_EQ(gst_vad_process(vad, silence.data(), silence.size(), &event, &frame), WINDOW * 3);
+    EXPECT_EQ(event, GST_VAD_EVENT_NONE);
+    EXPECT_EQ(gst_vad_process(vad, silence.data(), silence.size(), &event, &frame), WINDOW);
+    EXPECT_EQ(event, GST_VAD_EVENT_SPEECH_STOP);
+    EXPECT_EQ(frame, -(gint64)WINDOW * 3);
+
+    gst_vad_reset(vad);
+    EXPECT_FALSE(gst_vad_is_speech(vad));
+    gst_vad_free(vad);
+}